@@ -0,0 +1,186 @@
+// Square-wave buzzer synthesis from timestamped sound timer transitions, and WAV output.
+
+#include "audio.h"
+#include <string.h>
+
+static uint64_t frame_sample(const Audio* a, uint64_t frame) {
+    return frame * a->sample_rate / AUDIO_FRAME_HZ;
+}
+
+// Phase step for 4000 * 2^((pitch - 64) / 48) pattern bits per second
+static uint32_t pattern_step(uint32_t sample_rate, uint8_t pitch) {
+    double rate = 4000.0;
+    int e = pitch - 64;
+    for (; e < 0; e += 48) rate *= 0.5;
+    for (; e >= 48; e -= 48) rate *= 2.0;
+    for (; e > 0; --e) rate *= 1.0145453349375237;   // 2^(1/48)
+    return (uint32_t)(rate / (AUDIO_PATTERN_BYTES * 8) * 4294967296.0 / sample_rate);
+}
+
+// Queue the producer's current state; false (state unchanged) if the ring is full.
+static bool push_state(Audio* a, uint64_t frame, const AudioEvent* state) {
+    AudioEvent ev = *state;
+    ev.sample = frame_sample(a, frame);
+    if (!spsc_ring_push(&a->events, &ev)) return false;
+    a->producer_state = ev;
+    return true;
+}
+
+bool audio_init(Audio* a, uint32_t sample_rate) {
+    memset(a, 0, sizeof(*a));
+    if (!spsc_ring_init(&a->events, AUDIO_EVENT_CAPACITY, sizeof(AudioEvent))) return false;
+    a->sample_rate = sample_rate;
+    a->tone_step = (uint32_t)(((uint64_t)AUDIO_TONE_HZ << 32) / sample_rate);
+    a->volume = AUDIO_VOLUME;
+    a->latency = sample_rate * 2 / AUDIO_FRAME_HZ;
+    atomic_init(&a->produced, 0);
+    return true;
+}
+
+void audio_destroy(Audio* a) {
+    spsc_ring_free(&a->events);
+}
+
+void audio_frame(Audio* a, uint64_t frame, bool on) {
+    if (on != a->producer_on) {
+        AudioEvent state = a->producer_state;
+        state.on = on;
+        // A full ring keeps producer_on unchanged, so the transition is retried next frame.
+        if (push_state(a, frame, &state)) a->producer_on = on;
+    }
+    atomic_store_explicit(&a->produced, frame_sample(a, frame + 1), memory_order_release);
+}
+
+void audio_pattern(Audio* a, uint64_t frame, const uint8_t pattern[AUDIO_PATTERN_BYTES], uint8_t pitch) {
+    const AudioEvent* cur = &a->producer_state;
+    if (cur->pattern_set && cur->pitch == pitch && memcmp(cur->pattern, pattern, AUDIO_PATTERN_BYTES) == 0) {
+        return;
+    }
+    AudioEvent state = *cur;
+    state.pattern_set = 1;
+    state.pitch = pitch;
+    memcpy(state.pattern, pattern, AUDIO_PATTERN_BYTES);
+    push_state(a, frame, &state);   // retried next frame if the ring is full
+}
+
+uint64_t audio_pending(Audio* a) {
+    uint64_t produced = atomic_load_explicit(&a->produced, memory_order_acquire);
+    return produced > a->position ? produced - a->position : 0;
+}
+
+void audio_render(Audio* a, int16_t* out, size_t n, bool realtime) {
+    if (realtime) {
+        // Keep the read position `latency` behind the producer; jump rather than drift when
+        // emulation runs ahead (turbo) or stalls.
+        uint64_t produced = atomic_load_explicit(&a->produced, memory_order_acquire);
+        uint64_t target = produced > a->latency ? produced - a->latency : 0;
+        uint64_t distance = target > a->position ? target - a->position : a->position - target;
+        if (distance > a->latency) {
+            a->position = target;
+            a->resyncs++;
+        }
+    }
+
+    AudioEvent next;
+    bool have_next = spsc_ring_peek(&a->events, &next);
+
+    for (size_t i = 0; i < n; ++i) {
+        // Apply every transition due at this sample (late ones apply immediately)
+        while (have_next && next.sample <= a->position) {
+            if (next.on && !a->on) a->phase = 0;
+            a->on = next.on != 0;
+            if (next.pattern_set) {
+                a->pattern_set = true;
+                memcpy(a->pattern, next.pattern, AUDIO_PATTERN_BYTES);
+                a->pattern_step = pattern_step(a->sample_rate, next.pitch);
+            }
+            spsc_ring_pop(&a->events, NULL);
+            have_next = spsc_ring_peek(&a->events, &next);
+        }
+
+        if (a->on && a->pattern_set) {
+            uint32_t bit = a->phase >> 25;   // 128 bits per period
+            bool high = (a->pattern[bit >> 3] >> (7 - (bit & 7))) & 1;
+            out[i] = high ? a->volume : (int16_t)-a->volume;
+            a->phase += a->pattern_step;
+        }
+        else if (a->on) {
+            out[i] = (a->phase < 0x80000000u) ? a->volume : (int16_t)-a->volume;
+            a->phase += a->tone_step;
+        }
+        else {
+            out[i] = 0;
+        }
+        a->position++;
+    }
+}
+
+static void put_u16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t* p, uint32_t v) {
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void wav_header(uint8_t h[44], uint32_t sample_rate, uint32_t data_bytes) {
+    memcpy(h, "RIFF", 4);
+    put_u32(h + 4, 36 + data_bytes);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    put_u32(h + 16, 16);                 // fmt chunk size
+    put_u16(h + 20, 1);                  // PCM
+    put_u16(h + 22, 1);                  // mono
+    put_u32(h + 24, sample_rate);
+    put_u32(h + 28, sample_rate * 2);    // byte rate
+    put_u16(h + 32, 2);                  // block align
+    put_u16(h + 34, 16);                 // bits per sample
+    memcpy(h + 36, "data", 4);
+    put_u32(h + 40, data_bytes);
+}
+
+bool audio_wav_open(AudioWav* w, const char* path, uint32_t sample_rate) {
+    memset(w, 0, sizeof(*w));
+#ifdef _MSC_VER
+    fopen_s(&w->file, path, "wb");
+#else
+    w->file = fopen(path, "wb");
+#endif
+    if (!w->file) {
+        fprintf(stderr, "Failed to create WAV file: %s\n", path);
+        return false;
+    }
+    w->sample_rate = sample_rate;
+
+    uint8_t header[44];
+    wav_header(header, sample_rate, 0);
+    return fwrite(header, sizeof(header), 1, w->file) == 1;
+}
+
+bool audio_wav_drain(AudioWav* w, Audio* a) {
+    int16_t buffer[1024];
+    uint8_t bytes[sizeof(buffer)];
+    uint64_t pending = audio_pending(a);
+
+    while (pending > 0) {
+        size_t n = pending < 1024 ? (size_t)pending : 1024;
+        audio_render(a, buffer, n, false);
+        for (size_t i = 0; i < n; ++i) put_u16(bytes + i * 2, (uint16_t)buffer[i]);
+        if (fwrite(bytes, 2, n, w->file) != n) return false;
+        w->samples += n;
+        pending -= n;
+    }
+    return true;
+}
+
+bool audio_wav_close(AudioWav* w) {
+    if (!w->file) return false;
+
+    uint8_t header[44];
+    wav_header(header, w->sample_rate, (uint32_t)(w->samples * 2));
+    bool ok = fseek(w->file, 0, SEEK_SET) == 0 && fwrite(header, sizeof(header), 1, w->file) == 1;
+    ok = (fclose(w->file) == 0) && ok;
+    w->file = NULL;
+    return ok;
+}
@@ -0,0 +1,92 @@
+// Buzzer audio: the emulation thread reports the sound timer state once per emulated 60Hz
+// frame; a consumer (the SDL audio callback, or a headless WAV writer) renders a square wave,
+// or an XO-CHIP sample pattern, from those timestamped transitions. The two sides only share
+// a lock-free ring.
+
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include "spsc_ring.h"
+
+#define AUDIO_DEFAULT_RATE   48000
+#define AUDIO_TONE_HZ        800     // same pitch the old Beep() used
+#define AUDIO_VOLUME         4000
+#define AUDIO_FRAME_HZ       60
+#define AUDIO_EVENT_CAPACITY 1024
+#define AUDIO_PATTERN_BYTES  16      // XO-CHIP pattern: 128 1-bit samples, MSB first
+
+// Buzzer state from an emulated sample time on; every event carries the full state
+typedef struct AudioEvent {
+    uint64_t sample;
+    uint8_t  on;
+    uint8_t  pattern_set;   // play `pattern` at `pitch` instead of the tone
+    uint8_t  pitch;
+    uint8_t  reserved[5];
+    uint8_t  pattern[AUDIO_PATTERN_BYTES];
+} AudioEvent;
+
+typedef struct Audio {
+    SpscRing events;
+    uint32_t sample_rate;
+    uint32_t tone_step;          // square wave phase increment per sample (2^32 = one period)
+    int16_t  volume;
+
+    // Producer (emulation thread)
+    bool     producer_on;
+    AudioEvent producer_state;   // last state pushed to the ring (sample unused)
+    _Atomic uint64_t produced;   // emulated sample time reached by the producer
+
+    // Consumer (audio thread or headless writer)
+    uint64_t position;           // emulated sample time of the next rendered sample
+    uint32_t phase;
+    bool     on;
+    bool     pattern_set;
+    uint8_t  pattern[AUDIO_PATTERN_BYTES];
+    uint32_t pattern_step;       // pattern phase increment per sample (2^32 = all 128 bits)
+    uint32_t latency;            // samples the consumer trails the producer in real-time mode
+    uint64_t resyncs;            // real-time consumer jumps to stay within latency
+} Audio;
+
+// Set up a generator at sample_rate. Returns false on allocation failure.
+bool audio_init(Audio* a, uint32_t sample_rate);
+void audio_destroy(Audio* a);
+
+// Producer: the sound timer state at the end of emulated frame `frame` (0-based, counted in
+// timer ticks). The buzzer sounds for that whole frame's samples, so audio is exact to the
+// sound timer's own 60Hz resolution and independent of host timing.
+void audio_frame(Audio* a, uint64_t frame, bool on);
+
+// Producer: the XO-CHIP pattern (F002) and pitch (Fx3A) for frame `frame`, reported before that
+// frame's audio_frame once a machine has loaded a pattern. From then on the buzzer plays the
+// pattern at 4000 * 2^((pitch - 64) / 48) bits per second instead of the tone.
+void audio_pattern(Audio* a, uint64_t frame, const uint8_t pattern[AUDIO_PATTERN_BYTES], uint8_t pitch);
+
+// Consumer: render n mono samples. In real-time mode the read position follows the
+// producer at a fixed latency and jumps when emulation stalls or runs ahead (turbo);
+// otherwise samples are rendered strictly in emulated time.
+void audio_render(Audio* a, int16_t* out, size_t n, bool realtime);
+
+// Samples the producer has reported that the consumer has not rendered yet
+uint64_t audio_pending(Audio* a);
+
+// 16-bit mono PCM WAV writer for headless runs
+typedef struct AudioWav {
+    FILE*    file;
+    uint32_t sample_rate;
+    uint64_t samples;
+} AudioWav;
+
+bool audio_wav_open(AudioWav* w, const char* path, uint32_t sample_rate);
+
+// Render everything the producer has reported so far into the file
+bool audio_wav_drain(AudioWav* w, Audio* a);
+
+// Patch the header sizes and close the file
+bool audio_wav_close(AudioWav* w);
+
+#endif // AUDIO_H
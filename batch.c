@@ -0,0 +1,601 @@
+// Headless batch runner: executes many independent CHIP-8 instances across all cores
+// with no wall-clock pacing and reports per-instance results and aggregate throughput.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "audio.h"
+#include "chip8.h"
+#include "chip8_engine.h"
+#include "chip8_movie.h"
+#include "chip8_profile.h"
+#include "chip8_state.h"
+#include "chip8_video.h"
+#include "host_thread.h"
+#include "work_pool.h"
+
+#define DEFAULT_INSTRUCTIONS_PER_FRAME 12   // ~700Hz at 60 frames per second
+#define DEFAULT_FRAMES                 600  // 10 seconds of emulated time
+#define MAX_ROM_BYTES                  (CHIP8_XO_MEMORY_SIZE - 0x200)   // chip8_load_rom_data checks the machine's own limit
+
+typedef struct RomImage {
+    const char*   path;
+    uint8_t*      data;    // size bytes
+    size_t        size;
+    Chip8StateMap state;   // used instead of data when the inputs are save states
+    bool          ok;
+} RomImage;
+
+typedef struct InstanceResult {
+    int      rom;
+    uint64_t instructions;
+    uint64_t frames;
+    uint16_t pc;
+    bool     running;
+    bool     loaded;
+    uint64_t display_hash;
+    uint64_t elapsed_ns;
+    uint64_t video_frames;     // frames written to this instance's video
+    uint64_t video_stalls;     // captures that waited for the encoder
+    uint64_t video_stall_ns;
+    bool     video_failed;
+} InstanceResult;
+
+typedef struct BatchConfig {
+    int      threads;
+    int      copies;
+    uint64_t cycle_budget;   // 0 = use frame budget
+    uint64_t frame_budget;
+    uint32_t instructions_per_frame;
+    Chip8EngineKind engine;
+    Chip8Quirks quirks;        // ROM runs only; states and movies carry their own
+    bool     from_states;      // inputs are save-state files, not ROMs
+    const char* save_path;     // write instance 0's final machine here
+    const Chip8Movie* movie;   // replay these inputs and timer ticks instead of free-running
+    const char* wav_path;      // write instance 0's buzzer output here (frame mode)
+    const char* video_path;    // capture every instance's frames here
+    bool     quiet;
+} BatchConfig;
+
+typedef struct BatchJob {
+    const BatchConfig* config;
+    RomImage*          roms;
+    InstanceResult*    results;
+    Chip8Profile**     profiles;   // one per worker, NULL unless profiling
+    Chip8VideoEncoder* video;      // NULL unless capturing video
+    int                instance_count;
+} BatchJob;
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+        "Usage: %s [options] rom [rom ...]\n"
+        "  -t N   worker threads (default: one per CPU)\n"
+        "  -n N   instances per ROM (default 1)\n"
+        "  -c N   instruction budget per instance\n"
+        "  -f N   frame budget per instance (default %d)\n"
+        "  -i N   instructions per 60Hz frame (default %d)\n"
+        "  -e E   execution engine: switch, threaded, jit (default switch)\n"
+        "  -Q P   quirk profile: modern, vip, chip48, schip, xochip (default modern)\n"
+        "  -l F   read additional ROM paths from file F, one per line\n"
+        "  -s     inputs are save-state files; every instance warm-starts from its state\n"
+        "  -w F   write the final state of instance 0 to F\n"
+        "  -m F   replay input movie F on every instance (timers tick from the movie)\n"
+        "  -a F   write the buzzer output of instance 0 to WAV file F (without -m)\n"
+        "  -v F   capture the frames of every instance to F: .y4m, .png (a numbered sequence)\n"
+        "         or raw RGB24 otherwise; with several instances instance n writes F_n\n"
+        "  -x N   video scale 1-%d (default %d)\n"
+        "  -X     smooth the video with Scale2x instead of plain pixel doubling\n"
+        "  -V N   video encoder threads (default: one per CPU)\n"
+#ifdef CHIP8_PROFILE
+        "  -p F   write an execution profile to F and folded call stacks to F.folded\n"
+#endif
+        "  -q     only print the aggregate summary\n",
+        prog, DEFAULT_FRAMES, DEFAULT_INSTRUCTIONS_PER_FRAME, CHIP8_VIDEO_MAX_SCALE, CHIP8_VIDEO_DEFAULT_SCALE);
+}
+
+static bool load_rom_image(RomImage* rom) {
+    FILE* f = NULL;
+#ifdef _MSC_VER
+    fopen_s(&f, rom->path, "rb");
+#else
+    f = fopen(rom->path, "rb");
+#endif
+    if (!f) {
+        fprintf(stderr, "Failed to open ROM: %s\n", rom->path);
+        return false;
+    }
+    rom->data = (uint8_t*)malloc(MAX_ROM_BYTES);
+    rom->size = rom->data ? fread(rom->data, 1, MAX_ROM_BYTES, f) : 0;
+    bool too_big = fgetc(f) != EOF;
+    fclose(f);
+
+    if (rom->size == 0 || too_big) {
+        fprintf(stderr, "ROM too big or invalid size: %s\n", rom->path);
+        return false;
+    }
+    uint8_t* fitted = (uint8_t*)realloc(rom->data, rom->size);
+    if (fitted) rom->data = fitted;
+    return true;
+}
+
+// Initialize the machine for a run. Classic machines live in `classic`; XO-CHIP runs need the
+// 64 KB Chip8Xo, allocated into *xo for the caller to free. Returns NULL if that fails.
+static Chip8* init_machine(Chip8* classic, Chip8Xo** xo, bool xochip) {
+    *xo = NULL;
+    if (!xochip) {
+        chip8_init(classic);
+        return classic;
+    }
+    *xo = (Chip8Xo*)malloc(sizeof(Chip8Xo));
+    if (!*xo) return NULL;
+    chip8_xo_init(*xo);
+    return &(*xo)->base;
+}
+
+// Append the non-empty lines of a list file to the path array.
+static bool read_list_file(const char* list_path, char*** paths, int* count, int* capacity) {
+    FILE* f = fopen(list_path, "r");
+    if (!f) {
+        fprintf(stderr, "Failed to open ROM list: %s\n", list_path);
+        return false;
+    }
+
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        size_t len = strcspn(line, "\r\n");
+        line[len] = '\0';
+        if (len == 0) continue;
+
+        if (*count >= *capacity) {
+            *capacity = *capacity ? *capacity * 2 : 16;
+            char** grown = (char**)realloc(*paths, (size_t)*capacity * sizeof(char*));
+            if (!grown) {
+                fclose(f);
+                return false;
+            }
+            *paths = grown;
+        }
+        char* copy = (char*)malloc(len + 1);
+        if (!copy) {
+            fclose(f);
+            return false;
+        }
+        memcpy(copy, line, len + 1);
+        (*paths)[(*count)++] = copy;
+    }
+    fclose(f);
+    return true;
+}
+
+// Video path of one instance: with several instances "_<n>" goes before the extension
+static char* instance_video_path(const char* path, int task, int count) {
+    size_t len = strlen(path);
+    char* out = (char*)malloc(len + 16);
+    if (!out) return NULL;
+    const char* dot = strrchr(path, '.');
+    const char* sep = strrchr(path, '/');
+    const char* bsep = strrchr(path, '\\');
+    if (bsep > sep) sep = bsep;
+    size_t stem = dot && dot > sep ? (size_t)(dot - path) : len;
+    if (count <= 1) memcpy(out, path, len + 1);
+    else snprintf(out, len + 16, "%.*s_%d%s", (int)stem, path, task, path + stem);
+    return out;
+}
+
+// Replay like chip8_movie_play, capturing a video frame at every timer tick
+static uint64_t play_movie_captured(Chip8MoviePlayer* player, Chip8Engine* engine, Chip8* c8,
+    uint64_t cycles, Chip8VideoStream* video)
+{
+    const Chip8Movie* movie = player->movie;
+    uint64_t end = c8->cycle_count + cycles;
+    uint64_t executed = 0;
+    while (c8->running) {
+        // chip8_movie_play applies the events due when its budget runs out, so stopping at
+        // the next tick's cycle leaves the frame it ends on the display
+        uint64_t until = end;
+        for (size_t i = player->next; i < movie->count; ++i) {
+            if (movie->events[i].type != CHIP8_MOVIE_TICK) continue;
+            if (movie->events[i].cycle < until) until = movie->events[i].cycle;
+            break;
+        }
+        uint64_t ticks = player->ticks;
+        executed += chip8_movie_play(player, engine, c8, until - c8->cycle_count);
+        for (; ticks < player->ticks; ++ticks) chip8_video_capture(video, c8);
+        if (c8->cycle_count >= end) break;
+    }
+    return executed;
+}
+
+#ifdef CHIP8_PROFILE
+// Write the combined profile as text to path and as folded stacks to path.folded
+static void write_profile(const Chip8Profile* profile, const char* path) {
+    size_t len = strlen(path);
+    char* folded_path = (char*)malloc(len + sizeof(".folded"));
+    if (!folded_path) return;
+    memcpy(folded_path, path, len);
+    memcpy(folded_path + len, ".folded", sizeof(".folded"));
+
+    FILE* f = fopen(path, "w");
+    if (f) {
+        chip8_profile_dump_text(profile, f);
+        fclose(f);
+    }
+    else {
+        fprintf(stderr, "Failed to write profile: %s\n", path);
+    }
+
+    f = fopen(folded_path, "w");
+    if (f) {
+        chip8_profile_dump_folded(profile, f);
+        fclose(f);
+    }
+    else {
+        fprintf(stderr, "Failed to write profile: %s\n", folded_path);
+    }
+    free(folded_path);
+}
+#endif
+
+static void run_instance(void* ctx, int task, int worker) {
+    BatchJob* job = (BatchJob*)ctx;
+    const BatchConfig* cfg = job->config;
+    InstanceResult* res = &job->results[task];
+    const RomImage* rom = &job->roms[res->rom];
+
+    if (!rom->ok) return;
+
+    Chip8Quirks quirks = cfg->movie ? (Chip8Quirks)cfg->movie->quirks : cfg->quirks;
+    bool xochip = cfg->from_states ? rom->state.machine_size == sizeof(Chip8Xo)
+                                   : quirks == CHIP8_QUIRKS_XOCHIP;
+    Chip8 classic;
+    Chip8Xo* xo;
+    Chip8* c8 = init_machine(&classic, &xo, xochip);
+    if (!c8) return;
+
+    if (cfg->from_states) {
+        chip8_state_restore(&rom->state, c8);
+        res->loaded = true;
+    }
+    else {
+        chip8_set_quirks(c8, quirks);
+        if (cfg->movie) chip8_seed(c8, cfg->movie->seed);
+        res->loaded = chip8_load_rom_data(c8, rom->data, rom->size);
+        if (!res->loaded) {
+            free(xo);
+            return;
+        }
+    }
+
+#ifdef CHIP8_PROFILE
+    if (job->profiles) chip8_profile_attach(c8, job->profiles[worker]);
+#else
+    (void)worker;
+#endif
+
+    Chip8Engine engine;
+    if (!chip8_engine_create(&engine, cfg->engine)) {
+        res->loaded = false;
+        free(xo);
+        return;
+    }
+
+    Chip8VideoStream* video = NULL;
+    if (job->video) {
+        char* path = instance_video_path(cfg->video_path, task, job->instance_count);
+        video = path ? chip8_video_open(job->video, path) : NULL;
+        res->video_failed = !video;
+        free(path);
+    }
+
+    uint64_t budget = cfg->cycle_budget ? cfg->cycle_budget
+                                        : cfg->frame_budget * cfg->instructions_per_frame;
+    uint64_t start = host_time_ns();
+
+    if (cfg->movie) {
+        // Replay up to the last event, or to cycle -c if a budget was given
+        Chip8MoviePlayer player;
+        chip8_movie_play_begin(&player, cfg->movie);
+        uint64_t last = cfg->movie->count ? cfg->movie->events[cfg->movie->count - 1].cycle : 0;
+        uint64_t target = cfg->cycle_budget ? cfg->cycle_budget : last;
+        uint64_t cycles = target > c8->cycle_count ? target - c8->cycle_count : 0;
+        res->instructions = video ? play_movie_captured(&player, &engine, c8, cycles, video)
+                                  : chip8_movie_play(&player, &engine, c8, cycles);
+        res->frames = player.ticks;
+    }
+    else {
+        Audio audio;
+        AudioWav wav;
+        bool record_audio = task == 0 && cfg->wav_path &&
+            audio_init(&audio, AUDIO_DEFAULT_RATE) && audio_wav_open(&wav, cfg->wav_path, AUDIO_DEFAULT_RATE);
+
+        // Run frame by frame so timers advance in emulated time, not host time.
+        while (res->instructions < budget && c8->running) {
+            uint64_t left = budget - res->instructions;
+            uint32_t slice = left < cfg->instructions_per_frame ? (uint32_t)left
+                                                                : cfg->instructions_per_frame;
+            uint32_t ran = chip8_engine_run(&engine, c8, slice);
+            res->instructions += ran;
+            if (ran < cfg->instructions_per_frame) break;
+
+            if (record_audio) {
+                if (c8->audio_pattern_set) audio_pattern(&audio, res->frames, c8->audio_pattern, c8->pitch);
+                audio_frame(&audio, res->frames, c8->sound_timer > 0);
+                audio_wav_drain(&wav, &audio);
+            }
+            chip8_tick_timers(c8);
+            res->frames++;
+            if (video) chip8_video_capture(video, c8);
+        }
+
+        if (record_audio) {
+            audio_wav_close(&wav);
+            audio_destroy(&audio);
+        }
+    }
+
+    res->elapsed_ns = host_time_ns() - start;
+    if (video) {
+        Chip8VideoStats stats;
+        res->video_failed = !chip8_video_close(video, &stats);
+        res->video_frames = stats.written;
+        res->video_stalls = stats.stalls;
+        res->video_stall_ns = stats.stall_ns;
+    }
+    chip8_engine_destroy(&engine);
+    res->pc = c8->pc;
+    res->running = c8->running;
+    res->display_hash = chip8_display_hash(c8);
+
+    if (task == 0 && cfg->save_path) {
+        chip8_save_state(c8, cfg->save_path);
+    }
+    free(xo);
+}
+
+int main(int argc, char* argv[]) {
+    BatchConfig cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.copies = 1;
+    cfg.frame_budget = DEFAULT_FRAMES;
+    cfg.instructions_per_frame = DEFAULT_INSTRUCTIONS_PER_FRAME;
+
+    const char* movie_path = NULL;
+    int video_scale = 0;
+    int video_threads = 0;
+    bool video_smooth = false;
+#ifdef CHIP8_PROFILE
+    const char* profile_path = NULL;
+#endif
+    Chip8Movie movie;
+    memset(&movie, 0, sizeof(movie));
+
+    char** paths = NULL;
+    int path_count = 0;
+    int path_capacity = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(arg, "-t") == 0 && has_value) {
+            cfg.threads = atoi(argv[++i]);
+        }
+        else if (strcmp(arg, "-n") == 0 && has_value) {
+            cfg.copies = atoi(argv[++i]);
+        }
+        else if (strcmp(arg, "-c") == 0 && has_value) {
+            cfg.cycle_budget = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(arg, "-f") == 0 && has_value) {
+            cfg.frame_budget = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(arg, "-i") == 0 && has_value) {
+            cfg.instructions_per_frame = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(arg, "-e") == 0 && has_value) {
+            if (!chip8_engine_parse(argv[++i], &cfg.engine)) {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(arg, "-Q") == 0 && has_value) {
+            if (!chip8_quirks_parse(argv[++i], &cfg.quirks)) {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(arg, "-l") == 0 && has_value) {
+            if (!read_list_file(argv[++i], &paths, &path_count, &path_capacity)) return 1;
+        }
+        else if (strcmp(arg, "-s") == 0) {
+            cfg.from_states = true;
+        }
+        else if (strcmp(arg, "-w") == 0 && has_value) {
+            cfg.save_path = argv[++i];
+        }
+        else if (strcmp(arg, "-a") == 0 && has_value) {
+            cfg.wav_path = argv[++i];
+        }
+        else if (strcmp(arg, "-v") == 0 && has_value) {
+            cfg.video_path = argv[++i];
+        }
+        else if (strcmp(arg, "-x") == 0 && has_value) {
+            video_scale = atoi(argv[++i]);
+        }
+        else if (strcmp(arg, "-X") == 0) {
+            video_smooth = true;
+        }
+        else if (strcmp(arg, "-V") == 0 && has_value) {
+            video_threads = atoi(argv[++i]);
+        }
+        else if (strcmp(arg, "-m") == 0 && has_value) {
+            movie_path = argv[++i];
+        }
+#ifdef CHIP8_PROFILE
+        else if (strcmp(arg, "-p") == 0 && has_value) {
+            profile_path = argv[++i];
+        }
+#endif
+        else if (strcmp(arg, "-q") == 0) {
+            cfg.quiet = true;
+        }
+        else if (arg[0] == '-') {
+            usage(argv[0]);
+            return 1;
+        }
+        else {
+            if (path_count >= path_capacity) {
+                path_capacity = path_capacity ? path_capacity * 2 : 16;
+                char** grown = (char**)realloc(paths, (size_t)path_capacity * sizeof(char*));
+                if (!grown) return 1;
+                paths = grown;
+            }
+            size_t len = strlen(arg);
+            paths[path_count] = (char*)malloc(len + 1);
+            if (!paths[path_count]) return 1;
+            memcpy(paths[path_count++], arg, len + 1);
+        }
+    }
+
+    if (path_count == 0 || cfg.copies <= 0 || cfg.instructions_per_frame == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (movie_path) {
+        if (!chip8_movie_load(&movie, movie_path)) return 1;
+        cfg.movie = &movie;
+    }
+
+    // Each ROM or state is read from disk once and shared by all of its instances;
+    // states are mapped and validated here, so an instance restore is a single copy.
+    RomImage* roms = (RomImage*)calloc((size_t)path_count, sizeof(RomImage));
+    if (!roms) return 1;
+    for (int i = 0; i < path_count; ++i) {
+        roms[i].path = paths[i];
+        roms[i].ok = cfg.from_states ? chip8_state_map_open(&roms[i].state, paths[i])
+                                     : load_rom_image(&roms[i]);
+        if (roms[i].ok && cfg.movie && !cfg.from_states) {
+            Chip8 classic;
+            Chip8Xo* xo;
+            Chip8* probe = init_machine(&classic, &xo, movie.quirks == CHIP8_QUIRKS_XOCHIP);
+            if (probe && chip8_load_rom_data(probe, roms[i].data, roms[i].size) &&
+                chip8_movie_rom_hash(probe) != movie.rom_hash) {
+                fprintf(stderr, "Warning: movie was recorded with a different ROM: %s\n", paths[i]);
+            }
+            free(xo);
+        }
+    }
+
+    int instance_count = path_count * cfg.copies;
+    InstanceResult* results = (InstanceResult*)calloc((size_t)instance_count, sizeof(InstanceResult));
+    if (!results) return 1;
+    for (int i = 0; i < instance_count; ++i) {
+        results[i].rom = i / cfg.copies;
+    }
+
+    BatchJob job = { &cfg, roms, results, NULL, NULL, instance_count };
+    int workers = work_pool_thread_count(cfg.threads, instance_count);
+
+    // Encoder threads run beside the workers; each worker has at most one stream open
+    Chip8VideoEncoder video;
+    if (cfg.video_path) {
+        Chip8VideoConfig video_config = { video_threads, workers, 0, video_scale, NULL, video_smooth };
+        if (!chip8_video_encoder_start(&video, &video_config)) return 1;
+        job.video = &video;
+        video_threads = video.worker_count;
+    }
+
+#ifdef CHIP8_PROFILE
+    if (profile_path) {
+        job.profiles = (Chip8Profile**)calloc((size_t)workers, sizeof(Chip8Profile*));
+        if (!job.profiles) return 1;
+        for (int w = 0; w < workers; ++w) {
+            job.profiles[w] = chip8_profile_create();
+            if (!job.profiles[w]) return 1;
+        }
+    }
+#endif
+
+    uint64_t start = host_time_ns();
+    work_pool_run(workers, instance_count, run_instance, &job);
+    uint64_t wall_ns = host_time_ns() - start;
+    if (job.video) chip8_video_encoder_stop(&video);
+
+    uint64_t total_instructions = 0;
+    uint64_t total_frames = 0;
+    uint64_t video_frames = 0;
+    uint64_t video_stalls = 0;
+    uint64_t video_stall_ns = 0;
+    int video_failed = 0;
+    int failed = 0;
+    if (!cfg.quiet) {
+        printf("instance\trom\tinstructions\tframes\tpc\trunning\tdisplay_hash\tips\n");
+    }
+    for (int i = 0; i < instance_count; ++i) {
+        const InstanceResult* r = &results[i];
+        if (!r->loaded) {
+            failed++;
+            continue;
+        }
+        total_instructions += r->instructions;
+        total_frames += r->frames;
+        video_frames += r->video_frames;
+        video_stalls += r->video_stalls;
+        video_stall_ns += r->video_stall_ns;
+        if (r->video_failed) video_failed++;
+        if (!cfg.quiet) {
+            double ips = r->elapsed_ns ? (double)r->instructions * 1e9 / (double)r->elapsed_ns : 0.0;
+            printf("%d\t%s\t%llu\t%llu\t0x%03X\t%d\t%016llx\t%.0f\n",
+                i, roms[r->rom].path,
+                (unsigned long long)r->instructions,
+                (unsigned long long)r->frames,
+                r->pc, r->running ? 1 : 0,
+                (unsigned long long)r->display_hash, ips);
+        }
+    }
+
+    double seconds = (double)wall_ns / 1e9;
+    printf("# engine=%s quirks=%s instances=%d failed=%d threads=%d instructions=%llu frames=%llu seconds=%.3f ips=%.0f\n",
+        chip8_engine_name(cfg.engine), chip8_quirks_name(cfg.movie ? (Chip8Quirks)cfg.movie->quirks : cfg.quirks),
+        instance_count, failed, workers,
+        (unsigned long long)total_instructions,
+        (unsigned long long)total_frames,
+        seconds,
+        seconds > 0.0 ? (double)total_instructions / seconds : 0.0);
+    if (job.video) {
+        printf("# video=%s format=%s scale=%d%s encoder_threads=%d frames=%llu stalls=%llu stall_seconds=%.3f failed=%d\n",
+            cfg.video_path, chip8_video_format_name(chip8_video_format_for_path(cfg.video_path)),
+            video.scale, video.smooth ? " smooth=scale2x" : "", video_threads, (unsigned long long)video_frames,
+            (unsigned long long)video_stalls, (double)video_stall_ns / 1e9, video_failed);
+        if (video_stalls) {
+            printf("# video encoding fell behind: instances waited %.3f s for a full queue; "
+                "add encoder threads (-V) or lower the scale (-x)\n", (double)video_stall_ns / 1e9);
+        }
+    }
+
+#ifdef CHIP8_PROFILE
+    if (job.profiles) {
+        for (int w = 1; w < workers; ++w) {
+            chip8_profile_merge(job.profiles[0], job.profiles[w]);
+            chip8_profile_destroy(job.profiles[w]);
+        }
+        write_profile(job.profiles[0], profile_path);
+        chip8_profile_destroy(job.profiles[0]);
+        free(job.profiles);
+    }
+#endif
+
+    for (int i = 0; i < path_count; ++i) {
+        if (cfg.from_states) chip8_state_map_close(&roms[i].state);
+        free(roms[i].data);
+        free(paths[i]);
+    }
+    free(paths);
+    free(roms);
+    chip8_movie_free(&movie);
+    free(results);
+    return failed == instance_count ? 1 : 0;
+}
@@ -0,0 +1,947 @@
+// Core benchmark suite: per-opcode microbenchmarks and a synthetic ROM corpus.
+// Every benchmark is a generated ROM run headless through the selected engine; results go to
+// stdout as a table, CSV or JSON so runs can be compared between builds. The lanes suite
+// runs the corpus on many seeded machines at once, through chip8_lockstep and one by one;
+// the env suite measures chip8_env steps of one frame, where per-step overhead dominates, and
+// the clone suite grows search trees of one-frame nodes with whole-struct copies or chip8_clone,
+// the trace suite runs the corpus with chip8_trace recording every instruction to a file, and
+// the blit suite converts the corpus's screens to ARGB for presentation.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "chip8.h"
+#include "chip8_blit.h"
+#include "chip8_clone.h"
+#include "chip8_engine.h"
+#include "chip8_env.h"
+#include "chip8_lockstep.h"
+#include "chip8_trace.h"
+#include "host_thread.h"
+
+#define DEFAULT_MICRO_INSTRUCTIONS  2000000
+#define DEFAULT_MACRO_INSTRUCTIONS  10000000
+#define DEFAULT_REPEATS             3
+#define DEFAULT_INSTRUCTIONS_PER_FRAME 12
+#define MICRO_UNROLL                32      // copies of the body per loop iteration
+#define MICRO_SLICE                 65536
+#define MAX_ROM_BYTES               (CHIP8_MEMORY_SIZE - 0x200)
+#define DATA_ADDR                   0xF00   // sprite / copy source data
+#define SCRATCH_ADDR                0xE80   // Fx33 / Fx55 destination, outside the code
+#define ENV_EPISODE_FRAMES          600     // env suite resets every 10 seconds of play
+#define CLONE_TREE_NODES            4096    // clone suite trees are rebuilt at this size
+#define TRACE_PATH                  "bench_trace.c8t"   // trace suite output, removed afterwards
+#define BLIT_SETTLE_FRAMES          120     // blit suite runs each ROM this long for its screen
+#define BLIT_FRAMES                 20000   // blit suite conversions per repeat
+#define BLIT_SCALE                  4       // blit suite nearest upscale factor
+
+typedef enum OutputFormat {
+    OUTPUT_TEXT,
+    OUTPUT_CSV,
+    OUTPUT_JSON,
+} OutputFormat;
+
+typedef struct RomBuilder {
+    uint8_t  data[MAX_ROM_BYTES];
+    size_t   size;
+    uint16_t pc;   // address of the next emitted instruction
+} RomBuilder;
+
+typedef enum BodyKind {
+    BODY_PLAIN,       // body ops as written
+    BODY_CALL,        // body[0] is 2nnn to a 00EE subroutine after the loop
+    BODY_JUMP_NEXT,   // body[0] is 1nnn/Bnnn to the following instruction
+} BodyKind;
+
+typedef struct MicroBench {
+    const char* name;
+    uint16_t    setup[6];   // runs once; 0 terminates
+    uint16_t    body[2];    // repeated MICRO_UNROLL times; 0 terminates
+    BodyKind    kind;
+} MicroBench;
+
+typedef struct BenchResult {
+    const char* suite;
+    const char* name;
+    const char* engine;        // chip8_engine_name, or "lockstep"
+    uint64_t    instructions;
+    uint64_t    frames;        // 0 for microbenchmarks
+    double      seconds;       // best of the repeats
+    double      bytes_per;     // clone: memory per tree node; trace: file bytes per instruction
+    const char* per;           // "node" or "instr"; NULL elsewhere
+} BenchResult;
+
+typedef struct BenchConfig {
+    uint64_t micro_instructions;
+    uint64_t macro_instructions;
+    int      repeats;
+    uint32_t instructions_per_frame;
+    bool     run_micro;
+    bool     run_macro;
+    bool     run_lockstep;
+    bool     run_env;
+    bool     run_clone;
+    bool     run_trace;
+    bool     run_blit;
+    int      lanes;            // machines per ROM in the lanes suite, environments in env
+    bool     engines[CHIP8_ENGINE_COUNT];
+    Chip8Quirks quirks;
+    const char* filter;        // only benchmarks whose name contains this
+    OutputFormat format;
+} BenchConfig;
+
+// Registers every microbenchmark starts with (the setup list adds to these)
+#define COMMON_SETUP 0x6A12, 0x6B34, 0x600D, 0x6107, 0xA000 | DATA_ADDR
+
+static const MicroBench micro_benches[] = {
+    { "00E0_cls",            { COMMON_SETUP },          { 0x00E0 },         BODY_PLAIN },
+    { "2nnn_00EE_call_ret",  { COMMON_SETUP },          { 0x2000 },         BODY_CALL },
+    { "1nnn_jump",           { COMMON_SETUP },          { 0x1000 },         BODY_JUMP_NEXT },
+    { "Bnnn_jump_v0",        { 0x6000 },                { 0xB000 },         BODY_JUMP_NEXT },
+    { "3xkk_skip_not_taken", { COMMON_SETUP },          { 0x3A00 },         BODY_PLAIN },
+    { "3xkk_skip_taken",     { COMMON_SETUP },          { 0x3A12, 0x6C00 }, BODY_PLAIN },
+    { "5xy0_skip_not_taken", { COMMON_SETUP },          { 0x5AB0 },         BODY_PLAIN },
+    { "6xkk_load",           { COMMON_SETUP },          { 0x6C55 },         BODY_PLAIN },
+    { "7xkk_add",            { COMMON_SETUP },          { 0x7C01 },         BODY_PLAIN },
+    { "8xy0_mov",            { COMMON_SETUP },          { 0x8CA0 },         BODY_PLAIN },
+    { "8xy1_or",             { COMMON_SETUP },          { 0x8AB1 },         BODY_PLAIN },
+    { "8xy2_and",            { COMMON_SETUP },          { 0x8AB2 },         BODY_PLAIN },
+    { "8xy3_xor",            { COMMON_SETUP },          { 0x8AB3 },         BODY_PLAIN },
+    { "8xy4_add",            { COMMON_SETUP },          { 0x8AB4 },         BODY_PLAIN },
+    { "8xy5_sub",            { COMMON_SETUP },          { 0x8AB5 },         BODY_PLAIN },
+    { "8xy6_shr",            { COMMON_SETUP },          { 0x8AB6 },         BODY_PLAIN },
+    { "8xy7_subn",           { COMMON_SETUP },          { 0x8AB7 },         BODY_PLAIN },
+    { "8xyE_shl",            { COMMON_SETUP },          { 0x8ABE },         BODY_PLAIN },
+    { "Annn_load_i",         { COMMON_SETUP },          { 0xA000 | DATA_ADDR }, BODY_PLAIN },
+    { "Cxkk_random",         { COMMON_SETUP },          { 0xCC7F },         BODY_PLAIN },
+    { "Dxyn_draw_8x1",       { COMMON_SETUP },          { 0xD011 },         BODY_PLAIN },
+    { "Dxyn_draw_8x5",       { COMMON_SETUP },          { 0xD015 },         BODY_PLAIN },
+    { "Dxyn_draw_8x8",       { COMMON_SETUP },          { 0xD018 },         BODY_PLAIN },
+    { "Dxyn_draw_8x15",      { COMMON_SETUP },          { 0xD01F },         BODY_PLAIN },
+    { "Dxyn_draw_8x5_wrap",  { COMMON_SETUP, 0x603C },  { 0xD015 },         BODY_PLAIN },
+    { "Dxy0_draw_16x16",     { COMMON_SETUP, 0x00FF },  { 0xD010 },         BODY_PLAIN },
+    { "ExA1_skip_key_up",    { COMMON_SETUP },          { 0xEAA1, 0x6C00 }, BODY_PLAIN },
+    { "Fx07_get_delay",      { COMMON_SETUP },          { 0xFC07 },         BODY_PLAIN },
+    { "Fx15_set_delay",      { COMMON_SETUP },          { 0xFA15 },         BODY_PLAIN },
+    { "Fx1E_add_i",          { COMMON_SETUP },          { 0xFA1E },         BODY_PLAIN },
+    { "Fx29_font",           { COMMON_SETUP },          { 0xFA29 },         BODY_PLAIN },
+    { "Fx33_bcd",            { COMMON_SETUP, 0xA000 | SCRATCH_ADDR }, { 0xFB33 }, BODY_PLAIN },
+    { "Fx55_store_v0_v3",    { COMMON_SETUP, 0xA000 | SCRATCH_ADDR }, { 0xF355 }, BODY_PLAIN },
+    { "Fx55_store_v0_vF",    { COMMON_SETUP, 0xA000 | SCRATCH_ADDR }, { 0xFF55 }, BODY_PLAIN },
+    { "Fx65_load_v0_v3",     { COMMON_SETUP },          { 0xF365 },         BODY_PLAIN },
+    { "Fx65_load_v0_vF",     { COMMON_SETUP },          { 0xFF65 },         BODY_PLAIN },
+    { "00Cn_scroll_down_4",  { COMMON_SETUP, 0x00FF },  { 0x00C4 },         BODY_PLAIN },
+    { "00FB_scroll_right",   { COMMON_SETUP, 0x00FF },  { 0x00FB },         BODY_PLAIN },
+    { "00FC_scroll_left",    { COMMON_SETUP, 0x00FF },  { 0x00FC },         BODY_PLAIN },
+    { "00Cn_scroll_down_lo", { COMMON_SETUP },          { 0x00C4 },         BODY_PLAIN },
+};
+
+static void rom_begin(RomBuilder* b) {
+    memset(b, 0, sizeof(*b));
+    b->pc = 0x200;
+
+    // Source data for sprites and block copies: alternating dense rows
+    for (int i = 0; i < 64; ++i) {
+        b->data[DATA_ADDR - 0x200 + i] = (i & 1) ? 0x5A : 0xA5;
+    }
+    b->size = DATA_ADDR - 0x200 + 64;
+}
+
+static void emit(RomBuilder* b, uint16_t op) {
+    b->data[b->pc - 0x200] = (uint8_t)(op >> 8);
+    b->data[b->pc - 0x200 + 1] = (uint8_t)op;
+    b->pc += 2;
+}
+
+static void build_micro(RomBuilder* b, const MicroBench* m) {
+    rom_begin(b);
+    for (int i = 0; i < 6 && m->setup[i]; ++i) {
+        emit(b, m->setup[i]);
+    }
+
+    uint16_t loop = b->pc;
+    int body_len = m->body[1] ? 2 : 1;
+    uint16_t sub = (uint16_t)(loop + MICRO_UNROLL * body_len * 2 + 2);
+
+    for (int r = 0; r < MICRO_UNROLL; ++r) {
+        for (int i = 0; i < body_len; ++i) {
+            uint16_t op = m->body[i];
+            if (m->kind == BODY_CALL) op = (uint16_t)(0x2000 | sub);
+            if (m->kind == BODY_JUMP_NEXT) op = (uint16_t)(op | (b->pc + 2));
+            emit(b, op);
+        }
+    }
+    emit(b, (uint16_t)(0x1000 | loop));
+    if (m->kind == BODY_CALL) emit(b, 0x00EE);
+}
+
+// Synthetic workloads shaped like common game loops
+static void build_alu_mix(RomBuilder* b) {
+    rom_begin(b);
+    uint16_t loop = b->pc;
+    emit(b, 0x7001);   // counters and flag-setting arithmetic
+    emit(b, 0x8104);
+    emit(b, 0x8215);
+    emit(b, 0x8316);
+    emit(b, 0x8427);
+    emit(b, 0x831E);
+    emit(b, 0x3100);
+    emit(b, 0x7201);
+    emit(b, 0x8551);
+    emit(b, 0x8652);
+    emit(b, (uint16_t)(0x1000 | loop));
+}
+
+static void build_sprite_field(RomBuilder* b) {
+    rom_begin(b);
+    emit(b, 0xA000 | DATA_ADDR);
+    uint16_t loop = b->pc;
+    emit(b, 0xC03F);   // random position
+    emit(b, 0xC11F);
+    emit(b, 0xD018);
+    emit(b, 0x7201);
+    emit(b, 0x4200);   // clear the screen every 256 sprites
+    emit(b, 0x00E0);
+    emit(b, (uint16_t)(0x1000 | loop));
+}
+
+static void build_hires_scroller(RomBuilder* b) {
+    rom_begin(b);
+    emit(b, 0x00FF);
+    emit(b, 0xA000 | DATA_ADDR);
+    uint16_t loop = b->pc;
+    emit(b, 0xC07F);
+    emit(b, 0xC13F);
+    emit(b, 0xD010);
+    emit(b, 0x00C1);
+    emit(b, 0x7201);
+    emit(b, 0x3200 | 0x07);   // sideways every time the counter hits 7
+    emit(b, 0x1000 | (uint16_t)(loop + 18));
+    emit(b, 0x00FB);
+    emit(b, 0x6200);
+    emit(b, (uint16_t)(0x1000 | loop));
+}
+
+static void build_score_display(RomBuilder* b) {
+    rom_begin(b);
+    emit(b, 0x6410);   // digit x positions and y
+    emit(b, 0x6515);
+    emit(b, 0x661A);
+    emit(b, 0x6702);
+    uint16_t loop = b->pc;
+    emit(b, 0x7301);   // score++
+    emit(b, 0xA000 | SCRATCH_ADDR);
+    emit(b, 0xF333);
+    emit(b, 0xF265);
+    emit(b, 0xF029);
+    emit(b, 0xD475);
+    emit(b, 0xF129);
+    emit(b, 0xD575);
+    emit(b, 0xF229);
+    emit(b, 0xD675);
+    emit(b, (uint16_t)(0x1000 | loop));
+}
+
+static void build_block_copy(RomBuilder* b) {
+    rom_begin(b);
+    emit(b, 0x6C10);
+    uint16_t loop = b->pc;
+    emit(b, 0xA000 | DATA_ADDR);
+    emit(b, 0xFF65);
+    emit(b, 0xFC1E);
+    emit(b, 0xF765);
+    emit(b, 0xA000 | SCRATCH_ADDR);
+    emit(b, 0xFF55);
+    emit(b, 0xFC1E);
+    emit(b, 0xF755);
+    emit(b, (uint16_t)(0x1000 | loop));
+}
+
+static void build_timer_poll(RomBuilder* b) {
+    rom_begin(b);
+    emit(b, 0xA000 | DATA_ADDR);
+    uint16_t loop = b->pc;
+    emit(b, 0x6A02);   // wait two frames on the delay timer, then draw
+    emit(b, 0xFA15);
+    uint16_t wait = b->pc;
+    emit(b, 0xFA07);
+    emit(b, 0x3A00);
+    emit(b, (uint16_t)(0x1000 | wait));
+    emit(b, 0xC03F);
+    emit(b, 0xC11F);
+    emit(b, 0xD015);
+    emit(b, (uint16_t)(0x1000 | loop));
+}
+
+typedef struct MacroBench {
+    const char* name;
+    void (*build)(RomBuilder* b);
+} MacroBench;
+
+static const MacroBench macro_benches[] = {
+    { "alu_mix",         build_alu_mix },
+    { "sprite_field",    build_sprite_field },
+    { "hires_scroller",  build_hires_scroller },
+    { "score_display",   build_score_display },
+    { "block_copy",      build_block_copy },
+    { "timer_poll",      build_timer_poll },
+};
+
+// XO-CHIP runs need the 64 KB machine; classic profiles use its base only.
+static Chip8Xo bench_machine;
+
+static Chip8* load_machine(const RomBuilder* b, Chip8Quirks quirks) {
+    Chip8* c8 = &bench_machine.base;
+    if (quirks == CHIP8_QUIRKS_XOCHIP) chip8_xo_init(&bench_machine);
+    else {
+        chip8_init(c8);
+        chip8_set_quirks(c8, quirks);
+    }
+    chip8_load_rom_data(c8, b->data, b->size);
+    return c8;
+}
+
+// Run `instructions` back to back with no timer ticks; returns elapsed seconds
+static double run_micro_once(Chip8Engine* engine, Chip8* c8, uint64_t instructions) {
+    uint64_t start = host_time_ns();
+    uint64_t done = 0;
+    while (done < instructions && c8->running) {
+        uint64_t left = instructions - done;
+        uint32_t slice = left < MICRO_SLICE ? (uint32_t)left : MICRO_SLICE;
+        done += chip8_engine_run(engine, c8, slice);
+    }
+    return (double)(host_time_ns() - start) / 1e9;
+}
+
+// Run `instructions` in 60Hz frames of `ipf`, ticking timers between frames
+static double run_macro_once(Chip8Engine* engine, Chip8* c8, uint64_t instructions,
+    uint32_t ipf, uint64_t* frames) {
+    uint64_t start = host_time_ns();
+    uint64_t done = 0;
+    *frames = 0;
+    while (done < instructions && c8->running) {
+        uint64_t left = instructions - done;
+        uint32_t slice = left < ipf ? (uint32_t)left : ipf;
+        uint32_t ran = chip8_engine_run(engine, c8, slice);
+        done += ran;
+        if (ran < slice) break;
+        chip8_tick_timers(c8);
+        (*frames)++;
+    }
+    return (double)(host_time_ns() - start) / 1e9;
+}
+
+// Best-of-N timing of one ROM on one engine. Each repeat starts from a fresh machine;
+// the engine is warmed up first so translation caches are populated.
+static bool run_bench(const BenchConfig* cfg, const RomBuilder* rom, bool macro,
+    Chip8EngineKind kind, BenchResult* out) {
+    Chip8Engine engine;
+    if (!chip8_engine_create(&engine, kind)) return false;
+
+    uint64_t instructions = macro ? cfg->macro_instructions : cfg->micro_instructions;
+    uint64_t frames = 0;
+
+    Chip8* c8 = load_machine(rom, cfg->quirks);
+    run_micro_once(&engine, c8, instructions / 10 + 1);
+
+    out->engine = chip8_engine_name(kind);
+    out->instructions = instructions;
+    out->frames = 0;
+    out->seconds = 0.0;
+    for (int r = 0; r < cfg->repeats; ++r) {
+        c8 = load_machine(rom, cfg->quirks);
+        chip8_engine_reset(&engine);
+        double seconds = macro ? run_macro_once(&engine, c8, instructions, cfg->instructions_per_frame, &frames)
+                               : run_micro_once(&engine, c8, instructions);
+        if (r == 0 || seconds < out->seconds) {
+            out->seconds = seconds;
+            out->frames = frames;
+        }
+    }
+    chip8_engine_destroy(&engine);
+    return true;
+}
+
+// Lanes suite: cfg->lanes machines seeded 1..lanes, run in 60Hz frames for about
+// macro_instructions in total. Frames count per machine, so fps is aggregate too.
+static Chip8 lane_machines[CHIP8_LOCKSTEP_LANES];
+
+static void load_lanes(const BenchConfig* cfg, const RomBuilder* rom) {
+    for (int l = 0; l < cfg->lanes; ++l) {
+        chip8_init(&lane_machines[l]);
+        chip8_set_quirks(&lane_machines[l], cfg->quirks);
+        chip8_load_rom_data(&lane_machines[l], rom->data, rom->size);
+        chip8_seed(&lane_machines[l], (uint64_t)l + 1);
+    }
+}
+
+// Best-of-N over the lanes, with chip8_lockstep or (lockstep false) chip8_run on each lane in turn
+static bool run_lockstep_bench(const BenchConfig* cfg, const RomBuilder* rom, bool lockstep,
+    BenchResult* out) {
+    static Chip8Lockstep ls;
+    Chip8* machines[CHIP8_LOCKSTEP_LANES];
+    for (int l = 0; l < cfg->lanes; ++l) machines[l] = &lane_machines[l];
+    uint64_t per_lane = cfg->macro_instructions / (uint64_t)cfg->lanes;
+    uint32_t ipf = cfg->instructions_per_frame;
+
+    out->engine = lockstep ? "lockstep" : chip8_engine_name(CHIP8_ENGINE_SWITCH);
+    out->seconds = 0.0;
+    for (int r = 0; r < cfg->repeats; ++r) {
+        load_lanes(cfg, rom);
+        if (lockstep && !chip8_lockstep_init(&ls, machines, cfg->lanes)) return false;
+
+        uint64_t done = 0;
+        uint64_t frames = 0;
+        uint64_t start = host_time_ns();
+        for (uint64_t f = 0; f * ipf < per_lane; ++f) {
+            if (lockstep) done += chip8_lockstep_run(&ls, ipf);
+            for (int l = 0; l < cfg->lanes; ++l) {
+                if (!lockstep) done += chip8_run(machines[l], ipf);
+                chip8_tick_timers(machines[l]);
+            }
+            frames += (uint64_t)cfg->lanes;
+        }
+        double seconds = (double)(host_time_ns() - start) / 1e9;
+        if (r == 0 || seconds < out->seconds) {
+            out->seconds = seconds;
+            out->instructions = done;
+            out->frames = frames;
+        }
+    }
+    return true;
+}
+
+// Env suite: one-frame steps with a changing key mask until about macro_instructions have run,
+// on one environment (`many` false) or cfg->lanes environments per chip8_env_step_many call.
+// fps is environment steps per second.
+static bool run_env_bench(const BenchConfig* cfg, const RomBuilder* rom, bool many, BenchResult* out) {
+    static Chip8Env envs[CHIP8_LOCKSTEP_LANES];
+    static uint64_t obs[CHIP8_LOCKSTEP_LANES * CHIP8_ENV_OBS_WORDS];
+    uint16_t keys[CHIP8_LOCKSTEP_LANES];
+    bool done[CHIP8_LOCKSTEP_LANES];
+    int count = many ? cfg->lanes : 1;
+
+    Chip8 start;
+    chip8_init(&start);
+    chip8_set_quirks(&start, cfg->quirks);
+    chip8_load_rom_data(&start, rom->data, rom->size);
+    for (int i = 0; i < count; ++i) {
+        if (!chip8_env_init(&envs[i], &start, CHIP8_ENGINE_SWITCH, cfg->instructions_per_frame,
+            CHIP8_OBS_64X32)) {
+            for (int j = 0; j < i; ++j) chip8_env_destroy(&envs[j]);
+            return false;
+        }
+    }
+
+    uint64_t steps = cfg->macro_instructions / cfg->instructions_per_frame;
+    out->engine = many ? "env_many" : "env";
+    out->seconds = 0.0;
+    for (int r = 0; r < cfg->repeats; ++r) {
+        uint64_t instructions = 0;
+        uint64_t done_steps = 0;
+        for (int i = 0; i < count; ++i) chip8_env_reset(&envs[i], (uint64_t)i + 1);
+
+        uint64_t start_ns = host_time_ns();
+        for (uint64_t t = 0; done_steps < steps; ++t) {
+            if (t % ENV_EPISODE_FRAMES == 0 && t) {
+                for (int i = 0; i < count; ++i) {
+                    instructions += envs[i].machine.cycle_count - envs[i].snapshot.cycle_count;
+                    chip8_env_reset(&envs[i], t + (uint64_t)i);
+                }
+            }
+            for (int i = 0; i < count; ++i) keys[i] = (uint16_t)(1u << ((t + (uint64_t)i) & 15));
+            if (many) chip8_env_step_many(envs, count, keys, 1, obs, done);
+            else obs[0] ^= chip8_env_step(&envs[0], keys[0], 1)[0];
+            done_steps += (uint64_t)count;
+        }
+        double seconds = (double)(host_time_ns() - start_ns) / 1e9;
+        for (int i = 0; i < count; ++i) {
+            instructions += envs[i].machine.cycle_count - envs[i].snapshot.cycle_count;
+        }
+        if (r == 0 || seconds < out->seconds) {
+            out->seconds = seconds;
+            out->instructions = instructions;
+            out->frames = done_steps;
+        }
+    }
+    for (int i = 0; i < count; ++i) chip8_env_destroy(&envs[i]);
+    return true;
+}
+
+// Clone suite: grow trees of CLONE_TREE_NODES one-frame nodes from randomly chosen parents,
+// each child holding a different key, until about macro_instructions have run. Nodes are whole
+// Chip8 copies, or chip8_clone nodes checked out into one work machine (`cow`). fps is nodes
+// created per second.
+static bool run_clone_bench(const BenchConfig* cfg, const RomBuilder* rom, bool cow, BenchResult* out) {
+    static Chip8ClonePool pool;
+    static Chip8CloneWork work;
+    static Chip8Clone* nodes[CLONE_TREE_NODES];
+    Chip8* copies = NULL;
+    uint32_t ipf = cfg->instructions_per_frame;
+
+    Chip8 start;
+    chip8_init(&start);
+    chip8_set_quirks(&start, cfg->quirks);
+    chip8_load_rom_data(&start, rom->data, rom->size);
+    if (!cow) {
+        copies = malloc(CLONE_TREE_NODES * sizeof(Chip8));
+        if (!copies) return false;
+    }
+    else if (start.addr_mask != CHIP8_ADDR_MASK) {
+        return false;
+    }
+
+    out->engine = cow ? "clone" : "copy";
+    out->seconds = 0.0;
+    for (int r = 0; r < cfg->repeats; ++r) {
+        uint64_t rng = 0x9E3779B97F4A7C15ull;
+        uint64_t done = 0;
+        uint64_t created = 0;
+        double bytes = 0.0;
+        int count = 0;
+        chip8_clone_pool_init(&pool);
+        chip8_clone_work_init(&work);
+
+        uint64_t start_ns = host_time_ns();
+        while (done < cfg->macro_instructions) {
+            if (count == CLONE_TREE_NODES || count == 0) {
+                if (count) {
+                    bytes = cow ? (double)chip8_clone_pool_bytes(&pool) / count : (double)sizeof(Chip8);
+                }
+                for (int i = 0; cow && i < count; ++i) chip8_clone_free(&pool, nodes[i]);
+                if (cow) nodes[0] = chip8_clone_capture(&pool, &start);
+                else copies[0] = start;
+                count = 1;
+            }
+            rng ^= rng << 13;
+            rng ^= rng >> 7;
+            rng ^= rng << 17;
+            int parent = (int)(rng % (uint64_t)count);
+            Chip8* c8 = cow ? &work.machine : &copies[count];
+            if (cow) chip8_clone_checkout(&pool, &work, nodes[parent]);
+            else *c8 = copies[parent];
+
+            memset(c8->keys, 0, sizeof(c8->keys));
+            c8->keys[created & 15] = true;
+            done += chip8_run(c8, ipf);
+            chip8_tick_timers(c8);
+            if (cow) {
+                nodes[count] = chip8_clone_commit(&pool, &work);
+                if (!nodes[count]) break;
+            }
+            count++;
+            created++;
+        }
+        double seconds = (double)(host_time_ns() - start_ns) / 1e9;
+        for (int i = 0; cow && i < count; ++i) if (nodes[i]) chip8_clone_free(&pool, nodes[i]);
+        chip8_clone_work_release(&pool, &work);
+        chip8_clone_pool_destroy(&pool);
+
+        if (r == 0 || seconds < out->seconds) {
+            out->seconds = seconds;
+            out->instructions = done;
+            out->frames = created;
+            out->bytes_per = bytes;
+            out->per = "node";
+        }
+    }
+    free(copies);
+    return true;
+}
+
+// Trace suite: the corpus in 60Hz frames on the switch interpreter, plain or through
+// chip8_trace_run writing TRACE_PATH. Reports the file size per instruction.
+static bool run_trace_bench(const BenchConfig* cfg, const RomBuilder* rom, bool trace, BenchResult* out) {
+    uint32_t ipf = cfg->instructions_per_frame;
+    out->engine = trace ? "trace" : chip8_engine_name(CHIP8_ENGINE_SWITCH);
+    out->seconds = 0.0;
+    for (int r = 0; r < cfg->repeats; ++r) {
+        Chip8* c8 = load_machine(rom, cfg->quirks);
+        Chip8Trace t;
+        if (trace && !chip8_trace_open(&t, TRACE_PATH, c8, 0)) return false;
+
+        uint64_t done = 0;
+        uint64_t frames = 0;
+        uint64_t start = host_time_ns();
+        while (done < cfg->macro_instructions && c8->running) {
+            done += trace ? chip8_trace_run(&t, c8, ipf) : chip8_run(c8, ipf);
+            chip8_tick_timers(c8);
+            frames++;
+        }
+        // Includes the writer draining the ring, so a backlog is not left out of the time
+        if (trace && !chip8_trace_close(&t)) return false;
+        double seconds = (double)(host_time_ns() - start) / 1e9;
+
+        double bytes = 0.0;
+        if (trace) {
+            FILE* f = fopen(TRACE_PATH, "rb");
+            if (f) {
+                fseek(f, 0, SEEK_END);
+                bytes = (double)ftell(f);
+                fclose(f);
+            }
+            remove(TRACE_PATH);
+        }
+        if (r == 0 || seconds < out->seconds) {
+            out->seconds = seconds;
+            out->instructions = done;
+            out->frames = frames;
+            out->bytes_per = done ? bytes / (double)done : 0.0;
+            out->per = trace ? "instr" : NULL;
+        }
+    }
+    return true;
+}
+
+typedef enum BlitVariant {
+    BLIT_PIXEL,      // chip8_pixel_color per pixel, as the presentation path used to
+    BLIT_KERNEL,     // chip8_blit
+    BLIT_NEAREST,    // chip8_blit, then chip8_upscale_nearest by BLIT_SCALE
+    BLIT_SCALE2X,    // chip8_blit, then chip8_upscale_scale2x
+    BLIT_VARIANT_COUNT,
+} BlitVariant;
+
+static const uint32_t blit_palette[1 << CHIP8_DISPLAY_PLANES] = {
+    0xFF000000, 0xFF00FF00, 0xFFFF8000, 0xFFFFFFFF
+};
+
+// Blit suite: convert the whole 128x64 display left after BLIT_SETTLE_FRAMES of the ROM,
+// BLIT_FRAMES times. fps is conversions per second; instructions counts output pixels, so
+// ns/instr is the cost per pixel written.
+static bool run_blit_bench(const BenchConfig* cfg, const RomBuilder* rom, BlitVariant variant, BenchResult* out) {
+    static uint32_t argb[CHIP8_HIGH_RES_HEIGHT * CHIP8_HIGH_RES_WIDTH];
+    static uint32_t scaled[CHIP8_HIGH_RES_HEIGHT * BLIT_SCALE * CHIP8_HIGH_RES_WIDTH * BLIT_SCALE];
+    static const char* const names[BLIT_VARIANT_COUNT] = { "pixel", NULL, "nearest4", "scale2x" };
+    const int w = CHIP8_HIGH_RES_WIDTH;
+    const int h = CHIP8_HIGH_RES_HEIGHT;
+
+    Chip8* c8 = load_machine(rom, cfg->quirks);
+    for (int f = 0; f < BLIT_SETTLE_FRAMES && c8->running; ++f) {
+        chip8_run(c8, cfg->instructions_per_frame);
+        chip8_tick_timers(c8);
+    }
+    int width, height;
+    const uint64_t* display = chip8_get_display(c8, &width, &height);
+
+    uint64_t pixels = (uint64_t)w * (uint64_t)h;
+    if (variant == BLIT_NEAREST) pixels *= BLIT_SCALE * BLIT_SCALE;
+    else if (variant == BLIT_SCALE2X) pixels *= 4;
+
+    out->engine = variant == BLIT_KERNEL ? chip8_blit_simd() : names[variant];
+    out->seconds = 0.0;
+    for (int r = 0; r < cfg->repeats; ++r) {
+        uint64_t start = host_time_ns();
+        for (int n = 0; n < BLIT_FRAMES; ++n) {
+            if (variant == BLIT_PIXEL) {
+                for (int y = 0; y < h; ++y) {
+                    for (int x = 0; x < w; ++x) argb[y * w + x] = blit_palette[chip8_pixel_color(display, x, y)];
+                }
+                continue;
+            }
+            chip8_blit(display, w, h, blit_palette, argb, (size_t)w);
+            if (variant == BLIT_NEAREST) {
+                chip8_upscale_nearest(argb, w, h, (size_t)w, scaled, (size_t)w * BLIT_SCALE, BLIT_SCALE);
+            }
+            else if (variant == BLIT_SCALE2X) {
+                chip8_upscale_scale2x(argb, w, h, (size_t)w, scaled, (size_t)w * 2);
+            }
+        }
+        double seconds = (double)(host_time_ns() - start) / 1e9;
+        if (r == 0 || seconds < out->seconds) {
+            out->seconds = seconds;
+            out->instructions = pixels * BLIT_FRAMES;
+            out->frames = BLIT_FRAMES;
+        }
+    }
+    return true;
+}
+
+static void print_header(OutputFormat format) {
+    if (format == OUTPUT_CSV) {
+        printf("suite,name,engine,instructions,seconds,ips,ns_per_instruction,fps,bytes_per,per\n");
+    }
+    else if (format == OUTPUT_JSON) {
+        printf("{\n  \"results\": [\n");
+    }
+    else {
+        printf("%-6s %-22s %-9s %12s %10s %8s %10s\n",
+            "suite", "name", "engine", "ips", "ns/instr", "Mips", "fps");
+    }
+}
+
+static void print_result(OutputFormat format, const BenchResult* r, bool first) {
+    double ips = r->seconds > 0.0 ? (double)r->instructions / r->seconds : 0.0;
+    double ns = r->instructions ? r->seconds * 1e9 / (double)r->instructions : 0.0;
+    double fps = r->seconds > 0.0 ? (double)r->frames / r->seconds : 0.0;
+    const char* engine = r->engine;
+
+    if (format == OUTPUT_CSV) {
+        printf("%s,%s,%s,%llu,%.6f,%.0f,%.3f,", r->suite, r->name, engine,
+            (unsigned long long)r->instructions, r->seconds, ips, ns);
+        if (r->frames) printf("%.1f", fps);
+        printf(",");
+        if (r->per) printf("%.2f,%s", r->bytes_per, r->per);
+        else printf(",");
+        printf("\n");
+    }
+    else if (format == OUTPUT_JSON) {
+        printf("%s    {\"suite\": \"%s\", \"name\": \"%s\", \"engine\": \"%s\", \"instructions\": %llu, "
+            "\"seconds\": %.6f, \"ips\": %.0f, \"ns_per_instruction\": %.3f, \"fps\": ",
+            first ? "" : ",\n", r->suite, r->name, engine,
+            (unsigned long long)r->instructions, r->seconds, ips, ns);
+        if (r->frames) printf("%.1f", fps);
+        else printf("null");
+        if (r->per) printf(", \"bytes_per_%s\": %.2f", r->per, r->bytes_per);
+        printf("}");
+    }
+    else {
+        printf("%-6s %-22s %-9s %12.0f %10.3f %8.1f ", r->suite, r->name, engine, ips, ns, ips / 1e6);
+        if (r->frames) printf("%10.0f", fps);
+        else printf("%10s", "-");
+        if (r->per) printf(" %8.2f B/%s", r->bytes_per, r->per);
+        printf("\n");
+    }
+    fflush(stdout);
+}
+
+static void print_footer(OutputFormat format, const BenchConfig* cfg) {
+    if (format == OUTPUT_JSON) {
+        printf("\n  ],\n  \"micro_instructions\": %llu,\n  \"macro_instructions\": %llu,\n"
+            "  \"repeats\": %d,\n  \"instructions_per_frame\": %u,\n  \"quirks\": \"%s\",\n"
+            "  \"lanes\": %d,\n  \"lockstep_simd\": \"%s\",\n  \"blit_simd\": \"%s\"\n}\n",
+            (unsigned long long)cfg->micro_instructions,
+            (unsigned long long)cfg->macro_instructions,
+            cfg->repeats, cfg->instructions_per_frame, chip8_quirks_name(cfg->quirks),
+            cfg->lanes, chip8_lockstep_simd(), chip8_blit_simd());
+    }
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  -s S   suite: micro, macro, lanes, env, clone, trace, blit or all (default all)\n"
+        "  -e E   engine: switch, threaded, jit or all (default all)\n"
+        "  -k S   only run benchmarks whose name contains S\n"
+        "  -n N   instructions per microbenchmark (default %d)\n"
+        "  -m N   instructions per corpus ROM (default %d)\n"
+        "  -r N   repeats, best time is reported (default %d)\n"
+        "  -i N   instructions per 60Hz frame for the corpus (default %d)\n"
+        "  -f F   output format: text, csv or json (default text)\n"
+        "  -Q P   quirk profile: modern, vip, chip48, schip, xochip (default modern)\n"
+        "  -L N   machines per ROM in the lanes and env suites, 1-%d (default %d)\n"
+        "  -l     list benchmarks and exit\n",
+        prog, DEFAULT_MICRO_INSTRUCTIONS, DEFAULT_MACRO_INSTRUCTIONS, DEFAULT_REPEATS,
+        DEFAULT_INSTRUCTIONS_PER_FRAME, CHIP8_LOCKSTEP_LANES, CHIP8_LOCKSTEP_LANES);
+}
+
+int main(int argc, char* argv[]) {
+    BenchConfig cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.micro_instructions = DEFAULT_MICRO_INSTRUCTIONS;
+    cfg.macro_instructions = DEFAULT_MACRO_INSTRUCTIONS;
+    cfg.repeats = DEFAULT_REPEATS;
+    cfg.instructions_per_frame = DEFAULT_INSTRUCTIONS_PER_FRAME;
+    cfg.run_micro = true;
+    cfg.run_macro = true;
+    cfg.run_lockstep = true;
+    cfg.run_env = true;
+    cfg.run_clone = true;
+    cfg.run_trace = true;
+    cfg.run_blit = true;
+    cfg.lanes = CHIP8_LOCKSTEP_LANES;
+    for (int e = 0; e < CHIP8_ENGINE_COUNT; ++e) cfg.engines[e] = true;
+
+    size_t micro_count = sizeof(micro_benches) / sizeof(micro_benches[0]);
+    size_t macro_count = sizeof(macro_benches) / sizeof(macro_benches[0]);
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(arg, "-s") == 0 && has_value) {
+            const char* suite = argv[++i];
+            cfg.run_micro = strcmp(suite, "micro") == 0 || strcmp(suite, "all") == 0;
+            cfg.run_macro = strcmp(suite, "macro") == 0 || strcmp(suite, "all") == 0;
+            cfg.run_lockstep = strcmp(suite, "lanes") == 0 || strcmp(suite, "all") == 0;
+            cfg.run_env = strcmp(suite, "env") == 0 || strcmp(suite, "all") == 0;
+            cfg.run_clone = strcmp(suite, "clone") == 0 || strcmp(suite, "all") == 0;
+            cfg.run_trace = strcmp(suite, "trace") == 0 || strcmp(suite, "all") == 0;
+            cfg.run_blit = strcmp(suite, "blit") == 0 || strcmp(suite, "all") == 0;
+            if (!cfg.run_micro && !cfg.run_macro && !cfg.run_lockstep && !cfg.run_env &&
+                !cfg.run_clone && !cfg.run_trace && !cfg.run_blit) {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(arg, "-e") == 0 && has_value) {
+            const char* name = argv[++i];
+            if (strcmp(name, "all") != 0) {
+                Chip8EngineKind kind;
+                if (!chip8_engine_parse(name, &kind)) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                memset(cfg.engines, 0, sizeof(cfg.engines));
+                cfg.engines[kind] = true;
+            }
+        }
+        else if (strcmp(arg, "-k") == 0 && has_value) {
+            cfg.filter = argv[++i];
+        }
+        else if (strcmp(arg, "-n") == 0 && has_value) {
+            cfg.micro_instructions = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(arg, "-m") == 0 && has_value) {
+            cfg.macro_instructions = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(arg, "-r") == 0 && has_value) {
+            cfg.repeats = atoi(argv[++i]);
+        }
+        else if (strcmp(arg, "-i") == 0 && has_value) {
+            cfg.instructions_per_frame = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(arg, "-f") == 0 && has_value) {
+            const char* format = argv[++i];
+            if (strcmp(format, "text") == 0) cfg.format = OUTPUT_TEXT;
+            else if (strcmp(format, "csv") == 0) cfg.format = OUTPUT_CSV;
+            else if (strcmp(format, "json") == 0) cfg.format = OUTPUT_JSON;
+            else {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(arg, "-Q") == 0 && has_value) {
+            if (!chip8_quirks_parse(argv[++i], &cfg.quirks)) {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(arg, "-L") == 0 && has_value) {
+            cfg.lanes = atoi(argv[++i]);
+        }
+        else if (strcmp(arg, "-l") == 0) {
+            for (size_t b = 0; b < micro_count; ++b) printf("micro %s\n", micro_benches[b].name);
+            for (size_t b = 0; b < macro_count; ++b) printf("macro %s\n", macro_benches[b].name);
+            return 0;
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (cfg.repeats <= 0 || cfg.instructions_per_frame == 0 ||
+        cfg.lanes < 1 || cfg.lanes > CHIP8_LOCKSTEP_LANES) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    static RomBuilder rom;
+    BenchResult result;   // cleared before every run: runners only set the fields they measure
+    bool first = true;
+    print_header(cfg.format);
+
+    for (size_t b = 0; cfg.run_micro && b < micro_count; ++b) {
+        const MicroBench* m = &micro_benches[b];
+        if (cfg.filter && !strstr(m->name, cfg.filter)) continue;
+        build_micro(&rom, m);
+        for (int e = 0; e < CHIP8_ENGINE_COUNT; ++e) {
+            memset(&result, 0, sizeof(result));
+            if (!cfg.engines[e] || !run_bench(&cfg, &rom, false, (Chip8EngineKind)e, &result)) continue;
+            result.suite = "micro";
+            result.name = m->name;
+            print_result(cfg.format, &result, first);
+            first = false;
+        }
+    }
+
+    for (size_t b = 0; cfg.run_macro && b < macro_count; ++b) {
+        const MacroBench* m = &macro_benches[b];
+        if (cfg.filter && !strstr(m->name, cfg.filter)) continue;
+        m->build(&rom);
+        for (int e = 0; e < CHIP8_ENGINE_COUNT; ++e) {
+            memset(&result, 0, sizeof(result));
+            if (!cfg.engines[e] || !run_bench(&cfg, &rom, true, (Chip8EngineKind)e, &result)) continue;
+            result.suite = "macro";
+            result.name = m->name;
+            print_result(cfg.format, &result, first);
+            first = false;
+        }
+    }
+
+    // XO-CHIP machines cannot run in lockstep lanes
+    for (size_t b = 0; cfg.run_lockstep && cfg.quirks != CHIP8_QUIRKS_XOCHIP && b < macro_count; ++b) {
+        const MacroBench* m = &macro_benches[b];
+        if (cfg.filter && !strstr(m->name, cfg.filter)) continue;
+        m->build(&rom);
+        for (int lockstep = 0; lockstep < 2; ++lockstep) {
+            memset(&result, 0, sizeof(result));
+            if (!run_lockstep_bench(&cfg, &rom, lockstep != 0, &result)) continue;
+            result.suite = "lanes";
+            result.name = m->name;
+            print_result(cfg.format, &result, first);
+            first = false;
+        }
+    }
+
+    for (size_t b = 0; cfg.run_env && b < macro_count; ++b) {
+        const MacroBench* m = &macro_benches[b];
+        if (cfg.filter && !strstr(m->name, cfg.filter)) continue;
+        m->build(&rom);
+        for (int many = 0; many < 2; ++many) {
+            memset(&result, 0, sizeof(result));
+            if (!run_env_bench(&cfg, &rom, many != 0, &result)) continue;
+            result.suite = "env";
+            result.name = m->name;
+            print_result(cfg.format, &result, first);
+            first = false;
+        }
+    }
+
+    for (size_t b = 0; cfg.run_clone && b < macro_count; ++b) {
+        const MacroBench* m = &macro_benches[b];
+        if (cfg.filter && !strstr(m->name, cfg.filter)) continue;
+        m->build(&rom);
+        for (int cow = 0; cow < 2; ++cow) {
+            memset(&result, 0, sizeof(result));
+            if (!run_clone_bench(&cfg, &rom, cow != 0, &result)) continue;
+            result.suite = "clone";
+            result.name = m->name;
+            print_result(cfg.format, &result, first);
+            first = false;
+        }
+    }
+
+    for (size_t b = 0; cfg.run_trace && b < macro_count; ++b) {
+        const MacroBench* m = &macro_benches[b];
+        if (cfg.filter && !strstr(m->name, cfg.filter)) continue;
+        m->build(&rom);
+        for (int trace = 0; trace < 2; ++trace) {
+            memset(&result, 0, sizeof(result));
+            if (!run_trace_bench(&cfg, &rom, trace != 0, &result)) continue;
+            result.suite = "trace";
+            result.name = m->name;
+            print_result(cfg.format, &result, first);
+            first = false;
+        }
+    }
+
+    for (size_t b = 0; cfg.run_blit && b < macro_count; ++b) {
+        const MacroBench* m = &macro_benches[b];
+        if (cfg.filter && !strstr(m->name, cfg.filter)) continue;
+        m->build(&rom);
+        for (int v = 0; v < BLIT_VARIANT_COUNT; ++v) {
+            memset(&result, 0, sizeof(result));
+            if (!run_blit_bench(&cfg, &rom, (BlitVariant)v, &result)) continue;
+            result.suite = "blit";
+            result.name = m->name;
+            print_result(cfg.format, &result, first);
+            first = false;
+        }
+    }
+
+    print_footer(cfg.format, &cfg);
+    return 0;
+}
@@ -1,456 +1,524 @@
-// Complete CPU draw flag and display handling
-
-
-#include "chip8.h"
-#include <string.h>
-#include <stdlib.h>
-#include <stdio.h>
-#include <time.h>
-
-// Standard CHIP-8 4x5 font (0-F)
-static const uint8_t font_small[16 * 5] = {
-    0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
-    0x20, 0x60, 0x20, 0x20, 0x70, // 1
-    0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
-    0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
-    0x90, 0x90, 0xF0, 0x10, 0x10, // 4
-    0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
-    0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
-    0xF0, 0x10, 0x20, 0x40, 0x40, // 7
-    0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
-    0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
-    0xF0, 0x90, 0xF0, 0x90, 0x90, // A
-    0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
-    0xF0, 0x80, 0x80, 0x80, 0xF0, // C
-    0xE0, 0x90, 0x90, 0x90, 0xE0, // D
-    0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
-    0xF0, 0x80, 0xF0, 0x80, 0x80  // F
-};
-
-// Super CHIP-8 8x10 font for 0-9 (big font)
-static const uint8_t font_big[10 * 10] = {
-    // 0
-    0x3C, 0x42, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x42, 0x3C,
-    // 1
-    0x18, 0x38, 0x58, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x7E,
-    // 2
-    0x3C, 0x42, 0x81, 0x01, 0x02, 0x0C, 0x30, 0x40, 0x80, 0xFF,
-    // 3
-    0xFF, 0x02, 0x0C, 0x10, 0x3C, 0x02, 0x01, 0x81, 0x42, 0x3C,
-    // 4
-    0x04, 0x0C, 0x14, 0x24, 0x44, 0x84, 0xFF, 0x04, 0x04, 0x04,
-    // 5
-    0xFF, 0x80, 0x80, 0xFC, 0x02, 0x01, 0x01, 0x81, 0x42, 0x3C,
-    // 6
-    0x3C, 0x42, 0x81, 0x80, 0xFC, 0x82, 0x81, 0x81, 0x42, 0x3C,
-    // 7
-    0xFF, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x40, 0x40, 0x40,
-    // 8
-    0x3C, 0x42, 0x81, 0x42, 0x3C, 0x42, 0x81, 0x81, 0x42, 0x3C,
-    // 9
-    0x3C, 0x42, 0x81, 0x81, 0x43, 0x3D, 0x01, 0x81, 0x42, 0x3C
-};
-
-static void clear_display(Chip8* c8) {
-    memset(c8->display, 0, sizeof(c8->display));
-    c8->draw_flag = true;
-}
-
-void chip8_init(Chip8* c8) {
-    memset(c8, 0, sizeof(Chip8));
-
-    c8->pc = 0x200;           // Programs start at 0x200
-    c8->I = 0;
-    c8->sp = 0;
-    c8->high_res = false;          // Start in low resolution
-    c8->running = true;
-
-    // Load small font at 0x000
-    memcpy(&c8->memory[0x000], font_small, sizeof(font_small));
-
-    // Load big font at 0x050
-    memcpy(&c8->memory[0x050], font_big, sizeof(font_big));
-
-    srand((unsigned int)time(NULL));
-}
-
-bool chip8_load_rom(Chip8* c8, const char* path) {
-    FILE* f = NULL;
-#ifdef _MSC_VER
-    fopen_s(&f, path, "rb");
-#else
-    f = fopen(path, "rb");
-#endif
-    if (!f) {
-        fprintf(stderr, "Failed to open ROM: %s\n", path);
-        return false;
-    }
-
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-
-    if (size <= 0 || (size + 0x200) > CHIP8_MEMORY_SIZE) {
-        fprintf(stderr, "ROM too big or invalid size\n");
-        fclose(f);
-        return false;
-    }
-
-    size_t read = fread(&c8->memory[0x200], 1, (size_t)size, f);
-    fclose(f);
-
-    if (read != (size_t)size) {
-        fprintf(stderr, "ROM read mismatch\n");
-        return false;
-    }
-
-    return true;
-}
-
-void chip8_key_down(Chip8* c8, uint8_t key) {
-    if (key < CHIP8_KEY_COUNT) {
-        c8->keys[key] = true;
-    }
-}
-
-void chip8_key_up(Chip8* c8, uint8_t key) {
-    if (key < CHIP8_KEY_COUNT) {
-        c8->keys[key] = false;
-    }
-}
-// Get display buffer and current logical resolution
-const bool* chip8_get_display(const Chip8* c8, int* width, int* height) {
-    if (c8->high_res) {
-        *width = CHIP8_HIGH_RES_WIDTH;
-        *height = CHIP8_HIGH_RES_HEIGHT;
-    }
-    else {
-        *width = CHIP8_LOW_RES_WIDTH;
-        *height = CHIP8_LOW_RES_HEIGHT;
-    }
-    return c8->display;
-}
-
-// Scroll display down by n pixels
-static void scroll_down(Chip8* c8, uint8_t n) {
-    int w = c8->high_res ? CHIP8_HIGH_RES_WIDTH : CHIP8_LOW_RES_WIDTH;
-    int h = c8->high_res ? CHIP8_HIGH_RES_HEIGHT : CHIP8_LOW_RES_HEIGHT;
-
-    if (n == 0) return;
-    if (n > h) n = (uint8_t)h;
-
-    for (int y = h - 1; y >= 0; --y) {
-        int src_y = y - n;
-        for (int x = 0; x < w; ++x) {
-            bool val = false;
-            if (src_y >= 0)
-                val = c8->display[src_y * CHIP8_HIGH_RES_WIDTH + x];
-            c8->display[y * CHIP8_HIGH_RES_WIDTH + x] = val;
-        }
-    }
-    c8->draw_flag = true;
-}
-// Scroll display right by 4 pixels
-static void scroll_right(Chip8* c8) {
-    int w = c8->high_res ? CHIP8_HIGH_RES_WIDTH : CHIP8_LOW_RES_WIDTH;
-    int h = c8->high_res ? CHIP8_HIGH_RES_HEIGHT : CHIP8_LOW_RES_HEIGHT;
-
-    for (int y = 0; y < h; ++y) {
-        for (int x = w - 1; x >= 0; --x) {
-            int src_x = x - 4;
-            bool val = false;
-            if (src_x >= 0)
-                val = c8->display[y * CHIP8_HIGH_RES_WIDTH + src_x];
-            c8->display[y * CHIP8_HIGH_RES_WIDTH + x] = val;
-        }
-    }
-    c8->draw_flag = true;
-}
-// Scroll display left by 4 pixels
-static void scroll_left(Chip8* c8) {
-    int w = c8->high_res ? CHIP8_HIGH_RES_WIDTH : CHIP8_LOW_RES_WIDTH;
-    int h = c8->high_res ? CHIP8_HIGH_RES_HEIGHT : CHIP8_LOW_RES_HEIGHT;
-
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            int src_x = x + 4;
-            bool val = false;
-            if (src_x < w)
-                val = c8->display[y * CHIP8_HIGH_RES_WIDTH + src_x];
-            c8->display[y * CHIP8_HIGH_RES_WIDTH + x] = val;
-        }
-    }
-    c8->draw_flag = true;
-}
-
-static void draw_sprite(Chip8* c8, uint8_t x, uint8_t y, uint8_t n) {
-    int w = c8->high_res ? CHIP8_HIGH_RES_WIDTH : CHIP8_LOW_RES_WIDTH;
-    int h = c8->high_res ? CHIP8_HIGH_RES_HEIGHT : CHIP8_LOW_RES_HEIGHT;
-
-    c8->V[0xF] = 0;
-
-    if (n == 0 && c8->high_res) {
-        // Super CHIP-8 16x16 sprite
-        for (int row = 0; row < 16; ++row) {
-            uint16_t spr_row = (uint16_t)c8->memory[c8->I + row * 2] << 8 |
-                (uint16_t)c8->memory[c8->I + row * 2 + 1];
-
-            for (int col = 0; col < 16; ++col) {
-                if ((spr_row & (0x8000 >> col)) != 0) {
-                    int px = (x + col) % w;
-                    int py = (y + row) % h;
-                    int idx = py * CHIP8_HIGH_RES_WIDTH + px;
-                    if (c8->display[idx])
-                        c8->V[0xF] = 1;
-                    c8->display[idx] = !c8->display[idx];
-                }
-            }
-        }
-    }
-    else {
-        // Standard 8xN sprite
-        for (int row = 0; row < n; ++row) {
-            uint8_t spr_row = c8->memory[c8->I + row];
-            for (int col = 0; col < 8; ++col) {
-                if ((spr_row & (0x80 >> col)) != 0) {
-                    int px = (x + col) % w;
-                    int py = (y + row) % h;
-                    int idx = py * CHIP8_HIGH_RES_WIDTH + px;
-                    if (c8->display[idx])
-                        c8->V[0xF] = 1;
-                    c8->display[idx] = !c8->display[idx];
-                }
-            }
-        }
-    }
-
-    c8->draw_flag = true;
-}
-
-void chip8_cycle(Chip8* c8) {
-    if (!c8->running) return;
-
-    uint16_t opcode = (uint16_t)c8->memory[c8->pc] << 8 |
-        (uint16_t)c8->memory[c8->pc + 1];
-    c8->pc += 2;
-
-    uint8_t  x = (opcode & 0x0F00) >> 8;
-    uint8_t  y = (opcode & 0x00F0) >> 4;
-    uint8_t  n = (opcode & 0x000F);
-    uint8_t  kk = (opcode & 0x00FF);
-    uint16_t nnn = (opcode & 0x0FFF);
-
-    switch (opcode & 0xF000) {
-    case 0x0000:
-        switch (opcode) {
-        case 0x00E0: // CLS
-            clear_display(c8);
-            break;
-        case 0x00EE: // RET
-            if (c8->sp > 0) {
-                c8->sp--;
-                c8->pc = c8->stack[c8->sp];
-            }
-            break;
-        case 0x00FE: // LOW RES (Super CHIP-8)
-            c8->high_res = false;
-            clear_display(c8);
-            break;
-        case 0x00FF: // HIGH RES (Super CHIP-8)
-            c8->high_res = true;
-            clear_display(c8);
-            break;
-        case 0x00FD: // EXIT (Super CHIP-8)
-            c8->running = false;
-            break;
-        case 0x00FB: // SCROLL RIGHT 4
-            scroll_right(c8);
-            break;
-        case 0x00FC: // SCROLL LEFT 4
-            scroll_left(c8);
-            break;
-        default:
-            if ((opcode & 0xFFF0) == 0x00C0) {
-                // 00CN: scroll down N lines
-                uint8_t lines = (uint8_t)(opcode & 0x000F);
-                scroll_down(c8, lines);
-            }
-            else {
-                // System call / ignored
-            }
-            break;
-        }
-        break;
-
-    case 0x1000: // JP addr
-        c8->pc = nnn;
-        break;
-
-    case 0x2000: // CALL addr
-        if (c8->sp < CHIP8_STACK_SIZE) {
-            c8->stack[c8->sp] = c8->pc;
-            c8->sp++;
-            c8->pc = nnn;
-        }
-        break;
-
-    case 0x3000: // SE Vx, byte
-        if (c8->V[x] == kk)
-            c8->pc += 2;
-        break;
-
-    case 0x4000: // SNE Vx, byte
-        if (c8->V[x] != kk)
-            c8->pc += 2;
-        break;
-
-    case 0x5000: // SE Vx, Vy
-        if ((opcode & 0x000F) == 0x0) {
-            if (c8->V[x] == c8->V[y])
-                c8->pc += 2;
-        }
-        break;
-
-    case 0x6000: // LD Vx, byte
-        c8->V[x] = kk;
-        break;
-
-    case 0x7000: // ADD Vx, byte
-        c8->V[x] += kk;
-        break;
-
-    case 0x8000:
-        switch (opcode & 0x000F) {
-        case 0x0: // LD Vx, Vy
-            c8->V[x] = c8->V[y];
-            break;
-        case 0x1: // OR Vx, Vy
-            c8->V[x] |= c8->V[y];
-            break;
-        case 0x2: // AND Vx, Vy
-            c8->V[x] &= c8->V[y];
-            break;
-        case 0x3: // XOR Vx, Vy
-            c8->V[x] ^= c8->V[y];
-            break;
-        case 0x4: { // ADD Vx, Vy
-            uint16_t sum = c8->V[x] + c8->V[y];
-            c8->V[0xF] = sum > 0xFF;
-            c8->V[x] = (uint8_t)(sum & 0xFF);
-        } break;
-        case 0x5: // SUB Vx, Vy
-            c8->V[0xF] = c8->V[x] > c8->V[y];
-            c8->V[x] = (uint8_t)(c8->V[x] - c8->V[y]);
-            break;
-        case 0x6: // SHR Vx {, Vy}
-            c8->V[0xF] = c8->V[x] & 0x1;
-            c8->V[x] >>= 1;
-            break;
-        case 0x7: // SUBN Vx, Vy
-            c8->V[0xF] = c8->V[y] > c8->V[x];
-            c8->V[x] = (uint8_t)(c8->V[y] - c8->V[x]);
-            break;
-        case 0xE: // SHL Vx {, Vy}
-            c8->V[0xF] = (c8->V[x] & 0x80) >> 7;
-            c8->V[x] <<= 1;
-            break;
-        default:
-            break;
-        }
-        break;
-
-    case 0x9000: // SNE Vx, Vy
-        if ((opcode & 0x000F) == 0x0) {
-            if (c8->V[x] != c8->V[y])
-                c8->pc += 2;
-        }
-        break;
-
-    case 0xA000: // LD I, addr
-        c8->I = nnn;
-        break;
-
-    case 0xB000: // JP V0, addr
-        c8->pc = nnn + c8->V[0];
-        break;
-
-    case 0xC000: // RND Vx, byte
-        c8->V[x] = (uint8_t)((rand() % 256) & kk);
-        break;
-
-    case 0xD000: // DRW Vx, Vy, nibble
-        draw_sprite(c8, c8->V[x], c8->V[y], n);
-        break;
-
-    case 0xE000:
-        switch (opcode & 0x00FF) {
-        case 0x9E: // SKP Vx
-            if (c8->keys[c8->V[x]]) c8->pc += 2;
-            break;
-        case 0xA1: // SKNP Vx
-            if (!c8->keys[c8->V[x]]) c8->pc += 2;
-            break;
-        default:
-            break;
-        }
-        break;
-
-    case 0xF000:
-        switch (opcode & 0x00FF) {
-        case 0x07: // LD Vx, DT
-            c8->V[x] = c8->delay_timer;
-            break;
-        case 0x0A: { // LD Vx, K (wait for key)
-            bool found = false;
-            for (int i = 0; i < CHIP8_KEY_COUNT; ++i) {
-                if (c8->keys[i]) {
-                    c8->V[x] = (uint8_t)i;
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
-                // Repeat this instruction
-                c8->pc -= 2;
-            }
-        } break;
-        case 0x15: // LD DT, Vx
-            c8->delay_timer = c8->V[x];
-            break;
-        case 0x18: // LD ST, Vx
-            c8->sound_timer = c8->V[x];
-            break;
-        case 0x1E: // ADD I, Vx
-            c8->I += c8->V[x];
-            break;
-        case 0x29: // LD F, Vx (small font)
-            c8->I = (uint16_t)(c8->V[x] * 5);
-            break;
-        case 0x30: // LD HF, Vx (big font digit)
-            c8->I = (uint16_t)(0x50 + (c8->V[x] * 10));
-            break;
-        case 0x33: { // LD B, Vx (BCD)
-            uint8_t v = c8->V[x];
-            c8->memory[c8->I + 0] = (uint8_t)(v / 100);
-            c8->memory[c8->I + 1] = (uint8_t)((v / 10) % 10);
-            c8->memory[c8->I + 2] = (uint8_t)(v % 10);
-        } break;
-        case 0x55: // LD [I], V0..Vx
-            for (uint8_t i = 0; i <= x; ++i) {
-                c8->memory[c8->I + i] = c8->V[i];
-            }
-            break;
-        case 0x65: // LD V0..Vx, [I]
-            for (uint8_t i = 0; i <= x; ++i) {
-                c8->V[i] = c8->memory[c8->I + i];
-            }
-            break;
-        default:
-            break;
-        }
-        break;
-
-    default:
-        break;
-    }
-}
+// Complete CPU draw flag and display handling
+
+
+#include "chip8.h"
+#include "chip8_internal.h"
+#include "chip8_fb.h"
+#include "chip8_profile.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+// Standard CHIP-8 4x5 font (0-F)
+static const uint8_t font_small[16 * 5] = {
+    0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+    0x20, 0x60, 0x20, 0x20, 0x70, // 1
+    0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+    0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+    0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+    0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+    0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+    0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+    0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+    0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+    0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+    0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+    0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+    0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+    0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+    0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+};
+
+// Super CHIP-8 8x10 font for 0-9 (big font)
+static const uint8_t font_big[10 * 10] = {
+    // 0
+    0x3C, 0x42, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0x42, 0x3C,
+    // 1
+    0x18, 0x38, 0x58, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x7E,
+    // 2
+    0x3C, 0x42, 0x81, 0x01, 0x02, 0x0C, 0x30, 0x40, 0x80, 0xFF,
+    // 3
+    0xFF, 0x02, 0x0C, 0x10, 0x3C, 0x02, 0x01, 0x81, 0x42, 0x3C,
+    // 4
+    0x04, 0x0C, 0x14, 0x24, 0x44, 0x84, 0xFF, 0x04, 0x04, 0x04,
+    // 5
+    0xFF, 0x80, 0x80, 0xFC, 0x02, 0x01, 0x01, 0x81, 0x42, 0x3C,
+    // 6
+    0x3C, 0x42, 0x81, 0x80, 0xFC, 0x82, 0x81, 0x81, 0x42, 0x3C,
+    // 7
+    0xFF, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x40, 0x40, 0x40,
+    // 8
+    0x3C, 0x42, 0x81, 0x42, 0x3C, 0x42, 0x81, 0x81, 0x42, 0x3C,
+    // 9
+    0x3C, 0x42, 0x81, 0x81, 0x43, 0x3D, 0x01, 0x81, 0x42, 0x3C
+};
+
+_Static_assert(offsetof(Chip8Xo, memory_high) == offsetof(Chip8, memory) + CHIP8_MEMORY_SIZE,
+    "Chip8Xo memory must continue Chip8.memory without a gap");
+
+// Bitmask with bits [0, h) set
+static uint64_t rows_below(int h) {
+    return h >= 64 ? ~0ull : (1ull << h) - 1;
+}
+
+// Planes a display operation acts on. Plane 1 stays blank outside XO-CHIP, so classic
+// machines can move and clear whole rows.
+static int selected_planes(const Chip8* c8) {
+    return c8->quirks == CHIP8_QUIRKS_XOCHIP ? c8->planes : CHIP8_PLANES_ALL;
+}
+
+void chip8_clear_display(Chip8* c8) {
+    int planes = selected_planes(c8);
+    if (planes == CHIP8_PLANES_ALL) {
+        memset(c8->display, 0, sizeof(c8->display));
+    }
+    else {
+        for (int p = 0; p < CHIP8_DISPLAY_PLANES; ++p) {
+            if (!(planes & (1 << p))) continue;
+            for (int y = 0; y < CHIP8_HIGH_RES_HEIGHT; ++y) {
+                memset(&c8->display[y][p * CHIP8_DISPLAY_WORDS], 0, CHIP8_DISPLAY_WORDS * sizeof(uint64_t));
+            }
+        }
+    }
+    c8->dirty_rows = ~0ull;
+    c8->draw_flag = true;
+}
+
+void chip8_init(Chip8* c8) {
+    memset(c8, 0, sizeof(Chip8));
+    c8->addr_mask = CHIP8_ADDR_MASK;
+    c8->planes = 1;
+    c8->pitch = 64;   // 4000 samples per second
+
+    c8->pc = 0x200;           // Programs start at 0x200
+    c8->I = 0;
+    c8->sp = 0;
+    c8->high_res = false;          // Start in low resolution
+    c8->running = true;
+
+    // Load small font at 0x000
+    memcpy(&c8->memory[0x000], font_small, sizeof(font_small));
+
+    // Load big font at 0x050
+    memcpy(&c8->memory[0x050], font_big, sizeof(font_big));
+
+    chip8_seed(c8, CHIP8_DEFAULT_SEED);
+    c8->quirks = CHIP8_QUIRKS_MODERN;
+}
+
+void chip8_xo_init(Chip8Xo* xo) {
+    chip8_init(&xo->base);
+    memset(xo->memory_high, 0, sizeof(xo->memory_high));
+    xo->base.addr_mask = CHIP8_XO_ADDR_MASK;
+    xo->base.quirks = CHIP8_QUIRKS_XOCHIP;
+}
+
+size_t chip8_machine_size(const Chip8* c8) {
+    return c8->addr_mask == CHIP8_XO_ADDR_MASK ? sizeof(Chip8Xo) : sizeof(Chip8);
+}
+
+static const char* const quirks_names[CHIP8_QUIRKS_COUNT] = {
+    "modern",
+    "vip",
+    "chip48",
+    "schip",
+    "xochip",
+};
+
+bool chip8_set_quirks(Chip8* c8, Chip8Quirks quirks) {
+    if ((unsigned)quirks >= CHIP8_QUIRKS_COUNT) return false;
+    bool xo_machine = c8->addr_mask == CHIP8_XO_ADDR_MASK;
+    if ((quirks == CHIP8_QUIRKS_XOCHIP) != xo_machine) return false;
+    c8->quirks = (uint8_t)quirks;
+    return true;
+}
+
+const char* chip8_quirks_name(Chip8Quirks quirks) {
+    return (unsigned)quirks < CHIP8_QUIRKS_COUNT ? quirks_names[quirks] : "unknown";
+}
+
+bool chip8_quirks_parse(const char* name, Chip8Quirks* quirks) {
+    for (int i = 0; i < CHIP8_QUIRKS_COUNT; ++i) {
+        if (strcmp(name, quirks_names[i]) == 0) {
+            *quirks = (Chip8Quirks)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void chip8_seed(Chip8* c8, uint64_t seed) {
+    // splitmix64 finalizer, so neighbouring seeds give unrelated streams
+    uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    c8->rng_state = z ? z : 0x9E3779B97F4A7C15ull;
+}
+
+bool chip8_load_rom(Chip8* c8, const char* path) {
+    FILE* f = NULL;
+#ifdef _MSC_VER
+    fopen_s(&f, path, "rb");
+#else
+    f = fopen(path, "rb");
+#endif
+    if (!f) {
+        fprintf(stderr, "Failed to open ROM: %s\n", path);
+        return false;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    if (size <= 0 || (size + 0x200) > c8->addr_mask + 1) {
+        fprintf(stderr, "ROM too big or invalid size\n");
+        fclose(f);
+        return false;
+    }
+
+    size_t read = fread(&c8->memory[0x200], 1, (size_t)size, f);
+    fclose(f);
+    c8->dirty_pages = 0xFFFF;   // as chip8_load_rom_data; a short read changed memory too
+
+    if (read != (size_t)size) {
+        fprintf(stderr, "ROM read mismatch\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool chip8_load_rom_data(Chip8* c8, const uint8_t* data, size_t size) {
+    if (size == 0 || (size + 0x200) > (size_t)c8->addr_mask + 1) {
+        fprintf(stderr, "ROM too big or invalid size\n");
+        return false;
+    }
+
+    memcpy(&c8->memory[0x200], data, size);
+    c8->dirty_pages = 0xFFFF;
+    return true;
+}
+
+void chip8_key_down(Chip8* c8, uint8_t key) {
+    if (key < CHIP8_KEY_COUNT) {
+        c8->keys[key] = true;
+    }
+}
+
+void chip8_key_up(Chip8* c8, uint8_t key) {
+    if (key < CHIP8_KEY_COUNT) {
+        c8->keys[key] = false;
+    }
+}
+// Get packed display rows and current logical resolution
+const uint64_t* chip8_get_display(const Chip8* c8, int* width, int* height) {
+    if (c8->high_res) {
+        *width = CHIP8_HIGH_RES_WIDTH;
+        *height = CHIP8_HIGH_RES_HEIGHT;
+    }
+    else {
+        *width = CHIP8_LOW_RES_WIDTH;
+        *height = CHIP8_LOW_RES_HEIGHT;
+    }
+    return &c8->display[0][0];
+}
+
+uint64_t chip8_get_dirty_rows(const Chip8* c8) {
+    return c8->dirty_rows;
+}
+
+void chip8_clear_dirty_rows(Chip8* c8) {
+    c8->dirty_rows = 0;
+}
+
+uint64_t chip8_display_hash(const Chip8* c8) {
+    const uint8_t* bytes = (const uint8_t*)c8->display;
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < sizeof(c8->display); ++i) {
+        hash ^= (uint64_t)bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+void chip8_tick_timers(Chip8* c8) {
+    if (c8->delay_timer > 0) {
+        c8->delay_timer--;
+    }
+    if (c8->sound_timer > 0) {
+        c8->sound_timer--;
+    }
+}
+
+// Scroll display down by n pixels
+void chip8_scroll_down(Chip8* c8, uint8_t n) {
+    int h = c8->high_res ? CHIP8_HIGH_RES_HEIGHT : CHIP8_LOW_RES_HEIGHT;
+
+    if (n == 0) return;
+
+    CHIP8_PROFILE_START(c8, start);
+    chip8_fb_scroll_down(c8->display, h, n, selected_planes(c8));
+    c8->dirty_rows |= rows_below(h);
+    c8->draw_flag = true;
+    CHIP8_PROFILE_STOP(c8, CHIP8_PROFILE_SCROLL_DOWN, start);
+}
+// Scroll display up by n pixels (XO-CHIP)
+void chip8_scroll_up(Chip8* c8, uint8_t n) {
+    int h = c8->high_res ? CHIP8_HIGH_RES_HEIGHT : CHIP8_LOW_RES_HEIGHT;
+
+    if (n == 0) return;
+
+    CHIP8_PROFILE_START(c8, start);
+    chip8_fb_scroll_up(c8->display, h, n, selected_planes(c8));
+    c8->dirty_rows |= rows_below(h);
+    c8->draw_flag = true;
+    CHIP8_PROFILE_STOP(c8, CHIP8_PROFILE_SCROLL_UP, start);
+}
+// Scroll display right by 4 pixels
+void chip8_scroll_right(Chip8* c8) {
+    int w = c8->high_res ? CHIP8_HIGH_RES_WIDTH : CHIP8_LOW_RES_WIDTH;
+    int h = c8->high_res ? CHIP8_HIGH_RES_HEIGHT : CHIP8_LOW_RES_HEIGHT;
+
+    CHIP8_PROFILE_START(c8, start);
+    chip8_fb_scroll_right(c8->display, w, h, 4, selected_planes(c8));
+    c8->dirty_rows |= rows_below(h);
+    c8->draw_flag = true;
+    CHIP8_PROFILE_STOP(c8, CHIP8_PROFILE_SCROLL_RIGHT, start);
+}
+// Scroll display left by 4 pixels
+void chip8_scroll_left(Chip8* c8) {
+    int w = c8->high_res ? CHIP8_HIGH_RES_WIDTH : CHIP8_LOW_RES_WIDTH;
+    int h = c8->high_res ? CHIP8_HIGH_RES_HEIGHT : CHIP8_LOW_RES_HEIGHT;
+
+    CHIP8_PROFILE_START(c8, start);
+    chip8_fb_scroll_left(c8->display, w, h, 4, selected_planes(c8));
+    c8->dirty_rows |= rows_below(h);
+    c8->draw_flag = true;
+    CHIP8_PROFILE_STOP(c8, CHIP8_PROFILE_SCROLL_LEFT, start);
+}
+
+// Each sprite row becomes a shifted mask per 64-pixel word: one AND for collision, one XOR.
+// Both planes of a display row sit next to each other, so a two-plane draw makes one pass
+// over the rows and the second plane's XOR lands in the cache line the first just loaded.
+// `clip` is a constant at both call sites, so each gets its own copy of the loops.
+static inline void draw_sprite(Chip8* c8, uint8_t x, uint8_t y, uint8_t n, bool clip) {
+    int w = c8->high_res ? CHIP8_HIGH_RES_WIDTH : CHIP8_LOW_RES_WIDTH;
+    int h = c8->high_res ? CHIP8_HIGH_RES_HEIGHT : CHIP8_LOW_RES_HEIGHT;
+    bool xo = c8->quirks == CHIP8_QUIRKS_XOCHIP;
+    int planes = xo ? c8->planes : 1;
+    uint16_t addr_mask = c8->addr_mask;
+    bool collision = false;
+    uint64_t mask[CHIP8_DISPLAY_WORDS];
+    CHIP8_PROFILE_START(c8, start);
+
+    // Super CHIP-8 draws 16x16 sprites in high res only, XO-CHIP in both resolutions.
+    bool wide = n == 0 && (c8->high_res || xo);
+    int rows = wide ? 16 : n;
+    int row_bytes = wide ? 2 : 1;
+    int sprite_bytes = rows * row_bytes;   // plane 1's sprite follows plane 0's
+
+    for (int row = 0; row < rows; ++row) {
+        int py = clip ? y % h + row : (y + row) % h;
+        if (clip && py >= h) break;
+
+        uint16_t addr = (uint16_t)(c8->I + row * row_bytes);
+        bool touched = false;
+        for (int p = 0; p < CHIP8_DISPLAY_PLANES; ++p) {
+            if (!(planes & (1 << p))) continue;
+            uint32_t bits = c8->memory[addr & addr_mask];
+            if (wide) bits = bits << 8 | c8->memory[(addr + 1) & addr_mask];
+            addr = (uint16_t)(addr + sprite_bytes);
+            if (bits == 0) continue;
+
+            if (clip) chip8_fb_row_mask_clipped(bits, wide ? 16 : 8, x, w, mask);
+            else chip8_fb_row_mask(bits, wide ? 16 : 8, x, w, mask);
+            collision |= chip8_fb_xor_row(&c8->display[py][p * CHIP8_DISPLAY_WORDS], mask);
+            touched = true;
+        }
+        if (touched) c8->dirty_rows |= 1ull << py;
+    }
+
+    c8->V[0xF] = collision ? 1 : 0;
+    c8->draw_flag = true;
+    CHIP8_PROFILE_STOP(c8, CHIP8_PROFILE_DRAW, start);
+}
+
+void chip8_draw_sprite(Chip8* c8, uint8_t x, uint8_t y, uint8_t n) {
+    draw_sprite(c8, x, y, n, false);
+}
+
+void chip8_draw_sprite_clipped(Chip8* c8, uint8_t x, uint8_t y, uint8_t n) {
+    draw_sprite(c8, x, y, n, true);
+}
+
+uint8_t chip8_random_byte(Chip8* c8) {
+    uint64_t s = c8->rng_state;
+    s ^= s >> 12;
+    s ^= s << 25;
+    s ^= s >> 27;
+    c8->rng_state = s;
+    return (uint8_t)((s * 0x2545F4914F6CDD1Dull) >> 56);
+}
+
+bool chip8_wait_key(Chip8* c8, uint8_t x) {
+    for (int i = 0; i < CHIP8_KEY_COUNT; ++i) {
+        if (c8->keys[i]) {
+            c8->V[x] = (uint8_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// A store of len (1-16) bytes at I touches at most two pages, those of its first and last byte
+static void mark_stored(Chip8* c8, int len) {
+    unsigned first = (c8->I & c8->addr_mask) >> CHIP8_PAGE_SHIFT;
+    unsigned last = ((c8->I + len - 1) & c8->addr_mask) >> CHIP8_PAGE_SHIFT;
+    c8->dirty_pages |= (uint16_t)(1u << (first % CHIP8_PAGE_COUNT) | 1u << (last % CHIP8_PAGE_COUNT));
+}
+
+void chip8_store_bcd(Chip8* c8, uint8_t x) {
+    mark_stored(c8, 3);
+    uint8_t v = c8->V[x];
+    c8->memory[(c8->I + 0) & c8->addr_mask] = (uint8_t)(v / 100);
+    c8->memory[(c8->I + 1) & c8->addr_mask] = (uint8_t)((v / 10) % 10);
+    c8->memory[(c8->I + 2) & c8->addr_mask] = (uint8_t)(v % 10);
+}
+
+void chip8_store_registers(Chip8* c8, uint8_t x) {
+    mark_stored(c8, x + 1);
+    for (uint8_t i = 0; i <= x; ++i) {
+        c8->memory[(c8->I + i) & c8->addr_mask] = c8->V[i];
+    }
+}
+
+void chip8_load_registers(Chip8* c8, uint8_t x) {
+    for (uint8_t i = 0; i <= x; ++i) {
+        c8->V[i] = c8->memory[(c8->I + i) & c8->addr_mask];
+    }
+}
+
+void chip8_store_range(Chip8* c8, uint8_t x, uint8_t y) {
+    int step = x <= y ? 1 : -1;
+    mark_stored(c8, x <= y ? y - x + 1 : x - y + 1);
+    for (int i = 0, r = x;; ++i, r += step) {
+        c8->memory[(c8->I + i) & c8->addr_mask] = c8->V[r];
+        if (r == y) break;
+    }
+}
+
+void chip8_load_range(Chip8* c8, uint8_t x, uint8_t y) {
+    int step = x <= y ? 1 : -1;
+    for (int i = 0, r = x;; ++i, r += step) {
+        c8->V[r] = c8->memory[(c8->I + i) & c8->addr_mask];
+        if (r == y) break;
+    }
+}
+
+void chip8_load_audio_pattern(Chip8* c8) {
+    for (int i = 0; i < CHIP8_AUDIO_PATTERN_SIZE; ++i) {
+        c8->audio_pattern[i] = c8->memory[(c8->I + i) & c8->addr_mask];
+    }
+    c8->audio_pattern_set = true;
+}
+
+static inline uint16_t opcode_at(const Chip8* c8, uint16_t addr) {
+    return (uint16_t)(c8->memory[addr & c8->addr_mask] << 8 | c8->memory[(addr + 1) & c8->addr_mask]);
+}
+
+uint32_t chip8_idle_skip(Chip8* c8, uint16_t pc, uint32_t budget) {
+#ifdef CHIP8_PROFILE
+    // Profiles describe the real instruction stream, idle spins included.
+    (void)c8;
+    (void)pc;
+    (void)budget;
+    return 0;
+#else
+    pc &= c8->addr_mask;
+    uint16_t opcode = opcode_at(c8, pc);
+    uint8_t x = (opcode >> 8) & 0xF;
+    uint16_t jump_back = (uint16_t)(0x1000 | pc);
+
+    // 1nnn only reaches the first 4 KB; past it only the Fx0A spin can be an idle loop.
+    if (pc > CHIP8_ADDR_MASK && opcode != (0xF00A | x << 8)) return 0;
+
+    switch (opcode & 0xF000) {
+    case 0x1000: // JP to itself
+        return (opcode & 0x0FFF) == pc ? budget : 0;
+
+    case 0xE000: { // SKP/SKNP Vx; JP back
+        if (opcode_at(c8, pc + 2) != jump_back) return 0;
+        bool down = c8->keys[c8->V[x] & 0xF];
+        bool waiting = (opcode & 0xFF) == 0x9E ? !down : (opcode & 0xFF) == 0xA1 ? down : false;
+        return waiting ? budget - budget % 2 : 0;
+    }
+
+    case 0xF000:
+        if ((opcode & 0xFF) == 0x0A) { // LD Vx, K with no key down
+            for (int i = 0; i < CHIP8_KEY_COUNT; ++i) {
+                if (c8->keys[i]) return 0;
+            }
+            return budget;
+        }
+        if ((opcode & 0xFF) == 0x07) { // LD Vx, DT; SE/SNE Vx, kk; JP back
+            uint16_t test = opcode_at(c8, pc + 2);
+            if (((test >> 8) & 0xF) != x || opcode_at(c8, pc + 4) != jump_back) return 0;
+            uint8_t kk = (uint8_t)test;
+            bool waiting = (test & 0xF000) == 0x3000 ? c8->delay_timer != kk
+                : (test & 0xF000) == 0x4000 ? c8->delay_timer == kk : false;
+            uint32_t skipped = budget - budget % 3;
+            if (!waiting || skipped == 0) return 0;
+            c8->V[x] = c8->delay_timer;
+            return skipped;
+        }
+        return 0;
+
+    default:
+        return 0;
+    }
+#endif
+}
+
+// One specialized interpreter per quirk profile
+#define QUIRK_PROFILE CHIP8_QUIRKS_MODERN
+#define QUIRK_SUFFIX  modern
+#include "chip8_cycle_impl.h"
+
+#define QUIRK_PROFILE CHIP8_QUIRKS_VIP
+#define QUIRK_SUFFIX  vip
+#include "chip8_cycle_impl.h"
+
+#define QUIRK_PROFILE CHIP8_QUIRKS_CHIP48
+#define QUIRK_SUFFIX  chip48
+#include "chip8_cycle_impl.h"
+
+#define QUIRK_PROFILE CHIP8_QUIRKS_SCHIP
+#define QUIRK_SUFFIX  schip
+#include "chip8_cycle_impl.h"
+
+#define QUIRK_PROFILE CHIP8_QUIRKS_XOCHIP
+#define QUIRK_SUFFIX  xochip
+#include "chip8_cycle_impl.h"
+
+// The profile is chosen once per call; the instruction loop itself never looks at it.
+void chip8_cycle(Chip8* c8) {
+    switch (c8->quirks) {
+    case CHIP8_QUIRKS_VIP:    cycle_vip(c8);    break;
+    case CHIP8_QUIRKS_CHIP48: cycle_chip48(c8); break;
+    case CHIP8_QUIRKS_SCHIP:  cycle_schip(c8);  break;
+    case CHIP8_QUIRKS_XOCHIP: cycle_xochip(c8); break;
+    default:                  cycle_modern(c8); break;
+    }
+}
+
+uint32_t chip8_run(Chip8* c8, uint32_t cycles) {
+    switch (c8->quirks) {
+    case CHIP8_QUIRKS_VIP:    return run_vip(c8, cycles);
+    case CHIP8_QUIRKS_CHIP48: return run_chip48(c8, cycles);
+    case CHIP8_QUIRKS_SCHIP:  return run_schip(c8, cycles);
+    case CHIP8_QUIRKS_XOCHIP: return run_xochip(c8, cycles);
+    default:                  return run_modern(c8, cycles);
+    }
+}
@@ -1,54 +1,163 @@
-// Chip-8 emulator core header file for defining the Chip8 struct and function prototypes.
-
-#ifndef CHIP8_H
-#define CHIP8_H
-
-#include <stdint.h>
-#include <stdbool.h>
-
-#define CHIP8_MEMORY_SIZE       4096
-#define CHIP8_STACK_SIZE        16
-#define CHIP8_REGISTER_COUNT    16
-#define CHIP8_KEY_COUNT         16
-
-#define CHIP8_LOW_RES_WIDTH     64
-#define CHIP8_LOW_RES_HEIGHT    32
-#define CHIP8_HIGH_RES_WIDTH    128
-#define CHIP8_HIGH_RES_HEIGHT   64
-
-typedef struct Chip8 {
-    uint8_t  memory[CHIP8_MEMORY_SIZE];
-    uint8_t  V[CHIP8_REGISTER_COUNT];  // General registers V0-VF
-    uint16_t I;                        // Index register
-    uint16_t pc;                       // Program counter
-    uint16_t stack[CHIP8_STACK_SIZE];
-    uint8_t  sp;                       // Stack pointer
-    uint8_t  delay_timer;
-    uint8_t  sound_timer;
-
-    bool     display[CHIP8_HIGH_RES_WIDTH * CHIP8_HIGH_RES_HEIGHT];
-    bool     keys[CHIP8_KEY_COUNT];
-
-    bool     draw_flag;
-    bool     high_res;   // false = 64x32, true = 128x64
-    bool     running;    // false when 00FD (exit) or external quit
-
-} Chip8;
-
-// Initialize machine state and load fonts
-void chip8_init(Chip8* c8);
-
-// Load ROM into memory starting at 0x200
-bool chip8_load_rom(Chip8* c8, const char* path);
-
-// Execute a single instruction cycle
-void chip8_cycle(Chip8* c8);
-
-// Key press / release
-void chip8_key_down(Chip8* c8, uint8_t key);
-void chip8_key_up(Chip8* c8, uint8_t key);
-
-// Get display buffer and current logical resolution
-const bool* chip8_get_display(const Chip8* c8, int* width, int* height);
-
-#endif 
+// Chip-8 emulator core header file for defining the Chip8 struct and function prototypes.
+
+#ifndef CHIP8_H
+#define CHIP8_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define CHIP8_MEMORY_SIZE       4096
+#define CHIP8_ADDR_MASK         (CHIP8_MEMORY_SIZE - 1)   // pc and I-relative accesses wrap within memory
+#define CHIP8_XO_MEMORY_SIZE    65536                     // XO-CHIP address space (Chip8Xo)
+#define CHIP8_XO_ADDR_MASK      (CHIP8_XO_MEMORY_SIZE - 1)
+#define CHIP8_STACK_SIZE        16
+#define CHIP8_REGISTER_COUNT    16
+#define CHIP8_KEY_COUNT         16
+#define CHIP8_PAGE_SHIFT        8                         // dirty_pages granule: 256-byte pages
+#define CHIP8_PAGE_COUNT        (CHIP8_MEMORY_SIZE >> CHIP8_PAGE_SHIFT)
+
+#define CHIP8_LOW_RES_WIDTH     64
+#define CHIP8_LOW_RES_HEIGHT    32
+#define CHIP8_HIGH_RES_WIDTH    128
+#define CHIP8_HIGH_RES_HEIGHT   64
+#define CHIP8_DISPLAY_WORDS     (CHIP8_HIGH_RES_WIDTH / 64)   // uint64_t words per packed plane row
+#define CHIP8_DISPLAY_PLANES    2                             // XO-CHIP bitplanes; others only use plane 0
+#define CHIP8_ROW_WORDS         (CHIP8_DISPLAY_PLANES * CHIP8_DISPLAY_WORDS)   // words per display row
+#define CHIP8_PLANES_ALL        ((1 << CHIP8_DISPLAY_PLANES) - 1)
+#define CHIP8_AUDIO_PATTERN_SIZE 16                           // XO-CHIP F002 pattern buffer, 128 1-bit samples
+
+#define CHIP8_DEFAULT_SEED      0x43484950382D3031ull   // chip8_init seed; reseed with chip8_seed
+
+// Behaviour of the opcodes that historical interpreters disagree on. Every engine runs a
+// separately specialized interpreter per profile, so the choice costs nothing per instruction.
+typedef enum Chip8Quirks {
+    CHIP8_QUIRKS_MODERN,   // default: 8xy6/8xyE shift Vx, Fx55/Fx65 keep I, sprites wrap, Bnnn + V0
+    CHIP8_QUIRKS_VIP,      // COSMAC VIP: shifts read Vy, I += x + 1, sprites clip, 8xy1-3 clear VF
+    CHIP8_QUIRKS_CHIP48,   // HP48 CHIP-48: I += x, sprites clip, Bxnn + Vx
+    CHIP8_QUIRKS_SCHIP,    // Super CHIP 1.1: sprites clip, Bxnn + Vx
+    CHIP8_QUIRKS_XOCHIP,   // XO-CHIP: 64 KB memory, two planes, shifts read Vy, I += x + 1.
+                           // Only a Chip8Xo runs it, and a Chip8Xo runs nothing else.
+    CHIP8_QUIRKS_COUNT
+} Chip8Quirks;
+
+// Save states (chip8_state.h) store this struct verbatim: bump CHIP8_STATE_VERSION on any change.
+// memory must stay the last member: a Chip8Xo continues it past the end of the struct.
+typedef struct Chip8 {
+    uint8_t  V[CHIP8_REGISTER_COUNT];  // General registers V0-VF
+    uint16_t I;                        // Index register
+    uint16_t pc;                       // Program counter
+    uint16_t stack[CHIP8_STACK_SIZE];
+    uint8_t  sp;                       // Stack pointer
+    uint8_t  delay_timer;
+    uint8_t  sound_timer;
+
+    // Packed rows: CHIP8_DISPLAY_WORDS words of plane 0, then of plane 1 (see chip8_pixel).
+    // Both planes of a row share one cache line, so a two-plane draw touches no more lines.
+    uint64_t display[CHIP8_HIGH_RES_HEIGHT][CHIP8_ROW_WORDS];
+    bool     keys[CHIP8_KEY_COUNT];
+
+    uint64_t rng_state;   // xorshift64* state for Cxkk, never zero
+    uint64_t cycle_count; // instructions executed since chip8_init, by any engine
+
+    uint64_t dirty_rows; // bit y set when display row y was touched since chip8_clear_dirty_rows
+    uint16_t dirty_pages; // bit p set when memory page p was stored to or reloaded since cleared
+                          // (XO-CHIP: any page congruent to p mod CHIP8_PAGE_COUNT)
+    bool     draw_flag;
+    bool     high_res;   // false = 64x32, true = 128x64
+    bool     running;    // false when 00FD (exit) or external quit
+    uint8_t  quirks;     // Chip8Quirks, set with chip8_set_quirks
+    uint8_t  planes;     // planes Dxyn, 00E0 and scrolling act on (bit p = plane p); Fn01 selects
+    uint16_t addr_mask;  // memory size - 1: CHIP8_ADDR_MASK, or CHIP8_XO_ADDR_MASK for a Chip8Xo
+
+    // XO-CHIP buzzer: while audio_pattern_set, the sound timer plays this 1-bit pattern
+    // (F002) at 4000 * 2^((pitch - 64) / 48) samples per second (Fx3A) instead of a tone.
+    uint8_t  audio_pattern[CHIP8_AUDIO_PATTERN_SIZE];
+    uint8_t  pitch;
+    bool     audio_pattern_set;
+
+    // See chip8_profile.h; only set in a CHIP8_PROFILE build, but present in every build so
+    // state files share one layout. Not part of the machine state: saved as NULL.
+    struct Chip8Profile* profile;
+
+    _Alignas(uint64_t) uint8_t memory[CHIP8_MEMORY_SIZE];   // aligned so no padding follows it
+} Chip8;
+
+// XO-CHIP machine: a Chip8 whose memory continues to 64 KB. Pass &xo->base to every Chip8 API.
+// Keeping the size in the type leaves classic machines at 4 KB, so large batches of them stay
+// cache resident.
+typedef struct Chip8Xo {
+    Chip8    base;
+    uint8_t  memory_high[CHIP8_XO_MEMORY_SIZE - CHIP8_MEMORY_SIZE];   // base.memory[4096...]
+} Chip8Xo;
+
+// Initialize machine state and load fonts
+void chip8_init(Chip8* c8);
+
+// Initialize an XO-CHIP machine (chip8_init plus 64 KB memory and the xochip profile)
+void chip8_xo_init(Chip8Xo* xo);
+
+// Bytes of machine state behind c8: sizeof(Chip8), or sizeof(Chip8Xo) for an XO-CHIP machine
+size_t chip8_machine_size(const Chip8* c8);
+
+// Reseed the Cxkk generator. Runs with equal seeds and inputs are bit-identical.
+void chip8_seed(Chip8* c8, uint64_t seed);
+
+// Select the quirk profile (chip8_init picks CHIP8_QUIRKS_MODERN). Engines that cache decoded
+// or compiled code drop it on their next run after a change. Returns false, leaving the profile
+// unchanged, if it does not fit the machine (xochip needs a Chip8Xo and vice versa).
+bool chip8_set_quirks(Chip8* c8, Chip8Quirks quirks);
+
+// Profile name for command lines ("modern", "vip", "chip48", "schip", "xochip")
+const char* chip8_quirks_name(Chip8Quirks quirks);
+
+// Parse a profile name; returns false if unknown
+bool chip8_quirks_parse(const char* name, Chip8Quirks* quirks);
+
+// Load ROM into memory starting at 0x200. XO-CHIP machines accept ROMs up to 64 KB - 0x200.
+bool chip8_load_rom(Chip8* c8, const char* path);
+
+// Load ROM image already in memory starting at 0x200
+bool chip8_load_rom_data(Chip8* c8, const uint8_t* data, size_t size);
+
+// Execute a single instruction cycle
+void chip8_cycle(Chip8* c8);
+
+// Execute up to `cycles` instructions back to back; stops early when the machine halts.
+// Returns the number of instructions executed.
+uint32_t chip8_run(Chip8* c8, uint32_t cycles);
+
+// Decrement delay and sound timers; call once per 60Hz tick
+void chip8_tick_timers(Chip8* c8);
+
+// Key press / release
+void chip8_key_down(Chip8* c8, uint8_t key);
+void chip8_key_up(Chip8* c8, uint8_t key);
+
+// Get packed display rows and current logical resolution.
+// Row y starts at index y * CHIP8_ROW_WORDS; read pixels with chip8_pixel or chip8_pixel_color.
+const uint64_t* chip8_get_display(const Chip8* c8, int* width, int* height);
+
+// Plane-0 pixel (x, y) of a packed display: bit (63 - x % 64) of word x / 64 in row y
+static inline bool chip8_pixel(const uint64_t* display, int x, int y) {
+    return (display[y * CHIP8_ROW_WORDS + (x >> 6)] >> (63 - (x & 63))) & 1;
+}
+
+// Colour index 0-3 of pixel (x, y): bit p is the pixel of plane p
+static inline int chip8_pixel_color(const uint64_t* display, int x, int y) {
+    const uint64_t* row = &display[y * CHIP8_ROW_WORDS + (x >> 6)];
+    int shift = 63 - (x & 63);
+    return (int)((row[0] >> shift) & 1) | (int)((row[CHIP8_DISPLAY_WORDS] >> shift) & 1) << 1;
+}
+
+// Rows touched since the last chip8_clear_dirty_rows (bit y = row y). A set bit only means the
+// row was written; its pixels may have XORed back to what was last shown.
+uint64_t chip8_get_dirty_rows(const Chip8* c8);
+
+// Acknowledge the dirty rows after presenting a frame
+void chip8_clear_dirty_rows(Chip8* c8);
+
+// FNV-1a hash of the full display buffer, for comparing runs
+uint64_t chip8_display_hash(const Chip8* c8);
+
+#endif 
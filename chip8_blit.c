@@ -0,0 +1,151 @@
+// Presentation kernels. Eight pixels of a row come from one byte of each plane word; the
+// vector paths broadcast the two bytes, turn them into lane masks with and/compare, and pick
+// the palette entry with masked XORs, so there is no per-pixel branch or table lookup.
+
+#include "chip8_blit.h"
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BLIT_SIMD "avx2"
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BLIT_SIMD "sse2"
+#else
+#define BLIT_SIMD "scalar"
+#endif
+
+const char* chip8_blit_simd(void) {
+    return BLIT_SIMD;
+}
+
+// Pixels x..x+7 of one plane word, leftmost in bit 7
+static inline uint32_t row_byte(const uint64_t* plane, int x) {
+    return (uint32_t)(plane[x >> 6] >> (56 - (x & 63))) & 0xFF;
+}
+
+void chip8_blit_row(const uint64_t* row, int width, const uint32_t palette[1 << CHIP8_DISPLAY_PLANES],
+    uint32_t* out)
+{
+    const uint64_t* plane1 = row + CHIP8_DISPLAY_WORDS;
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    // With m0/m1 the lane masks of planes 0/1:
+    // colour = P0 ^ (m0 & (P0^P1)) ^ (m1 & (P0^P2)) ^ (m0 & m1 & (P0^P1^P2^P3))
+    uint32_t d1 = palette[0] ^ palette[1];
+    uint32_t d2 = palette[0] ^ palette[2];
+    uint32_t d3 = d1 ^ palette[2] ^ palette[3];
+#endif
+#if defined(__AVX2__)
+    const __m256i bits = _mm256_setr_epi32(128, 64, 32, 16, 8, 4, 2, 1);
+    const __m256i p0 = _mm256_set1_epi32((int)palette[0]);
+    const __m256i v1 = _mm256_set1_epi32((int)d1);
+    const __m256i v2 = _mm256_set1_epi32((int)d2);
+    const __m256i v3 = _mm256_set1_epi32((int)d3);
+    for (int x = 0; x < width; x += 8) {
+        __m256i b0 = _mm256_set1_epi32((int)row_byte(row, x));
+        __m256i b1 = _mm256_set1_epi32((int)row_byte(plane1, x));
+        __m256i m0 = _mm256_cmpeq_epi32(_mm256_and_si256(b0, bits), bits);
+        __m256i m1 = _mm256_cmpeq_epi32(_mm256_and_si256(b1, bits), bits);
+        __m256i c = _mm256_xor_si256(p0, _mm256_and_si256(m0, v1));
+        c = _mm256_xor_si256(c, _mm256_and_si256(m1, v2));
+        c = _mm256_xor_si256(c, _mm256_and_si256(_mm256_and_si256(m0, m1), v3));
+        _mm256_storeu_si256((__m256i*)(out + x), c);
+    }
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    const __m128i bits_hi = _mm_setr_epi32(128, 64, 32, 16);
+    const __m128i bits_lo = _mm_setr_epi32(8, 4, 2, 1);
+    const __m128i p0 = _mm_set1_epi32((int)palette[0]);
+    const __m128i v1 = _mm_set1_epi32((int)d1);
+    const __m128i v2 = _mm_set1_epi32((int)d2);
+    const __m128i v3 = _mm_set1_epi32((int)d3);
+    for (int x = 0; x < width; x += 8) {
+        __m128i b0 = _mm_set1_epi32((int)row_byte(row, x));
+        __m128i b1 = _mm_set1_epi32((int)row_byte(plane1, x));
+        for (int half = 0; half < 2; ++half) {
+            __m128i bits = half ? bits_lo : bits_hi;
+            __m128i m0 = _mm_cmpeq_epi32(_mm_and_si128(b0, bits), bits);
+            __m128i m1 = _mm_cmpeq_epi32(_mm_and_si128(b1, bits), bits);
+            __m128i c = _mm_xor_si128(p0, _mm_and_si128(m0, v1));
+            c = _mm_xor_si128(c, _mm_and_si128(m1, v2));
+            c = _mm_xor_si128(c, _mm_and_si128(_mm_and_si128(m0, m1), v3));
+            _mm_storeu_si128((__m128i*)(out + x + 4 * half), c);
+        }
+    }
+#else
+    for (int x = 0; x < width; x += 8) {
+        uint32_t b0 = row_byte(row, x);
+        uint32_t b1 = row_byte(plane1, x) << 1;
+        for (int k = 0; k < 8; ++k) {
+            int shift = 7 - k;
+            out[x + k] = palette[((b0 >> shift) & 1) | ((b1 >> shift) & 2)];
+        }
+    }
+#endif
+}
+
+void chip8_blit(const uint64_t* display, int width, int height,
+    const uint32_t palette[1 << CHIP8_DISPLAY_PLANES], uint32_t* out, size_t pitch)
+{
+    for (int y = 0; y < height; ++y) {
+        chip8_blit_row(display + (size_t)y * CHIP8_ROW_WORDS, width, palette, out + (size_t)y * pitch);
+    }
+}
+
+// Each pixel n times; inlined with a constant n so the inner loop unrolls
+static inline void repeat_pixels(const uint32_t* src, int width, uint32_t* dst, int n) {
+    for (int x = 0; x < width; ++x) {
+        uint32_t c = src[x];
+        for (int k = 0; k < n; ++k) dst[x * n + k] = c;
+    }
+}
+
+void chip8_upscale_nearest(const uint32_t* src, int width, int height, size_t src_pitch,
+    uint32_t* dst, size_t dst_pitch, int factor)
+{
+    if (factor < 1) factor = 1;
+    size_t out_w = (size_t)width * (size_t)factor;
+    for (int y = 0; y < height; ++y) {
+        const uint32_t* s = src + (size_t)y * src_pitch;
+        uint32_t* d = dst + (size_t)y * (size_t)factor * dst_pitch;
+        switch (factor) {
+        case 1: memcpy(d, s, out_w * sizeof(uint32_t)); break;
+        case 2: repeat_pixels(s, width, d, 2); break;
+        case 3: repeat_pixels(s, width, d, 3); break;
+        case 4: repeat_pixels(s, width, d, 4); break;
+        case 5: repeat_pixels(s, width, d, 5); break;
+        case 6: repeat_pixels(s, width, d, 6); break;
+        case 7: repeat_pixels(s, width, d, 7); break;
+        case 8: repeat_pixels(s, width, d, 8); break;
+        default: repeat_pixels(s, width, d, factor); break;
+        }
+        for (int k = 1; k < factor; ++k) memcpy(d + (size_t)k * dst_pitch, d, out_w * sizeof(uint32_t));
+    }
+}
+
+void chip8_upscale_scale2x(const uint32_t* src, int width, int height, size_t src_pitch,
+    uint32_t* dst, size_t dst_pitch)
+{
+    for (int y = 0; y < height; ++y) {
+        const uint32_t* up = src + (size_t)(y > 0 ? y - 1 : y) * src_pitch;
+        const uint32_t* mid = src + (size_t)y * src_pitch;
+        const uint32_t* down = src + (size_t)(y + 1 < height ? y + 1 : y) * src_pitch;
+        uint32_t* d0 = dst + (size_t)(2 * y) * dst_pitch;
+        uint32_t* d1 = d0 + dst_pitch;
+        for (int x = 0; x < width; ++x) {
+            uint32_t b = up[x], e = mid[x], h = down[x];
+            uint32_t d = mid[x > 0 ? x - 1 : x];
+            uint32_t f = mid[x + 1 < width ? x + 1 : x];
+            uint32_t e0 = e, e1 = e, e2 = e, e3 = e;
+            if (b != h && d != f) {
+                if (d == b) e0 = d;
+                if (b == f) e1 = f;
+                if (d == h) e2 = d;
+                if (h == f) e3 = f;
+            }
+            d0[2 * x] = e0;
+            d0[2 * x + 1] = e1;
+            d1[2 * x] = e2;
+            d1[2 * x + 1] = e3;
+        }
+    }
+}
@@ -0,0 +1,37 @@
+// Presentation kernels: packed display rows expanded to 32-bit pixels through a 4-entry
+// palette in one pass, and integer upscalers (nearest, Scale2x) for CPU-side output.
+
+#ifndef CHIP8_BLIT_H
+#define CHIP8_BLIT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "chip8.h"
+
+#define CHIP8_BLIT_MAX_SCALE  8   // largest upscale factor with its own unrolled kernel
+
+// Instruction set the conversion kernel was compiled for: "avx2", "sse2" or "scalar"
+const char* chip8_blit_simd(void);
+
+// Expand the first `width` pixels (a multiple of 8) of one display row, CHIP8_ROW_WORDS words
+// holding every plane, to palette[chip8_pixel_color] per pixel
+void chip8_blit_row(const uint64_t* row, int width, const uint32_t palette[1 << CHIP8_DISPLAY_PLANES],
+    uint32_t* out);
+
+// chip8_blit_row for rows [0, height) of a packed display (chip8_get_display layout).
+// `pitch` is the distance between output rows in pixels.
+void chip8_blit(const uint64_t* display, int width, int height,
+    const uint32_t palette[1 << CHIP8_DISPLAY_PLANES], uint32_t* out, size_t pitch);
+
+// Nearest-neighbour upscale by an integer factor; factors below 1 count as 1, and factors
+// 1..CHIP8_BLIT_MAX_SCALE get an unrolled kernel. Pitches are in pixels; dst holds
+// width * factor by height * factor pixels.
+void chip8_upscale_nearest(const uint32_t* src, int width, int height, size_t src_pitch,
+    uint32_t* dst, size_t dst_pitch, int factor);
+
+// Scale2x (EPX) 2x upscale: rounds off diagonal staircases while keeping the palette, so it
+// suits indexed and ARGB images alike. Edge pixels repeat past the border.
+void chip8_upscale_scale2x(const uint32_t* src, int width, int height, size_t src_pitch,
+    uint32_t* dst, size_t dst_pitch);
+
+#endif // CHIP8_BLIT_H
@@ -0,0 +1,313 @@
+// Copy-on-write machine snapshots: page pool, checkout/commit and state hashing.
+
+#include "chip8_clone.h"
+#include <stdlib.h>
+#include <string.h>
+
+_Static_assert(offsetof(Chip8, keys) == offsetof(Chip8, display) + sizeof(((Chip8*)0)->display),
+    "head and tail must cover everything but display and memory");
+_Static_assert(CHIP8_CLONE_DISPLAY_PAGES * CHIP8_CLONE_ROWS_PER_PAGE == CHIP8_HIGH_RES_HEIGHT,
+    "display pages must hold whole rows");
+_Static_assert(sizeof(Chip8Clone) >= sizeof(Chip8Clone*), "free nodes store a link");
+
+typedef struct Chip8ClonePageChunk {
+    uint8_t  data[CHIP8_CLONE_CHUNK_PAGES][CHIP8_CLONE_PAGE_SIZE];
+    uint64_t hash[CHIP8_CLONE_CHUNK_PAGES];
+    uint32_t refs[CHIP8_CLONE_CHUNK_PAGES];
+} Chip8ClonePageChunk;
+
+typedef struct Chip8CloneNodeChunk {
+    struct Chip8CloneNodeChunk* next;
+    Chip8Clone nodes[CHIP8_CLONE_CHUNK_NODES];
+} Chip8CloneNodeChunk;
+
+#define MIX_MUL 0x9E3779B97F4A7C15ull
+
+static uint64_t rotl(uint64_t x, int r) {
+    return x << r | x >> (64 - r);
+}
+
+static uint64_t mix(uint64_t h, uint64_t v) {
+    return rotl((h ^ v) * MIX_MUL, 27) * 0xC2B2AE3D27D4EB4Full;
+}
+
+static uint64_t finish(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    return h ^ h >> 33;
+}
+
+// Four independent multiply lanes over the page's 32 words, so the multiplies overlap
+static uint64_t hash_page(const uint8_t* page) {
+    uint64_t h[4] = { 0x243F6A8885A308D3ull, 0x13198A2E03707344ull,
+                      0xA4093822299F31D0ull, 0x082EFA98EC4E6C89ull };
+    for (int i = 0; i < CHIP8_CLONE_PAGE_SIZE; i += 32) {
+        for (int k = 0; k < 4; ++k) {
+            uint64_t w;
+            memcpy(&w, page + i + k * 8, sizeof(w));
+            h[k] = rotl((h[k] ^ w) * MIX_MUL, 29);
+        }
+    }
+    return finish(mix(mix(mix(h[0], h[1]), h[2]), h[3]));
+}
+
+// Registers and flags that decide how the machine runs on, then the page hashes in order
+static uint64_t state_hash(const Chip8* c8, const uint64_t* page_hash) {
+    uint64_t w[4];
+    uint64_t h = 0x452821E638D01377ull;
+
+    memcpy(w, c8->V, sizeof(c8->V));
+    h = mix(mix(h, w[0]), w[1]);
+    memcpy(w, c8->stack, sizeof(c8->stack));
+    for (int i = 0; i < 4; ++i) h = mix(h, w[i]);
+    h = mix(h, (uint64_t)c8->I | (uint64_t)c8->pc << 16 | (uint64_t)c8->sp << 32 |
+        (uint64_t)c8->delay_timer << 40 | (uint64_t)c8->sound_timer << 48);
+    h = mix(h, (uint64_t)c8->high_res | (uint64_t)c8->running << 1 | (uint64_t)c8->quirks << 8 |
+        (uint64_t)c8->planes << 16);
+    h = mix(h, c8->rng_state);
+    for (int i = 0; i < CHIP8_CLONE_PAGES; ++i) h = mix(h, page_hash[i]);
+    return finish(h);
+}
+
+// Page i of a machine: memory pages, then groups of CHIP8_CLONE_ROWS_PER_PAGE display rows
+static uint8_t* region(Chip8* c8, int i) {
+    if (i < CHIP8_PAGE_COUNT) return &c8->memory[i * CHIP8_CLONE_PAGE_SIZE];
+    return (uint8_t*)c8->display[(i - CHIP8_PAGE_COUNT) * CHIP8_CLONE_ROWS_PER_PAGE];
+}
+
+// Bit i set when page i of the machine may differ from the page it was loaded from
+static uint32_t written_pages(const Chip8* c8) {
+    uint32_t mask = c8->dirty_pages;
+    for (int g = 0; g < CHIP8_CLONE_DISPLAY_PAGES; ++g) {
+        uint64_t rows = c8->dirty_rows >> (g * CHIP8_CLONE_ROWS_PER_PAGE);
+        if (rows & ((1ull << CHIP8_CLONE_ROWS_PER_PAGE) - 1)) mask |= 1u << (CHIP8_PAGE_COUNT + g);
+    }
+    return mask;
+}
+
+static Chip8ClonePageChunk* page_chunk(const Chip8ClonePool* pool, uint32_t id) {
+    return pool->chunks[id / CHIP8_CLONE_CHUNK_PAGES];
+}
+
+static uint8_t* page_data(const Chip8ClonePool* pool, uint32_t id) {
+    return page_chunk(pool, id)->data[id % CHIP8_CLONE_CHUNK_PAGES];
+}
+
+// Hashed on first use and kept with the page; 0 means not hashed yet
+static uint64_t page_hash(const Chip8ClonePool* pool, uint32_t id) {
+    uint64_t* hash = &page_chunk(pool, id)->hash[id % CHIP8_CLONE_CHUNK_PAGES];
+    if (!*hash) *hash = hash_page(page_data(pool, id)) | 1;
+    return *hash;
+}
+
+static void page_ref(Chip8ClonePool* pool, uint32_t id) {
+    page_chunk(pool, id)->refs[id % CHIP8_CLONE_CHUNK_PAGES]++;
+}
+
+static void page_release(Chip8ClonePool* pool, uint32_t id) {
+    if (id == CHIP8_CLONE_NO_PAGE) return;
+    if (--page_chunk(pool, id)->refs[id % CHIP8_CLONE_CHUNK_PAGES]) return;
+    memcpy(page_data(pool, id), &pool->free_page, sizeof(pool->free_page));
+    pool->free_page = id;
+    pool->live_pages--;
+}
+
+// New page holding a copy of `src`, with one reference
+static uint32_t page_new(Chip8ClonePool* pool, const uint8_t* src) {
+    uint32_t id = pool->free_page;
+    if (id != CHIP8_CLONE_NO_PAGE) {
+        memcpy(&pool->free_page, page_data(pool, id), sizeof(pool->free_page));
+    }
+    else {
+        if (pool->page_count == pool->chunk_count * CHIP8_CLONE_CHUNK_PAGES) {
+            if (pool->chunk_count == pool->chunk_capacity) {
+                uint32_t capacity = pool->chunk_capacity ? pool->chunk_capacity * 2 : 16;
+                Chip8ClonePageChunk** chunks = realloc(pool->chunks, capacity * sizeof(*chunks));
+                if (!chunks) return CHIP8_CLONE_NO_PAGE;
+                pool->chunks = chunks;
+                pool->chunk_capacity = capacity;
+            }
+            Chip8ClonePageChunk* chunk = malloc(sizeof(Chip8ClonePageChunk));
+            if (!chunk) return CHIP8_CLONE_NO_PAGE;
+            pool->chunks[pool->chunk_count++] = chunk;
+        }
+        id = pool->page_count++;
+    }
+
+    Chip8ClonePageChunk* chunk = page_chunk(pool, id);
+    memcpy(chunk->data[id % CHIP8_CLONE_CHUNK_PAGES], src, CHIP8_CLONE_PAGE_SIZE);
+    chunk->hash[id % CHIP8_CLONE_CHUNK_PAGES] = 0;
+    chunk->refs[id % CHIP8_CLONE_CHUNK_PAGES] = 1;
+    pool->live_pages++;
+    return id;
+}
+
+static Chip8Clone* node_new(Chip8ClonePool* pool) {
+    Chip8Clone* node = pool->free_node;
+    if (node) {
+        memcpy(&pool->free_node, node, sizeof(pool->free_node));
+    }
+    else {
+        if (pool->node_count % CHIP8_CLONE_CHUNK_NODES == 0) {
+            Chip8CloneNodeChunk* chunk = malloc(sizeof(Chip8CloneNodeChunk));
+            if (!chunk) return NULL;
+            chunk->next = pool->node_chunks;
+            pool->node_chunks = chunk;
+        }
+        node = &pool->node_chunks->nodes[pool->node_count++ % CHIP8_CLONE_CHUNK_NODES];
+    }
+    pool->live_nodes++;
+    return node;
+}
+
+void chip8_clone_pool_init(Chip8ClonePool* pool) {
+    memset(pool, 0, sizeof(*pool));
+    pool->free_page = CHIP8_CLONE_NO_PAGE;
+}
+
+void chip8_clone_pool_destroy(Chip8ClonePool* pool) {
+    for (uint32_t i = 0; i < pool->chunk_count; ++i) free(pool->chunks[i]);
+    free(pool->chunks);
+    while (pool->node_chunks) {
+        Chip8CloneNodeChunk* next = pool->node_chunks->next;
+        free(pool->node_chunks);
+        pool->node_chunks = next;
+    }
+    chip8_clone_pool_init(pool);
+}
+
+size_t chip8_clone_pool_bytes(const Chip8ClonePool* pool) {
+    size_t node_chunks = (pool->node_count + CHIP8_CLONE_CHUNK_NODES - 1) / CHIP8_CLONE_CHUNK_NODES;
+    return pool->chunk_count * sizeof(Chip8ClonePageChunk) + node_chunks * sizeof(Chip8CloneNodeChunk);
+}
+
+void chip8_clone_free(Chip8ClonePool* pool, Chip8Clone* node) {
+    for (int i = 0; i < CHIP8_CLONE_PAGES; ++i) page_release(pool, node->pages[i]);
+    memcpy(node, &pool->free_node, sizeof(pool->free_node));
+    pool->free_node = node;
+    pool->live_nodes--;
+}
+
+// Snapshot c8 into a new node. held[i] is the page c8's region i was loaded from (holding one
+// reference) or CHIP8_CLONE_NO_PAGE; regions outside `written` still match it. A written
+// region whose bytes differ goes to a new page, which replaces held[i].
+static Chip8Clone* snapshot(Chip8ClonePool* pool, Chip8* c8, uint32_t* held, uint32_t written) {
+    Chip8Clone* node = node_new(pool);
+    if (!node) return NULL;
+    memcpy(node->head, c8, CHIP8_CLONE_HEAD_BYTES);
+    memcpy(node->tail, (const uint8_t*)c8 + offsetof(Chip8, keys), CHIP8_CLONE_TAIL_BYTES);
+
+    node->hash = 0;
+    for (int i = 0; i < CHIP8_CLONE_PAGES; ++i) {
+        uint32_t id = held[i];
+        const uint8_t* src = region(c8, i);
+        bool same = id != CHIP8_CLONE_NO_PAGE &&
+            (!(written >> i & 1) || memcmp(src, page_data(pool, id), CHIP8_CLONE_PAGE_SIZE) == 0);
+        if (!same) {
+            id = page_new(pool, src);
+            if (id == CHIP8_CLONE_NO_PAGE) {
+                for (int j = i; j < CHIP8_CLONE_PAGES; ++j) node->pages[j] = CHIP8_CLONE_NO_PAGE;
+                chip8_clone_free(pool, node);
+                return NULL;
+            }
+            page_release(pool, held[i]);
+            held[i] = id;
+        }
+        page_ref(pool, id);
+        node->pages[i] = id;
+    }
+    return node;
+}
+
+Chip8Clone* chip8_clone_capture(Chip8ClonePool* pool, const Chip8* c8) {
+    if (c8->addr_mask != CHIP8_ADDR_MASK) return NULL;
+    uint32_t held[CHIP8_CLONE_PAGES];
+    for (int i = 0; i < CHIP8_CLONE_PAGES; ++i) held[i] = CHIP8_CLONE_NO_PAGE;
+
+    Chip8Clone* node = snapshot(pool, (Chip8*)c8, held, ~0u);
+    for (int i = 0; i < CHIP8_CLONE_PAGES; ++i) page_release(pool, held[i]);
+    return node;
+}
+
+Chip8Clone* chip8_clone_fork(Chip8ClonePool* pool, const Chip8Clone* node) {
+    Chip8Clone* child = node_new(pool);
+    if (!child) return NULL;
+    *child = *node;
+    for (int i = 0; i < CHIP8_CLONE_PAGES; ++i) page_ref(pool, child->pages[i]);
+    return child;
+}
+
+void chip8_clone_work_init(Chip8CloneWork* work) {
+    chip8_init(&work->machine);
+    for (int i = 0; i < CHIP8_CLONE_PAGES; ++i) work->pages[i] = CHIP8_CLONE_NO_PAGE;
+}
+
+void chip8_clone_work_release(Chip8ClonePool* pool, Chip8CloneWork* work) {
+    for (int i = 0; i < CHIP8_CLONE_PAGES; ++i) {
+        page_release(pool, work->pages[i]);
+        work->pages[i] = CHIP8_CLONE_NO_PAGE;
+    }
+}
+
+bool chip8_clone_checkout(Chip8ClonePool* pool, Chip8CloneWork* work, const Chip8Clone* node) {
+    Chip8* c8 = &work->machine;
+    uint32_t written = written_pages(c8);
+    struct Chip8Profile* profile = c8->profile;
+    memcpy(c8, node->head, CHIP8_CLONE_HEAD_BYTES);
+    memcpy((uint8_t*)c8 + offsetof(Chip8, keys), node->tail, CHIP8_CLONE_TAIL_BYTES);
+    c8->profile = profile;
+    c8->dirty_rows = 0;
+    c8->dirty_pages = 0;
+
+    bool memory_changed = false;
+    for (int i = 0; i < CHIP8_CLONE_PAGES; ++i) {
+        uint32_t id = node->pages[i];
+        if (work->pages[i] == id && !(written >> i & 1)) continue;
+        memcpy(region(c8, i), page_data(pool, id), CHIP8_CLONE_PAGE_SIZE);
+        if (work->pages[i] != id) {
+            page_ref(pool, id);
+            page_release(pool, work->pages[i]);
+            work->pages[i] = id;
+        }
+        if (i < CHIP8_PAGE_COUNT) memory_changed = true;
+    }
+    return memory_changed;
+}
+
+Chip8Clone* chip8_clone_commit(Chip8ClonePool* pool, Chip8CloneWork* work) {
+    Chip8* c8 = &work->machine;
+    uint32_t written = written_pages(c8);
+    uint64_t dirty_rows = c8->dirty_rows;
+    uint16_t dirty_pages = c8->dirty_pages;
+    c8->dirty_rows = 0;
+    c8->dirty_pages = 0;
+
+    Chip8Clone* node = snapshot(pool, c8, work->pages, written);
+    if (!node) {
+        // Keep the pages marked so a later commit or checkout does not trust them
+        c8->dirty_rows = dirty_rows;
+        c8->dirty_pages = dirty_pages;
+    }
+    return node;
+}
+
+uint64_t chip8_clone_hash(const Chip8ClonePool* pool, Chip8Clone* node) {
+    if (node->hash) return node->hash;
+
+    // Only the register fields state_hash reads are filled in
+    Chip8 core;
+    memcpy(&core, node->head, CHIP8_CLONE_HEAD_BYTES);
+    memcpy((uint8_t*)&core + offsetof(Chip8, keys), node->tail, CHIP8_CLONE_TAIL_BYTES);
+    uint64_t hashes[CHIP8_CLONE_PAGES];
+    for (int i = 0; i < CHIP8_CLONE_PAGES; ++i) hashes[i] = page_hash(pool, node->pages[i]);
+    node->hash = state_hash(&core, hashes) | 1;
+    return node->hash;
+}
+
+uint64_t chip8_clone_hash_machine(const Chip8* c8) {
+    uint64_t hashes[CHIP8_CLONE_PAGES];
+    for (int i = 0; i < CHIP8_CLONE_PAGES; ++i) hashes[i] = hash_page(region((Chip8*)c8, i)) | 1;
+    return state_hash(c8, hashes) | 1;
+}
@@ -0,0 +1,98 @@
+// Copy-on-write machine snapshots for tree search. A node keeps the registers inline and
+// shares 256-byte pages of memory and display (eight rows each) with the nodes it was forked
+// from, so a child costs the pages its Fx33/Fx55/Dxyn writes touched plus about 250 bytes.
+// Nodes and pages come from a pool; nothing is allocated per node once the pool has grown.
+
+#ifndef CHIP8_CLONE_H
+#define CHIP8_CLONE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "chip8.h"
+
+#define CHIP8_CLONE_PAGE_SIZE      (1 << CHIP8_PAGE_SHIFT)
+#define CHIP8_CLONE_ROWS_PER_PAGE  (CHIP8_CLONE_PAGE_SIZE / (CHIP8_ROW_WORDS * (int)sizeof(uint64_t)))
+#define CHIP8_CLONE_DISPLAY_PAGES  (CHIP8_HIGH_RES_HEIGHT / CHIP8_CLONE_ROWS_PER_PAGE)
+#define CHIP8_CLONE_PAGES          (CHIP8_PAGE_COUNT + CHIP8_CLONE_DISPLAY_PAGES)   // memory first
+#define CHIP8_CLONE_CHUNK_PAGES    1024     // pages per pool allocation
+#define CHIP8_CLONE_CHUNK_NODES    256      // nodes per pool allocation
+#define CHIP8_CLONE_NO_PAGE        UINT32_MAX
+
+// Everything in a Chip8 except display and memory, which live in pages
+#define CHIP8_CLONE_HEAD_BYTES     offsetof(Chip8, display)
+#define CHIP8_CLONE_TAIL_BYTES     (offsetof(Chip8, memory) - offsetof(Chip8, keys))
+
+typedef struct Chip8Clone {
+    uint64_t hash;                          // chip8_clone_hash, 0 until first asked for
+    uint32_t pages[CHIP8_CLONE_PAGES];      // pool page ids, each holding one reference
+    uint8_t  head[CHIP8_CLONE_HEAD_BYTES];  // Chip8 bytes before display
+    uint8_t  tail[CHIP8_CLONE_TAIL_BYTES];  // Chip8 bytes from keys up to memory
+} Chip8Clone;
+
+struct Chip8ClonePageChunk;
+struct Chip8CloneNodeChunk;
+
+typedef struct Chip8ClonePool {
+    struct Chip8ClonePageChunk** chunks;
+    uint32_t    chunk_count;
+    uint32_t    chunk_capacity;
+    uint32_t    page_count;    // page ids handed out so far, free or not
+    uint32_t    free_page;     // freed pages, linked through their first bytes
+    struct Chip8CloneNodeChunk* node_chunks;
+    Chip8Clone* free_node;     // freed nodes, linked through their first bytes
+    uint32_t    node_count;    // nodes in node_chunks, free or not
+
+    uint32_t    live_pages;    // pages referenced by a node or a work machine
+    uint32_t    live_nodes;
+} Chip8ClonePool;
+
+// The machine nodes are checked out into and run. It holds a reference to the page each
+// region was last loaded from or committed to, so checking out a relative only copies the
+// pages that differ. Its dirty_rows and dirty_pages belong to the pool between calls.
+typedef struct Chip8CloneWork {
+    Chip8    machine;
+    uint32_t pages[CHIP8_CLONE_PAGES];   // CHIP8_CLONE_NO_PAGE: region not from the pool
+} Chip8CloneWork;
+
+void chip8_clone_pool_init(Chip8ClonePool* pool);
+
+// Free every chunk. Nodes and work machines from this pool must not be used afterwards.
+void chip8_clone_pool_destroy(Chip8ClonePool* pool);
+
+// Bytes the pool has allocated for pages and nodes
+size_t chip8_clone_pool_bytes(const Chip8ClonePool* pool);
+
+// New root node copying every page of a classic machine. Returns NULL for XO-CHIP machines
+// or when out of memory.
+Chip8Clone* chip8_clone_capture(Chip8ClonePool* pool, const Chip8* c8);
+
+// New node sharing every page with `node`: a 24-reference copy, no page data is touched
+Chip8Clone* chip8_clone_fork(Chip8ClonePool* pool, const Chip8Clone* node);
+
+// Drop a node and its page references
+void chip8_clone_free(Chip8ClonePool* pool, Chip8Clone* node);
+
+void chip8_clone_work_init(Chip8CloneWork* work);
+void chip8_clone_work_release(Chip8ClonePool* pool, Chip8CloneWork* work);
+
+// Load `node` into work->machine, copying only pages that differ from what the machine holds
+// (the profile pointer is kept). Returns true if any memory page was
+// copied: engines that cache translations must then be reset (chip8_engine_reset).
+bool chip8_clone_checkout(Chip8ClonePool* pool, Chip8CloneWork* work, const Chip8Clone* node);
+
+// Snapshot work->machine as a new node. Pages nothing wrote since the last checkout or commit
+// are shared; written pages are shared too if their bytes came out unchanged, and are copied
+// otherwise. Returns NULL when out of memory.
+Chip8Clone* chip8_clone_commit(Chip8ClonePool* pool, Chip8CloneWork* work);
+
+// Hash of the state that decides how a machine runs on: registers, stack, timers, RNG,
+// display, memory and mode flags, but not cycle_count, keys or the dirty/draw bookkeeping.
+// Never 0. Pages are hashed once, on first use, and the result is kept with the page and
+// the node, so hashing a child only reads the pages it did not share with a hashed parent.
+uint64_t chip8_clone_hash(const Chip8ClonePool* pool, Chip8Clone* node);
+
+// The same hash computed from a machine, e.g. to probe a transposition table before committing
+uint64_t chip8_clone_hash_machine(const Chip8* c8);
+
+#endif // CHIP8_CLONE_H
@@ -0,0 +1,311 @@
+// Interpreter template, specialized per quirk profile. chip8.c includes this file once per
+// profile after defining
+//   QUIRK_PROFILE  a Chip8Quirks constant
+//   QUIRK_SUFFIX   suffix of the generated cycle_<suffix> and run_<suffix>
+// and optionally QUIRK_CYCLE_ONLY, for modules that drive cycle_<suffix> with their own loop.
+// QUIRK reads chip8_quirk_flags with a constant index, so every quirk test below folds to a
+// constant and each instantiation contains only its own profile's code. The address mask is
+// part of the profile too: only the XO-CHIP instantiation addresses 64 KB. No include guard.
+
+#define QUIRK_PASTE2(a, b) a##_##b
+#define QUIRK_PASTE(a, b) QUIRK_PASTE2(a, b)
+#define QUIRK_FN(base) QUIRK_PASTE(base, QUIRK_SUFFIX)
+#define QUIRK (chip8_quirk_flags[QUIRK_PROFILE])
+#define QUIRK_MASK (QUIRK.xo ? CHIP8_XO_ADDR_MASK : CHIP8_ADDR_MASK)
+
+// Skip the next instruction; XO-CHIP's F000 nnnn is two words long.
+#define QUIRK_SKIP() do { \
+    uint16_t skip = 2; \
+    if (QUIRK.xo && c8->memory[c8->pc & QUIRK_MASK] == 0xF0 && \
+        c8->memory[(c8->pc + 1) & QUIRK_MASK] == 0x00) skip = 4; \
+    c8->pc = (c8->pc + skip) & QUIRK_MASK; \
+} while (0)
+
+static void QUIRK_FN(cycle)(Chip8* c8) {
+    if (!c8->running) return;
+    c8->cycle_count++;
+
+    uint16_t opcode = (uint16_t)c8->memory[c8->pc & QUIRK_MASK] << 8 |
+        (uint16_t)c8->memory[(c8->pc + 1) & QUIRK_MASK];
+    CHIP8_PROFILE_INSTR(c8, c8->pc & QUIRK_MASK, opcode);
+    c8->pc = (c8->pc + 2) & QUIRK_MASK;
+
+    uint8_t  x = (opcode & 0x0F00) >> 8;
+    uint8_t  y = (opcode & 0x00F0) >> 4;
+    uint8_t  n = (opcode & 0x000F);
+    uint8_t  kk = (opcode & 0x00FF);
+    uint16_t nnn = (opcode & 0x0FFF);
+
+    switch (opcode & 0xF000) {
+    case 0x0000:
+        switch (opcode) {
+        case 0x00E0: // CLS
+            chip8_clear_display(c8);
+            break;
+        case 0x00EE: // RET
+            if (c8->sp > 0) {
+                c8->sp--;
+                c8->pc = c8->stack[c8->sp] & QUIRK_MASK;
+            }
+            break;
+        case 0x00FE: // LOW RES (Super CHIP-8)
+            c8->high_res = false;
+            chip8_clear_display(c8);
+            break;
+        case 0x00FF: // HIGH RES (Super CHIP-8)
+            c8->high_res = true;
+            chip8_clear_display(c8);
+            break;
+        case 0x00FD: // EXIT (Super CHIP-8)
+            c8->running = false;
+            break;
+        case 0x00FB: // SCROLL RIGHT 4
+            chip8_scroll_right(c8);
+            break;
+        case 0x00FC: // SCROLL LEFT 4
+            chip8_scroll_left(c8);
+            break;
+        default:
+            if ((opcode & 0xFFF0) == 0x00C0) {
+                // 00CN: scroll down N lines
+                uint8_t lines = (uint8_t)(opcode & 0x000F);
+                chip8_scroll_down(c8, lines);
+            }
+            else if (QUIRK.xo && (opcode & 0xFFF0) == 0x00D0) {
+                // 00DN: scroll up N lines (XO-CHIP)
+                chip8_scroll_up(c8, n);
+            }
+            else {
+                // System call / ignored
+            }
+            break;
+        }
+        break;
+
+    case 0x1000: // JP addr
+        c8->pc = nnn;
+        break;
+
+    case 0x2000: // CALL addr
+        if (c8->sp < CHIP8_STACK_SIZE) {
+            c8->stack[c8->sp] = c8->pc;
+            c8->sp++;
+            c8->pc = nnn;
+        }
+        break;
+
+    case 0x3000: // SE Vx, byte
+        if (c8->V[x] == kk)
+            QUIRK_SKIP();
+        break;
+
+    case 0x4000: // SNE Vx, byte
+        if (c8->V[x] != kk)
+            QUIRK_SKIP();
+        break;
+
+    case 0x5000: // SE Vx, Vy
+        if ((opcode & 0x000F) == 0x0) {
+            if (c8->V[x] == c8->V[y])
+                QUIRK_SKIP();
+        }
+        else if (QUIRK.xo && (opcode & 0x000F) == 0x2) { // LD [I], Vx..Vy (XO-CHIP)
+            chip8_store_range(c8, x, y);
+        }
+        else if (QUIRK.xo && (opcode & 0x000F) == 0x3) { // LD Vx..Vy, [I] (XO-CHIP)
+            chip8_load_range(c8, x, y);
+        }
+        break;
+
+    case 0x6000: // LD Vx, byte
+        c8->V[x] = kk;
+        break;
+
+    case 0x7000: // ADD Vx, byte
+        c8->V[x] += kk;
+        break;
+
+    case 0x8000:
+        switch (opcode & 0x000F) {
+        case 0x0: // LD Vx, Vy
+            c8->V[x] = c8->V[y];
+            break;
+        case 0x1: // OR Vx, Vy
+            c8->V[x] |= c8->V[y];
+            if (QUIRK.vf_reset) c8->V[0xF] = 0;
+            break;
+        case 0x2: // AND Vx, Vy
+            c8->V[x] &= c8->V[y];
+            if (QUIRK.vf_reset) c8->V[0xF] = 0;
+            break;
+        case 0x3: // XOR Vx, Vy
+            c8->V[x] ^= c8->V[y];
+            if (QUIRK.vf_reset) c8->V[0xF] = 0;
+            break;
+        case 0x4: { // ADD Vx, Vy
+            uint16_t sum = c8->V[x] + c8->V[y];
+            c8->V[0xF] = sum > 0xFF;
+            c8->V[x] = (uint8_t)(sum & 0xFF);
+        } break;
+        case 0x5: // SUB Vx, Vy
+            c8->V[0xF] = c8->V[x] > c8->V[y];
+            c8->V[x] = (uint8_t)(c8->V[x] - c8->V[y]);
+            break;
+        case 0x6: // SHR Vx {, Vy}
+            if (QUIRK.shift_vy) {
+                uint8_t v = c8->V[y];
+                c8->V[0xF] = v & 0x1;
+                c8->V[x] = (uint8_t)(v >> 1);
+            }
+            else {
+                c8->V[0xF] = c8->V[x] & 0x1;
+                c8->V[x] >>= 1;
+            }
+            break;
+        case 0x7: // SUBN Vx, Vy
+            c8->V[0xF] = c8->V[y] > c8->V[x];
+            c8->V[x] = (uint8_t)(c8->V[y] - c8->V[x]);
+            break;
+        case 0xE: // SHL Vx {, Vy}
+            if (QUIRK.shift_vy) {
+                uint8_t v = c8->V[y];
+                c8->V[0xF] = (v & 0x80) >> 7;
+                c8->V[x] = (uint8_t)(v << 1);
+            }
+            else {
+                c8->V[0xF] = (c8->V[x] & 0x80) >> 7;
+                c8->V[x] <<= 1;
+            }
+            break;
+        default:
+            break;
+        }
+        break;
+
+    case 0x9000: // SNE Vx, Vy
+        if ((opcode & 0x000F) == 0x0) {
+            if (c8->V[x] != c8->V[y])
+                QUIRK_SKIP();
+        }
+        break;
+
+    case 0xA000: // LD I, addr
+        c8->I = nnn;
+        break;
+
+    case 0xB000: // JP V0, addr (Bxnn: JP Vx, xnn)
+        c8->pc = (nnn + c8->V[QUIRK.jump_vx ? x : 0]) & QUIRK_MASK;
+        break;
+
+    case 0xC000: // RND Vx, byte
+        c8->V[x] = (uint8_t)(chip8_random_byte(c8) & kk);
+        break;
+
+    case 0xD000: // DRW Vx, Vy, nibble
+        if (QUIRK.clip) chip8_draw_sprite_clipped(c8, c8->V[x], c8->V[y], n);
+        else chip8_draw_sprite(c8, c8->V[x], c8->V[y], n);
+        break;
+
+    case 0xE000:
+        switch (opcode & 0x00FF) {
+        case 0x9E: // SKP Vx
+            if (c8->keys[c8->V[x] & 0xF]) QUIRK_SKIP();
+            break;
+        case 0xA1: // SKNP Vx
+            if (!c8->keys[c8->V[x] & 0xF]) QUIRK_SKIP();
+            break;
+        default:
+            break;
+        }
+        break;
+
+    case 0xF000:
+        switch (opcode & 0x00FF) {
+        case 0x00: // LD I, long nnnn (XO-CHIP F000 nnnn)
+            if (QUIRK.xo && x == 0) {
+                c8->I = (uint16_t)(c8->memory[c8->pc & QUIRK_MASK] << 8 |
+                    c8->memory[(c8->pc + 1) & QUIRK_MASK]);
+                c8->pc = (c8->pc + 2) & QUIRK_MASK;
+            }
+            break;
+        case 0x01: // PLANE n (XO-CHIP Fn01)
+            if (QUIRK.xo) c8->planes = x & CHIP8_PLANES_ALL;
+            break;
+        case 0x02: // AUDIO (XO-CHIP F002)
+            if (QUIRK.xo && x == 0) chip8_load_audio_pattern(c8);
+            break;
+        case 0x07: // LD Vx, DT
+            c8->V[x] = c8->delay_timer;
+            break;
+        case 0x0A: // LD Vx, K (wait for key)
+            if (!chip8_wait_key(c8, x)) {
+                // Repeat this instruction
+                c8->pc = (c8->pc - 2) & QUIRK_MASK;
+            }
+            break;
+        case 0x15: // LD DT, Vx
+            c8->delay_timer = c8->V[x];
+            break;
+        case 0x18: // LD ST, Vx
+            c8->sound_timer = c8->V[x];
+            break;
+        case 0x1E: // ADD I, Vx
+            c8->I += c8->V[x];
+            break;
+        case 0x29: // LD F, Vx (small font)
+            c8->I = (uint16_t)(c8->V[x] * 5);
+            break;
+        case 0x30: // LD HF, Vx (big font digit)
+            c8->I = (uint16_t)(0x50 + (c8->V[x] * 10));
+            break;
+        case 0x33: // LD B, Vx (BCD)
+            chip8_store_bcd(c8, x);
+            break;
+        case 0x3A: // PITCH Vx (XO-CHIP)
+            if (QUIRK.xo) c8->pitch = c8->V[x];
+            break;
+        case 0x55: // LD [I], V0..Vx
+            chip8_store_registers(c8, x);
+            if (QUIRK.memory_i) c8->I = (uint16_t)(c8->I + x + QUIRK.memory_i - 1);
+            break;
+        case 0x65: // LD V0..Vx, [I]
+            chip8_load_registers(c8, x);
+            if (QUIRK.memory_i) c8->I = (uint16_t)(c8->I + x + QUIRK.memory_i - 1);
+            break;
+        default:
+            break;
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+#ifndef QUIRK_CYCLE_ONLY
+static uint32_t QUIRK_FN(run)(Chip8* c8, uint32_t cycles) {
+    uint32_t executed = 0;
+    while (executed < cycles && c8->running) {
+        uint16_t pc = c8->pc;
+        QUIRK_FN(cycle)(c8);
+        executed++;
+
+        // Control went backwards: the loop may be an idle spin worth skipping.
+        if (c8->pc <= pc && executed < cycles) {
+            uint32_t skipped = chip8_idle_skip(c8, c8->pc, cycles - executed);
+            c8->cycle_count += skipped;
+            executed += skipped;
+        }
+    }
+    return executed;
+}
+#endif
+
+#undef QUIRK_SKIP
+#undef QUIRK_MASK
+#undef QUIRK
+#undef QUIRK_FN
+#undef QUIRK_PASTE
+#undef QUIRK_PASTE2
+#undef QUIRK_PROFILE
+#undef QUIRK_SUFFIX
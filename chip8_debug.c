@@ -0,0 +1,99 @@
+// Debugger core: address bitmaps and the armed instruction loop.
+
+#include "chip8_debug.h"
+#include "chip8_internal.h"
+#include <string.h>
+
+void chip8_debug_init(Chip8Debug* d) {
+    memset(d, 0, sizeof(*d));
+}
+
+static bool test_bit(const uint64_t* bits, uint32_t addr) {
+    return (bits[addr >> 6] >> (addr & 63)) & 1;
+}
+
+// Set or clear one bit, keeping `count` equal to the number of bits set
+static void set_bit(uint64_t* bits, uint32_t* count, uint32_t addr, bool on) {
+    uint64_t mask = 1ull << (addr & 63);
+    bool was = (bits[addr >> 6] & mask) != 0;
+    if (on == was) return;
+    bits[addr >> 6] ^= mask;
+    if (on) (*count)++;
+    else (*count)--;
+}
+
+void chip8_debug_set_breakpoint(Chip8Debug* d, uint16_t addr, bool on) {
+    set_bit(d->breakpoints, &d->breakpoint_count, addr, on);
+}
+
+void chip8_debug_set_watch(Chip8Debug* d, uint16_t addr, uint32_t len, bool on) {
+    for (uint32_t i = 0; i < len && i < CHIP8_XO_MEMORY_SIZE; ++i) {
+        set_bit(d->watches, &d->watch_count, (addr + i) & CHIP8_XO_ADDR_MASK, on);
+    }
+}
+
+void chip8_debug_clear(Chip8Debug* d) {
+    memset(d->breakpoints, 0, sizeof(d->breakpoints));
+    memset(d->watches, 0, sizeof(d->watches));
+    d->breakpoint_count = 0;
+    d->watch_count = 0;
+    d->watch_i = false;
+    d->step = false;
+    d->resume = false;
+}
+
+void chip8_debug_resume(Chip8Debug* d, bool step) {
+    d->step = step;
+    d->resume = true;
+}
+
+uint32_t chip8_debug_run(Chip8Debug* d, Chip8* c8, uint32_t cycles) {
+    d->stop = CHIP8_DEBUG_NONE;
+    if (!chip8_debug_armed(d)) {
+        d->resume = false;
+        return chip8_run(c8, cycles);
+    }
+
+    uint16_t mask = c8->addr_mask;
+    bool xo = c8->quirks == CHIP8_QUIRKS_XOCHIP;
+    bool check = !d->resume;
+    d->resume = false;
+
+    uint32_t executed = 0;
+    while (executed < cycles && c8->running) {
+        uint16_t pc = c8->pc & mask;
+        if (check && d->breakpoint_count && test_bit(d->breakpoints, pc)) {
+            d->stop = CHIP8_DEBUG_BREAKPOINT;
+            d->stop_addr = pc;
+            break;
+        }
+        check = true;
+
+        // Watched stores are found from the opcode and I before it, as the trace recorder does
+        uint16_t I = c8->I;
+        uint16_t opcode = (uint16_t)(c8->memory[pc] << 8 | c8->memory[(pc + 1) & mask]);
+        chip8_cycle(c8);
+        executed++;
+
+        uint8_t stored = d->watch_count ? chip8_store_length(opcode, xo) : 0;
+        for (uint8_t i = 0; i < stored; ++i) {
+            uint16_t addr = (I + i) & mask;
+            if (test_bit(d->watches, addr)) {
+                d->stop = CHIP8_DEBUG_WATCH_MEMORY;
+                d->stop_addr = addr;
+                return executed;
+            }
+        }
+        if (d->watch_i && c8->I != I) {
+            d->stop = CHIP8_DEBUG_WATCH_I;
+            d->stop_addr = c8->I;
+            break;
+        }
+        if (d->step) {
+            d->step = false;
+            d->stop = CHIP8_DEBUG_STEP;
+            break;
+        }
+    }
+    return executed;
+}
@@ -0,0 +1,58 @@
+// Debugger core: breakpoints, memory and I watchpoints and single-stepping for a Chip8.
+// chip8_debug_run replaces chip8_run; with nothing armed it is chip8_run, so an idle debugger
+// costs one test per call and chip8_cycle itself is never touched.
+
+#ifndef CHIP8_DEBUG_H
+#define CHIP8_DEBUG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "chip8.h"
+
+#define CHIP8_DEBUG_BITMAP_WORDS  (CHIP8_XO_MEMORY_SIZE / 64)   // one bit per address, XO-CHIP sized
+
+typedef enum Chip8DebugStop {
+    CHIP8_DEBUG_NONE,          // ran the whole budget, or the machine halted
+    CHIP8_DEBUG_BREAKPOINT,    // before the instruction at stop_addr
+    CHIP8_DEBUG_WATCH_MEMORY,  // after an instruction stored to watched address stop_addr
+    CHIP8_DEBUG_WATCH_I,       // after an instruction changed I
+    CHIP8_DEBUG_STEP,          // after the single instruction a step asked for
+} Chip8DebugStop;
+
+typedef struct Chip8Debug {
+    uint64_t breakpoints[CHIP8_DEBUG_BITMAP_WORDS];   // bit a: stop before executing address a
+    uint64_t watches[CHIP8_DEBUG_BITMAP_WORDS];       // bit a: stop after a store to address a
+    uint32_t breakpoint_count;
+    uint32_t watch_count;
+    bool     watch_i;
+    bool     step;       // the next run executes one instruction and stops
+    bool     resume;     // the next run does not stop at a breakpoint on its first instruction
+
+    Chip8DebugStop stop; // why the last chip8_debug_run returned
+    uint16_t stop_addr;
+} Chip8Debug;
+
+void chip8_debug_init(Chip8Debug* d);
+
+// Set or clear a breakpoint / a write watchpoint on `len` bytes from `addr`
+void chip8_debug_set_breakpoint(Chip8Debug* d, uint16_t addr, bool on);
+void chip8_debug_set_watch(Chip8Debug* d, uint16_t addr, uint32_t len, bool on);
+
+// Clear every breakpoint and watchpoint, and any pending step
+void chip8_debug_clear(Chip8Debug* d);
+
+// True when a run may stop: anything armed or a step pending
+static inline bool chip8_debug_armed(const Chip8Debug* d) {
+    return d->breakpoint_count || d->watch_count || d->watch_i || d->step;
+}
+
+// Continue from a stop: the first instruction is executed even if it has a breakpoint.
+// With `step` set the run stops again after it.
+void chip8_debug_resume(Chip8Debug* d, bool step);
+
+// Execute up to `cycles` instructions like chip8_run, stopping early as d->stop then reports.
+// While armed it steps every instruction itself, so idle loops are not skipped.
+// Returns the number of instructions executed.
+uint32_t chip8_debug_run(Chip8Debug* d, Chip8* c8, uint32_t cycles);
+
+#endif // CHIP8_DEBUG_H
@@ -0,0 +1,76 @@
+// Engine selection: dispatches chip8_engine_run to the interpreter chosen at creation.
+
+#include "chip8_engine.h"
+#include "chip8_threaded.h"
+#include "chip8_jit.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char* const engine_names[CHIP8_ENGINE_COUNT] = {
+    "switch",
+    "threaded",
+    "jit",
+};
+
+bool chip8_engine_create(Chip8Engine* e, Chip8EngineKind kind) {
+    memset(e, 0, sizeof(*e));
+    e->kind = kind;
+
+    if (kind == CHIP8_ENGINE_THREADED) {
+        e->threaded = (Chip8Threaded*)malloc(sizeof(Chip8Threaded));
+        if (!e->threaded) return false;
+        chip8_threaded_init(e->threaded);
+    }
+    else if (kind == CHIP8_ENGINE_JIT) {
+        e->jit = (struct Chip8Jit*)malloc(sizeof(Chip8Jit));
+        if (!e->jit) return false;
+        // Without native code support the JIT cache simply interprets.
+        chip8_jit_init(e->jit);
+    }
+    return true;
+}
+
+void chip8_engine_destroy(Chip8Engine* e) {
+    free(e->threaded);
+    e->threaded = NULL;
+    if (e->jit) {
+        chip8_jit_destroy(e->jit);
+        free(e->jit);
+        e->jit = NULL;
+    }
+}
+
+uint32_t chip8_engine_run(Chip8Engine* e, Chip8* c8, uint32_t cycles) {
+    switch (e->kind) {
+    case CHIP8_ENGINE_THREADED:
+        return chip8_threaded_run(e->threaded, c8, cycles);
+    case CHIP8_ENGINE_JIT:
+        return chip8_jit_run(e->jit, c8, cycles);
+    case CHIP8_ENGINE_SWITCH:
+    default:
+        return chip8_run(c8, cycles);
+    }
+}
+
+void chip8_engine_reset(Chip8Engine* e) {
+    if (e->threaded) {
+        chip8_threaded_init(e->threaded);
+    }
+    if (e->jit) {
+        chip8_jit_flush(e->jit);
+    }
+}
+
+const char* chip8_engine_name(Chip8EngineKind kind) {
+    return kind < CHIP8_ENGINE_COUNT ? engine_names[kind] : "unknown";
+}
+
+bool chip8_engine_parse(const char* name, Chip8EngineKind* kind) {
+    for (int i = 0; i < CHIP8_ENGINE_COUNT; ++i) {
+        if (strcmp(name, engine_names[i]) == 0) {
+            *kind = (Chip8EngineKind)i;
+            return true;
+        }
+    }
+    return false;
+}
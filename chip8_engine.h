@@ -0,0 +1,46 @@
+// Selectable execution engines behind one run API, so hosts can swap interpreters
+// without changing how they drive a Chip8.
+
+#ifndef CHIP8_ENGINE_H
+#define CHIP8_ENGINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "chip8.h"
+
+typedef enum Chip8EngineKind {
+    CHIP8_ENGINE_SWITCH,     // chip8_cycle, one switch dispatch per instruction
+    CHIP8_ENGINE_THREADED,   // predecoded records with threaded dispatch
+    CHIP8_ENGINE_JIT,        // x86-64 block recompiler, interprets elsewhere
+    CHIP8_ENGINE_COUNT
+} Chip8EngineKind;
+
+struct Chip8Threaded;
+struct Chip8Jit;
+
+// Engine state for one machine. Do not share one engine between machines.
+typedef struct Chip8Engine {
+    Chip8EngineKind kind;
+    struct Chip8Threaded* threaded;
+    struct Chip8Jit* jit;
+} Chip8Engine;
+
+// Allocate engine state. Returns false on allocation failure.
+bool chip8_engine_create(Chip8Engine* e, Chip8EngineKind kind);
+
+void chip8_engine_destroy(Chip8Engine* e);
+
+// Execute up to `cycles` instructions; returns the number executed.
+uint32_t chip8_engine_run(Chip8Engine* e, Chip8* c8, uint32_t cycles);
+
+// Forget cached translations. Call after memory was changed outside the engine
+// (ROM load, state restore, running chip8_cycle directly).
+void chip8_engine_reset(Chip8Engine* e);
+
+// Engine name for command lines and reports ("switch", "threaded", "jit")
+const char* chip8_engine_name(Chip8EngineKind kind);
+
+// Parse an engine name; returns false if unknown
+bool chip8_engine_parse(const char* name, Chip8EngineKind* kind);
+
+#endif // CHIP8_ENGINE_H
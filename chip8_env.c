@@ -0,0 +1,102 @@
+// Training environment: snapshot resets, key-mask actions and packed observations.
+
+#include "chip8_env.h"
+#include <string.h>
+
+bool chip8_env_init(Chip8Env* env, const Chip8* start, Chip8EngineKind engine,
+    uint32_t instructions_per_frame, Chip8ObsFormat format) {
+    if (start->addr_mask != CHIP8_ADDR_MASK || format >= CHIP8_OBS_COUNT) return false;
+
+    memset(env, 0, sizeof(*env));
+    if (!chip8_engine_create(&env->engine, engine)) {
+        chip8_engine_destroy(&env->engine);
+        return false;
+    }
+    env->machine = *start;
+    env->machine.dirty_pages = 0;   // so a reset can tell whether an episode stored to memory
+    env->snapshot = env->machine;
+    env->instructions_per_frame = instructions_per_frame;
+    env->format = format;
+    env->done = !start->running;
+    return true;
+}
+
+void chip8_env_destroy(Chip8Env* env) {
+    chip8_engine_destroy(&env->engine);
+}
+
+void chip8_env_snapshot(Chip8Env* env) {
+    env->machine.dirty_pages = 0;
+    env->snapshot = env->machine;
+    env->resnapshot = true;
+}
+
+// OR each horizontal pixel pair of a 64-pixel word into one bit: 64 pixels -> 32, MSB first
+static uint32_t pool_word(uint64_t w) {
+    uint64_t x = (w | w >> 1) & 0x5555555555555555ull;   // pair k lands on bit 62 - 2k
+    x = (x | x >> 1) & 0x3333333333333333ull;
+    x = (x | x >> 2) & 0x0F0F0F0F0F0F0F0Full;
+    x = (x | x >> 4) & 0x00FF00FF00FF00FFull;
+    x = (x | x >> 8) & 0x0000FFFF0000FFFFull;
+    x = (x | x >> 16) & 0x00000000FFFFFFFFull;
+    return (uint32_t)x;
+}
+
+// 64x32 plane-0 observation: low res copies word 0 of each row, high res max-pools 2x2 blocks
+static void observe_64x32(const Chip8* c8, uint64_t* out) {
+    if (!c8->high_res) {
+        for (int y = 0; y < CHIP8_LOW_RES_HEIGHT; ++y) out[y] = c8->display[y][0];
+        return;
+    }
+    for (int y = 0; y < CHIP8_LOW_RES_HEIGHT; ++y) {
+        const uint64_t* top = c8->display[2 * y];
+        const uint64_t* bottom = c8->display[2 * y + 1];
+        out[y] = (uint64_t)pool_word(top[0] | bottom[0]) << 32 | pool_word(top[1] | bottom[1]);
+    }
+}
+
+const uint64_t* chip8_env_observe(Chip8Env* env) {
+    if (env->format == CHIP8_OBS_NATIVE) return &env->machine.display[0][0];
+    observe_64x32(&env->machine, env->obs);
+    return env->obs;
+}
+
+const uint64_t* chip8_env_reset(Chip8Env* env, uint64_t seed) {
+    // Translations may describe code the last episode overwrote; keep them otherwise, so
+    // short episodes do not recompile the ROM every time
+    if (env->machine.dirty_pages || env->resnapshot) chip8_engine_reset(&env->engine);
+    env->resnapshot = false;
+    env->machine = env->snapshot;
+    if (seed) chip8_seed(&env->machine, seed);
+    env->frame = 0;
+    env->done = !env->machine.running;
+    return chip8_env_observe(env);
+}
+
+static void run_frames(Chip8Env* env, uint16_t keys, uint32_t frames) {
+    Chip8* c8 = &env->machine;
+    for (int k = 0; k < CHIP8_KEY_COUNT; ++k) c8->keys[k] = (keys >> k) & 1;
+
+    for (uint32_t f = 0; f < frames && !env->done; ++f) {
+        chip8_engine_run(&env->engine, c8, env->instructions_per_frame);
+        chip8_tick_timers(c8);
+        env->frame++;
+        env->done = !c8->running;
+    }
+}
+
+const uint64_t* chip8_env_step(Chip8Env* env, uint16_t keys, uint32_t frames) {
+    run_frames(env, keys, frames);
+    return chip8_env_observe(env);
+}
+
+void chip8_env_step_many(Chip8Env* envs, int count, const uint16_t* keys, uint32_t frames,
+    uint64_t* obs, bool* done) {
+    for (int i = 0; i < count; ++i) {
+        Chip8Env* env = &envs[i];
+        run_frames(env, keys[i], frames);
+        done[i] = env->done;
+        if (env->done) chip8_env_reset(env, 0);
+        observe_64x32(&env->machine, obs + (size_t)i * CHIP8_ENV_OBS_WORDS);
+    }
+}
@@ -0,0 +1,62 @@
+// Training environment API: apply an action, advance whole 60Hz frames, read a packed screen.
+// Resets copy a cached snapshot instead of re-initializing and re-reading the ROM, and
+// observations are read straight from the packed display rows, one bit per pixel.
+
+#ifndef CHIP8_ENV_H
+#define CHIP8_ENV_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "chip8.h"
+#include "chip8_engine.h"
+
+#define CHIP8_ENV_OBS_WORDS CHIP8_LOW_RES_HEIGHT   // words in one CHIP8_OBS_64X32 observation
+
+typedef enum Chip8ObsFormat {
+    CHIP8_OBS_NATIVE,   // the display itself, no copy: CHIP8_ROW_WORDS per row, see chip8_pixel
+    CHIP8_OBS_64X32,    // one word per row, MSB = left; high res is 2x2 max-pooled to 64x32
+    CHIP8_OBS_COUNT
+} Chip8ObsFormat;
+
+// One environment. Classic machines only; do not share an engine between environments.
+typedef struct Chip8Env {
+    Chip8          machine;
+    Chip8          snapshot;   // state chip8_env_reset restores
+    Chip8Engine    engine;
+    uint32_t       instructions_per_frame;
+    Chip8ObsFormat format;
+    uint64_t       frame;      // frames since the last reset
+    bool           done;       // the machine halted (00FD); stays set until reset
+    bool           resnapshot; // chip8_env_snapshot ran: the next reset drops the engine's cache
+    uint64_t       obs[CHIP8_ENV_OBS_WORDS];   // CHIP8_OBS_64X32 output
+} Chip8Env;
+
+// Start from `start` (ROM loaded, quirks and seed set; it may be mid-game) and make it the
+// reset point. Returns false for XO-CHIP machines or if the engine cannot be created.
+bool chip8_env_init(Chip8Env* env, const Chip8* start, Chip8EngineKind engine,
+    uint32_t instructions_per_frame, Chip8ObsFormat format);
+
+void chip8_env_destroy(Chip8Env* env);
+
+// Make the current state the reset point
+void chip8_env_snapshot(Chip8Env* env);
+
+// Restore the reset point. A non-zero seed reseeds Cxkk so episodes differ; 0 keeps the
+// snapshot's generator. Returns the first observation.
+const uint64_t* chip8_env_reset(Chip8Env* env, uint64_t seed);
+
+// Hold `keys` (bit k = key k down) for `frames` frames, ticking the timers after each.
+// Stops early when the machine halts. Returns the observation in env->format.
+const uint64_t* chip8_env_step(Chip8Env* env, uint16_t keys, uint32_t frames);
+
+// Current observation in env->format, valid until the next step or reset
+const uint64_t* chip8_env_observe(Chip8Env* env);
+
+// Step `count` environments with one call: environment i holds keys[i] for `frames` frames,
+// its 64x32 observation is written to obs + i * CHIP8_ENV_OBS_WORDS and done[i] reports a halt.
+// Halted environments are reset (seed 0) before returning, so their observation starts the
+// next episode.
+void chip8_env_step_many(Chip8Env* envs, int count, const uint16_t* keys, uint32_t frames,
+    uint64_t* obs, bool* done);
+
+#endif // CHIP8_ENV_H
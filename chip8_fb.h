@@ -0,0 +1,140 @@
+// Packed 1-bit framebuffer row operations shared by the display routines.
+// A plane row is CHIP8_DISPLAY_WORDS uint64_t words; pixel x is bit (63 - x % 64) of word x / 64,
+// so sprite bytes (MSB = leftmost pixel) drop in with plain shifts.
+
+#ifndef CHIP8_FB_H
+#define CHIP8_FB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "chip8.h"
+
+// Place `nbits` sprite bits (MSB first) at column x of a row `w` pixels wide (64 or 128),
+// wrapping around the right edge. Returns the mask for each word of the row.
+static inline void chip8_fb_row_mask(uint32_t bits, int nbits, int x, int w, uint64_t mask[2]) {
+    uint64_t hi = (uint64_t)bits << (64 - nbits);
+    uint64_t lo = 0;
+    x %= w;
+
+    if (w <= 64) {
+        mask[0] = x ? (hi >> x) | (hi << (64 - x)) : hi;
+        mask[1] = 0;
+        return;
+    }
+
+    // 128-bit rotate right by x
+    if (x >= 64) {
+        lo = hi;
+        hi = 0;
+        x -= 64;
+    }
+    if (x) {
+        uint64_t new_hi = (hi >> x) | (lo << (64 - x));
+        uint64_t new_lo = (lo >> x) | (hi << (64 - x));
+        hi = new_hi;
+        lo = new_lo;
+    }
+    mask[0] = hi;
+    mask[1] = lo;
+}
+
+// Like chip8_fb_row_mask, but bits past the right edge are dropped instead of wrapping.
+static inline void chip8_fb_row_mask_clipped(uint32_t bits, int nbits, int x, int w, uint64_t mask[2]) {
+    uint64_t hi = (uint64_t)bits << (64 - nbits);
+    x %= w;
+
+    if (x >= 64) {
+        // Only possible in a 128-pixel row: the sprite starts in the second word
+        mask[0] = 0;
+        mask[1] = hi >> (x - 64);
+        return;
+    }
+    mask[0] = hi >> x;
+    mask[1] = (w > 64 && x) ? hi << (64 - x) : 0;
+}
+
+// XOR a mask into a row; returns true if any lit pixel was turned off.
+static inline bool chip8_fb_xor_row(uint64_t* row, const uint64_t mask[2]) {
+    bool collision = ((row[0] & mask[0]) | (row[1] & mask[1])) != 0;
+    row[0] ^= mask[0];
+    row[1] ^= mask[1];
+    return collision;
+}
+
+// Display rows hold every plane: CHIP8_DISPLAY_WORDS words of plane 0, then of plane 1.
+typedef uint64_t Chip8FbRow[CHIP8_ROW_WORDS];
+
+// Shift the planes set in `planes` of rows [0, h) down by n, clearing the rows that scroll in.
+// With every plane selected whole rows move with one memmove.
+static inline void chip8_fb_scroll_down(Chip8FbRow* rows, int h, int n, int planes) {
+    if (n > h) n = h;
+    if (planes == CHIP8_PLANES_ALL) {
+        memmove(rows[n], rows[0], (size_t)(h - n) * sizeof(rows[0]));
+        memset(rows[0], 0, (size_t)n * sizeof(rows[0]));
+        return;
+    }
+    for (int p = 0; p < CHIP8_DISPLAY_PLANES; ++p) {
+        if (!(planes & (1 << p))) continue;
+        int w0 = p * CHIP8_DISPLAY_WORDS;
+        for (int y = h - 1; y >= 0; --y) {
+            for (int i = 0; i < CHIP8_DISPLAY_WORDS; ++i) {
+                rows[y][w0 + i] = y >= n ? rows[y - n][w0 + i] : 0;
+            }
+        }
+    }
+}
+
+// Shift the selected planes of rows [0, h) up by n, clearing the rows that scroll in.
+static inline void chip8_fb_scroll_up(Chip8FbRow* rows, int h, int n, int planes) {
+    if (n > h) n = h;
+    if (planes == CHIP8_PLANES_ALL) {
+        memmove(rows[0], rows[n], (size_t)(h - n) * sizeof(rows[0]));
+        memset(rows[h - n], 0, (size_t)n * sizeof(rows[0]));
+        return;
+    }
+    for (int p = 0; p < CHIP8_DISPLAY_PLANES; ++p) {
+        if (!(planes & (1 << p))) continue;
+        int w0 = p * CHIP8_DISPLAY_WORDS;
+        for (int y = 0; y < h; ++y) {
+            for (int i = 0; i < CHIP8_DISPLAY_WORDS; ++i) {
+                rows[y][w0 + i] = y + n < h ? rows[y + n][w0 + i] : 0;
+            }
+        }
+    }
+}
+
+// Shift the selected planes of rows [0, h) right (toward higher x) by n < 64 pixels within width w.
+static inline void chip8_fb_scroll_right(Chip8FbRow* rows, int w, int h, int n, int planes) {
+    for (int p = 0; p < CHIP8_DISPLAY_PLANES; ++p) {
+        if (!(planes & (1 << p))) continue;
+        int w0 = p * CHIP8_DISPLAY_WORDS;
+        for (int y = 0; y < h; ++y) {
+            uint64_t* row = &rows[y][w0];
+            if (w > 64) {
+                row[1] = (row[1] >> n) | (row[0] << (64 - n));
+            }
+            row[0] >>= n;
+        }
+    }
+}
+
+// Shift the selected planes of rows [0, h) left (toward lower x) by n < 64 pixels within width w.
+static inline void chip8_fb_scroll_left(Chip8FbRow* rows, int w, int h, int n, int planes) {
+    for (int p = 0; p < CHIP8_DISPLAY_PLANES; ++p) {
+        if (!(planes & (1 << p))) continue;
+        int w0 = p * CHIP8_DISPLAY_WORDS;
+        for (int y = 0; y < h; ++y) {
+            uint64_t* row = &rows[y][w0];
+            if (w > 64) {
+                row[0] = (row[0] << n) | (row[1] >> (64 - n));
+                row[1] <<= n;
+            }
+            else {
+                row[0] <<= n;
+            }
+        }
+    }
+}
+
+#endif // CHIP8_FB_H
@@ -0,0 +1,649 @@
+// GDB remote serial protocol stub for the debugger core, over a loopback TCP socket.
+
+#ifdef _WIN32
+#include <winsock2.h>   // before windows.h, which host_thread.h includes
+#include <ws2tcpip.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "ws2_32.lib")
+#endif
+typedef SOCKET GdbSocket;
+#define GDB_NO_SOCKET INVALID_SOCKET
+#define close_socket closesocket
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int GdbSocket;
+#define GDB_NO_SOCKET (-1)
+#define close_socket close
+#endif
+
+#include "chip8_gdb.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define GDB_PACKET_SIZE    4096        // advertised PacketSize: largest packet either side sends
+#define GDB_POLL_MS        50          // stub thread: how often an idle wait checks for quit
+#define GDB_RUN_POLL_MS    2           // stub thread: Ctrl-C and stop polling while the machine runs
+#define GDB_PARK_POLL_NS   1000000ull  // emulation thread: resume polling while stopped
+#define GDB_ACK_TIMEOUT_MS 2000
+
+#define GDB_TIMEOUT    (-1)
+#define GDB_CLOSED     (-2)
+#define GDB_INTERRUPT  (-3)
+
+// Register file as g/G/p/P see it: V0-VF, I and PC little-endian, SP, DT, ST
+#define GDB_REG_COUNT  21
+#define GDB_REG_BYTES  23
+
+typedef struct Chip8GdbConnection {
+    GdbSocket listener;
+    GdbSocket client;
+    bool      no_ack;    // QStartNoAckMode accepted
+    size_t    in_pos;
+    size_t    in_len;
+    uint8_t   in[1024];
+    char      packet[GDB_PACKET_SIZE + 1];
+    char      reply[GDB_PACKET_SIZE + 1];
+    char      out[GDB_PACKET_SIZE + 8];
+} Chip8GdbConnection;
+
+static const char target_xml[] =
+    "<?xml version=\"1.0\"?>"
+    "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+    "<target version=\"1.0\"><feature name=\"org.chip8.core\">"
+    "<reg name=\"v0\" bitsize=\"8\" type=\"uint8\" regnum=\"0\"/>"
+    "<reg name=\"v1\" bitsize=\"8\" type=\"uint8\"/><reg name=\"v2\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"v3\" bitsize=\"8\" type=\"uint8\"/><reg name=\"v4\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"v5\" bitsize=\"8\" type=\"uint8\"/><reg name=\"v6\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"v7\" bitsize=\"8\" type=\"uint8\"/><reg name=\"v8\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"v9\" bitsize=\"8\" type=\"uint8\"/><reg name=\"va\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"vb\" bitsize=\"8\" type=\"uint8\"/><reg name=\"vc\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"vd\" bitsize=\"8\" type=\"uint8\"/><reg name=\"ve\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"vf\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"i\" bitsize=\"16\" type=\"data_ptr\"/>"
+    "<reg name=\"pc\" bitsize=\"16\" type=\"code_ptr\"/>"
+    "<reg name=\"sp\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"dt\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"st\" bitsize=\"8\" type=\"uint8\"/>"
+    "</feature></target>";
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static int hex_value(int ch) {
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    return -1;
+}
+
+// Parse hex digits at *p, advancing past them
+static uint32_t parse_hex(const char** p) {
+    uint32_t value = 0;
+    int digit;
+    while ((digit = hex_value(**p)) >= 0) {
+        value = value << 4 | (uint32_t)digit;
+        (*p)++;
+    }
+    return value;
+}
+
+static char* put_hex(char* out, const uint8_t* bytes, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        *out++ = hex_digits[bytes[i] >> 4];
+        *out++ = hex_digits[bytes[i] & 0xF];
+    }
+    *out = '\0';
+    return out;
+}
+
+// Decode `count` bytes of hex at `in`; false if a digit is missing or invalid
+static bool get_hex(const char* in, uint8_t* bytes, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        int hi = hex_value(in[2 * i]);
+        int lo = hi >= 0 ? hex_value(in[2 * i + 1]) : -1;
+        if (lo < 0) return false;
+        bytes[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return true;
+}
+
+// ---- Socket I/O ----
+
+// 1 when `s` is readable (or has a connection to accept), 0 on timeout, -1 on error
+static int wait_readable(GdbSocket s, int timeout_ms) {
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(s, &set);
+    struct timeval tv = { timeout_ms / 1000, (timeout_ms % 1000) * 1000 };
+    int n = select((int)s + 1, &set, NULL, NULL, &tv);
+    return n < 0 ? -1 : n > 0;
+}
+
+// Next byte from the client, GDB_TIMEOUT after timeout_ms, or GDB_CLOSED
+static int read_byte(Chip8GdbConnection* c, int timeout_ms) {
+    if (c->in_pos == c->in_len) {
+        int ready = wait_readable(c->client, timeout_ms);
+        if (ready == 0) return GDB_TIMEOUT;
+        if (ready < 0) return GDB_CLOSED;
+        int n = (int)recv(c->client, (char*)c->in, (int)sizeof(c->in), 0);
+        if (n <= 0) return GDB_CLOSED;
+        c->in_pos = 0;
+        c->in_len = (size_t)n;
+    }
+    return c->in[c->in_pos++];
+}
+
+// Like read_byte, but waits until a byte arrives unless the stub is shutting down
+static int read_byte_wait(Chip8Gdb* g, Chip8GdbConnection* c) {
+    for (;;) {
+        int ch = read_byte(c, GDB_POLL_MS);
+        if (ch != GDB_TIMEOUT) return ch;
+        if (atomic_load(&g->quit)) return GDB_CLOSED;
+    }
+}
+
+static bool send_all(Chip8GdbConnection* c, const char* data, size_t len) {
+    while (len > 0) {
+        int n = (int)send(c->client, data, (int)len, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        data += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+// Read the next packet into c->packet, acknowledging it. Returns its length, GDB_INTERRUPT
+// for a Ctrl-C byte between packets, or GDB_CLOSED.
+static int read_packet(Chip8Gdb* g, Chip8GdbConnection* c) {
+    for (;;) {
+        int ch = read_byte_wait(g, c);
+        if (ch < 0) return ch;
+        if (ch == 0x03) return GDB_INTERRUPT;
+        if (ch != '$') continue;   // acks and noise between packets
+
+        size_t len = 0;
+        uint8_t sum = 0;
+        bool overflow = false;
+        while ((ch = read_byte_wait(g, c)) != '#') {
+            if (ch < 0) return GDB_CLOSED;
+            if (ch == '$') {       // a new packet started: drop the partial one
+                len = 0;
+                sum = 0;
+                overflow = false;
+                continue;
+            }
+            sum += (uint8_t)ch;
+            if (len < GDB_PACKET_SIZE) c->packet[len++] = (char)ch;
+            else overflow = true;
+        }
+        int hi = read_byte_wait(g, c);
+        int lo = read_byte_wait(g, c);
+        if (hi < 0 || lo < 0) return GDB_CLOSED;
+        c->packet[len] = '\0';
+
+        bool ok = !overflow && hex_value(hi) >= 0 && hex_value(lo) >= 0 &&
+            (uint8_t)(hex_value(hi) << 4 | hex_value(lo)) == sum;
+        if (!c->no_ack && !send_all(c, ok ? "+" : "-", 1)) return GDB_CLOSED;
+        if (ok) return (int)len;
+    }
+}
+
+// Frame and send `data`; in ack mode, resend until the client acknowledges it
+static bool send_packet(Chip8GdbConnection* c, const char* data) {
+    size_t len = strlen(data);
+    if (len > GDB_PACKET_SIZE) len = GDB_PACKET_SIZE;
+    uint8_t sum = 0;
+    c->out[0] = '$';
+    for (size_t i = 0; i < len; ++i) {
+        c->out[1 + i] = data[i];
+        sum += (uint8_t)data[i];
+    }
+    c->out[1 + len] = '#';
+    c->out[2 + len] = hex_digits[sum >> 4];
+    c->out[3 + len] = hex_digits[sum & 0xF];
+
+    for (int attempt = 0; attempt < 3; ++attempt) {
+        if (!send_all(c, c->out, len + 4)) return false;
+        if (c->no_ack) return true;
+        int ch;
+        do {
+            ch = read_byte(c, GDB_ACK_TIMEOUT_MS);
+        } while (ch >= 0 && ch != '+' && ch != '-');
+        if (ch == '+') return true;
+        if (ch == GDB_CLOSED) return false;
+    }
+    return false;
+}
+
+// ---- Machine access (stub thread, only while the machine is stopped) ----
+
+static void pack_registers(const Chip8* c8, uint8_t* regs) {
+    memcpy(regs, c8->V, CHIP8_REGISTER_COUNT);
+    regs[16] = (uint8_t)c8->I;
+    regs[17] = (uint8_t)(c8->I >> 8);
+    regs[18] = (uint8_t)c8->pc;
+    regs[19] = (uint8_t)(c8->pc >> 8);
+    regs[20] = c8->sp;
+    regs[21] = c8->delay_timer;
+    regs[22] = c8->sound_timer;
+}
+
+// False if the values do not fit the machine (a stack pointer past the stack)
+static bool unpack_registers(Chip8* c8, const uint8_t* regs) {
+    if (regs[20] > CHIP8_STACK_SIZE) return false;
+    memcpy(c8->V, regs, CHIP8_REGISTER_COUNT);
+    c8->I = (uint16_t)(regs[16] | regs[17] << 8);
+    c8->pc = (uint16_t)((regs[18] | regs[19] << 8) & c8->addr_mask);
+    c8->sp = regs[20];
+    c8->delay_timer = regs[21];
+    c8->sound_timer = regs[22];
+    return true;
+}
+
+// Byte offset and size of register n in the packed register file
+static bool register_span(uint32_t n, uint32_t* offset, uint32_t* size) {
+    static const uint8_t offsets[GDB_REG_COUNT - CHIP8_REGISTER_COUNT] = { 16, 18, 20, 21, 22 };
+    static const uint8_t sizes[GDB_REG_COUNT - CHIP8_REGISTER_COUNT] = { 2, 2, 1, 1, 1 };
+    if (n >= GDB_REG_COUNT) return false;
+    *offset = n < CHIP8_REGISTER_COUNT ? n : offsets[n - CHIP8_REGISTER_COUNT];
+    *size = n < CHIP8_REGISTER_COUNT ? 1 : sizes[n - CHIP8_REGISTER_COUNT];
+    return true;
+}
+
+// Bytes of memory readable or writable from `addr`, at most `len`; 0 past the end
+static uint32_t memory_span(const Chip8* c8, uint32_t addr, uint32_t len) {
+    uint32_t size = (uint32_t)c8->addr_mask + 1;
+    if (addr >= size) return 0;
+    return len < size - addr ? len : size - addr;
+}
+
+// Text for the client's console, as O packets
+static bool send_output(Chip8GdbConnection* c, const char* text) {
+    size_t len = strlen(text);
+    while (len > 0) {
+        size_t chunk = len < (GDB_PACKET_SIZE - 1) / 2 ? len : (GDB_PACKET_SIZE - 1) / 2;
+        c->reply[0] = 'O';
+        put_hex(c->reply + 1, (const uint8_t*)text, chunk);
+        if (!send_packet(c, c->reply)) return false;
+        text += chunk;
+        len -= chunk;
+    }
+    return true;
+}
+
+// qRcmd: `monitor <command>` in GDB
+static bool monitor_command(Chip8Gdb* g, Chip8GdbConnection* c, const char* hex) {
+    char command[128];
+    size_t len = strlen(hex) / 2;
+    if (len >= sizeof(command) || !get_hex(hex, (uint8_t*)command, len)) return send_packet(c, "E01");
+    command[len] = '\0';
+
+    Chip8* c8 = g->chip8;
+    char text[1024];
+    if (strcmp(command, "stack") == 0) {
+        int n = snprintf(text, sizeof(text), "sp=%u\n", c8->sp);
+        for (int i = c8->sp - 1; i >= 0 && n < (int)sizeof(text) - 32; --i) {
+            n += snprintf(text + n, sizeof(text) - (size_t)n, "  #%d  return to 0x%03x\n",
+                c8->sp - 1 - i, c8->stack[i]);
+        }
+    }
+    else if (strcmp(command, "watch-i") == 0 || strcmp(command, "unwatch-i") == 0) {
+        g->debug.watch_i = command[0] == 'w';
+        snprintf(text, sizeof(text), "Watchpoint on I %s\n", g->debug.watch_i ? "set" : "cleared");
+    }
+    else if (strcmp(command, "help") == 0) {
+        snprintf(text, sizeof(text),
+            "stack      show the call stack\n"
+            "watch-i    stop after any instruction that changes I\n"
+            "unwatch-i  remove the watchpoint on I\n");
+    }
+    else {
+        snprintf(text, sizeof(text), "Unknown monitor command '%s', try 'monitor help'\n", command);
+    }
+    return send_output(c, text) && send_packet(c, "OK");
+}
+
+// Stop reply for the current stop
+static bool send_stop_reply(Chip8Gdb* g, Chip8GdbConnection* c) {
+    if (atomic_load(&g->state) == CHIP8_GDB_EXITED) return send_packet(c, "W00");
+    if (g->interrupted) return send_packet(c, "S02");
+    char reply[32];
+    switch (g->debug.stop) {
+    case CHIP8_DEBUG_BREAKPOINT:
+        return send_packet(c, "T05swbreak:;");
+    case CHIP8_DEBUG_WATCH_MEMORY:
+        snprintf(reply, sizeof(reply), "T05watch:%x;", g->debug.stop_addr);
+        return send_packet(c, reply);
+    default:
+        return send_packet(c, "S05");
+    }
+}
+
+// Wait until the emulation thread stopped or the machine exited. False if the stub quits first.
+static bool wait_stopped(Chip8Gdb* g) {
+    while (atomic_load(&g->state) == CHIP8_GDB_RUNNING) {
+        if (atomic_load(&g->quit)) return false;
+        host_sleep_until_ns(host_time_ns() + GDB_PARK_POLL_NS);
+    }
+    return true;
+}
+
+// c / s / vCont: let the machine run until the next stop, forwarding Ctrl-C, then report it
+static bool resume(Chip8Gdb* g, Chip8GdbConnection* c, bool step, const char* addr) {
+    if (atomic_load(&g->state) == CHIP8_GDB_EXITED) return send_packet(c, "W00");
+    if (*addr) g->chip8->pc = (uint16_t)(parse_hex(&addr) & g->chip8->addr_mask);
+    chip8_debug_resume(&g->debug, step);
+    g->interrupted = false;
+    atomic_store(&g->halt, false);
+    atomic_store(&g->state, CHIP8_GDB_RUNNING);
+
+    while (atomic_load(&g->state) == CHIP8_GDB_RUNNING) {
+        if (atomic_load(&g->quit)) return false;
+        int ch = read_byte(c, GDB_RUN_POLL_MS);
+        if (ch == 0x03) atomic_store(&g->halt, true);
+        else if (ch == GDB_CLOSED) return false;
+    }
+    return send_stop_reply(g, c);
+}
+
+// Handle one packet while the machine is stopped. Returns false to end the session.
+static bool handle_packet(Chip8Gdb* g, Chip8GdbConnection* c) {
+    Chip8* c8 = g->chip8;
+    const char* p = c->packet;
+    uint8_t regs[GDB_REG_BYTES];
+
+    switch (*p++) {
+    case '?':
+        return send_stop_reply(g, c);
+
+    case 'g':
+        pack_registers(c8, regs);
+        put_hex(c->reply, regs, sizeof(regs));
+        return send_packet(c, c->reply);
+
+    case 'G':
+        if (!get_hex(p, regs, sizeof(regs)) || !unpack_registers(c8, regs)) return send_packet(c, "E01");
+        return send_packet(c, "OK");
+
+    case 'p': {
+        uint32_t offset, size;
+        if (!register_span(parse_hex(&p), &offset, &size)) return send_packet(c, "E01");
+        pack_registers(c8, regs);
+        put_hex(c->reply, regs + offset, size);
+        return send_packet(c, c->reply);
+    }
+
+    case 'P': {
+        uint32_t offset, size;
+        bool ok = register_span(parse_hex(&p), &offset, &size) && *p++ == '=';
+        pack_registers(c8, regs);
+        ok = ok && get_hex(p, regs + offset, size) && unpack_registers(c8, regs);
+        return send_packet(c, ok ? "OK" : "E01");
+    }
+
+    case 'm': {
+        uint32_t addr = parse_hex(&p);
+        uint32_t len = *p == ',' ? (++p, parse_hex(&p)) : 0;
+        if (len > GDB_PACKET_SIZE / 2) len = GDB_PACKET_SIZE / 2;
+        len = memory_span(c8, addr, len);
+        if (len == 0) return send_packet(c, "E01");
+        put_hex(c->reply, c8->memory + addr, len);
+        return send_packet(c, c->reply);
+    }
+
+    case 'M': {
+        uint32_t addr = parse_hex(&p);
+        uint32_t len = *p == ',' ? (++p, parse_hex(&p)) : 0;
+        if (*p++ != ':' || memory_span(c8, addr, len) != len || strlen(p) != 2 * (size_t)len ||
+            !get_hex(p, c8->memory + addr, len)) {
+            return send_packet(c, "E01");
+        }
+        // Engines that cache decoded code see the store like an Fx55 to the same pages
+        for (uint32_t page = addr >> CHIP8_PAGE_SHIFT; len && page <= (addr + len - 1) >> CHIP8_PAGE_SHIFT; ++page) {
+            c8->dirty_pages |= (uint16_t)(1u << (page % CHIP8_PAGE_COUNT));
+        }
+        return send_packet(c, "OK");
+    }
+
+    case 'c':
+        return resume(g, c, false, p);
+
+    case 's':
+        return resume(g, c, true, p);
+
+    case 'Z':
+    case 'z': {
+        bool on = c->packet[0] == 'Z';
+        char type = *p++;
+        if (*p++ != ',') return send_packet(c, "E01");
+        uint32_t addr = parse_hex(&p);
+        uint32_t len = *p == ',' ? (++p, parse_hex(&p)) : 1;
+        if (type == '0' || type == '1') {
+            if (memory_span(c8, addr, 1) == 0) return send_packet(c, "E01");
+            chip8_debug_set_breakpoint(&g->debug, (uint16_t)addr, on);
+            return send_packet(c, "OK");
+        }
+        if (type == '2') {
+            if (memory_span(c8, addr, len) != len) return send_packet(c, "E01");
+            chip8_debug_set_watch(&g->debug, (uint16_t)addr, len, on);
+            return send_packet(c, "OK");
+        }
+        return send_packet(c, "");   // read and access watchpoints: nothing reads memory to hook
+    }
+
+    case 'v':
+        if (strcmp(p, "Cont?") == 0) return send_packet(c, "vCont;c;C;s;S");
+        if (strncmp(p, "Cont;", 5) == 0) {
+            char action = p[5];
+            return resume(g, c, action == 's' || action == 'S', "");
+        }
+        return send_packet(c, "");
+
+    case 'q':
+        if (strncmp(p, "Supported", 9) == 0) {
+            snprintf(c->reply, sizeof(c->reply),
+                "PacketSize=%x;qXfer:features:read+;swbreak+;hwbreak+;QStartNoAckMode+", GDB_PACKET_SIZE);
+            return send_packet(c, c->reply);
+        }
+        if (strncmp(p, "Xfer:features:read:target.xml:", 30) == 0) {
+            p += 30;
+            uint32_t offset = parse_hex(&p);
+            uint32_t len = *p == ',' ? (++p, parse_hex(&p)) : 0;
+            uint32_t size = (uint32_t)sizeof(target_xml) - 1;
+            if (len > GDB_PACKET_SIZE - 1) len = GDB_PACKET_SIZE - 1;
+            if (offset >= size) return send_packet(c, "l");
+            uint32_t chunk = size - offset < len ? size - offset : len;
+            c->reply[0] = offset + chunk < size ? 'm' : 'l';
+            memcpy(c->reply + 1, target_xml + offset, chunk);
+            c->reply[1 + chunk] = '\0';
+            return send_packet(c, c->reply);
+        }
+        if (strncmp(p, "Rcmd,", 5) == 0) return monitor_command(g, c, p + 5);
+        if (strcmp(p, "Attached") == 0) return send_packet(c, "1");
+        if (strcmp(p, "C") == 0) return send_packet(c, "QC1");
+        if (strcmp(p, "fThreadInfo") == 0) return send_packet(c, "m1");
+        if (strcmp(p, "sThreadInfo") == 0) return send_packet(c, "l");
+        return send_packet(c, "");
+
+    case 'Q':
+        if (strcmp(p, "StartNoAckMode") == 0) {
+            bool ok = send_packet(c, "OK");   // still acknowledged; no acks after it
+            c->no_ack = true;
+            return ok;
+        }
+        return send_packet(c, "");
+
+    case 'H':
+    case 'T':
+        return send_packet(c, "OK");   // one thread
+
+    case 'D':
+        send_packet(c, "OK");
+        return false;
+
+    case 'k':
+        c8->running = false;   // ends the emulation like 00FD
+        return false;
+
+    default:
+        return send_packet(c, "");
+    }
+}
+
+// One client session: stop the machine, serve packets, then let it run on undebugged
+static void serve_client(Chip8Gdb* g, Chip8GdbConnection* c) {
+    atomic_store(&g->halt, true);
+    atomic_store(&g->attached, true);
+    bool alive = wait_stopped(g);
+    g->interrupted = false;          // report the attach as a trap, not a Ctrl-C
+    g->debug.stop = CHIP8_DEBUG_NONE;
+
+    while (alive) {
+        int len = read_packet(g, c);
+        if (len == GDB_INTERRUPT) continue;   // already stopped
+        alive = len >= 0 && handle_packet(g, c);
+    }
+
+    if (atomic_load(&g->quit)) {
+        send_packet(c, "W00");
+        return;   // the emulation thread may be running; it stops using `debug` on quit
+    }
+    // The client may have gone while the machine ran: stop it before disarming
+    atomic_store(&g->halt, true);
+    wait_stopped(g);
+    chip8_debug_clear(&g->debug);
+    atomic_store(&g->attached, false);
+    atomic_store(&g->halt, false);
+    int stopped = CHIP8_GDB_STOPPED;
+    atomic_compare_exchange_strong(&g->state, &stopped, CHIP8_GDB_RUNNING);
+}
+
+static void stub_thread(void* arg) {
+    Chip8Gdb* g = (Chip8Gdb*)arg;
+    Chip8GdbConnection* c = g->conn;
+    while (!atomic_load(&g->quit)) {
+        if (wait_readable(c->listener, GDB_POLL_MS) <= 0) continue;
+        GdbSocket client = accept(c->listener, NULL, NULL);
+        if (client == GDB_NO_SOCKET) continue;
+        int one = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, (const char*)&one, sizeof(one));
+
+        printf("GDB client connected on port %u\n", g->port);
+        c->client = client;
+        c->no_ack = false;
+        c->in_pos = 0;
+        c->in_len = 0;
+        serve_client(g, c);
+        close_socket(client);
+        c->client = GDB_NO_SOCKET;
+        printf("GDB client disconnected\n");
+    }
+}
+
+// ---- Public API ----
+
+bool chip8_gdb_open(Chip8Gdb* g, Chip8* c8, uint16_t port) {
+    memset(g, 0, sizeof(*g));
+    chip8_debug_init(&g->debug);
+    g->chip8 = c8;
+    g->port = port ? port : CHIP8_GDB_DEFAULT_PORT;
+    atomic_init(&g->state, c8->running ? CHIP8_GDB_RUNNING : CHIP8_GDB_EXITED);
+    atomic_init(&g->attached, false);
+    atomic_init(&g->halt, false);
+    atomic_init(&g->quit, false);
+
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        fprintf(stderr, "gdb: WSAStartup failed\n");
+        return false;
+    }
+#endif
+    g->conn = (Chip8GdbConnection*)calloc(1, sizeof(Chip8GdbConnection));
+    GdbSocket listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (!g->conn || listener == GDB_NO_SOCKET) {
+        fprintf(stderr, "gdb: cannot create a socket\n");
+        goto fail;
+    }
+    g->conn->listener = listener;
+    g->conn->client = GDB_NO_SOCKET;
+
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(g->port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);   // local debugging only
+    if (bind(listener, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 1) != 0) {
+        fprintf(stderr, "gdb: cannot listen on port %u\n", g->port);
+        goto fail;
+    }
+    if (!host_thread_start(&g->thread, stub_thread, g)) {
+        fprintf(stderr, "gdb: cannot start the stub thread\n");
+        goto fail;
+    }
+    return true;
+
+fail:
+    if (listener != GDB_NO_SOCKET) close_socket(listener);
+    free(g->conn);
+    g->conn = NULL;
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return false;
+}
+
+// Emulation thread: hand the machine to the stub until it resumes or the stub quits
+static void park(Chip8Gdb* g) {
+    atomic_store(&g->state, CHIP8_GDB_STOPPED);
+    while (atomic_load(&g->state) == CHIP8_GDB_STOPPED && !atomic_load(&g->quit)) {
+        host_sleep_until_ns(host_time_ns() + GDB_PARK_POLL_NS);
+    }
+}
+
+uint32_t chip8_gdb_run(Chip8Gdb* g, Chip8* c8, uint32_t cycles) {
+    uint32_t executed = 0;
+    if (!atomic_load(&g->attached)) {
+        executed = chip8_run(c8, cycles);
+    }
+    else {
+        while (executed < cycles && c8->running && !atomic_load(&g->quit)) {
+            if (atomic_exchange(&g->halt, false)) {
+                g->interrupted = true;
+                park(g);
+                continue;
+            }
+            executed += chip8_debug_run(&g->debug, c8, cycles - executed);
+            if (g->debug.stop != CHIP8_DEBUG_NONE) {
+                g->interrupted = false;
+                park(g);
+            }
+        }
+    }
+    if (!c8->running) atomic_store(&g->state, CHIP8_GDB_EXITED);
+    return executed;
+}
+
+void chip8_gdb_close(Chip8Gdb* g) {
+    if (!g->conn) return;
+    atomic_store(&g->quit, true);
+    host_thread_join(&g->thread);
+    close_socket(g->conn->listener);
+    free(g->conn);
+    g->conn = NULL;
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
@@ -0,0 +1,51 @@
+// GDB remote serial protocol stub: serves one client at a time on a local TCP port, on its
+// own thread, while the emulation thread runs the machine through chip8_gdb_run.
+// Registers are V0-VF, I, PC, SP, DT and ST; `monitor stack` prints the call stack.
+
+#ifndef CHIP8_GDB_H
+#define CHIP8_GDB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "chip8.h"
+#include "chip8_debug.h"
+#include "host_thread.h"
+
+#define CHIP8_GDB_DEFAULT_PORT  2159
+
+typedef enum Chip8GdbState {
+    CHIP8_GDB_RUNNING,   // the emulation thread owns the machine
+    CHIP8_GDB_STOPPED,   // parked in chip8_gdb_run; the stub owns the machine and `debug`
+    CHIP8_GDB_EXITED,    // the machine halted
+} Chip8GdbState;
+
+struct Chip8GdbConnection;
+
+typedef struct Chip8Gdb {
+    Chip8Debug   debug;
+    Chip8*       chip8;
+    HostThread   thread;
+    struct Chip8GdbConnection* conn;   // sockets, owned by the stub thread
+    atomic_int   state;       // Chip8GdbState
+    atomic_bool  attached;    // a client is connected; until then chip8_gdb_run is chip8_run
+    atomic_bool  halt;        // the stub asks the emulation thread to stop (connect, Ctrl-C)
+    atomic_bool  quit;
+    bool         interrupted; // the last stop was a halt request rather than a debug stop
+    uint16_t     port;
+} Chip8Gdb;
+
+// Listen on 127.0.0.1:port (0 uses CHIP8_GDB_DEFAULT_PORT) and start the stub thread.
+// Returns false if the socket or the thread could not be set up.
+bool chip8_gdb_open(Chip8Gdb* g, Chip8* c8, uint16_t port);
+
+// Emulation thread: execute up to `cycles` instructions like chip8_run. While a client is
+// attached, stops at breakpoints, watchpoints, steps and interrupts wait here until the client
+// resumes. Returns the instructions executed.
+uint32_t chip8_gdb_run(Chip8Gdb* g, Chip8* c8, uint32_t cycles);
+
+// Tell a connected client the program exited, stop the stub thread and close the sockets.
+// Releases an emulation thread parked in chip8_gdb_run, which then returns.
+void chip8_gdb_close(Chip8Gdb* g);
+
+#endif // CHIP8_GDB_H
@@ -0,0 +1,87 @@
+// Shared instruction semantics used by every execution engine (switch, threaded).
+// Engines must route side effects through these so they stay bit-identical to chip8_cycle.
+
+#ifndef CHIP8_INTERNAL_H
+#define CHIP8_INTERNAL_H
+
+#include "chip8.h"
+
+// What each Chip8Quirks profile changes, for engines that specialize per profile
+typedef struct Chip8QuirkFlags {
+    bool    shift_vy;   // 8xy6/8xyE: Vx = Vy shifted, instead of shifting Vx in place
+    uint8_t memory_i;   // Fx55/Fx65: 0 = I unchanged, 1 = I += x, 2 = I += x + 1
+    bool    clip;       // Dxyn clips at the screen edges instead of wrapping
+    bool    jump_vx;    // Bxnn jumps to xnn + Vx instead of nnn + V0
+    bool    vf_reset;   // 8xy1/8xy2/8xy3 clear VF
+    bool    xo;         // XO-CHIP: 64 KB addressing, F000 nnnn (skips step over it), 5xy2/5xy3,
+                        // Fn01, F002, Fx3A, 00Dn, and Dxy0 draws 16x16 in low res too
+} Chip8QuirkFlags;
+
+// Indexed by Chip8Quirks. Reads with a constant index fold away at compile time.
+static const Chip8QuirkFlags chip8_quirk_flags[CHIP8_QUIRKS_COUNT] = {
+    [CHIP8_QUIRKS_MODERN] = { false, 0, false, false, false, false },
+    [CHIP8_QUIRKS_VIP]    = { true,  2, true,  false, true,  false },
+    [CHIP8_QUIRKS_CHIP48] = { false, 1, true,  true,  false, false },
+    [CHIP8_QUIRKS_SCHIP]  = { false, 0, true,  true,  false, false },
+    [CHIP8_QUIRKS_XOCHIP] = { true,  2, false, false, false, true  },
+};
+
+// 00E0 / 00FE / 00FF: clear the selected planes
+void chip8_clear_display(Chip8* c8);
+
+// 00CN / 00FB / 00FC: Super CHIP-8 scrolling; 00DN: XO-CHIP scroll up. Selected planes only.
+void chip8_scroll_down(Chip8* c8, uint8_t n);
+void chip8_scroll_up(Chip8* c8, uint8_t n);
+void chip8_scroll_right(Chip8* c8);
+void chip8_scroll_left(Chip8* c8);
+
+// Dxyn: draw sprite at (x, y) from memory[I]; sets VF on collision.
+// The start position always wraps; pixels past the edges wrap, or are dropped when clipped.
+// With two planes selected, plane 1's sprite follows plane 0's in memory.
+void chip8_draw_sprite(Chip8* c8, uint8_t x, uint8_t y, uint8_t n);
+void chip8_draw_sprite_clipped(Chip8* c8, uint8_t x, uint8_t y, uint8_t n);
+
+// Cxkk: next random byte for this machine
+uint8_t chip8_random_byte(Chip8* c8);
+
+// Fx0A: store the lowest pressed key in Vx; false if no key is down
+bool chip8_wait_key(Chip8* c8, uint8_t x);
+
+// Fx33 / Fx55: the only instructions that write memory (with 5xy2); they mark dirty_pages
+void chip8_store_bcd(Chip8* c8, uint8_t x);
+void chip8_store_registers(Chip8* c8, uint8_t x);
+
+// Fx65
+void chip8_load_registers(Chip8* c8, uint8_t x);
+
+// Bytes `opcode` stores from I: 3 for Fx33, x + 1 for Fx55, |x - y| + 1 for XO-CHIP 5xy2, else 0.
+// Lets tools that run the interpreter see writes from the opcode alone, costing chip8_cycle nothing.
+static inline uint8_t chip8_store_length(uint16_t opcode, bool xo) {
+    uint8_t x = (opcode >> 8) & 0xF;
+    uint8_t y = (opcode >> 4) & 0xF;
+    if ((opcode & 0xF0FF) == 0xF033) return 3;
+    if ((opcode & 0xF0FF) == 0xF055) return (uint8_t)(x + 1);
+    if (xo && (opcode & 0xF00F) == 0x5002) return (uint8_t)((x <= y ? y - x : x - y) + 1);
+    return 0;
+}
+
+// XO-CHIP 5xy2 / 5xy3: store or load Vx..Vy (descending if x > y) at I, leaving I unchanged
+void chip8_store_range(Chip8* c8, uint8_t x, uint8_t y);
+void chip8_load_range(Chip8* c8, uint8_t x, uint8_t y);
+
+// XO-CHIP F002: load the 16-byte audio pattern from I
+void chip8_load_audio_pattern(Chip8* c8);
+
+// Idle-loop fast-forward. Call with the pc of the next instruction when a jump went backwards
+// (or Fx0A rewound) and up to `budget` more instructions may run. Timers and keys only change
+// between runs, so if pc starts one of these loops and it is still looping, the rest of the
+// budget is spent in it:
+//   Fx0A with no key down; 1nnn jumping to itself;
+//   Fx07, 3xkk/4xkk on the same Vx, 1nnn back (delay timer poll);
+//   Ex9E/ExA1, 1nnn back (key poll).
+// Applies the effect of the whole iterations that fit in the budget and returns how many
+// instructions they account for (0 = not idle); pc is left at the loop start. The caller adds
+// them to its executed count and cycle_count. Profile builds never skip.
+uint32_t chip8_idle_skip(Chip8* c8, uint16_t pc, uint32_t budget);
+
+#endif // CHIP8_INTERNAL_H
@@ -0,0 +1,866 @@
+// x86-64 block compiler and dispatcher. Compiled blocks take the remaining cycle budget;
+// before each instruction after the first they exit early through a per-instruction stub if
+// the budget is used up, so frame-sized slices still run native code. Skips branch over the
+// next instruction inside the block, and a block ending in a jump to its own start loops
+// without returning to the dispatcher.
+//
+// An address is compiled once control has arrived at it JIT_HOT_ENTRIES times; until then a
+// specialized interpreter runs it, so short runs such as fuzz cases do not pay for compiling
+// code that only runs a few times.
+//
+// Host register use inside a block:
+//   rbx  Chip8*            (callee-saved)
+//   r12d I                 (callee-saved, written back before helpers and on exit)
+//   r13d cycle budget + r14d
+//   r14d instruction index minus instructions executed (taken skips add 1, loops subtract
+//        the block length), so the budget check before instruction i is `r13d <= i` and the
+//        executed count on exit is i - r14d
+//   al/cl/dl/eax/ecx/edx   scratch
+// pc is a compile-time constant within a block and is stored only on exit.
+
+#include "chip8_jit.h"
+#include "chip8_internal.h"
+#include "chip8_profile.h"
+#include <string.h>
+
+#if CHIP8_JIT_X64
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+#define JIT_CODE_SIZE        (1u << 20)
+#define JIT_MAX_BLOCK_INSNS  64
+#define JIT_MAX_BLOCK_BYTES  (JIT_MAX_BLOCK_INSNS * 448 + 256)   // Fx65 with x=F is the largest
+#define JIT_MAX_BUDGET       (1u << 30)   // per block call, so r13d cannot wrap (see above)
+#define JIT_HOT_ENTRIES      32           // times control reaches an address before it is compiled
+#define JIT_PAGE_SIZE        4096         // x86-64 base page: the unit of protection changes
+
+enum {
+    JIT_BLOCK_NONE = 0,
+    JIT_BLOCK_COMPILED = 1,
+    JIT_BLOCK_INTERPRET = 2,
+};
+
+// Drop every translation if any byte in memory[addr, addr + len) was compiled.
+static inline void note_write(Chip8Jit* jit, uint16_t addr, uint16_t len) {
+    for (uint16_t i = 0; i < len; ++i) {
+        if (jit->code_map[(addr + i) & CHIP8_ADDR_MASK]) {
+            chip8_jit_flush(jit);
+            return;
+        }
+    }
+}
+
+void chip8_jit_flush(Chip8Jit* jit) {
+    memset(jit->blocks, 0, sizeof(jit->blocks));
+    memset(jit->code_map, 0, sizeof(jit->code_map));
+    jit->code_used = 0;
+    jit->flushes++;
+}
+
+#if CHIP8_JIT_X64
+
+// Stack space below the pushes: alignment padding, plus shadow space for helper calls on Win64
+#ifdef _WIN32
+#define JIT_FRAME 40
+#else
+#define JIT_FRAME 8
+#endif
+
+#define OFF_V(r)   ((int32_t)(offsetof(Chip8, V) + (r)))
+#define OFF_I      ((int32_t)offsetof(Chip8, I))
+#define OFF_PC     ((int32_t)offsetof(Chip8, pc))
+#define OFF_DT     ((int32_t)offsetof(Chip8, delay_timer))
+#define OFF_ST     ((int32_t)offsetof(Chip8, sound_timer))
+#define OFF_KEYS   ((int32_t)offsetof(Chip8, keys))
+#define OFF_MEM    ((int32_t)offsetof(Chip8, memory))
+
+// x86 register numbers used in ModRM fields
+#define R_AX 0
+#define R_CX 1
+#define R_DX 2
+
+typedef struct JitAsm {
+    uint8_t* p;
+} JitAsm;
+
+static void emit8(JitAsm* a, uint8_t b) { *a->p++ = b; }
+
+static void emit16(JitAsm* a, uint16_t v) {
+    emit8(a, (uint8_t)v);
+    emit8(a, (uint8_t)(v >> 8));
+}
+
+static void emit32(JitAsm* a, uint32_t v) {
+    emit16(a, (uint16_t)v);
+    emit16(a, (uint16_t)(v >> 16));
+}
+
+static void emit64(JitAsm* a, uint64_t v) {
+    emit32(a, (uint32_t)v);
+    emit32(a, (uint32_t)(v >> 32));
+}
+
+// <op> reg, [rbx + disp32]   (or [rbx + disp32], reg, depending on op)
+static void emit_rbx(JitAsm* a, uint8_t op, uint8_t reg, int32_t disp) {
+    emit8(a, op);
+    emit8(a, (uint8_t)(0x80 | (reg << 3) | 3));
+    emit32(a, (uint32_t)disp);
+}
+
+static void emit_store_i(JitAsm* a) {
+    // mov [rbx + I], r12w
+    emit8(a, 0x66);
+    emit8(a, 0x44);
+    emit_rbx(a, 0x89, 4, OFF_I);
+}
+
+static void emit_load_i(JitAsm* a) {
+    // movzx r12d, word [rbx + I]
+    emit8(a, 0x44);
+    emit8(a, 0x0F);
+    emit_rbx(a, 0xB7, 4, OFF_I);
+}
+
+static void emit_set_pc(JitAsm* a, uint16_t pc) {
+    // mov word [rbx + pc], imm16
+    emit8(a, 0x66);
+    emit_rbx(a, 0xC7, 0, OFF_PC);
+    emit16(a, pc);
+}
+
+// Four pushes after the return address and JIT_FRAME leave rsp 16-byte aligned for helper calls.
+static void emit_prologue(JitAsm* a) {
+    emit8(a, 0x53);                          // push rbx
+    emit8(a, 0x41); emit8(a, 0x54);          // push r12
+    emit8(a, 0x41); emit8(a, 0x55);          // push r13
+    emit8(a, 0x41); emit8(a, 0x56);          // push r14
+    emit8(a, 0x48); emit8(a, 0x83); emit8(a, 0xEC); emit8(a, JIT_FRAME);   // sub rsp, frame
+#ifdef _WIN32
+    emit8(a, 0x48); emit8(a, 0x89); emit8(a, 0xCB);   // mov rbx, rcx
+    emit8(a, 0x41); emit8(a, 0x89); emit8(a, 0xD5);   // mov r13d, edx
+#else
+    emit8(a, 0x48); emit8(a, 0x89); emit8(a, 0xFB);   // mov rbx, rdi
+    emit8(a, 0x41); emit8(a, 0x89); emit8(a, 0xF5);   // mov r13d, esi
+#endif
+    emit8(a, 0x45); emit8(a, 0x31); emit8(a, 0xF6);   // xor r14d, r14d
+    emit_load_i(a);
+}
+
+// Expects the executed instruction count in eax.
+static void emit_epilogue(JitAsm* a) {
+    emit_store_i(a);
+    emit8(a, 0x48); emit8(a, 0x83); emit8(a, 0xC4); emit8(a, JIT_FRAME);   // add rsp, frame
+    emit8(a, 0x41); emit8(a, 0x5E);          // pop r14
+    emit8(a, 0x41); emit8(a, 0x5D);          // pop r13
+    emit8(a, 0x41); emit8(a, 0x5C);          // pop r12
+    emit8(a, 0x5B);                          // pop rbx
+    emit8(a, 0xC3);                          // ret
+}
+
+static void emit_mov_eax(JitAsm* a, uint32_t v) {
+    emit8(a, 0xB8); emit32(a, v);            // mov eax, imm32
+}
+
+// eax = instructions executed when leaving before instruction index i
+static void emit_executed(JitAsm* a, uint32_t i) {
+    emit_mov_eax(a, i);
+    emit8(a, 0x44); emit8(a, 0x29); emit8(a, 0xF0);   // sub eax, r14d
+}
+
+// jcc rel32 (0x80 | cc) with the offset left to patch; returns the offset's address
+static uint8_t* emit_jcc(JitAsm* a, uint8_t cc) {
+    emit8(a, 0x0F); emit8(a, (uint8_t)(0x80 | cc));
+    uint8_t* at = a->p;
+    emit32(a, 0);
+    return at;
+}
+
+static uint8_t* emit_jmp(JitAsm* a) {
+    emit8(a, 0xE9);
+    uint8_t* at = a->p;
+    emit32(a, 0);
+    return at;
+}
+
+#define CC_E   0x4
+#define CC_NE  0x5
+#define CC_BE  0x6
+
+static void patch_rel32(uint8_t* at, const uint8_t* target) {
+    int32_t rel = (int32_t)(target - (at + 4));
+    memcpy(at, &rel, sizeof(rel));
+}
+
+// Call helper(c8, jit, arg). I is spilled before and reloaded after.
+typedef void (*JitHelper)(Chip8* c8, Chip8Jit* jit, uint32_t arg);
+
+static void emit_call(JitAsm* a, JitHelper fn, Chip8Jit* jit, uint32_t arg) {
+    emit_store_i(a);
+#ifdef _WIN32
+    emit8(a, 0x48); emit8(a, 0x89); emit8(a, 0xD9);   // mov rcx, rbx
+    emit8(a, 0x48); emit8(a, 0xBA); emit64(a, (uint64_t)(uintptr_t)jit);   // mov rdx, jit
+    emit8(a, 0x41); emit8(a, 0xB8); emit32(a, arg);   // mov r8d, arg
+#else
+    emit8(a, 0x48); emit8(a, 0x89); emit8(a, 0xDF);   // mov rdi, rbx
+    emit8(a, 0x48); emit8(a, 0xBE); emit64(a, (uint64_t)(uintptr_t)jit);   // mov rsi, jit
+    emit8(a, 0xBA); emit32(a, arg);                   // mov edx, arg
+#endif
+    emit8(a, 0x48); emit8(a, 0xB8); emit64(a, (uint64_t)(uintptr_t)fn);     // mov rax, fn
+    emit8(a, 0xFF); emit8(a, 0xD0);                   // call rax
+    emit_load_i(a);
+}
+
+// After a helper that may store to memory: a jump taken if the store overwrote compiled code
+// and discarded every translation, this block included. Blocks only run between flushes, so
+// the count at compile time tells.
+static uint8_t* emit_flush_check(JitAsm* a, Chip8Jit* jit) {
+    emit8(a, 0x48); emit8(a, 0xB8); emit64(a, (uint64_t)(uintptr_t)&jit->flushes);   // mov rax, &flushes
+    emit8(a, 0x81); emit8(a, 0x38); emit32(a, (uint32_t)jit->flushes);               // cmp dword [rax], flushes
+    return emit_jcc(a, CC_NE);
+}
+
+// Helpers for instructions with side effects beyond registers. Each terminator helper
+// stores the next pc itself.
+
+static void helper_rnd(Chip8* c8, Chip8Jit* jit, uint32_t arg) {
+    (void)jit;
+    c8->V[arg & 0xF] = (uint8_t)(chip8_random_byte(c8) & (arg >> 8));
+}
+
+static void helper_call(Chip8* c8, Chip8Jit* jit, uint32_t arg) {
+    (void)jit;
+    uint16_t nnn = (uint16_t)(arg & 0xFFF);
+    uint16_t next = (uint16_t)(arg >> 16);
+    c8->pc = next;
+    if (c8->sp < CHIP8_STACK_SIZE) {
+        c8->stack[c8->sp] = next;
+        c8->sp++;
+        c8->pc = nnn;
+    }
+}
+
+static void helper_ret(Chip8* c8, Chip8Jit* jit, uint32_t next) {
+    (void)jit;
+    c8->pc = (uint16_t)next;
+    if (c8->sp > 0) {
+        c8->sp--;
+        c8->pc = c8->stack[c8->sp] & CHIP8_ADDR_MASK;
+    }
+}
+
+static void helper_wait_key(Chip8* c8, Chip8Jit* jit, uint32_t arg) {
+    (void)jit;
+    uint16_t next = (uint16_t)(arg >> 8);
+    c8->pc = chip8_wait_key(c8, (uint8_t)(arg & 0xF)) ? next
+                                                      : (uint16_t)((next - 2) & CHIP8_ADDR_MASK);
+}
+
+static void helper_bcd(Chip8* c8, Chip8Jit* jit, uint32_t x) {
+    chip8_store_bcd(c8, (uint8_t)x);
+    note_write(jit, c8->I, 3);
+}
+
+static void helper_store(Chip8* c8, Chip8Jit* jit, uint32_t x) {
+    chip8_store_registers(c8, (uint8_t)x);
+    note_write(jit, c8->I, (uint16_t)(x + 1));
+}
+
+// Display ops call the display routines directly; arg is the opcode
+static void helper_display(Chip8* c8, Chip8Jit* jit, uint32_t opcode) {
+    (void)jit;
+    if (opcode == 0x00E0) chip8_clear_display(c8);
+    else if (opcode == 0x00FB) chip8_scroll_right(c8);
+    else if (opcode == 0x00FC) chip8_scroll_left(c8);
+    else chip8_scroll_down(c8, (uint8_t)(opcode & 0xF));
+}
+
+static void helper_draw(Chip8* c8, Chip8Jit* jit, uint32_t opcode) {
+    (void)jit;
+    chip8_draw_sprite(c8, c8->V[(opcode >> 8) & 0xF], c8->V[(opcode >> 4) & 0xF], (uint8_t)(opcode & 0xF));
+}
+
+static void helper_draw_clipped(Chip8* c8, Chip8Jit* jit, uint32_t opcode) {
+    (void)jit;
+    chip8_draw_sprite_clipped(c8, c8->V[(opcode >> 8) & 0xF], c8->V[(opcode >> 4) & 0xF],
+        (uint8_t)(opcode & 0xF));
+}
+
+// Run one instruction on the interpreter, tracking any code it overwrites.
+static void interpret_one(Chip8Jit* jit, Chip8* c8) {
+    uint16_t pc = c8->pc & CHIP8_ADDR_MASK;
+    uint8_t hi = c8->memory[pc];
+    uint8_t lo = c8->memory[(pc + 1) & CHIP8_ADDR_MASK];
+    uint16_t I = c8->I;
+
+    chip8_cycle(c8);
+    jit->interpreted++;
+
+    if ((hi & 0xF0) == 0xF0) {
+        if (lo == 0x33) note_write(jit, I, 3);
+        else if (lo == 0x55) note_write(jit, I, (uint16_t)((hi & 0x0F) + 1));
+    }
+}
+
+// An instruction without a translation, run by the interpreter in the middle of a block.
+// chip8_cycle counts it, and so does the block's total on exit, so one count is taken back.
+static void helper_interpret(Chip8* c8, Chip8Jit* jit, uint32_t addr) {
+    c8->pc = (uint16_t)addr;
+    interpret_one(jit, c8);
+    c8->cycle_count--;
+}
+
+typedef enum JitClass {
+    JIT_INLINE,       // compiled, block continues
+    JIT_SKIP,         // compiled, block continues; `branch` is taken when the skip is
+    JIT_STORE,        // compiled, block continues; `branch` is taken when the store flushed
+    JIT_TERMINATOR,   // compiled, block ends after it
+    JIT_FALLBACK,     // interpreter only, block ends before it
+} JitClass;
+
+// Run the instruction at next - 2 through helper_interpret
+static JitClass emit_interpret(JitAsm* a, Chip8Jit* jit, uint16_t opcode, uint16_t next, uint8_t** branch) {
+    emit_call(a, helper_interpret, jit, (uint32_t)((next - 2) & CHIP8_ADDR_MASK));
+    if (chip8_store_length(opcode, false) == 0) return JIT_INLINE;
+    *branch = emit_flush_check(a, jit);
+    return JIT_STORE;
+}
+
+// Emit one instruction. `next` is the address after it. Returns its class; for
+// JIT_FALLBACK nothing is emitted, and JIT_SKIP and JIT_STORE leave a jump to patch in
+// `branch`. Only the modern behaviour of quirky opcodes is compiled; other profiles run
+// those through the interpreter inside the block.
+static JitClass emit_insn(JitAsm* a, Chip8Jit* jit, const Chip8QuirkFlags* q, uint16_t opcode,
+    uint16_t next, uint8_t** branch) {
+    uint8_t  x = (opcode & 0x0F00) >> 8;
+    uint8_t  y = (opcode & 0x00F0) >> 4;
+    uint8_t  n = (opcode & 0x000F);
+    uint8_t  kk = (opcode & 0x00FF);
+    uint16_t nnn = (opcode & 0x0FFF);
+
+    switch (opcode & 0xF000) {
+    case 0x0000:
+        if (opcode == 0x00EE) {
+            emit_call(a, helper_ret, jit, next);
+            return JIT_TERMINATOR;
+        }
+        if (opcode == 0x00FD) return JIT_FALLBACK;   // exit: the dispatcher sees running drop
+        if (opcode == 0x00E0 || opcode == 0x00FB || opcode == 0x00FC || (opcode & 0xFFF0) == 0x00C0) {
+            emit_call(a, helper_display, jit, opcode);
+            return JIT_INLINE;
+        }
+        if (opcode == 0x00FE || opcode == 0x00FF) return emit_interpret(a, jit, opcode, next, branch);
+        return JIT_INLINE;   // system call / ignored
+
+    case 0x1000:
+        emit_set_pc(a, nnn);
+        return JIT_TERMINATOR;
+
+    case 0x2000:
+        emit_call(a, helper_call, jit, (uint32_t)nnn | (uint32_t)next << 16);
+        return JIT_TERMINATOR;
+
+    case 0x3000:
+    case 0x4000:
+        emit_rbx(a, 0x80, 7, OFF_V(x)); emit8(a, kk);          // cmp byte [Vx], kk
+        *branch = emit_jcc(a, (opcode & 0xF000) == 0x3000 ? CC_E : CC_NE);
+        return JIT_SKIP;
+
+    case 0x5000:
+    case 0x9000:
+        if (n != 0) return JIT_INLINE;
+        emit_rbx(a, 0x8A, R_DX, OFF_V(x));                     // mov dl, [Vx]
+        emit_rbx(a, 0x3A, R_DX, OFF_V(y));                     // cmp dl, [Vy]
+        *branch = emit_jcc(a, (opcode & 0xF000) == 0x5000 ? CC_E : CC_NE);
+        return JIT_SKIP;
+
+    case 0x6000:
+        emit_rbx(a, 0xC6, 0, OFF_V(x)); emit8(a, kk);          // mov byte [Vx], kk
+        return JIT_INLINE;
+
+    case 0x7000:
+        emit_rbx(a, 0x80, 0, OFF_V(x)); emit8(a, kk);          // add byte [Vx], kk
+        return JIT_INLINE;
+
+    case 0x8000:
+        if ((q->vf_reset && n >= 0x1 && n <= 0x3) || (q->shift_vy && (n == 0x6 || n == 0xE))) {
+            return emit_interpret(a, jit, opcode, next, branch);
+        }
+        switch (n) {
+        case 0x0:
+            emit_rbx(a, 0x8A, R_AX, OFF_V(y));                 // mov al, [Vy]
+            emit_rbx(a, 0x88, R_AX, OFF_V(x));                 // mov [Vx], al
+            break;
+        case 0x1:
+        case 0x2:
+        case 0x3:
+            emit_rbx(a, 0x8A, R_AX, OFF_V(y));                 // mov al, [Vy]
+            emit_rbx(a, n == 1 ? 0x08 : n == 2 ? 0x20 : 0x30, R_AX, OFF_V(x));   // or/and/xor [Vx], al
+            break;
+        case 0x4:
+            emit_rbx(a, 0x8A, R_AX, OFF_V(x));                 // mov al, [Vx]
+            emit_rbx(a, 0x02, R_AX, OFF_V(y));                 // add al, [Vy]
+            emit8(a, 0x0F); emit8(a, 0x92); emit8(a, 0xC1);    // setc cl
+            emit_rbx(a, 0x88, R_CX, OFF_V(0xF));               // mov [VF], cl
+            emit_rbx(a, 0x88, R_AX, OFF_V(x));                 // mov [Vx], al
+            break;
+        case 0x5:
+        case 0x7: {
+            // VF is written before the difference is computed, exactly as chip8_cycle does.
+            uint8_t lhs = n == 5 ? x : y;
+            uint8_t rhs = n == 5 ? y : x;
+            emit_rbx(a, 0x8A, R_AX, OFF_V(lhs));               // mov al, [lhs]
+            emit_rbx(a, 0x3A, R_AX, OFF_V(rhs));               // cmp al, [rhs]
+            emit8(a, 0x0F); emit8(a, 0x97); emit8(a, 0xC1);    // seta cl
+            emit_rbx(a, 0x88, R_CX, OFF_V(0xF));               // mov [VF], cl
+            emit_rbx(a, 0x8A, R_AX, OFF_V(lhs));               // mov al, [lhs]
+            emit_rbx(a, 0x2A, R_AX, OFF_V(rhs));               // sub al, [rhs]
+            emit_rbx(a, 0x88, R_AX, OFF_V(x));                 // mov [Vx], al
+        } break;
+        case 0x6:
+            emit_rbx(a, 0x8A, R_AX, OFF_V(x));                 // mov al, [Vx]
+            emit8(a, 0x24); emit8(a, 0x01);                    // and al, 1
+            emit_rbx(a, 0x88, R_AX, OFF_V(0xF));               // mov [VF], al
+            emit_rbx(a, 0xD0, 5, OFF_V(x));                    // shr byte [Vx], 1
+            break;
+        case 0xE:
+            emit_rbx(a, 0x8A, R_AX, OFF_V(x));                 // mov al, [Vx]
+            emit8(a, 0xC0); emit8(a, 0xE8); emit8(a, 0x07);    // shr al, 7
+            emit_rbx(a, 0x88, R_AX, OFF_V(0xF));               // mov [VF], al
+            emit_rbx(a, 0xD0, 4, OFF_V(x));                    // shl byte [Vx], 1
+            break;
+        default:
+            break;
+        }
+        return JIT_INLINE;
+
+    case 0xA000:
+        emit8(a, 0x41); emit8(a, 0xBC); emit32(a, nnn);        // mov r12d, nnn
+        return JIT_INLINE;
+
+    case 0xB000:
+        if (q->jump_vx) return JIT_FALLBACK;
+        emit8(a, 0x0F); emit_rbx(a, 0xB6, R_AX, OFF_V(0));     // movzx eax, byte [V0]
+        emit8(a, 0x05); emit32(a, nnn);                        // add eax, nnn
+        emit8(a, 0x25); emit32(a, CHIP8_ADDR_MASK);            // and eax, mask
+        emit8(a, 0x66); emit_rbx(a, 0x89, R_AX, OFF_PC);       // mov [pc], ax
+        return JIT_TERMINATOR;
+
+    case 0xC000:
+        emit_call(a, helper_rnd, jit, (uint32_t)x | (uint32_t)kk << 8);
+        return JIT_INLINE;
+
+    case 0xD000:
+        emit_call(a, q->clip ? helper_draw_clipped : helper_draw, jit, opcode);
+        return JIT_INLINE;
+
+    case 0xE000:
+        if (kk != 0x9E && kk != 0xA1) return JIT_INLINE;
+        emit8(a, 0x0F); emit_rbx(a, 0xB6, R_DX, OFF_V(x));     // movzx edx, byte [Vx]
+        emit8(a, 0x83); emit8(a, 0xE2); emit8(a, 0x0F);        // and edx, 15
+        emit8(a, 0x80); emit8(a, 0xBC); emit8(a, 0x13);        // cmp byte [rbx + rdx + keys], 0
+        emit32(a, (uint32_t)OFF_KEYS); emit8(a, 0x00);
+        *branch = emit_jcc(a, kk == 0x9E ? CC_NE : CC_E);
+        return JIT_SKIP;
+
+    case 0xF000:
+        if (q->memory_i && (kk == 0x55 || kk == 0x65)) return emit_interpret(a, jit, opcode, next, branch);
+        switch (kk) {
+        case 0x07:
+            emit_rbx(a, 0x8A, R_AX, OFF_DT);                   // mov al, [dt]
+            emit_rbx(a, 0x88, R_AX, OFF_V(x));                 // mov [Vx], al
+            return JIT_INLINE;
+        case 0x0A:
+            emit_call(a, helper_wait_key, jit, (uint32_t)x | (uint32_t)next << 8);
+            return JIT_TERMINATOR;
+        case 0x15:
+        case 0x18:
+            emit_rbx(a, 0x8A, R_AX, OFF_V(x));                 // mov al, [Vx]
+            emit_rbx(a, 0x88, R_AX, kk == 0x15 ? OFF_DT : OFF_ST);
+            return JIT_INLINE;
+        case 0x1E:
+            emit8(a, 0x0F); emit_rbx(a, 0xB6, R_AX, OFF_V(x)); // movzx eax, byte [Vx]
+            emit8(a, 0x41); emit8(a, 0x01); emit8(a, 0xC4);    // add r12d, eax
+            emit8(a, 0x41); emit8(a, 0x81); emit8(a, 0xE4);    // and r12d, 0xFFFF
+            emit32(a, 0xFFFF);
+            return JIT_INLINE;
+        case 0x29:
+            emit8(a, 0x0F); emit_rbx(a, 0xB6, R_AX, OFF_V(x)); // movzx eax, byte [Vx]
+            emit8(a, 0x44); emit8(a, 0x8D); emit8(a, 0x24); emit8(a, 0x80);   // lea r12d, [rax + rax*4]
+            return JIT_INLINE;
+        case 0x30:
+            emit8(a, 0x0F); emit_rbx(a, 0xB6, R_AX, OFF_V(x)); // movzx eax, byte [Vx]
+            emit8(a, 0x44); emit8(a, 0x6B); emit8(a, 0xE0); emit8(a, 10);     // imul r12d, eax, 10
+            emit8(a, 0x41); emit8(a, 0x83); emit8(a, 0xC4); emit8(a, 0x50);   // add r12d, 0x50
+            return JIT_INLINE;
+        case 0x33:
+        case 0x55:
+            emit_call(a, kk == 0x33 ? helper_bcd : helper_store, jit, x);
+            *branch = emit_flush_check(a, jit);
+            return JIT_STORE;
+        case 0x65:
+            for (uint8_t i = 0; i <= x; ++i) {
+                emit8(a, 0x41); emit8(a, 0x8D); emit8(a, 0x44); emit8(a, 0x24); emit8(a, i);   // lea eax, [r12 + i]
+                emit8(a, 0x25); emit32(a, CHIP8_ADDR_MASK);                                   // and eax, mask
+                emit8(a, 0x0F); emit8(a, 0xB6); emit8(a, 0x8C); emit8(a, 0x03);               // movzx ecx, byte [rbx + rax + mem]
+                emit32(a, (uint32_t)OFF_MEM);
+                emit_rbx(a, 0x88, R_CX, OFF_V(i));                                            // mov [Vi], cl
+            }
+            return JIT_INLINE;
+        default:
+            return JIT_INLINE;
+        }
+
+    default:
+        return JIT_INLINE;
+    }
+}
+
+// Change the protection of code[begin, end) (page multiples) to read/write or read/execute.
+static bool protect(Chip8Jit* jit, size_t begin, size_t end, bool writable) {
+    if (begin >= end) return true;
+#ifdef _WIN32
+    DWORD old;
+    if (!VirtualProtect(jit->code + begin, end - begin, writable ? PAGE_READWRITE : PAGE_EXECUTE_READ, &old)) {
+        return false;
+    }
+    if (!writable) FlushInstructionCache(GetCurrentProcess(), jit->code + begin, end - begin);
+#else
+    if (mprotect(jit->code + begin, end - begin, writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC) != 0) {
+        return false;
+    }
+#endif
+    return true;
+}
+
+// Make code[code_used, ...) writable before compiling. Everything from `sealed` on already is,
+// so this reopens at most the page the last block ended in (or all of it after a flush).
+static bool unseal_tail(Chip8Jit* jit) {
+    size_t page = jit->code_used & ~(size_t)(JIT_PAGE_SIZE - 1);
+    if (page >= jit->sealed) return true;
+    if (!protect(jit, page, jit->sealed, true)) return false;
+    jit->sealed = page;
+    return true;
+}
+
+// Make every compiled byte executable before running: only the pages written since the last
+// call change protection.
+static bool seal_code(Chip8Jit* jit) {
+    size_t end = (jit->code_used + JIT_PAGE_SIZE - 1) & ~(size_t)(JIT_PAGE_SIZE - 1);
+    if (end <= jit->sealed) return true;
+    if (!protect(jit, jit->sealed, end, false)) return false;
+    jit->sealed = end;
+    return true;
+}
+
+// Leave the block before instruction index i, continuing at pc
+static void emit_exit(JitAsm* a, uint32_t i, uint16_t pc, const uint8_t* epilogue) {
+    emit_set_pc(a, pc);
+    emit_executed(a, i);
+    patch_rel32(emit_jmp(a), epilogue);
+}
+
+// Compile the block starting at pc, or mark pc as interpreter-only.
+static void compile_block(Chip8Jit* jit, const Chip8* c8, uint16_t pc) {
+    if (jit->code_size - jit->code_used < JIT_MAX_BLOCK_BYTES) {
+        chip8_jit_flush(jit);
+    }
+    if (!unseal_tail(jit)) {
+        jit->blocks[pc].state = JIT_BLOCK_INTERPRET;
+        return;
+    }
+
+    JitAsm a;
+    uint8_t* start = jit->code + jit->code_used;
+    a.p = start;
+    emit_prologue(&a);
+
+    // Per instruction: where it starts (budget check included) and its address, then the
+    // forward jumps patched once the body is done: budget checks, taken skips, flushing stores.
+    uint8_t* insn_pos[JIT_MAX_BLOCK_INSNS + 1];
+    uint16_t insn_addr[JIT_MAX_BLOCK_INSNS + 1];
+    uint8_t* check_patch[JIT_MAX_BLOCK_INSNS];
+    uint8_t* skip_patch[JIT_MAX_BLOCK_INSNS];
+    uint8_t* store_patch[JIT_MAX_BLOCK_INSNS];
+    uint8_t* loop_patch = NULL;
+
+    uint16_t addr = pc;
+    uint16_t count = 0;
+    bool open = true;
+    while (open) {
+        uint16_t opcode = (uint16_t)c8->memory[addr] << 8 |
+            (uint16_t)c8->memory[(addr + 1) & CHIP8_ADDR_MASK];
+        uint16_t next = (uint16_t)((addr + 2) & CHIP8_ADDR_MASK);
+
+        uint8_t* insn_start = a.p;
+        insn_pos[count] = insn_start;
+        insn_addr[count] = addr;
+        skip_patch[count] = NULL;
+        store_patch[count] = NULL;
+        if (count > 0) {
+            emit8(&a, 0x41); emit8(&a, 0x83); emit8(&a, 0xFD); emit8(&a, (uint8_t)count);   // cmp r13d, count
+            check_patch[count] = emit_jcc(&a, CC_BE);
+        }
+
+        uint8_t* branch = NULL;
+        JitClass cls;
+        if (opcode == (0x1000 | pc)) {
+            // Jump back to the block start: count the pass and loop while budget is left
+            uint32_t pass = (uint32_t)count + 1;
+            emit8(&a, 0x41); emit8(&a, 0x81); emit8(&a, 0xEE); emit32(&a, pass);   // sub r14d, pass
+            emit8(&a, 0x41); emit8(&a, 0x81); emit8(&a, 0xED); emit32(&a, pass);   // sub r13d, pass
+            loop_patch = emit_jcc(&a, CC_E);
+            patch_rel32(emit_jmp(&a), insn_pos[0]);
+            cls = JIT_TERMINATOR;
+        }
+        else {
+            cls = emit_insn(&a, jit, &chip8_quirk_flags[c8->quirks], opcode, next, &branch);
+        }
+        if (cls == JIT_FALLBACK) {
+            if (count == 0) {
+                jit->blocks[pc].state = JIT_BLOCK_INTERPRET;
+                return;
+            }
+            a.p = insn_start;   // drop the budget check; the interpreter runs this one
+            emit_set_pc(&a, addr);
+            break;
+        }
+        if (cls == JIT_SKIP) skip_patch[count] = branch;
+        if (cls == JIT_STORE) store_patch[count] = branch;
+
+        jit->code_map[addr] = 1;
+        jit->code_map[(addr + 1) & CHIP8_ADDR_MASK] = 1;
+        count++;
+        addr = next;
+
+        if (cls == JIT_TERMINATOR) {
+            open = false;
+        }
+        else if (count == JIT_MAX_BLOCK_INSNS) {
+            emit_set_pc(&a, addr);
+            open = false;
+        }
+    }
+    insn_addr[count] = addr;
+    emit_executed(&a, count);
+    uint8_t* epilogue = a.p;
+    emit_epilogue(&a);
+
+    // Exit stubs
+    if (loop_patch) {
+        patch_rel32(loop_patch, a.p);
+        emit_exit(&a, 0, pc, epilogue);
+    }
+    for (uint16_t i = 0; i < count; ++i) {
+        if (i > 0) {
+            // Budget ran out before instruction i
+            patch_rel32(check_patch[i], a.p);
+            emit_exit(&a, i, insn_addr[i], epilogue);
+        }
+        if (store_patch[i]) {
+            // The store flushed this block: leave after it
+            patch_rel32(store_patch[i], a.p);
+            emit_exit(&a, i + 1u, insn_addr[i + 1], epilogue);
+        }
+        if (skip_patch[i]) {
+            // Skip taken: one instruction fewer ran than the index says
+            patch_rel32(skip_patch[i], a.p);
+            emit8(&a, 0x41); emit8(&a, 0xFF); emit8(&a, 0xC5);   // inc r13d
+            emit8(&a, 0x41); emit8(&a, 0xFF); emit8(&a, 0xC6);   // inc r14d
+            if (i + 2u < count) {
+                patch_rel32(emit_jmp(&a), insn_pos[i + 2]);
+            }
+            else {
+                emit_exit(&a, i + 2u, (uint16_t)((insn_addr[i] + 4) & CHIP8_ADDR_MASK), epilogue);
+            }
+        }
+    }
+
+    jit->code_used += (size_t)(a.p - start);
+    jit->code_used = (jit->code_used + 15) & ~(size_t)15;
+    jit->blocks[pc].fn = (Chip8JitFn)(void*)start;
+    jit->blocks[pc].length = count;
+    jit->blocks[pc].state = JIT_BLOCK_COMPILED;
+    jit->blocks_compiled++;
+}
+
+#endif // CHIP8_JIT_X64
+
+bool chip8_jit_init(Chip8Jit* jit) {
+    memset(jit, 0, sizeof(*jit));
+#if CHIP8_JIT_X64
+#ifdef _WIN32
+    jit->code = (uint8_t*)VirtualAlloc(NULL, JIT_CODE_SIZE, MEM_COMMIT | MEM_RESERVE,
+        PAGE_READWRITE);
+#else
+    void* mem = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    jit->code = mem == MAP_FAILED ? NULL : (uint8_t*)mem;
+#endif
+    if (jit->code) {
+        jit->code_size = JIT_CODE_SIZE;
+        jit->enabled = true;
+    }
+#endif
+    return jit->enabled;
+}
+
+void chip8_jit_destroy(Chip8Jit* jit) {
+#if CHIP8_JIT_X64
+    if (jit->code) {
+#ifdef _WIN32
+        VirtualFree(jit->code, 0, MEM_RELEASE);
+#else
+        munmap(jit->code, jit->code_size);
+#endif
+    }
+#endif
+    jit->code = NULL;
+    jit->code_size = 0;
+    jit->enabled = false;
+}
+
+// One specialized interpreter per profile for code that is not compiled. XO-CHIP machines
+// are handed to chip8_run and never get here.
+#define QUIRK_CYCLE_ONLY
+
+#define QUIRK_PROFILE CHIP8_QUIRKS_MODERN
+#define QUIRK_SUFFIX  modern
+#include "chip8_cycle_impl.h"
+
+#define QUIRK_PROFILE CHIP8_QUIRKS_VIP
+#define QUIRK_SUFFIX  vip
+#include "chip8_cycle_impl.h"
+
+#define QUIRK_PROFILE CHIP8_QUIRKS_CHIP48
+#define QUIRK_SUFFIX  chip48
+#include "chip8_cycle_impl.h"
+
+#define QUIRK_PROFILE CHIP8_QUIRKS_SCHIP
+#define QUIRK_SUFFIX  schip
+#include "chip8_cycle_impl.h"
+
+#undef QUIRK_CYCLE_ONLY
+
+// Interpret at most `cycles` instructions, stopping where compiled code starts or where control
+// arrives at an address often enough to compile it (the dispatcher counts that last entry and
+// compiles). `cycle` is a constant at each call site, so every profile gets its own loop with
+// the interpreter inlined. Stores are found from the opcode and I before it; backward jumps
+// are checked for idle loops as in chip8_run.
+static inline uint32_t interpret_loop(Chip8Jit* jit, Chip8* c8, uint32_t cycles, void (*cycle)(Chip8*)) {
+    uint32_t executed = 0;
+    uint32_t interpreted = 0;
+    while (executed < cycles && c8->running) {
+        uint16_t pc = c8->pc & CHIP8_ADDR_MASK;
+        uint16_t next = (uint16_t)((pc + 2) & CHIP8_ADDR_MASK);
+        if (c8->memory[pc] < 0xF0) {
+            cycle(c8);
+        }
+        else {
+            // Fx33/Fx55 may overwrite compiled code; the Fx group is rare enough for chip8_cycle
+            uint16_t opcode = (uint16_t)(c8->memory[pc] << 8 | c8->memory[(pc + 1) & CHIP8_ADDR_MASK]);
+            uint16_t I = c8->I;
+            chip8_cycle(c8);
+            uint8_t len = chip8_store_length(opcode, false);
+            if (len) note_write(jit, I, len);
+        }
+        executed++;
+        interpreted++;
+
+        uint16_t to = c8->pc & CHIP8_ADDR_MASK;
+        if (to == next) {
+            // Falling through: only addresses inside compiled code (code_map) can start a block
+            if (jit->code_map[to] && jit->blocks[to].state == JIT_BLOCK_COMPILED) break;
+            continue;
+        }
+        Chip8JitBlock* b = &jit->blocks[to];
+        if (b->state == JIT_BLOCK_COMPILED) break;
+        if (b->state == JIT_BLOCK_NONE && jit->enabled) {
+            if (b->entries + 1 >= JIT_HOT_ENTRIES) break;
+            b->entries++;
+        }
+        if (to <= pc && executed < cycles) {
+            uint32_t skipped = chip8_idle_skip(c8, to, cycles - executed);
+            c8->cycle_count += skipped;
+            executed += skipped;
+        }
+    }
+    jit->interpreted += interpreted;
+    return executed;
+}
+
+static uint32_t interpret_modern(Chip8Jit* jit, Chip8* c8, uint32_t cycles) {
+    return interpret_loop(jit, c8, cycles, cycle_modern);
+}
+
+static uint32_t interpret_vip(Chip8Jit* jit, Chip8* c8, uint32_t cycles) {
+    return interpret_loop(jit, c8, cycles, cycle_vip);
+}
+
+static uint32_t interpret_chip48(Chip8Jit* jit, Chip8* c8, uint32_t cycles) {
+    return interpret_loop(jit, c8, cycles, cycle_chip48);
+}
+
+static uint32_t interpret_schip(Chip8Jit* jit, Chip8* c8, uint32_t cycles) {
+    return interpret_loop(jit, c8, cycles, cycle_schip);
+}
+
+// Indexed by Chip8Quirks. Called through the table, which keeps the interpreters out of the
+// dispatcher loop that runs compiled blocks.
+static uint32_t (*const interpret_run[CHIP8_QUIRKS_COUNT])(Chip8Jit* jit, Chip8* c8, uint32_t cycles) = {
+    [CHIP8_QUIRKS_MODERN] = interpret_modern,
+    [CHIP8_QUIRKS_VIP]    = interpret_vip,
+    [CHIP8_QUIRKS_CHIP48] = interpret_chip48,
+    [CHIP8_QUIRKS_SCHIP]  = interpret_schip,
+};
+
+uint32_t chip8_jit_run(Chip8Jit* jit, Chip8* c8, uint32_t cycles) {
+    uint32_t executed = 0;
+    uint16_t last_pc = CHIP8_ADDR_MASK;
+
+    if (c8->quirks == CHIP8_QUIRKS_XOCHIP) return chip8_run(c8, cycles);
+    if (jit->quirks != c8->quirks) {
+        chip8_jit_flush(jit);
+        jit->quirks = c8->quirks;
+    }
+
+    while (executed < cycles && c8->running) {
+        // A block or step starting at or before the previous one may be an idle loop.
+        uint16_t start = c8->pc & CHIP8_ADDR_MASK;
+        if (start <= last_pc) {
+            uint32_t skipped = chip8_idle_skip(c8, start, cycles - executed);
+            c8->cycle_count += skipped;
+            executed += skipped;
+            if (executed == cycles) break;
+        }
+        last_pc = start;
+
+#if CHIP8_JIT_X64
+        if (jit->enabled) {
+            uint16_t pc = c8->pc & CHIP8_ADDR_MASK;
+            Chip8JitBlock* b = &jit->blocks[pc];
+            // Cold addresses are interpreted; most code in a short run never gets hot enough
+            // to repay compiling it.
+            if (b->state == JIT_BLOCK_NONE && ++b->entries >= JIT_HOT_ENTRIES) {
+                compile_block(jit, c8, pc);
+            }
+            // Native code only runs from read/execute pages
+            if (b->state == JIT_BLOCK_COMPILED && !seal_code(jit)) {
+                jit->enabled = false;
+            }
+            else if (b->state == JIT_BLOCK_COMPILED) {
+                uint32_t budget = cycles - executed;
+                uint32_t ran = b->fn(c8, budget < JIT_MAX_BUDGET ? budget : JIT_MAX_BUDGET);
+                c8->cycle_count += ran;
+                executed += ran;
+                continue;
+            }
+        }
+#endif
+        executed += interpret_run[c8->quirks](jit, c8, cycles - executed);
+    }
+    return executed;
+}
@@ -0,0 +1,66 @@
+// x86-64 dynamic recompiler for CHIP-8 basic blocks.
+// Blocks end at 1nnn/2nnn/00EE/Bnnn/Fx0A and are compiled to native code with I and pc kept
+// in host registers and V[] addressed directly inside the Chip8 struct. Skips branch inside the
+// block and a block that jumps back to its start loops in native code. Display and scroll ops
+// call the display routines from within the block; mode switches call the interpreter.
+// Code is only compiled once it is hot; until then it runs on the interpreter.
+// Profiling builds (CHIP8_PROFILE) interpret everything so every instruction is counted.
+
+#ifndef CHIP8_JIT_H
+#define CHIP8_JIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "chip8.h"
+
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(CHIP8_NO_JIT) && !defined(CHIP8_PROFILE)
+#define CHIP8_JIT_X64 1
+#else
+#define CHIP8_JIT_X64 0
+#endif
+
+// Compiled block: runs at most `budget` (>= 1) instructions, returns how many ran.
+typedef uint32_t (*Chip8JitFn)(Chip8* c8, uint32_t budget);
+
+typedef struct Chip8JitBlock {
+    Chip8JitFn fn;
+    uint16_t   length;   // instructions in the block
+    uint8_t    state;    // 0 = not compiled, 1 = compiled, 2 = interpret this address
+    uint8_t    entries;  // times control arrived here while not compiled
+} Chip8JitBlock;
+
+// Translation cache for one machine. Bind one cache to one Chip8.
+typedef struct Chip8Jit {
+    uint8_t*      code;
+    size_t        code_size;
+    size_t        code_used;
+    size_t        sealed;    // code[0, sealed) is read/execute, the rest read/write (page multiple)
+    bool          enabled;   // false = always interpret (for comparing results)
+    uint8_t       quirks;    // Chip8Quirks the translations were compiled for
+
+    Chip8JitBlock blocks[CHIP8_MEMORY_SIZE];
+    uint8_t       code_map[CHIP8_MEMORY_SIZE];   // nonzero where a compiled block reads memory
+
+    uint64_t      blocks_compiled;
+    uint64_t      flushes;
+    uint64_t      interpreted;   // instructions executed by the interpreter
+} Chip8Jit;
+
+// Allocate the code buffer. No page is ever writable and executable at once: pages holding
+// compiled code are read/execute and the free tail is read/write, so only the pages a new
+// block lands on change protection. Returns false if native code is unavailable
+// (non-x86-64 host, CHIP8_NO_JIT, or no memory); the cache then interprets.
+bool chip8_jit_init(Chip8Jit* jit);
+
+void chip8_jit_destroy(Chip8Jit* jit);
+
+// Discard every translation. Call after memory was changed outside the JIT
+// (ROM load, state restore, running chip8_cycle directly).
+void chip8_jit_flush(Chip8Jit* jit);
+
+// Execute up to `cycles` instructions with the same semantics as chip8_cycle.
+// Returns the number of instructions executed. XO-CHIP machines are handed to chip8_run.
+uint32_t chip8_jit_run(Chip8Jit* jit, Chip8* c8, uint32_t cycles);
+
+#endif // CHIP8_JIT_H
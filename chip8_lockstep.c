@@ -0,0 +1,579 @@
+// Lockstep engine: pick the lowest live pc, decode it once, run it on every lane parked there.
+// ALU, skip and jump ops are written as fixed-width lane loops with a blend mask so compilers
+// turn them into vector code; group selection uses SSE2/AVX2 intrinsics where available.
+
+#include "chip8_lockstep.h"
+#include "chip8_internal.h"
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LOCKSTEP_SIMD "avx2"
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LOCKSTEP_SIMD "sse2"
+#else
+#define LOCKSTEP_SIMD "scalar"
+#endif
+
+#define LANES CHIP8_LOCKSTEP_LANES
+#define LANE_LOOP(l) for (int l = 0; l < LANES; ++l)
+
+// Lanes with mask m (0xFF / 0xFFFF) take v, the others keep old
+#define BLEND8(old, v, m)  (uint8_t)(((old) & ~(m)) | ((v) & (m)))
+#define BLEND16(old, v, m) (uint16_t)(((old) & ~(m)) | ((v) & (m)))
+
+// Per-step lane masks: 0xFF / 0xFFFF for lanes in the group, 0 elsewhere
+typedef struct LaneMask {
+    uint16_t m16[LANES];
+    uint8_t  m8[LANES];
+} LaneMask;
+
+const char* chip8_lockstep_simd(void) {
+    return LOCKSTEP_SIMD;
+}
+
+static void load_lane(Chip8Lockstep* ls, int l) {
+    const Chip8* c8 = ls->lanes[l];
+    for (int r = 0; r < CHIP8_REGISTER_COUNT; ++r) ls->V[r][l] = c8->V[r];
+    for (int s = 0; s < CHIP8_STACK_SIZE; ++s) ls->stack[s][l] = c8->stack[s];
+    ls->I[l] = c8->I;
+    ls->pc[l] = c8->pc & CHIP8_ADDR_MASK;
+    ls->sp[l] = c8->sp;
+}
+
+static void store_lane(const Chip8Lockstep* ls, int l) {
+    Chip8* c8 = ls->lanes[l];
+    for (int r = 0; r < CHIP8_REGISTER_COUNT; ++r) c8->V[r] = ls->V[r][l];
+    for (int s = 0; s < CHIP8_STACK_SIZE; ++s) c8->stack[s] = ls->stack[s][l];
+    c8->I = ls->I[l];
+    c8->pc = ls->pc[l];
+    c8->sp = ls->sp[l];
+}
+
+// Set lane l's dirty bit for every block of [addr, addr + len) whose bytes now differ from code[]
+static void note_store(Chip8Lockstep* ls, int l, uint16_t addr, int len) {
+    const uint8_t* memory = ls->lanes[l]->memory;
+    for (int i = 0; i < len; ++i) {
+        uint16_t a = (uint16_t)((addr + i) & CHIP8_ADDR_MASK);
+        if (memory[a] != ls->code[a]) ls->dirty[a / CHIP8_LOCKSTEP_BLOCK] |= 1u << l;
+    }
+}
+
+bool chip8_lockstep_init(Chip8Lockstep* ls, Chip8** machines, int count) {
+    if (count < 1 || count > LANES) return false;
+    for (int l = 0; l < count; ++l) {
+        if (machines[l]->quirks != machines[0]->quirks ||
+            machines[l]->addr_mask != CHIP8_ADDR_MASK) {
+            return false;
+        }
+    }
+
+    memset(ls, 0, sizeof(*ls));
+    ls->count = count;
+    ls->quirks = machines[0]->quirks;
+    memcpy(ls->code, machines[0]->memory, CHIP8_MEMORY_SIZE);
+    for (int l = 0; l < count; ++l) {
+        ls->lanes[l] = machines[l];
+        load_lane(ls, l);
+        for (int b = 0; b < CHIP8_LOCKSTEP_BLOCKS; ++b) {
+            size_t at = (size_t)b * CHIP8_LOCKSTEP_BLOCK;
+            if (memcmp(machines[l]->memory + at, ls->code + at, CHIP8_LOCKSTEP_BLOCK) != 0) {
+                ls->dirty[b] |= 1u << l;
+            }
+        }
+    }
+    return true;
+}
+
+// Find the lowest pc among live lanes and mark the live lanes parked on it.
+// Returns the group as a lane bitmask, 0 once no lane is live.
+static uint32_t select_group(const Chip8Lockstep* ls, uint16_t* pc, LaneMask* mask) {
+#if defined(__AVX2__)
+    const __m256i ones = _mm256_set1_epi16(-1);
+    __m256i p0 = _mm256_loadu_si256((const __m256i*)&ls->pc[0]);
+    __m256i p1 = _mm256_loadu_si256((const __m256i*)&ls->pc[16]);
+    __m256i l0 = _mm256_loadu_si256((const __m256i*)&ls->live[0]);
+    __m256i l1 = _mm256_loadu_si256((const __m256i*)&ls->live[16]);
+
+    // Dead lanes read as 0xFFFF, which no masked pc can equal
+    __m256i k = _mm256_min_epu16(_mm256_or_si256(p0, _mm256_andnot_si256(l0, ones)),
+        _mm256_or_si256(p1, _mm256_andnot_si256(l1, ones)));
+    __m128i k128 = _mm_min_epu16(_mm256_castsi256_si128(k), _mm256_extracti128_si256(k, 1));
+    *pc = (uint16_t)_mm_cvtsi128_si32(_mm_minpos_epu16(k128));
+    if (*pc == 0xFFFF) return 0;
+
+    __m256i target = _mm256_set1_epi16((short)*pc);
+    __m256i g0 = _mm256_and_si256(_mm256_cmpeq_epi16(p0, target), l0);
+    __m256i g1 = _mm256_and_si256(_mm256_cmpeq_epi16(p1, target), l1);
+    _mm256_storeu_si256((__m256i*)&mask->m16[0], g0);
+    _mm256_storeu_si256((__m256i*)&mask->m16[16], g1);
+    // packs interleaves the 128-bit halves; put the lanes back in order
+    __m256i g8 = _mm256_permute4x64_epi64(_mm256_packs_epi16(g0, g1), 0xD8);
+    _mm256_storeu_si256((__m256i*)mask->m8, g8);
+    return (uint32_t)_mm256_movemask_epi8(g8);
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    // No unsigned 16-bit min in SSE2: bias into signed range and use pminsw
+    const __m128i ones = _mm_set1_epi16(-1);
+    const __m128i bias = _mm_set1_epi16((short)0x8000);
+    __m128i p[4], lv[4];
+    __m128i k = _mm_set1_epi16(0x7FFF);
+    for (int i = 0; i < 4; ++i) {
+        p[i] = _mm_loadu_si128((const __m128i*)&ls->pc[i * 8]);
+        lv[i] = _mm_loadu_si128((const __m128i*)&ls->live[i * 8]);
+        __m128i key = _mm_or_si128(p[i], _mm_andnot_si128(lv[i], ones));
+        k = _mm_min_epi16(k, _mm_xor_si128(key, bias));
+    }
+    k = _mm_min_epi16(k, _mm_shuffle_epi32(k, 0x4E));
+    k = _mm_min_epi16(k, _mm_shuffle_epi32(k, 0xB1));
+    k = _mm_min_epi16(k, _mm_shufflelo_epi16(k, 0xB1));
+    *pc = (uint16_t)(_mm_cvtsi128_si32(k) ^ 0x8000);
+    if (*pc == 0xFFFF) return 0;
+
+    __m128i target = _mm_set1_epi16((short)*pc);
+    __m128i g[4];
+    for (int i = 0; i < 4; ++i) {
+        g[i] = _mm_and_si128(_mm_cmpeq_epi16(p[i], target), lv[i]);
+        _mm_storeu_si128((__m128i*)&mask->m16[i * 8], g[i]);
+    }
+    __m128i b0 = _mm_packs_epi16(g[0], g[1]);
+    __m128i b1 = _mm_packs_epi16(g[2], g[3]);
+    _mm_storeu_si128((__m128i*)&mask->m8[0], b0);
+    _mm_storeu_si128((__m128i*)&mask->m8[16], b1);
+    return (uint32_t)_mm_movemask_epi8(b0) | (uint32_t)_mm_movemask_epi8(b1) << 16;
+#else
+    uint16_t lowest = 0xFFFF;
+    LANE_LOOP(l) {
+        uint16_t key = ls->pc[l] | (uint16_t)~ls->live[l];
+        if (key < lowest) lowest = key;
+    }
+    *pc = lowest;
+    if (lowest == 0xFFFF) return 0;
+
+    uint32_t group = 0;
+    LANE_LOOP(l) {
+        mask->m16[l] = ls->pc[l] == lowest ? ls->live[l] : 0;
+        mask->m8[l] = (uint8_t)mask->m16[l];
+        group |= (uint32_t)(mask->m16[l] & 1) << l;
+    }
+    return group;
+#endif
+}
+
+static int lowest_lane(uint32_t group) {
+    int l = 0;
+    while (!(group >> l & 1u)) ++l;
+    return l;
+}
+
+// True when every lane of the group has the same I and no lane rewrote memory[I, I + x],
+// so Fx65 can broadcast from code[] instead of reading each lane's memory
+static bool uniform_load(const Chip8Lockstep* ls, uint32_t group, const uint16_t m16[LANES], uint8_t x) {
+    uint16_t addr = ls->I[lowest_lane(group)];
+    uint16_t differ = 0;
+    LANE_LOOP(l) differ |= (uint16_t)((ls->I[l] ^ addr) & m16[l]);
+    if (differ) return false;
+
+    uint16_t last = (uint16_t)((addr + x) & CHIP8_ADDR_MASK);
+    uint32_t dirty = ls->dirty[(addr & CHIP8_ADDR_MASK) / CHIP8_LOCKSTEP_BLOCK] |
+        ls->dirty[last / CHIP8_LOCKSTEP_BLOCK];
+    return !(dirty & group);
+}
+
+static void set_pc(Chip8Lockstep* ls, const LaneMask* mask, uint16_t pc) {
+    LANE_LOOP(l) ls->pc[l] = BLEND16(ls->pc[l], pc, mask->m16[l]);
+}
+
+// Register columns are staged through locals so compilers see no overlap between Vx, Vy and VF
+// and vectorize every lane loop without runtime alias checks. Each statement re-reads the
+// columns it uses, as chip8_cycle does, so x or y == F resolves identically.
+#define GET(col, r) memcpy(col, ls->V[r], LANES)
+#define PUT(r, col) memcpy(ls->V[r], col, LANES)
+
+// Skip ops: lanes whose test holds move to `skip`, the rest of the group to `next`
+#define SKIP_IF(test) do { \
+    uint16_t to[LANES]; \
+    memcpy(to, ls->pc, sizeof(to)); \
+    LANE_LOOP(l) to[l] = BLEND16(to[l], (test) ? skip : next, m16[l]); \
+    memcpy(ls->pc, to, sizeof(to)); \
+} while (0)
+
+// Execute `opcode` at `pc` on every lane of the group
+static void step_group(Chip8Lockstep* ls, uint16_t pc, uint16_t opcode, uint32_t group, const LaneMask* mask) {
+    const Chip8QuirkFlags* q = &chip8_quirk_flags[ls->quirks];
+    uint8_t  x = (opcode & 0x0F00) >> 8;
+    uint8_t  y = (opcode & 0x00F0) >> 4;
+    uint8_t  n = (opcode & 0x000F);
+    uint8_t  kk = (opcode & 0x00FF);
+    uint16_t nnn = (opcode & 0x0FFF);
+    uint16_t next = (uint16_t)((pc + 2) & CHIP8_ADDR_MASK);
+    uint16_t skip = (uint16_t)((pc + 4) & CHIP8_ADDR_MASK);
+
+    uint8_t m8[LANES], a[LANES], b[LANES], f[LANES];
+    uint16_t m16[LANES], w[LANES];
+    memcpy(m8, mask->m8, sizeof(m8));
+    memcpy(m16, mask->m16, sizeof(m16));
+    GET(a, x);
+    GET(b, y);
+
+    switch (opcode & 0xF000) {
+    case 0x0000:
+        if (opcode == 0x00EE) { // RET
+            for (int l = 0; l < ls->count; ++l) {
+                if (!(group >> l & 1u)) continue;
+                if (ls->sp[l] > 0) {
+                    ls->sp[l]--;
+                    ls->pc[l] = ls->stack[ls->sp[l]][l] & CHIP8_ADDR_MASK;
+                }
+                else {
+                    ls->pc[l] = next;
+                }
+            }
+            return;
+        }
+        // Display ops leave the registers alone: call the shared helpers on each lane's machine
+        for (int l = 0; l < ls->count; ++l) {
+            if (!(group >> l & 1u)) continue;
+            Chip8* c8 = ls->lanes[l];
+            switch (opcode) {
+            case 0x00E0: chip8_clear_display(c8); break;
+            case 0x00FB: chip8_scroll_right(c8); break;
+            case 0x00FC: chip8_scroll_left(c8); break;
+            case 0x00FE:
+            case 0x00FF:
+                c8->high_res = opcode == 0x00FF;
+                chip8_clear_display(c8);
+                break;
+            case 0x00FD:
+                c8->running = false;
+                ls->live[l] = 0;
+                break;
+            default:
+                // 00CN scrolls down; other system calls are ignored
+                if ((opcode & 0xFFF0) == 0x00C0) chip8_scroll_down(c8, n);
+                break;
+            }
+        }
+        break;
+
+    case 0x1000: // JP addr
+        set_pc(ls, mask, nnn);
+        return;
+
+    case 0x2000: // CALL addr
+        for (int l = 0; l < ls->count; ++l) {
+            if (!(group >> l & 1u)) continue;
+            if (ls->sp[l] < CHIP8_STACK_SIZE) {
+                ls->stack[ls->sp[l]][l] = next;
+                ls->sp[l]++;
+                ls->pc[l] = nnn;
+            }
+            else {
+                ls->pc[l] = next;
+            }
+        }
+        return;
+
+    case 0x3000: // SE Vx, byte
+        SKIP_IF(a[l] == kk);
+        return;
+
+    case 0x4000: // SNE Vx, byte
+        SKIP_IF(a[l] != kk);
+        return;
+
+    case 0x5000: // SE Vx, Vy
+        if ((opcode & 0x000F) == 0x0) {
+            SKIP_IF(a[l] == b[l]);
+            return;
+        }
+        break;
+
+    case 0x6000: // LD Vx, byte
+        LANE_LOOP(l) a[l] = BLEND8(a[l], kk, m8[l]);
+        PUT(x, a);
+        break;
+
+    case 0x7000: // ADD Vx, byte
+        LANE_LOOP(l) a[l] = (uint8_t)(a[l] + (kk & m8[l]));
+        PUT(x, a);
+        break;
+
+    case 0x8000:
+        switch (opcode & 0x000F) {
+        case 0x0: // LD Vx, Vy
+            LANE_LOOP(l) a[l] = BLEND8(a[l], b[l], m8[l]);
+            PUT(x, a);
+            break;
+        case 0x1: // OR Vx, Vy
+        case 0x2: // AND Vx, Vy
+        case 0x3: // XOR Vx, Vy
+            if ((opcode & 0x000F) == 0x1) LANE_LOOP(l) a[l] = (uint8_t)(a[l] | (b[l] & m8[l]));
+            else if ((opcode & 0x000F) == 0x2) LANE_LOOP(l) a[l] = (uint8_t)(a[l] & (b[l] | ~m8[l]));
+            else LANE_LOOP(l) a[l] = (uint8_t)(a[l] ^ (b[l] & m8[l]));
+            PUT(x, a);
+            if (q->vf_reset) {
+                GET(f, 0xF);
+                LANE_LOOP(l) f[l] = (uint8_t)(f[l] & ~m8[l]);
+                PUT(0xF, f);
+            }
+            break;
+        case 0x4: // ADD Vx, Vy
+            GET(f, 0xF);
+            LANE_LOOP(l) {
+                uint8_t sum = (uint8_t)(a[l] + b[l]);
+                f[l] = BLEND8(f[l], sum < a[l], m8[l]);
+                a[l] = BLEND8(a[l], sum, m8[l]);
+            }
+            PUT(0xF, f);
+            PUT(x, a);
+            break;
+        case 0x5: // SUB Vx, Vy
+        case 0x7: // SUBN Vx, Vy
+            GET(f, 0xF);
+            if ((opcode & 0x000F) == 0x5) LANE_LOOP(l) f[l] = BLEND8(f[l], a[l] > b[l], m8[l]);
+            else LANE_LOOP(l) f[l] = BLEND8(f[l], b[l] > a[l], m8[l]);
+            PUT(0xF, f);
+            GET(a, x);
+            GET(b, y);
+            if ((opcode & 0x000F) == 0x5) LANE_LOOP(l) a[l] = BLEND8(a[l], a[l] - b[l], m8[l]);
+            else LANE_LOOP(l) a[l] = BLEND8(a[l], b[l] - a[l], m8[l]);
+            PUT(x, a);
+            break;
+        case 0x6: // SHR Vx {, Vy}
+        case 0xE: { // SHL Vx {, Vy}
+            // shift_vy reads Vy once up front; otherwise Vx is read again after VF is written.
+            // b holds the shifted source: Vy, or Vx
+            bool right = (opcode & 0x000F) == 0x6;
+            if (!q->shift_vy) memcpy(b, a, LANES);
+            GET(f, 0xF);
+            if (right) LANE_LOOP(l) f[l] = BLEND8(f[l], b[l] & 0x1, m8[l]);
+            else LANE_LOOP(l) f[l] = BLEND8(f[l], b[l] >> 7, m8[l]);
+            PUT(0xF, f);
+            if (!q->shift_vy) GET(b, x);
+            GET(a, x);
+            if (right) LANE_LOOP(l) a[l] = BLEND8(a[l], b[l] >> 1, m8[l]);
+            else LANE_LOOP(l) a[l] = BLEND8(a[l], b[l] << 1, m8[l]);
+            PUT(x, a);
+        } break;
+        default:
+            break;
+        }
+        break;
+
+    case 0x9000: // SNE Vx, Vy
+        if ((opcode & 0x000F) == 0x0) {
+            SKIP_IF(a[l] != b[l]);
+            return;
+        }
+        break;
+
+    case 0xA000: // LD I, addr
+        set_pc(ls, mask, next);
+        LANE_LOOP(l) ls->I[l] = BLEND16(ls->I[l], nnn, m16[l]);
+        return;
+
+    case 0xB000: // JP V0, addr (Bxnn: JP Vx, xnn)
+        if (!q->jump_vx) GET(a, 0);
+        memcpy(w, ls->pc, sizeof(w));
+        LANE_LOOP(l) w[l] = BLEND16(w[l], (nnn + a[l]) & CHIP8_ADDR_MASK, m16[l]);
+        memcpy(ls->pc, w, sizeof(w));
+        return;
+
+    case 0xC000: // RND Vx, byte: every lane draws from its own generator
+        for (int l = 0; l < ls->count; ++l) {
+            if (group >> l & 1u) ls->V[x][l] = (uint8_t)(chip8_random_byte(ls->lanes[l]) & kk);
+        }
+        break;
+
+    case 0xD000: // DRW Vx, Vy, nibble: draws read I and memory and set VF, lane by lane
+        for (int l = 0; l < ls->count; ++l) {
+            if (!(group >> l & 1u)) continue;
+            Chip8* c8 = ls->lanes[l];
+            c8->I = ls->I[l];
+            if (q->clip) chip8_draw_sprite_clipped(c8, a[l], b[l], n);
+            else chip8_draw_sprite(c8, a[l], b[l], n);
+            ls->V[0xF][l] = c8->V[0xF];
+        }
+        break;
+
+    case 0xE000: // SKP / SKNP Vx
+        if (kk == 0x9E || kk == 0xA1) {
+            bool want = kk == 0x9E;
+            for (int l = 0; l < ls->count; ++l) {
+                if (!(group >> l & 1u)) continue;
+                bool down = ls->lanes[l]->keys[a[l] & 0xF];
+                ls->pc[l] = down == want ? skip : next;
+            }
+            return;
+        }
+        break;
+
+    case 0xF000:
+        switch (kk) {
+        case 0x0A: // LD Vx, K: lanes with no key down stay on this instruction
+            for (int l = 0; l < ls->count; ++l) {
+                if (!(group >> l & 1u)) continue;
+                Chip8* c8 = ls->lanes[l];
+                if (chip8_wait_key(c8, x)) {
+                    ls->V[x][l] = c8->V[x];
+                    ls->pc[l] = next;
+                }
+            }
+            return;
+        case 0x07: // LD Vx, DT
+            for (int l = 0; l < ls->count; ++l) {
+                if (group >> l & 1u) ls->V[x][l] = ls->lanes[l]->delay_timer;
+            }
+            break;
+        case 0x15: // LD DT, Vx
+            for (int l = 0; l < ls->count; ++l) {
+                if (group >> l & 1u) ls->lanes[l]->delay_timer = a[l];
+            }
+            break;
+        case 0x18: // LD ST, Vx
+            for (int l = 0; l < ls->count; ++l) {
+                if (group >> l & 1u) ls->lanes[l]->sound_timer = a[l];
+            }
+            break;
+        case 0x1E: // ADD I, Vx
+        case 0x29: // LD F, Vx (small font)
+        case 0x30: // LD HF, Vx (big font digit)
+            memcpy(w, ls->I, sizeof(w));
+            if (kk == 0x1E) LANE_LOOP(l) w[l] = (uint16_t)(w[l] + (a[l] & m16[l]));
+            else if (kk == 0x29) LANE_LOOP(l) w[l] = BLEND16(w[l], a[l] * 5, m16[l]);
+            else LANE_LOOP(l) w[l] = BLEND16(w[l], 0x50 + a[l] * 10, m16[l]);
+            memcpy(ls->I, w, sizeof(w));
+            break;
+        case 0x33: // LD B, Vx
+        case 0x55: // LD [I], V0..Vx
+            for (int l = 0; l < ls->count; ++l) {
+                if (!(group >> l & 1u)) continue;
+                Chip8* c8 = ls->lanes[l];
+                c8->I = ls->I[l];
+                if (kk == 0x55) {
+                    for (int r = 0; r <= x; ++r) c8->V[r] = ls->V[r][l];
+                    chip8_store_registers(c8, x);
+                    note_store(ls, l, c8->I, x + 1);
+                }
+                else {
+                    c8->V[x] = a[l];
+                    chip8_store_bcd(c8, x);
+                    note_store(ls, l, c8->I, 3);
+                }
+            }
+            if (kk == 0x55 && q->memory_i) {
+                LANE_LOOP(l) ls->I[l] = (uint16_t)(ls->I[l] + ((x + q->memory_i - 1) & m16[l]));
+            }
+            break;
+        case 0x65: // LD V0..Vx, [I]
+            if (uniform_load(ls, group, m16, x)) {
+                // Every lane reads the same clean bytes of the code image
+                uint16_t addr = ls->I[lowest_lane(group)];
+                for (int r = 0; r <= x; ++r) {
+                    uint8_t v = ls->code[(addr + r) & CHIP8_ADDR_MASK];
+                    GET(a, r);
+                    LANE_LOOP(l) a[l] = BLEND8(a[l], v, m8[l]);
+                    PUT(r, a);
+                }
+            }
+            else {
+                for (int l = 0; l < ls->count; ++l) {
+                    if (!(group >> l & 1u)) continue;
+                    Chip8* c8 = ls->lanes[l];
+                    c8->I = ls->I[l];
+                    chip8_load_registers(c8, x);
+                    for (int r = 0; r <= x; ++r) ls->V[r][l] = c8->V[r];
+                }
+            }
+            if (q->memory_i) {
+                LANE_LOOP(l) ls->I[l] = (uint16_t)(ls->I[l] + ((x + q->memory_i - 1) & m16[l]));
+            }
+            break;
+        default:
+            break;
+        }
+        break;
+
+    default:
+        break;
+    }
+    set_pc(ls, mask, next);
+}
+
+#undef SKIP_IF
+#undef PUT
+#undef GET
+
+void chip8_lockstep_sync(Chip8Lockstep* ls) {
+    for (int l = 0; l < ls->count; ++l) store_lane(ls, l);
+}
+
+uint64_t chip8_lockstep_run(Chip8Lockstep* ls, uint32_t cycles) {
+    uint64_t base[LANES];
+    LANE_LOOP(l) {
+        ls->live[l] = 0;
+        ls->executed[l] = 0;
+    }
+    for (int l = 0; l < ls->count; ++l) {
+        base[l] = ls->lanes[l]->cycle_count;
+        if (cycles && ls->lanes[l]->running) ls->live[l] = 0xFFFF;
+    }
+
+    LaneMask mask;
+    uint64_t steps = 0;
+    for (;;) {
+        uint16_t pc;
+        uint32_t group = select_group(ls, &pc, &mask);
+        if (!group) break;
+
+        uint16_t opcode = (uint16_t)(ls->code[pc] << 8 | ls->code[(pc + 1) & CHIP8_ADDR_MASK]);
+
+        // Lanes that rewrote this code fetch their own copy; those that differ wait for a later step
+        uint32_t dirty = group & (ls->dirty[pc / CHIP8_LOCKSTEP_BLOCK] |
+            ls->dirty[((pc + 1) & CHIP8_ADDR_MASK) / CHIP8_LOCKSTEP_BLOCK]);
+        if (dirty) {
+            uint32_t first = 0;
+            uint16_t own_first = 0;
+            for (int l = 0; l < ls->count; ++l) {
+                if (!(dirty >> l & 1u)) continue;
+                const uint8_t* memory = ls->lanes[l]->memory;
+                uint16_t own = (uint16_t)(memory[pc] << 8 | memory[(pc + 1) & CHIP8_ADDR_MASK]);
+                if (own == opcode) continue;
+                if (!first) {
+                    first = 1u << l;
+                    own_first = own;
+                }
+                group &= ~(1u << l);
+                mask.m16[l] = 0;
+                mask.m8[l] = 0;
+            }
+            // Nobody runs the shared opcode: step the first diverged lane alone
+            if (!group) {
+                int l = lowest_lane(first);
+                group = first;
+                opcode = own_first;
+                mask.m16[l] = 0xFFFF;
+                mask.m8[l] = 0xFF;
+            }
+        }
+
+        step_group(ls, pc, opcode, group, &mask);
+        ls->steps++;
+
+        LANE_LOOP(l) ls->executed[l] += mask.m16[l] & 1;
+        // Until `cycles` steps have passed no lane can have used up its budget
+        if (++steps >= cycles) {
+            LANE_LOOP(l) {
+                if (ls->executed[l] >= cycles) ls->live[l] = 0;
+            }
+        }
+    }
+
+    uint64_t total = 0;
+    for (int l = 0; l < ls->count; ++l) {
+        ls->lanes[l]->cycle_count = base[l] + ls->executed[l];
+        total += ls->executed[l];
+    }
+    return total;
+}
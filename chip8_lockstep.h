@@ -0,0 +1,58 @@
+// Lockstep engine: many classic machines stepped together in struct-of-arrays lanes.
+// Registers, pc and stack live in lane columns, so one decode drives every lane that is at the
+// same pc with SSE2/AVX2-width ALU ops. Memory, display, timers, keys and the RNG stay in each
+// lane's Chip8; Dxyn, display ops and memory transfers fall back to one lane at a time.
+// Meant for fuzzing and search: one ROM run with different inputs or seeds per lane.
+
+#ifndef CHIP8_LOCKSTEP_H
+#define CHIP8_LOCKSTEP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "chip8.h"
+
+#define CHIP8_LOCKSTEP_LANES   32                                   // lanes per Chip8Lockstep
+#define CHIP8_LOCKSTEP_BLOCK   64                                   // code tracking granule, bytes
+#define CHIP8_LOCKSTEP_BLOCKS  (CHIP8_MEMORY_SIZE / CHIP8_LOCKSTEP_BLOCK)
+
+typedef struct Chip8Lockstep {
+    // Lane columns: the lanes' registers live here between chip8_lockstep_init and _sync
+    uint8_t  V[CHIP8_REGISTER_COUNT][CHIP8_LOCKSTEP_LANES];
+    uint16_t I[CHIP8_LOCKSTEP_LANES];
+    uint16_t pc[CHIP8_LOCKSTEP_LANES];
+    uint16_t stack[CHIP8_STACK_SIZE][CHIP8_LOCKSTEP_LANES];
+    uint8_t  sp[CHIP8_LOCKSTEP_LANES];
+    uint16_t live[CHIP8_LOCKSTEP_LANES];      // 0xFFFF while the lane may still run
+    uint32_t executed[CHIP8_LOCKSTEP_LANES];  // instructions this run
+
+    // Code image shared by every lane. Bit l of dirty[b] is set once lane l stored different
+    // bytes into block b; such lanes fetch their own opcode there instead of trusting code[].
+    uint8_t  code[CHIP8_MEMORY_SIZE];
+    uint32_t dirty[CHIP8_LOCKSTEP_BLOCKS];
+
+    Chip8*   lanes[CHIP8_LOCKSTEP_LANES];
+    int      count;
+    uint8_t  quirks;     // Chip8Quirks shared by every lane
+
+    uint64_t steps;      // decoded instructions, each retired by one or more lanes
+} Chip8Lockstep;
+
+// Bind `count` (1..CHIP8_LOCKSTEP_LANES) classic machines with the same quirk profile and
+// take over their registers. machines[0]'s memory becomes the shared code image. Call again
+// after changing a machine outside the engine (ROM load, state restore, register writes).
+// Returns false for XO-CHIP machines, mixed profiles or a bad count.
+bool chip8_lockstep_init(Chip8Lockstep* ls, Chip8** machines, int count);
+
+// Execute up to `cycles` instructions on every running lane with the same semantics as
+// chip8_cycle, always stepping the lanes at the lowest pc so diverged lanes reconverge.
+// Display, timers, keys, memory and cycle_count stay current in the machines, so hosts tick
+// timers and set keys on them between calls. Returns the instructions executed across all lanes.
+uint64_t chip8_lockstep_run(Chip8Lockstep* ls, uint32_t cycles);
+
+// Write V, I, pc, sp and the stack back to the machines, e.g. before saving or comparing them
+void chip8_lockstep_sync(Chip8Lockstep* ls);
+
+// Vector width chip8_lockstep_run was compiled for ("avx2", "sse2" or "scalar")
+const char* chip8_lockstep_simd(void);
+
+#endif // CHIP8_LOCKSTEP_H
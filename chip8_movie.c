@@ -0,0 +1,189 @@
+// Input movie recording, file format and cycle-exact playback.
+
+#include "chip8_movie.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t fnv1a(const uint8_t* data, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+uint64_t chip8_movie_rom_hash(const Chip8* c8) {
+    return fnv1a(&c8->memory[0x200], (size_t)c8->addr_mask + 1 - 0x200);
+}
+
+void chip8_movie_init(Chip8Movie* movie, uint64_t seed, const Chip8* c8) {
+    memset(movie, 0, sizeof(*movie));
+    movie->seed = seed;
+    movie->rom_hash = chip8_movie_rom_hash(c8);
+    movie->quirks = c8->quirks;
+}
+
+void chip8_movie_free(Chip8Movie* movie) {
+    free(movie->events);
+    memset(movie, 0, sizeof(*movie));
+}
+
+static bool reserve(Chip8Movie* movie, size_t count) {
+    if (count <= movie->capacity) return true;
+    size_t capacity = movie->capacity ? movie->capacity * 2 : 256;
+    while (capacity < count) capacity *= 2;
+    Chip8MovieEvent* grown = (Chip8MovieEvent*)realloc(movie->events, capacity * sizeof(Chip8MovieEvent));
+    if (!grown) return false;
+    movie->events = grown;
+    movie->capacity = capacity;
+    return true;
+}
+
+bool chip8_movie_add(Chip8Movie* movie, uint64_t cycle, Chip8MovieEventType type, uint8_t key) {
+    if (!reserve(movie, movie->count + 1)) return false;
+    Chip8MovieEvent* ev = &movie->events[movie->count++];
+    memset(ev, 0, sizeof(*ev));
+    ev->cycle = cycle;
+    ev->type = (uint8_t)type;
+    ev->key = key;
+    return true;
+}
+
+bool chip8_movie_record(Chip8Movie* movie, const Chip8* c8, Chip8MovieEventType type, uint8_t key) {
+    return chip8_movie_add(movie, c8->cycle_count, type, key);
+}
+
+bool chip8_movie_save(const Chip8Movie* movie, const char* path) {
+    Chip8MovieHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = CHIP8_MOVIE_MAGIC;
+    header.version = CHIP8_MOVIE_VERSION;
+    header.header_size = (uint16_t)sizeof(Chip8MovieHeader);
+    header.event_count = (uint32_t)movie->count;
+    header.seed = movie->seed;
+    header.rom_hash = movie->rom_hash;
+    header.quirks = movie->quirks;
+
+    FILE* f = NULL;
+#ifdef _MSC_VER
+    fopen_s(&f, path, "wb");
+#else
+    f = fopen(path, "wb");
+#endif
+    if (!f) {
+        fprintf(stderr, "Failed to create movie file: %s\n", path);
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+        fwrite(movie->events, sizeof(Chip8MovieEvent), movie->count, f) == movie->count;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) {
+        fprintf(stderr, "Failed to write movie file: %s\n", path);
+    }
+    return ok;
+}
+
+bool chip8_movie_load(Chip8Movie* movie, const char* path) {
+    memset(movie, 0, sizeof(*movie));
+
+    FILE* f = NULL;
+#ifdef _MSC_VER
+    fopen_s(&f, path, "rb");
+#else
+    f = fopen(path, "rb");
+#endif
+    if (!f) {
+        fprintf(stderr, "Failed to open movie file: %s\n", path);
+        return false;
+    }
+
+    Chip8MovieHeader header;
+    if (fread(&header, sizeof(header), 1, f) != 1 || header.magic != CHIP8_MOVIE_MAGIC) {
+        fprintf(stderr, "Not a CHIP-8 movie file: %s\n", path);
+        fclose(f);
+        return false;
+    }
+    if (header.version != CHIP8_MOVIE_VERSION || header.header_size != sizeof(Chip8MovieHeader)) {
+        fprintf(stderr, "Unsupported movie file version: %s\n", path);
+        fclose(f);
+        return false;
+    }
+
+    movie->seed = header.seed;
+    movie->rom_hash = header.rom_hash;
+    movie->quirks = header.quirks < CHIP8_QUIRKS_COUNT ? header.quirks : CHIP8_QUIRKS_MODERN;
+    if (!reserve(movie, header.event_count) ||
+        fread(movie->events, sizeof(Chip8MovieEvent), header.event_count, f) != header.event_count) {
+        fprintf(stderr, "Truncated movie file: %s\n", path);
+        fclose(f);
+        chip8_movie_free(movie);
+        return false;
+    }
+    fclose(f);
+    movie->count = header.event_count;
+
+    for (size_t i = 1; i < movie->count; ++i) {
+        if (movie->events[i].cycle < movie->events[i - 1].cycle) {
+            fprintf(stderr, "Movie events out of order: %s\n", path);
+            chip8_movie_free(movie);
+            return false;
+        }
+    }
+    return true;
+}
+
+void chip8_movie_play_begin(Chip8MoviePlayer* player, const Chip8Movie* movie) {
+    player->movie = movie;
+    player->next = 0;
+    player->ticks = 0;
+}
+
+bool chip8_movie_play_done(const Chip8MoviePlayer* player) {
+    return player->next >= player->movie->count;
+}
+
+// Apply every event due at or before the current cycle
+static void apply_due(Chip8MoviePlayer* player, Chip8* c8) {
+    const Chip8Movie* movie = player->movie;
+    while (player->next < movie->count && movie->events[player->next].cycle <= c8->cycle_count) {
+        const Chip8MovieEvent* ev = &movie->events[player->next++];
+        switch (ev->type) {
+        case CHIP8_MOVIE_KEY_DOWN:
+            chip8_key_down(c8, ev->key);
+            break;
+        case CHIP8_MOVIE_KEY_UP:
+            chip8_key_up(c8, ev->key);
+            break;
+        case CHIP8_MOVIE_TICK:
+            chip8_tick_timers(c8);
+            player->ticks++;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+uint64_t chip8_movie_play(Chip8MoviePlayer* player, Chip8Engine* engine, Chip8* c8, uint64_t cycles) {
+    const Chip8Movie* movie = player->movie;
+    uint64_t executed = 0;
+
+    while (c8->running) {
+        apply_due(player, c8);
+        if (executed >= cycles) break;
+
+        uint64_t left = cycles - executed;
+        if (player->next < movie->count) {
+            uint64_t until = movie->events[player->next].cycle - c8->cycle_count;
+            if (until < left) left = until;
+        }
+        uint32_t slice = left > UINT32_MAX ? UINT32_MAX : (uint32_t)left;
+        uint32_t ran = chip8_engine_run(engine, c8, slice);
+        executed += ran;
+        if (ran < slice) break;
+    }
+    return executed;
+}
@@ -0,0 +1,85 @@
+// Input movies: key presses, releases and 60Hz timer ticks keyed by instruction count
+// (Chip8.cycle_count). Together with the RNG seed and the ROM this fully determines a run,
+// so a movie replays bit-identically on any engine, at any speed.
+
+#ifndef CHIP8_MOVIE_H
+#define CHIP8_MOVIE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "chip8.h"
+#include "chip8_engine.h"
+
+#define CHIP8_MOVIE_MAGIC    0x564D3843u   // "C8MV" in file byte order on little-endian hosts
+#define CHIP8_MOVIE_VERSION  1
+
+typedef enum Chip8MovieEventType {
+    CHIP8_MOVIE_KEY_DOWN = 1,
+    CHIP8_MOVIE_KEY_UP   = 2,
+    CHIP8_MOVIE_TICK     = 3,   // chip8_tick_timers
+} Chip8MovieEventType;
+
+// Applied when Chip8.cycle_count equals `cycle`, before the next instruction runs
+typedef struct Chip8MovieEvent {
+    uint64_t cycle;
+    uint8_t  type;
+    uint8_t  key;
+    uint8_t  reserved[6];
+} Chip8MovieEvent;
+
+typedef struct Chip8MovieHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t event_count;
+    uint8_t  quirks;     // Chip8Quirks profile of the run (0 = modern in older files)
+    uint8_t  reserved[3];
+    uint64_t seed;       // chip8_seed value the run started with
+    uint64_t rom_hash;   // chip8_movie_rom_hash of the machine right after the ROM load
+} Chip8MovieHeader;
+
+typedef struct Chip8Movie {
+    uint64_t         seed;
+    uint64_t         rom_hash;
+    uint8_t          quirks;
+    Chip8MovieEvent* events;   // sorted by cycle
+    size_t           count;
+    size_t           capacity;
+} Chip8Movie;
+
+// Replay cursor into a movie
+typedef struct Chip8MoviePlayer {
+    const Chip8Movie* movie;
+    size_t            next;    // first event not applied yet
+    uint64_t          ticks;   // timer ticks applied so far
+} Chip8MoviePlayer;
+
+// Hash of program memory (0x200 up), identifying the loaded ROM
+uint64_t chip8_movie_rom_hash(const Chip8* c8);
+
+// Start an empty movie for a machine that was just seeded with `seed`, loaded and given its quirks
+void chip8_movie_init(Chip8Movie* movie, uint64_t seed, const Chip8* c8);
+
+void chip8_movie_free(Chip8Movie* movie);
+
+// Append an event at the machine's current cycle. Returns false on allocation failure.
+bool chip8_movie_record(Chip8Movie* movie, const Chip8* c8, Chip8MovieEventType type, uint8_t key);
+
+// Append an event at an explicit cycle, for generated inputs. Keep events in cycle order.
+bool chip8_movie_add(Chip8Movie* movie, uint64_t cycle, Chip8MovieEventType type, uint8_t key);
+
+bool chip8_movie_save(const Chip8Movie* movie, const char* path);
+bool chip8_movie_load(Chip8Movie* movie, const char* path);
+
+void chip8_movie_play_begin(Chip8MoviePlayer* player, const Chip8Movie* movie);
+
+// True once every event has been applied
+bool chip8_movie_play_done(const Chip8MoviePlayer* player);
+
+// Run up to `cycles` instructions on `engine`, applying events exactly at their cycles.
+// Slices end on event boundaries, so every engine sees the same inputs. Stops early when
+// the machine halts; returns the number of instructions executed.
+uint64_t chip8_movie_play(Chip8MoviePlayer* player, Chip8Engine* engine, Chip8* c8, uint64_t cycles);
+
+#endif // CHIP8_MOVIE_H
@@ -0,0 +1,311 @@
+// Execution profiler counters, call-stack table and dump formats.
+
+#include "chip8_profile.h"
+#include "host_thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_STACK UINT32_MAX
+#define HOT_PCS  24
+
+#define CHIP8_OP_CLASS_LABEL(name, label) label,
+static const char* const class_names[CHIP8_OP_CLASS_COUNT] = {
+    CHIP8_OP_CLASSES(CHIP8_OP_CLASS_LABEL)
+};
+#undef CHIP8_OP_CLASS_LABEL
+
+static const char* const timer_names[CHIP8_PROFILE_TIMER_COUNT] = {
+    "draw_sprite",
+    "scroll_down",
+    "scroll_right",
+    "scroll_left",
+    "scroll_up",
+};
+
+static uint32_t stack_hash(const uint16_t* frames, uint8_t depth) {
+    uint32_t hash = 2166136261u ^ depth;
+    for (uint8_t i = 0; i < depth; ++i) {
+        hash = (hash ^ frames[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Find or insert the slot for a call stack; NO_STACK when the table is full
+static uint32_t stack_slot(Chip8Profile* p, const uint16_t* frames, uint8_t depth) {
+    uint32_t slot = stack_hash(frames, depth) & (CHIP8_PROFILE_MAX_STACKS - 1);
+    for (uint32_t probe = 0; probe < CHIP8_PROFILE_MAX_STACKS; ++probe) {
+        Chip8ProfileStack* s = &p->stacks[slot];
+        if (!s->used) {
+            s->used = true;
+            s->depth = depth;
+            memcpy(s->frames, frames, depth * sizeof(uint16_t));
+            return slot;
+        }
+        if (s->depth == depth && memcmp(s->frames, frames, depth * sizeof(uint16_t)) == 0) {
+            return slot;
+        }
+        slot = (slot + 1) & (CHIP8_PROFILE_MAX_STACKS - 1);
+    }
+    return NO_STACK;
+}
+
+Chip8Profile* chip8_profile_create(void) {
+    Chip8Profile* p = (Chip8Profile*)malloc(sizeof(Chip8Profile));
+    if (p) chip8_profile_reset(p);
+    return p;
+}
+
+void chip8_profile_destroy(Chip8Profile* p) {
+    free(p);
+}
+
+void chip8_profile_reset(Chip8Profile* p) {
+    memset(p, 0, sizeof(*p));
+    p->current = stack_slot(p, p->frames, 0);
+}
+
+void chip8_profile_snapshot(const Chip8Profile* p, Chip8Profile* out) {
+    memcpy(out, p, sizeof(*out));
+}
+
+void chip8_profile_merge(Chip8Profile* dst, const Chip8Profile* src) {
+    dst->instructions += src->instructions;
+    for (int i = 0; i < CHIP8_OP_CLASS_COUNT; ++i) dst->class_count[i] += src->class_count[i];
+    for (int i = 0; i < CHIP8_MEMORY_SIZE; ++i) dst->pc_count[i] += src->pc_count[i];
+    for (int i = 0; i < CHIP8_PROFILE_TIMER_COUNT; ++i) {
+        dst->timer_calls[i] += src->timer_calls[i];
+        dst->timer_ns[i] += src->timer_ns[i];
+    }
+    dst->key_wait_spins += src->key_wait_spins;
+    dst->stack_overflow += src->stack_overflow;
+
+    for (int i = 0; i < CHIP8_PROFILE_MAX_STACKS; ++i) {
+        const Chip8ProfileStack* s = &src->stacks[i];
+        if (!s->used || s->count == 0) continue;
+        uint32_t slot = stack_slot(dst, s->frames, s->depth);
+        if (slot == NO_STACK) dst->stack_overflow += s->count;
+        else dst->stacks[slot].count += s->count;
+    }
+}
+
+Chip8OpClass chip8_op_class(uint16_t opcode) {
+    uint8_t kk = (uint8_t)opcode;
+
+    switch (opcode & 0xF000) {
+    case 0x0000:
+        if (opcode == 0x00E0) return CHIP8_OP_CLS;
+        if (opcode == 0x00EE) return CHIP8_OP_RET;
+        if (opcode == 0x00FB) return CHIP8_OP_SCROLL_RIGHT;
+        if (opcode == 0x00FC) return CHIP8_OP_SCROLL_LEFT;
+        if (opcode == 0x00FD) return CHIP8_OP_EXIT;
+        if (opcode == 0x00FE) return CHIP8_OP_LOW_RES;
+        if (opcode == 0x00FF) return CHIP8_OP_HIGH_RES;
+        if ((opcode & 0xFFF0) == 0x00C0) return CHIP8_OP_SCROLL_DOWN;
+        if ((opcode & 0xFFF0) == 0x00D0) return CHIP8_OP_SCROLL_UP;
+        return CHIP8_OP_SYS;
+    case 0x1000: return CHIP8_OP_JP;
+    case 0x2000: return CHIP8_OP_CALL;
+    case 0x3000: return CHIP8_OP_SE_IMM;
+    case 0x4000: return CHIP8_OP_SNE_IMM;
+    case 0x5000:
+        switch (opcode & 0xF) {
+        case 0x0: return CHIP8_OP_SE_REG;
+        case 0x2: return CHIP8_OP_SAVE_RANGE;
+        case 0x3: return CHIP8_OP_LOAD_RANGE;
+        default:  return CHIP8_OP_INVALID;
+        }
+    case 0x6000: return CHIP8_OP_LD_IMM;
+    case 0x7000: return CHIP8_OP_ADD_IMM;
+    case 0x8000:
+        switch (opcode & 0xF) {
+        case 0x0: return CHIP8_OP_MOV;
+        case 0x1: return CHIP8_OP_OR;
+        case 0x2: return CHIP8_OP_AND;
+        case 0x3: return CHIP8_OP_XOR;
+        case 0x4: return CHIP8_OP_ADD;
+        case 0x5: return CHIP8_OP_SUB;
+        case 0x6: return CHIP8_OP_SHR;
+        case 0x7: return CHIP8_OP_SUBN;
+        case 0xE: return CHIP8_OP_SHL;
+        default:  return CHIP8_OP_INVALID;
+        }
+    case 0x9000: return (opcode & 0xF) == 0 ? CHIP8_OP_SNE_REG : CHIP8_OP_INVALID;
+    case 0xA000: return CHIP8_OP_LD_I;
+    case 0xB000: return CHIP8_OP_JP_V0;
+    case 0xC000: return CHIP8_OP_RND;
+    case 0xD000: return CHIP8_OP_DRW;
+    case 0xE000:
+        if (kk == 0x9E) return CHIP8_OP_SKP;
+        if (kk == 0xA1) return CHIP8_OP_SKNP;
+        return CHIP8_OP_INVALID;
+    case 0xF000:
+        switch (kk) {
+        case 0x00: return opcode == 0xF000 ? CHIP8_OP_LONG_I : CHIP8_OP_INVALID;
+        case 0x01: return CHIP8_OP_PLANE;
+        case 0x02: return opcode == 0xF002 ? CHIP8_OP_AUDIO : CHIP8_OP_INVALID;
+        case 0x07: return CHIP8_OP_LD_DT;
+        case 0x0A: return CHIP8_OP_WAIT_KEY;
+        case 0x15: return CHIP8_OP_SET_DT;
+        case 0x18: return CHIP8_OP_SET_ST;
+        case 0x1E: return CHIP8_OP_ADD_I;
+        case 0x29: return CHIP8_OP_FONT;
+        case 0x30: return CHIP8_OP_BIG_FONT;
+        case 0x33: return CHIP8_OP_BCD;
+        case 0x3A: return CHIP8_OP_PITCH;
+        case 0x55: return CHIP8_OP_STORE;
+        case 0x65: return CHIP8_OP_LOAD;
+        default:   return CHIP8_OP_INVALID;
+        }
+    default:
+        return CHIP8_OP_INVALID;
+    }
+}
+
+const char* chip8_op_class_name(Chip8OpClass op_class) {
+    return (unsigned)op_class < CHIP8_OP_CLASS_COUNT ? class_names[op_class] : "unknown";
+}
+
+void chip8_profile_instr(Chip8Profile* p, const Chip8* c8, uint16_t pc, uint16_t opcode) {
+    Chip8OpClass op_class = chip8_op_class(opcode);
+
+    p->instructions++;
+    p->pc_count[pc & CHIP8_ADDR_MASK]++;
+    p->class_count[op_class]++;
+    if (p->current != NO_STACK) p->stacks[p->current].count++;
+    else p->stack_overflow++;
+
+    // Runs before the instruction executes, so c8->sp and the keys decide what it will do.
+    if (op_class == CHIP8_OP_CALL && c8->sp < CHIP8_STACK_SIZE) {
+        if (p->depth < CHIP8_STACK_SIZE) p->frames[p->depth++] = opcode & 0x0FFF;
+        p->current = stack_slot(p, p->frames, p->depth);
+    }
+    else if (op_class == CHIP8_OP_RET && c8->sp > 0) {
+        if (p->depth > 0) p->depth--;
+        p->current = stack_slot(p, p->frames, p->depth);
+    }
+    else if (op_class == CHIP8_OP_WAIT_KEY) {
+        bool any = false;
+        for (int k = 0; k < CHIP8_KEY_COUNT; ++k) any |= c8->keys[k];
+        if (!any) p->key_wait_spins++;
+    }
+
+    if (p->key_armed) {
+        uint16_t reads = 0;
+        if (op_class == CHIP8_OP_SKP || op_class == CHIP8_OP_SKNP) {
+            reads = (uint16_t)(1u << (c8->V[(opcode >> 8) & 0xF] & 0xF));
+        }
+        else if (op_class == CHIP8_OP_WAIT_KEY) {
+            for (int k = 0; k < CHIP8_KEY_COUNT; ++k) {
+                if (c8->keys[k]) reads |= (uint16_t)(1u << k);
+            }
+        }
+        reads &= p->key_armed;
+        if (reads) {
+            uint64_t now = host_time_ns();
+            for (int k = 0; k < CHIP8_KEY_COUNT; ++k) {
+                if (reads & (1u << k)) p->key_seen_ns[k] = now;
+            }
+            p->key_armed &= (uint16_t)~reads;
+            p->key_seen |= reads;
+        }
+    }
+}
+
+void chip8_profile_arm_key(Chip8Profile* p, uint8_t key) {
+    p->key_armed |= (uint16_t)(1u << (key & 0xF));
+}
+
+void chip8_profile_time(Chip8Profile* p, Chip8ProfileTimer timer, uint64_t ns) {
+    p->timer_calls[timer]++;
+    p->timer_ns[timer] += ns;
+}
+
+#ifdef CHIP8_PROFILE
+void chip8_profile_attach(Chip8* c8, Chip8Profile* p) {
+    c8->profile = p;
+    if (p) {
+        // Start the shadow stack at the machine's current depth with unknown targets.
+        p->depth = c8->sp;
+        memset(p->frames, 0, sizeof(p->frames));
+        p->current = stack_slot(p, p->frames, p->depth);
+    }
+}
+#endif
+
+static double percent(uint64_t part, uint64_t total) {
+    return total ? 100.0 * (double)part / (double)total : 0.0;
+}
+
+void chip8_profile_dump_text(const Chip8Profile* p, FILE* out) {
+    fprintf(out, "instructions: %llu\n\n", (unsigned long long)p->instructions);
+
+    // Opcode classes, most frequent first
+    int order[CHIP8_OP_CLASS_COUNT];
+    for (int i = 0; i < CHIP8_OP_CLASS_COUNT; ++i) order[i] = i;
+    for (int i = 1; i < CHIP8_OP_CLASS_COUNT; ++i) {
+        int v = order[i];
+        int j = i - 1;
+        while (j >= 0 && p->class_count[order[j]] < p->class_count[v]) {
+            order[j + 1] = order[j];
+            j--;
+        }
+        order[j + 1] = v;
+    }
+    fprintf(out, "opcode class              count      %%\n");
+    for (int i = 0; i < CHIP8_OP_CLASS_COUNT; ++i) {
+        uint64_t n = p->class_count[order[i]];
+        if (n == 0) break;
+        fprintf(out, "  %-20s %12llu %6.2f\n", class_names[order[i]], (unsigned long long)n,
+            percent(n, p->instructions));
+    }
+
+    // Hottest addresses
+    uint16_t hot[HOT_PCS];
+    int hot_count = 0;
+    for (int pc = 0; pc < CHIP8_MEMORY_SIZE; ++pc) {
+        uint64_t n = p->pc_count[pc];
+        if (n == 0) continue;
+        if (hot_count == HOT_PCS && n <= p->pc_count[hot[HOT_PCS - 1]]) continue;
+        int j = hot_count < HOT_PCS ? hot_count++ : HOT_PCS - 1;
+        while (j > 0 && p->pc_count[hot[j - 1]] < n) {
+            hot[j] = hot[j - 1];
+            j--;
+        }
+        hot[j] = (uint16_t)pc;
+    }
+    fprintf(out, "\nhot pc                    count      %%\n");
+    for (int i = 0; i < hot_count; ++i) {
+        fprintf(out, "  0x%03X %25llu %6.2f\n", hot[i], (unsigned long long)p->pc_count[hot[i]],
+            percent(p->pc_count[hot[i]], p->instructions));
+    }
+
+    fprintf(out, "\nroutine           calls      total ms    ns/call\n");
+    for (int t = 0; t < CHIP8_PROFILE_TIMER_COUNT; ++t) {
+        uint64_t calls = p->timer_calls[t];
+        fprintf(out, "  %-12s %10llu %13.3f %10.1f\n", timer_names[t], (unsigned long long)calls,
+            (double)p->timer_ns[t] / 1e6, calls ? (double)p->timer_ns[t] / (double)calls : 0.0);
+    }
+
+    fprintf(out, "\nFx0A spins: %llu (%.2f%% of instructions)\n",
+        (unsigned long long)p->key_wait_spins, percent(p->key_wait_spins, p->instructions));
+    if (p->stack_overflow) {
+        fprintf(out, "instructions outside the call-stack table: %llu\n",
+            (unsigned long long)p->stack_overflow);
+    }
+}
+
+void chip8_profile_dump_folded(const Chip8Profile* p, FILE* out) {
+    for (int i = 0; i < CHIP8_PROFILE_MAX_STACKS; ++i) {
+        const Chip8ProfileStack* s = &p->stacks[i];
+        if (!s->used || s->count == 0) continue;
+        fprintf(out, "main");
+        for (uint8_t d = 0; d < s->depth; ++d) {
+            if (s->frames[d]) fprintf(out, ";sub_%03X", s->frames[d]);
+            else fprintf(out, ";[unknown]");
+        }
+        fprintf(out, " %llu\n", (unsigned long long)s->count);
+    }
+    if (p->stack_overflow) {
+        fprintf(out, "main;[overflow] %llu\n", (unsigned long long)p->stack_overflow);
+    }
+}
@@ -0,0 +1,130 @@
+// Optional execution profiler. Build with -DCHIP8_PROFILE to compile the hooks in; without it
+// every hook expands to nothing and Chip8 has no profile pointer.
+// Counts instructions per opcode class, per pc and per 2nnn call stack, times the display
+// routines, and counts Fx0A spins. Dumps as text or as folded stacks for flamegraph.pl.
+// Also carries the key latency probe: hosts arm a key when they apply a transition, and the
+// first Ex9E/ExA1/Fx0A that reads the key records when it did.
+
+#ifndef CHIP8_PROFILE_H
+#define CHIP8_PROFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "chip8.h"
+
+#define CHIP8_PROFILE_MAX_STACKS 4096   // distinct call stacks tracked; the rest count as overflow
+
+// X-macro list of opcode classes: name, text label
+#define CHIP8_OP_CLASSES(X) \
+    X(CLS, "00E0 cls") X(RET, "00EE ret") X(SCROLL_DOWN, "00Cn scroll down") \
+    X(SCROLL_RIGHT, "00FB scroll right") X(SCROLL_LEFT, "00FC scroll left") X(EXIT, "00FD exit") \
+    X(LOW_RES, "00FE low res") X(HIGH_RES, "00FF high res") X(SYS, "0nnn sys") \
+    X(JP, "1nnn jp") X(CALL, "2nnn call") X(SE_IMM, "3xkk se") X(SNE_IMM, "4xkk sne") \
+    X(SE_REG, "5xy0 se") X(LD_IMM, "6xkk ld") X(ADD_IMM, "7xkk add") \
+    X(MOV, "8xy0 ld") X(OR, "8xy1 or") X(AND, "8xy2 and") X(XOR, "8xy3 xor") X(ADD, "8xy4 add") \
+    X(SUB, "8xy5 sub") X(SHR, "8xy6 shr") X(SUBN, "8xy7 subn") X(SHL, "8xyE shl") \
+    X(SNE_REG, "9xy0 sne") X(LD_I, "Annn ld i") X(JP_V0, "Bnnn jp v0") X(RND, "Cxkk rnd") \
+    X(DRW, "Dxyn drw") X(SKP, "Ex9E skp") X(SKNP, "ExA1 sknp") X(LD_DT, "Fx07 ld vx, dt") \
+    X(WAIT_KEY, "Fx0A ld k") X(SET_DT, "Fx15 ld dt, vx") X(SET_ST, "Fx18 ld st, vx") X(ADD_I, "Fx1E add i") \
+    X(FONT, "Fx29 ld f") X(BIG_FONT, "Fx30 ld hf") X(BCD, "Fx33 ld b") X(STORE, "Fx55 ld [i]") \
+    X(LOAD, "Fx65 ld vx") X(SCROLL_UP, "00Dn scroll up") X(SAVE_RANGE, "5xy2 save") \
+    X(LOAD_RANGE, "5xy3 load") X(LONG_I, "F000 ld i, long") X(PLANE, "Fn01 plane") \
+    X(AUDIO, "F002 audio") X(PITCH, "Fx3A pitch") X(INVALID, "invalid")
+
+#define CHIP8_OP_CLASS_ENUM(name, label) CHIP8_OP_##name,
+typedef enum Chip8OpClass {
+    CHIP8_OP_CLASSES(CHIP8_OP_CLASS_ENUM)
+    CHIP8_OP_CLASS_COUNT
+} Chip8OpClass;
+#undef CHIP8_OP_CLASS_ENUM
+
+typedef enum Chip8ProfileTimer {
+    CHIP8_PROFILE_DRAW,
+    CHIP8_PROFILE_SCROLL_DOWN,
+    CHIP8_PROFILE_SCROLL_RIGHT,
+    CHIP8_PROFILE_SCROLL_LEFT,
+    CHIP8_PROFILE_SCROLL_UP,
+    CHIP8_PROFILE_TIMER_COUNT
+} Chip8ProfileTimer;
+
+typedef struct Chip8ProfileStack {
+    uint16_t frames[CHIP8_STACK_SIZE];   // call targets, outermost first
+    uint8_t  depth;
+    bool     used;
+    uint64_t count;                      // instructions executed with exactly this stack
+} Chip8ProfileStack;
+
+typedef struct Chip8Profile {
+    uint64_t instructions;
+    uint64_t class_count[CHIP8_OP_CLASS_COUNT];
+    uint64_t pc_count[CHIP8_MEMORY_SIZE];
+    uint64_t timer_calls[CHIP8_PROFILE_TIMER_COUNT];
+    uint64_t timer_ns[CHIP8_PROFILE_TIMER_COUNT];
+    uint64_t key_wait_spins;    // Fx0A executions that found no key down
+
+    // Key latency probe (chip8_profile_arm_key); chip8_profile_merge skips it
+    uint16_t key_armed;         // keys whose next read is timestamped
+    uint16_t key_seen;          // armed keys read since the host last collected them
+    uint64_t key_seen_ns[CHIP8_KEY_COUNT];
+
+    // Shadow of the 2nnn stack of the machine being profiled
+    uint16_t frames[CHIP8_STACK_SIZE];
+    uint8_t  depth;
+    uint32_t current;           // stacks[] slot of the current stack, or UINT32_MAX
+    uint64_t stack_overflow;    // instructions whose stack did not fit in stacks[]
+    Chip8ProfileStack stacks[CHIP8_PROFILE_MAX_STACKS];
+} Chip8Profile;
+
+// Allocate a zeroed profile (about 200 KB). Returns NULL on allocation failure.
+Chip8Profile* chip8_profile_create(void);
+void chip8_profile_destroy(Chip8Profile* p);
+
+// Zero every counter
+void chip8_profile_reset(Chip8Profile* p);
+
+// Copy the counters of a live profile, e.g. to dump while the machine keeps running
+void chip8_profile_snapshot(const Chip8Profile* p, Chip8Profile* out);
+
+// Add the counters of src into dst (for combining per-thread profiles)
+void chip8_profile_merge(Chip8Profile* dst, const Chip8Profile* src);
+
+// Opcode class of an instruction and its label ("8xy4 add")
+Chip8OpClass chip8_op_class(uint16_t opcode);
+const char* chip8_op_class_name(Chip8OpClass op_class);
+
+// Human-readable summary: classes, hottest pcs, display routine timings, key-wait spins
+void chip8_profile_dump_text(const Chip8Profile* p, FILE* out);
+
+// One line per call stack: "main;sub_2A4;sub_300 <instructions>"
+void chip8_profile_dump_folded(const Chip8Profile* p, FILE* out);
+
+// Hooks called by the engines; only referenced when CHIP8_PROFILE is defined
+void chip8_profile_instr(Chip8Profile* p, const Chip8* c8, uint16_t pc, uint16_t opcode);
+void chip8_profile_time(Chip8Profile* p, Chip8ProfileTimer timer, uint64_t ns);
+
+// Key latency probe: call right after applying a transition of `key`. The next Ex9E/ExA1
+// testing that key, or Fx0A while it is down, sets its bit in key_seen and stores the host
+// time in key_seen_ns[key]. The host clears key_seen bits once it has read them.
+void chip8_profile_arm_key(Chip8Profile* p, uint8_t key);
+
+#ifdef CHIP8_PROFILE
+#include "host_thread.h"
+
+// Profile the instructions of c8 into p from now on (NULL stops profiling).
+// Attach after chip8_init or a state restore.
+void chip8_profile_attach(Chip8* c8, Chip8Profile* p);
+
+#define CHIP8_PROFILE_INSTR(c8, pc, opcode) \
+    do { if ((c8)->profile) chip8_profile_instr((c8)->profile, (c8), (pc), (opcode)); } while (0)
+#define CHIP8_PROFILE_START(c8, var) \
+    uint64_t var = (c8)->profile ? host_time_ns() : 0
+#define CHIP8_PROFILE_STOP(c8, timer, var) \
+    do { if ((c8)->profile) chip8_profile_time((c8)->profile, (timer), host_time_ns() - (var)); } while (0)
+#else
+#define CHIP8_PROFILE_INSTR(c8, pc, opcode) ((void)0)
+#define CHIP8_PROFILE_START(c8, var) ((void)0)
+#define CHIP8_PROFILE_STOP(c8, timer, var) ((void)0)
+#endif
+
+#endif // CHIP8_PROFILE_H
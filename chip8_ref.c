@@ -0,0 +1,504 @@
+// Reference interpreter: straight-line instruction semantics on a byte-per-pixel display.
+// Written for reading, not speed; where chip8.c has a defined but surprising behaviour (the
+// flag/result order of 8xyN, the low-res column range of 00FB/00FC) it is spelled out here.
+
+#include "chip8_ref.h"
+#include <stdio.h>
+#include <string.h>
+
+static bool is_xo(const Chip8Ref* r) {
+    return r->quirks == CHIP8_QUIRKS_XOCHIP;
+}
+
+// 8xy6/8xyE shift Vy into Vx
+static bool shifts_read_vy(const Chip8Ref* r) {
+    return r->quirks == CHIP8_QUIRKS_VIP || r->quirks == CHIP8_QUIRKS_XOCHIP;
+}
+
+// 8xy1/8xy2/8xy3 clear VF
+static bool logic_clears_vf(const Chip8Ref* r) {
+    return r->quirks == CHIP8_QUIRKS_VIP;
+}
+
+// Sprites are cut off at the right and bottom edges instead of wrapping
+static bool sprites_clip(const Chip8Ref* r) {
+    return r->quirks == CHIP8_QUIRKS_VIP || r->quirks == CHIP8_QUIRKS_CHIP48 ||
+        r->quirks == CHIP8_QUIRKS_SCHIP;
+}
+
+// Bxnn jumps to xnn + Vx
+static bool jump_adds_vx(const Chip8Ref* r) {
+    return r->quirks == CHIP8_QUIRKS_CHIP48 || r->quirks == CHIP8_QUIRKS_SCHIP;
+}
+
+// How far Fx55/Fx65 move I
+static uint16_t load_store_advance(const Chip8Ref* r, uint8_t x) {
+    switch (r->quirks) {
+    case CHIP8_QUIRKS_VIP:
+    case CHIP8_QUIRKS_XOCHIP: return (uint16_t)(x + 1);
+    case CHIP8_QUIRKS_CHIP48: return x;
+    default:                  return 0;
+    }
+}
+
+static int width(const Chip8Ref* r) {
+    return r->high_res ? CHIP8_HIGH_RES_WIDTH : CHIP8_LOW_RES_WIDTH;
+}
+
+static int height(const Chip8Ref* r) {
+    return r->high_res ? CHIP8_HIGH_RES_HEIGHT : CHIP8_LOW_RES_HEIGHT;
+}
+
+// Planes that clear and scroll act on: all of them outside XO-CHIP
+static int display_planes(const Chip8Ref* r) {
+    return is_xo(r) ? r->planes : CHIP8_PLANES_ALL;
+}
+
+static uint8_t read_byte(const Chip8Ref* r, uint32_t addr) {
+    return r->memory[addr & (r->memory_size - 1)];
+}
+
+static void write_byte(Chip8Ref* r, uint32_t addr, uint8_t value) {
+    addr &= r->memory_size - 1;
+    r->memory[addr] = value;
+    r->stored_pages[addr >> CHIP8_PAGE_SHIFT >> 6] |= 1ull << (addr >> CHIP8_PAGE_SHIFT & 63);
+}
+
+static uint16_t read_word(const Chip8Ref* r, uint32_t addr) {
+    return (uint16_t)(read_byte(r, addr) << 8 | read_byte(r, addr + 1));
+}
+
+static uint16_t next_pc(const Chip8Ref* r, uint32_t pc) {
+    return (uint16_t)(pc & (r->memory_size - 1));
+}
+
+void chip8_ref_load(Chip8Ref* ref, const Chip8* c8) {
+    memset(ref, 0, offsetof(Chip8Ref, memory));
+    memcpy(ref->V, c8->V, sizeof(ref->V));
+    ref->I = c8->I;
+    ref->pc = c8->pc;
+    memcpy(ref->stack, c8->stack, sizeof(ref->stack));
+    ref->sp = c8->sp;
+    ref->delay_timer = c8->delay_timer;
+    ref->sound_timer = c8->sound_timer;
+    memcpy(ref->keys, c8->keys, sizeof(ref->keys));
+    ref->rng_state = c8->rng_state;
+    ref->cycle_count = c8->cycle_count;
+    ref->high_res = c8->high_res;
+    ref->running = c8->running;
+    ref->quirks = c8->quirks;
+    ref->planes = c8->planes;
+    ref->pitch = c8->pitch;
+    ref->audio_pattern_set = c8->audio_pattern_set;
+    memcpy(ref->audio_pattern, c8->audio_pattern, sizeof(ref->audio_pattern));
+
+    const uint64_t* display = &c8->display[0][0];
+    for (int y = 0; y < CHIP8_HIGH_RES_HEIGHT; ++y) {
+        for (int x = 0; x < CHIP8_HIGH_RES_WIDTH; ++x) {
+            int color = chip8_pixel_color(display, x, y);
+            ref->pixels[0][y][x] = (uint8_t)(color & 1);
+            ref->pixels[1][y][x] = (uint8_t)(color >> 1);
+        }
+    }
+
+    ref->memory_size = (uint32_t)c8->addr_mask + 1;
+    memcpy(ref->memory, c8->memory, ref->memory_size);
+}
+
+static void clear_screen(Chip8Ref* r) {
+    for (int p = 0; p < CHIP8_DISPLAY_PLANES; ++p) {
+        if (display_planes(r) & (1 << p)) memset(r->pixels[p], 0, sizeof(r->pixels[p]));
+    }
+    r->touched_rows = ~0ull;
+}
+
+// Move rows [0, height) down by n (up if n < 0), across all 128 columns in either resolution
+static void scroll_vertical(Chip8Ref* r, int n) {
+    int h = height(r);
+    for (int p = 0; p < CHIP8_DISPLAY_PLANES; ++p) {
+        if (!(display_planes(r) & (1 << p))) continue;
+        if (n > 0) {
+            for (int y = h - 1; y >= 0; --y) {
+                for (int x = 0; x < CHIP8_HIGH_RES_WIDTH; ++x) {
+                    r->pixels[p][y][x] = y >= n ? r->pixels[p][y - n][x] : 0;
+                }
+            }
+        }
+        else {
+            for (int y = 0; y < h; ++y) {
+                for (int x = 0; x < CHIP8_HIGH_RES_WIDTH; ++x) {
+                    r->pixels[p][y][x] = y - n < h ? r->pixels[p][y - n][x] : 0;
+                }
+            }
+        }
+    }
+    r->touched_rows = ~0ull;
+}
+
+// Move columns [0, width) right by n (left if n < 0); in low res columns 64-127 stay put
+static void scroll_horizontal(Chip8Ref* r, int n) {
+    int w = width(r);
+    int h = height(r);
+    for (int p = 0; p < CHIP8_DISPLAY_PLANES; ++p) {
+        if (!(display_planes(r) & (1 << p))) continue;
+        for (int y = 0; y < h; ++y) {
+            uint8_t* row = r->pixels[p][y];
+            if (n > 0) {
+                for (int x = w - 1; x >= 0; --x) row[x] = x >= n ? row[x - n] : 0;
+            }
+            else {
+                for (int x = 0; x < w; ++x) row[x] = x - n < w ? row[x - n] : 0;
+            }
+        }
+    }
+    r->touched_rows = ~0ull;
+}
+
+// Dxyn. Each selected plane draws its own sprite, stored one after the other from I.
+static void draw_sprite(Chip8Ref* r, uint8_t x, uint8_t y, uint8_t n) {
+    int w = width(r);
+    int h = height(r);
+    int planes = is_xo(r) ? r->planes : 1;
+    bool wide = n == 0 && (r->high_res || is_xo(r));   // 16x16
+    int rows = wide ? 16 : n;
+    int cols = wide ? 16 : 8;
+    int row_bytes = wide ? 2 : 1;
+    bool clip = sprites_clip(r);
+    uint32_t addr = r->I;
+    bool collision = false;
+
+    for (int p = 0; p < CHIP8_DISPLAY_PLANES; ++p) {
+        if (!(planes & (1 << p))) continue;
+        for (int row = 0; row < rows; ++row) {
+            int py = clip ? y % h + row : (y + row) % h;
+            if (py >= h) break;
+            for (int col = 0; col < cols; ++col) {
+                uint8_t bits = read_byte(r, addr + (uint32_t)(row * row_bytes + col / 8));
+                if (!(bits & (0x80 >> (col % 8)))) continue;
+                int px = clip ? x % w + col : (x + col) % w;
+                if (px >= w) continue;
+                uint8_t* pixel = &r->pixels[p][py][px];
+                if (*pixel) collision = true;
+                *pixel ^= 1;
+                r->touched_rows |= 1ull << py;
+            }
+        }
+        addr += (uint32_t)(rows * row_bytes);
+    }
+    r->V[0xF] = collision ? 1 : 0;
+}
+
+// xorshift64*, as chip8.c seeds and steps it
+static uint8_t random_byte(Chip8Ref* r) {
+    uint64_t s = r->rng_state;
+    s ^= s >> 12;
+    s ^= s << 25;
+    s ^= s >> 27;
+    r->rng_state = s;
+    return (uint8_t)((s * 0x2545F4914F6CDD1Dull) >> 56);
+}
+
+// Skip the next instruction: on XO-CHIP F000 nnnn counts as one instruction of four bytes
+static void skip(Chip8Ref* r) {
+    bool long_load = is_xo(r) && read_word(r, r->pc) == 0xF000;
+    r->pc = next_pc(r, r->pc + (long_load ? 4u : 2u));
+}
+
+// 8xyN. The flag is written before the result, so with x = F the result wins, and
+// 8xy5/8xy6/8xy7/8xyE read the new VF when x or y is F.
+static void arithmetic(Chip8Ref* r, uint8_t x, uint8_t y, uint8_t op) {
+    uint8_t* V = r->V;
+    switch (op) {
+    case 0x0: V[x] = V[y]; break;
+    case 0x1: V[x] |= V[y]; if (logic_clears_vf(r)) V[0xF] = 0; break;
+    case 0x2: V[x] &= V[y]; if (logic_clears_vf(r)) V[0xF] = 0; break;
+    case 0x3: V[x] ^= V[y]; if (logic_clears_vf(r)) V[0xF] = 0; break;
+    case 0x4: {
+        unsigned sum = (unsigned)V[x] + V[y];
+        V[0xF] = sum > 0xFF;
+        V[x] = (uint8_t)sum;
+    } break;
+    case 0x5:
+        V[0xF] = V[x] > V[y];
+        V[x] = (uint8_t)(V[x] - V[y]);
+        break;
+    case 0x6:
+        if (shifts_read_vy(r)) {
+            uint8_t v = V[y];
+            V[0xF] = v & 1;
+            V[x] = (uint8_t)(v >> 1);
+        }
+        else {
+            V[0xF] = V[x] & 1;
+            V[x] = (uint8_t)(V[x] >> 1);
+        }
+        break;
+    case 0x7:
+        V[0xF] = V[y] > V[x];
+        V[x] = (uint8_t)(V[y] - V[x]);
+        break;
+    case 0xE:
+        if (shifts_read_vy(r)) {
+            uint8_t v = V[y];
+            V[0xF] = v >> 7;
+            V[x] = (uint8_t)(v << 1);
+        }
+        else {
+            V[0xF] = V[x] >> 7;
+            V[x] = (uint8_t)(V[x] << 1);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void misc(Chip8Ref* r, uint8_t x, uint8_t kk) {
+    switch (kk) {
+    case 0x00:
+        if (is_xo(r) && x == 0) {
+            r->I = read_word(r, r->pc);
+            r->pc = next_pc(r, r->pc + 2u);
+        }
+        break;
+    case 0x01:
+        if (is_xo(r)) r->planes = x & CHIP8_PLANES_ALL;
+        break;
+    case 0x02:
+        if (is_xo(r) && x == 0) {
+            for (int i = 0; i < CHIP8_AUDIO_PATTERN_SIZE; ++i) r->audio_pattern[i] = read_byte(r, r->I + (uint32_t)i);
+            r->audio_pattern_set = true;
+        }
+        break;
+    case 0x07: r->V[x] = r->delay_timer; break;
+    case 0x0A: {
+        int key = 0;
+        while (key < CHIP8_KEY_COUNT && !r->keys[key]) ++key;
+        if (key < CHIP8_KEY_COUNT) r->V[x] = (uint8_t)key;
+        else r->pc = next_pc(r, r->pc - 2u);   // wait: run this instruction again
+    } break;
+    case 0x15: r->delay_timer = r->V[x]; break;
+    case 0x18: r->sound_timer = r->V[x]; break;
+    case 0x1E: r->I = (uint16_t)(r->I + r->V[x]); break;
+    case 0x29: r->I = (uint16_t)(r->V[x] * 5); break;
+    case 0x30: r->I = (uint16_t)(0x50 + r->V[x] * 10); break;
+    case 0x33:
+        write_byte(r, r->I, (uint8_t)(r->V[x] / 100));
+        write_byte(r, r->I + 1u, (uint8_t)(r->V[x] / 10 % 10));
+        write_byte(r, r->I + 2u, (uint8_t)(r->V[x] % 10));
+        break;
+    case 0x3A:
+        if (is_xo(r)) r->pitch = r->V[x];
+        break;
+    case 0x55:
+        for (int i = 0; i <= x; ++i) write_byte(r, r->I + (uint32_t)i, r->V[i]);
+        r->I = (uint16_t)(r->I + load_store_advance(r, x));
+        break;
+    case 0x65:
+        for (int i = 0; i <= x; ++i) r->V[i] = read_byte(r, r->I + (uint32_t)i);
+        r->I = (uint16_t)(r->I + load_store_advance(r, x));
+        break;
+    default:
+        break;
+    }
+}
+
+void chip8_ref_step(Chip8Ref* r) {
+    if (!r->running) return;
+    r->cycle_count++;
+
+    uint16_t opcode = read_word(r, r->pc);
+    r->pc = next_pc(r, r->pc + 2u);
+
+    uint8_t  x = (opcode >> 8) & 0xF;
+    uint8_t  y = (opcode >> 4) & 0xF;
+    uint8_t  n = opcode & 0xF;
+    uint8_t  kk = opcode & 0xFF;
+    uint16_t nnn = opcode & 0xFFF;
+
+    switch (opcode >> 12) {
+    case 0x0:
+        if (opcode == 0x00E0) clear_screen(r);
+        else if (opcode == 0x00EE) {
+            if (r->sp > 0) r->pc = next_pc(r, r->stack[--r->sp]);
+        }
+        else if (opcode == 0x00FE || opcode == 0x00FF) {
+            r->high_res = opcode == 0x00FF;
+            clear_screen(r);
+        }
+        else if (opcode == 0x00FD) r->running = false;
+        else if (opcode == 0x00FB) scroll_horizontal(r, 4);
+        else if (opcode == 0x00FC) scroll_horizontal(r, -4);
+        else if ((opcode & 0xFFF0) == 0x00C0 && n) scroll_vertical(r, n);
+        else if ((opcode & 0xFFF0) == 0x00D0 && n && is_xo(r)) scroll_vertical(r, -n);
+        break;
+    case 0x1: r->pc = nnn; break;
+    case 0x2:
+        if (r->sp < CHIP8_STACK_SIZE) {
+            r->stack[r->sp++] = r->pc;
+            r->pc = nnn;
+        }
+        break;
+    case 0x3: if (r->V[x] == kk) skip(r); break;
+    case 0x4: if (r->V[x] != kk) skip(r); break;
+    case 0x5:
+        if (n == 0) {
+            if (r->V[x] == r->V[y]) skip(r);
+        }
+        else if (n == 2 && is_xo(r)) {   // Vx..Vy to I, descending if x > y
+            for (int i = 0, reg = x; ; ++i, reg += x <= y ? 1 : -1) {
+                write_byte(r, r->I + (uint32_t)i, r->V[reg]);
+                if (reg == y) break;
+            }
+        }
+        else if (n == 3 && is_xo(r)) {
+            for (int i = 0, reg = x; ; ++i, reg += x <= y ? 1 : -1) {
+                r->V[reg] = read_byte(r, r->I + (uint32_t)i);
+                if (reg == y) break;
+            }
+        }
+        break;
+    case 0x6: r->V[x] = kk; break;
+    case 0x7: r->V[x] = (uint8_t)(r->V[x] + kk); break;
+    case 0x8: arithmetic(r, x, y, n); break;
+    case 0x9: if (n == 0 && r->V[x] != r->V[y]) skip(r); break;
+    case 0xA: r->I = nnn; break;
+    case 0xB: r->pc = next_pc(r, (uint32_t)nnn + r->V[jump_adds_vx(r) ? x : 0]); break;
+    case 0xC: r->V[x] = random_byte(r) & kk; break;
+    case 0xD: draw_sprite(r, r->V[x], r->V[y], n); break;
+    case 0xE:
+        if (kk == 0x9E && r->keys[r->V[x] & 0xF]) skip(r);
+        else if (kk == 0xA1 && !r->keys[r->V[x] & 0xF]) skip(r);
+        break;
+    case 0xF: misc(r, x, kk); break;
+    }
+}
+
+void chip8_ref_tick_timers(Chip8Ref* ref) {
+    if (ref->delay_timer) ref->delay_timer--;
+    if (ref->sound_timer) ref->sound_timer--;
+}
+
+// 64 pixels as one word of Chip8's packed layout, leftmost in the top bit
+static uint64_t pack_word(const uint8_t* pixels) {
+    uint64_t word = 0;
+    for (int i = 0; i < 64; ++i) word = word << 1 | pixels[i];
+    return word;
+}
+
+// Display row y in Chip8's packed layout
+static void pack_row(const Chip8Ref* ref, int y, uint64_t row[CHIP8_ROW_WORDS]) {
+    for (int p = 0; p < CHIP8_DISPLAY_PLANES; ++p) {
+        for (int w = 0; w < CHIP8_DISPLAY_WORDS; ++w) {
+            row[p * CHIP8_DISPLAY_WORDS + w] = pack_word(&ref->pixels[p][y][w * 64]);
+        }
+    }
+}
+
+static void pack_display(const Chip8Ref* ref, uint64_t rows[CHIP8_HIGH_RES_HEIGHT][CHIP8_ROW_WORDS]) {
+    for (int y = 0; y < CHIP8_HIGH_RES_HEIGHT; ++y) pack_row(ref, y, rows[y]);
+}
+
+uint64_t chip8_ref_display_hash(const Chip8Ref* ref) {
+    uint64_t rows[CHIP8_HIGH_RES_HEIGHT][CHIP8_ROW_WORDS];
+    pack_display(ref, rows);
+    const uint8_t* bytes = (const uint8_t*)rows;
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < sizeof(rows); ++i) {
+        hash ^= (uint64_t)bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+// First pixel of the rows in `rows` that differs; false if none
+static bool find_pixel(const Chip8Ref* ref, const Chip8* c8, uint64_t rows, char* what, size_t size) {
+    const uint64_t* display = &c8->display[0][0];
+    for (int y = 0; y < CHIP8_HIGH_RES_HEIGHT; ++y) {
+        if (!(rows >> y & 1)) continue;
+        uint64_t packed[CHIP8_ROW_WORDS];
+        pack_row(ref, y, packed);
+        if (memcmp(packed, c8->display[y], sizeof(packed)) == 0) continue;
+        for (int x = 0; x < CHIP8_HIGH_RES_WIDTH; ++x) {
+            int color = chip8_pixel_color(display, x, y);
+            int expect = ref->pixels[0][y][x] | ref->pixels[1][y][x] << 1;
+            if (color != expect) {
+                snprintf(what, size, "pixel (%d, %d): reference colour %d, machine %d", x, y, expect, color);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+#define DIFFER(...) do { snprintf(what, size, __VA_ARGS__); return false; } while (0)
+
+bool chip8_ref_compare(Chip8Ref* ref, Chip8* c8, bool full, char* what, size_t size) {
+    uint64_t rows = full ? ~0ull : ref->touched_rows | c8->dirty_rows;
+    uint64_t stored[sizeof(ref->stored_pages) / sizeof(uint64_t)];
+    memcpy(stored, ref->stored_pages, sizeof(stored));
+    uint16_t dirty_pages = c8->dirty_pages;
+    ref->touched_rows = 0;
+    memset(ref->stored_pages, 0, sizeof(ref->stored_pages));
+    c8->dirty_rows = 0;
+    c8->dirty_pages = 0;
+
+    if (ref->cycle_count != c8->cycle_count) {
+        DIFFER("cycle_count: reference %llu, machine %llu",
+            (unsigned long long)ref->cycle_count, (unsigned long long)c8->cycle_count);
+    }
+    if (ref->running != c8->running) DIFFER("running: reference %d, machine %d", ref->running, c8->running);
+    if (ref->pc != c8->pc) DIFFER("pc: reference %04X, machine %04X", ref->pc, c8->pc);
+    if (ref->I != c8->I) DIFFER("I: reference %04X, machine %04X", ref->I, c8->I);
+    for (int r = 0; r < CHIP8_REGISTER_COUNT; ++r) {
+        if (ref->V[r] != c8->V[r]) DIFFER("V%X: reference %02X, machine %02X", r, ref->V[r], c8->V[r]);
+    }
+    if (ref->sp != c8->sp) DIFFER("sp: reference %u, machine %u", ref->sp, c8->sp);
+    for (int i = 0; i < CHIP8_STACK_SIZE; ++i) {
+        if (ref->stack[i] != c8->stack[i]) {
+            DIFFER("stack[%d]: reference %04X, machine %04X", i, ref->stack[i], c8->stack[i]);
+        }
+    }
+    if (ref->delay_timer != c8->delay_timer) {
+        DIFFER("delay timer: reference %u, machine %u", ref->delay_timer, c8->delay_timer);
+    }
+    if (ref->sound_timer != c8->sound_timer) {
+        DIFFER("sound timer: reference %u, machine %u", ref->sound_timer, c8->sound_timer);
+    }
+    if (ref->rng_state != c8->rng_state) DIFFER("RNG state");
+    if (ref->high_res != c8->high_res) DIFFER("high_res: reference %d, machine %d", ref->high_res, c8->high_res);
+    if (ref->planes != c8->planes) DIFFER("planes: reference %u, machine %u", ref->planes, c8->planes);
+    if (ref->pitch != c8->pitch) DIFFER("pitch: reference %u, machine %u", ref->pitch, c8->pitch);
+    if (ref->audio_pattern_set != c8->audio_pattern_set ||
+        memcmp(ref->audio_pattern, c8->audio_pattern, sizeof(ref->audio_pattern)) != 0) {
+        DIFFER("audio pattern");
+    }
+
+    // Pages either side stored to; the machine's dirty_pages bit p stands for every page
+    // congruent to p mod CHIP8_PAGE_COUNT
+    const uint8_t* machine = c8->memory;
+    if ((uint32_t)c8->addr_mask + 1 != ref->memory_size) DIFFER("memory size");
+    bool any_stored = dirty_pages != 0;
+    for (size_t i = 0; i < sizeof(stored) / sizeof(stored[0]); ++i) any_stored = any_stored || stored[i];
+    for (uint32_t page = 0; (full || any_stored) && page < ref->memory_size >> CHIP8_PAGE_SHIFT; ++page) {
+        if (!full && !(stored[page >> 6] >> (page & 63) & 1) && !(dirty_pages >> (page % CHIP8_PAGE_COUNT) & 1)) {
+            continue;
+        }
+        uint32_t base = page << CHIP8_PAGE_SHIFT;
+        if (memcmp(&ref->memory[base], &machine[base], 1u << CHIP8_PAGE_SHIFT) == 0) continue;
+        uint32_t a = base;
+        while (ref->memory[a] == machine[a]) ++a;
+        DIFFER("memory[%04X]: reference %02X, machine %02X", (unsigned)a, ref->memory[a], machine[a]);
+    }
+
+    if (full) {
+        if (chip8_ref_display_hash(ref) != chip8_display_hash(c8)) {
+            if (!find_pixel(ref, c8, ~0ull, what, size)) snprintf(what, size, "display hash");
+            return false;
+        }
+    }
+    else if (rows && find_pixel(ref, c8, rows, what, size)) {
+        return false;
+    }
+    return true;
+}
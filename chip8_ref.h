@@ -0,0 +1,59 @@
+// Reference interpreter for differential testing: a deliberately plain model of the CHIP-8,
+// Super CHIP-8 and XO-CHIP semantics, one byte per pixel and one if per quirk, that shares no
+// code with chip8.c. Engines are checked by running both from the same state and comparing.
+
+#ifndef CHIP8_REF_H
+#define CHIP8_REF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "chip8.h"
+
+typedef struct Chip8Ref {
+    uint8_t  V[CHIP8_REGISTER_COUNT];
+    uint16_t I;
+    uint16_t pc;
+    uint16_t stack[CHIP8_STACK_SIZE];
+    uint8_t  sp;
+    uint8_t  delay_timer;
+    uint8_t  sound_timer;
+    bool     keys[CHIP8_KEY_COUNT];
+    uint64_t rng_state;
+    uint64_t cycle_count;
+    bool     high_res;
+    bool     running;
+    uint8_t  quirks;
+    uint8_t  planes;
+    uint8_t  pitch;
+    bool     audio_pattern_set;
+    uint8_t  audio_pattern[CHIP8_AUDIO_PATTERN_SIZE];
+
+    uint8_t  pixels[CHIP8_DISPLAY_PLANES][CHIP8_HIGH_RES_HEIGHT][CHIP8_HIGH_RES_WIDTH];   // 0 or 1
+
+    // What steps touched since the last chip8_ref_compare, so it can skip the rest
+    uint64_t touched_rows;
+    uint64_t stored_pages[(CHIP8_XO_MEMORY_SIZE >> CHIP8_PAGE_SHIFT) / 64];   // bit per page
+
+    uint32_t memory_size;
+    uint8_t  memory[CHIP8_XO_MEMORY_SIZE];
+} Chip8Ref;
+
+// Copy the state of a machine (classic or XO-CHIP), e.g. right after its ROM was loaded
+void chip8_ref_load(Chip8Ref* ref, const Chip8* c8);
+
+// Execute one instruction; does nothing once the machine has halted
+void chip8_ref_step(Chip8Ref* ref);
+
+void chip8_ref_tick_timers(Chip8Ref* ref);
+
+// chip8_display_hash of the display this model holds
+uint64_t chip8_ref_display_hash(const Chip8Ref* ref);
+
+// Compare the state that decides how the machine runs on. `full` compares all of memory and
+// the display; otherwise only rows and memory either side touched since the last comparison
+// (the model's own record, and the machine's dirty_rows and dirty_pages, which this clears).
+// Returns false and describes the first difference in `what`.
+bool chip8_ref_compare(Chip8Ref* ref, Chip8* c8, bool full, char* what, size_t size);
+
+#endif // CHIP8_REF_H
@@ -0,0 +1,192 @@
+// Save state writer and memory-mapped loader.
+
+#include "chip8_state.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+_Static_assert(sizeof(Chip8StateHeader) % 8 == 0, "machine image must stay 8-byte aligned");
+
+#define FNV1A_OFFSET  0xCBF29CE484222325ull
+
+static uint64_t fnv1a(uint64_t hash, const uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+bool chip8_save_state(const Chip8* c8, const char* path) {
+    Chip8StateHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = CHIP8_STATE_MAGIC;
+    header.version = CHIP8_STATE_VERSION;
+    header.header_size = (uint16_t)sizeof(Chip8StateHeader);
+    header.machine_size = (uint32_t)chip8_machine_size(c8);
+
+    // The profiler pointer is host state: the image carries NULL in its place, so files do not
+    // depend on the build or leak a heap address. XO-CHIP memory past the Chip8 is written as is.
+    Chip8 core = *c8;
+    core.profile = NULL;
+    const uint8_t* high = (const uint8_t*)c8 + sizeof(Chip8);
+    size_t high_size = header.machine_size - sizeof(Chip8);
+    header.checksum = fnv1a(fnv1a(FNV1A_OFFSET, (const uint8_t*)&core, sizeof(core)), high, high_size);
+
+    FILE* f = NULL;
+#ifdef _MSC_VER
+    fopen_s(&f, path, "wb");
+#else
+    f = fopen(path, "wb");
+#endif
+    if (!f) {
+        fprintf(stderr, "Failed to create state file: %s\n", path);
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+        fwrite(&core, sizeof(core), 1, f) == 1 &&
+        (high_size == 0 || fwrite(high, high_size, 1, f) == 1);
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) {
+        fprintf(stderr, "Failed to write state file: %s\n", path);
+    }
+    return ok;
+}
+
+static bool validate(const Chip8StateMap* map, const char* path) {
+    const Chip8StateHeader* header = (const Chip8StateHeader*)map->base;
+
+    if (map->size < sizeof(Chip8StateHeader) || header->magic != CHIP8_STATE_MAGIC) {
+        fprintf(stderr, "Not a CHIP-8 state file: %s\n", path);
+        return false;
+    }
+    if (header->version != CHIP8_STATE_VERSION ||
+        header->header_size != sizeof(Chip8StateHeader) ||
+        (header->machine_size != sizeof(Chip8) && header->machine_size != sizeof(Chip8Xo))) {
+        fprintf(stderr, "Incompatible state file version or layout: %s\n", path);
+        return false;
+    }
+    if (map->size < sizeof(Chip8StateHeader) + header->machine_size) {
+        fprintf(stderr, "Truncated state file: %s\n", path);
+        return false;
+    }
+    if (fnv1a(FNV1A_OFFSET, map->base + sizeof(Chip8StateHeader), header->machine_size) != header->checksum) {
+        fprintf(stderr, "State file checksum mismatch: %s\n", path);
+        return false;
+    }
+
+    // The image is copied into a live machine as is: fields that index arrays or size memory
+    // must agree with the machine they describe.
+    const Chip8* image = (const Chip8*)(map->base + sizeof(Chip8StateHeader));
+    bool xo = header->machine_size == sizeof(Chip8Xo);
+    if (image->sp > CHIP8_STACK_SIZE ||
+        image->quirks >= CHIP8_QUIRKS_COUNT ||
+        (image->quirks == CHIP8_QUIRKS_XOCHIP) != xo ||
+        image->planes > CHIP8_PLANES_ALL ||
+        image->addr_mask != (xo ? CHIP8_XO_ADDR_MASK : CHIP8_ADDR_MASK) ||
+        image->rng_state == 0) {
+        fprintf(stderr, "Corrupt machine state in state file: %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+bool chip8_state_map_open(Chip8StateMap* map, const char* path) {
+    memset(map, 0, sizeof(*map));
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "Failed to open state file: %s\n", path);
+        return false;
+    }
+    LARGE_INTEGER size;
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!view) {
+        fprintf(stderr, "Failed to map state file: %s\n", path);
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    map->file = file;
+    map->mapping = mapping;
+    map->base = (const uint8_t*)view;
+    map->size = (size_t)size.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open state file: %s\n", path);
+        return false;
+    }
+    struct stat st;
+    void* view = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (view == MAP_FAILED) {
+        fprintf(stderr, "Failed to map state file: %s\n", path);
+        return false;
+    }
+    map->base = (const uint8_t*)view;
+    map->size = (size_t)st.st_size;
+#endif
+
+    if (!validate(map, path)) {
+        chip8_state_map_close(map);
+        return false;
+    }
+    map->image = (const Chip8*)(map->base + sizeof(Chip8StateHeader));
+    map->machine_size = ((const Chip8StateHeader*)map->base)->machine_size;
+    return true;
+}
+
+void chip8_state_restore(const Chip8StateMap* map, Chip8* c8) {
+    struct Chip8Profile* profile = c8->profile;
+    memcpy(c8, map->image, map->machine_size);
+    c8->profile = profile;
+    // The restored frame has never been shown by this host.
+    c8->dirty_rows = ~0ull;
+    c8->dirty_pages = 0xFFFF;
+    c8->draw_flag = true;
+}
+
+void chip8_state_map_close(Chip8StateMap* map) {
+    if (map->base) {
+#ifdef _WIN32
+        UnmapViewOfFile(map->base);
+        CloseHandle((HANDLE)map->mapping);
+        CloseHandle((HANDLE)map->file);
+#else
+        munmap((void*)map->base, map->size);
+#endif
+    }
+    memset(map, 0, sizeof(*map));
+}
+
+bool chip8_load_state(Chip8* c8, const char* path) {
+    Chip8StateMap map;
+    if (!chip8_state_map_open(&map, path)) return false;
+    if (map.machine_size > chip8_machine_size(c8)) {
+        fprintf(stderr, "XO-CHIP state needs an XO-CHIP machine: %s\n", path);
+        chip8_state_map_close(&map);
+        return false;
+    }
+    chip8_state_restore(&map, c8);
+    chip8_state_map_close(&map);
+    return true;
+}
@@ -0,0 +1,55 @@
+// Versioned, checksummed binary save states. A state file is a small header followed by the
+// raw Chip8 (or Chip8Xo) struct, so a memory-mapped file restores with a single copy and no
+// parsing.
+
+#ifndef CHIP8_STATE_H
+#define CHIP8_STATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "chip8.h"
+
+#define CHIP8_STATE_MAGIC    0x54533843u   // "C8ST" in file byte order on little-endian hosts
+#define CHIP8_STATE_VERSION  6             // bump whenever the Chip8 struct layout changes
+
+typedef struct Chip8StateHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;    // sizeof(Chip8StateHeader); the machine image follows it
+    uint32_t machine_size;   // chip8_machine_size of the saved machine (Chip8 or Chip8Xo)
+    uint32_t reserved;
+    uint64_t checksum;       // FNV-1a over the machine image
+} Chip8StateHeader;
+
+// A validated, read-only mapping of a state file
+typedef struct Chip8StateMap {
+    const uint8_t* base;
+    size_t         size;
+    const Chip8*   image;
+    size_t         machine_size;   // bytes restore copies: sizeof(Chip8) or sizeof(Chip8Xo)
+#ifdef _WIN32
+    void*          file;
+    void*          mapping;
+#endif
+} Chip8StateMap;
+
+// Write the full machine (memory, registers, stack, timers, display, mode) to path
+bool chip8_save_state(const Chip8* c8, const char* path);
+
+// Map, validate and restore a state file in one call. c8 must be initialized, so its kind is
+// known; an XO-CHIP state only restores into a Chip8Xo.
+bool chip8_load_state(Chip8* c8, const char* path);
+
+// Map a state file and validate header and checksum once.
+// Returns false (with a message on stderr) on any mismatch.
+bool chip8_state_map_open(Chip8StateMap* map, const char* path);
+
+// Restore a validated mapping into c8. This is a plain copy, cheap enough to repeat for
+// every warm start. Engines bound to c8 must be reset afterwards (chip8_engine_reset).
+// c8 must have room for map->machine_size bytes: pass &xo->base when it is sizeof(Chip8Xo).
+void chip8_state_restore(const Chip8StateMap* map, Chip8* c8);
+
+void chip8_state_map_close(Chip8StateMap* map);
+
+#endif // CHIP8_STATE_H
@@ -0,0 +1,388 @@
+// Predecoded, threaded-dispatch interpreter. Uses computed goto on GCC/Clang and falls back
+// to a switch over the same predecoded records elsewhere.
+
+#include "chip8_threaded.h"
+#include "chip8_internal.h"
+#include "chip8_profile.h"
+#include <string.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define THREADED_GOTO 1
+#else
+#define THREADED_GOTO 0
+#endif
+
+#define THREADED_HANDLERS(X) \
+    X(DECODE) X(NOP) X(CLS) X(RET) X(LOW) X(HIGH) X(EXIT) X(SCR) X(SCL) X(SCD) \
+    X(JP) X(CALL) X(SE_IMM) X(SNE_IMM) X(SE_REG) X(LD_IMM) X(ADD_IMM) \
+    X(LD_REG) X(OR) X(AND) X(XOR) X(ADD_REG) X(SUB) X(SHR) X(SUBN) X(SHL) X(SNE_REG) \
+    X(LD_I) X(JP_V0) X(RND) X(DRW) X(SKP) X(SKNP) \
+    X(LD_VX_DT) X(LD_VX_K) X(LD_DT) X(LD_ST) X(ADD_I) X(LD_F) X(LD_HF) \
+    X(BCD) X(STORE) X(LOAD) \
+    X(OR_VF) X(AND_VF) X(XOR_VF) X(SHR_VY) X(SHL_VY) X(JP_VX) X(DRW_CLIP) \
+    X(STORE_ADV) X(LOAD_ADV)
+
+#define HANDLER_ENUM(name) OP_##name,
+typedef enum Chip8ThreadedHandler {
+    THREADED_HANDLERS(HANDLER_ENUM)
+    OP_COUNT
+} Chip8ThreadedHandler;
+#undef HANDLER_ENUM
+
+void chip8_threaded_init(Chip8Threaded* t) {
+    memset(t->ops, 0, sizeof(t->ops));   // OP_DECODE == 0
+    t->quirks = CHIP8_QUIRKS_MODERN;
+}
+
+void chip8_threaded_invalidate(Chip8Threaded* t, uint16_t addr, uint16_t len) {
+    for (uint16_t i = 0; i < len; ++i) {
+        uint16_t a = (uint16_t)((addr + i) & CHIP8_ADDR_MASK);
+        // The record at a-1 covers this byte as its low opcode byte.
+        t->ops[a].handler = OP_DECODE;
+        t->ops[(a - 1) & CHIP8_ADDR_MASK].handler = OP_DECODE;
+    }
+}
+
+// Decode the opcode at addr into *op, mirroring the switch in chip8_cycle. Quirky opcodes
+// get the handler variant of the machine's profile.
+static void decode(Chip8DecodedOp* op, const Chip8* c8, uint16_t addr) {
+    uint16_t opcode = (uint16_t)c8->memory[addr] << 8 |
+        (uint16_t)c8->memory[(addr + 1) & CHIP8_ADDR_MASK];
+    const Chip8QuirkFlags* q = &chip8_quirk_flags[c8->quirks];
+
+    op->x = (opcode & 0x0F00) >> 8;
+    op->y = (opcode & 0x00F0) >> 4;
+    op->n = (opcode & 0x000F);
+    op->arg = (opcode & 0x0FFF);
+
+    uint8_t h = OP_NOP;
+    switch (opcode & 0xF000) {
+    case 0x0000:
+        switch (opcode) {
+        case 0x00E0: h = OP_CLS;  break;
+        case 0x00EE: h = OP_RET;  break;
+        case 0x00FE: h = OP_LOW;  break;
+        case 0x00FF: h = OP_HIGH; break;
+        case 0x00FD: h = OP_EXIT; break;
+        case 0x00FB: h = OP_SCR;  break;
+        case 0x00FC: h = OP_SCL;  break;
+        default:
+            if ((opcode & 0xFFF0) == 0x00C0) h = OP_SCD;
+            break;
+        }
+        break;
+    case 0x1000: h = OP_JP; break;
+    case 0x2000: h = OP_CALL; break;
+    case 0x3000: h = OP_SE_IMM; break;
+    case 0x4000: h = OP_SNE_IMM; break;
+    case 0x5000: if (op->n == 0) h = OP_SE_REG; break;
+    case 0x6000: h = OP_LD_IMM; break;
+    case 0x7000: h = OP_ADD_IMM; break;
+    case 0x8000:
+        switch (op->n) {
+        case 0x0: h = OP_LD_REG;  break;
+        case 0x1: h = q->vf_reset ? OP_OR_VF : OP_OR;   break;
+        case 0x2: h = q->vf_reset ? OP_AND_VF : OP_AND; break;
+        case 0x3: h = q->vf_reset ? OP_XOR_VF : OP_XOR; break;
+        case 0x4: h = OP_ADD_REG; break;
+        case 0x5: h = OP_SUB;     break;
+        case 0x6: h = q->shift_vy ? OP_SHR_VY : OP_SHR; break;
+        case 0x7: h = OP_SUBN;    break;
+        case 0xE: h = q->shift_vy ? OP_SHL_VY : OP_SHL; break;
+        default: break;
+        }
+        break;
+    case 0x9000: if (op->n == 0) h = OP_SNE_REG; break;
+    case 0xA000: h = OP_LD_I; break;
+    case 0xB000: h = q->jump_vx ? OP_JP_VX : OP_JP_V0; break;
+    case 0xC000: h = OP_RND; break;
+    case 0xD000: h = q->clip ? OP_DRW_CLIP : OP_DRW; break;
+    case 0xE000:
+        switch (opcode & 0x00FF) {
+        case 0x9E: h = OP_SKP;  break;
+        case 0xA1: h = OP_SKNP; break;
+        default: break;
+        }
+        break;
+    case 0xF000:
+        switch (opcode & 0x00FF) {
+        case 0x07: h = OP_LD_VX_DT; break;
+        case 0x0A: h = OP_LD_VX_K;  break;
+        case 0x15: h = OP_LD_DT;    break;
+        case 0x18: h = OP_LD_ST;    break;
+        case 0x1E: h = OP_ADD_I;    break;
+        case 0x29: h = OP_LD_F;     break;
+        case 0x30: h = OP_LD_HF;    break;
+        case 0x33: h = OP_BCD;      break;
+        case 0x55: h = q->memory_i ? OP_STORE_ADV : OP_STORE; break;
+        case 0x65: h = q->memory_i ? OP_LOAD_ADV : OP_LOAD;   break;
+        default: break;
+        }
+        break;
+    default:
+        break;
+    }
+    if (h == OP_STORE_ADV || h == OP_LOAD_ADV) op->arg = (uint16_t)(op->x + q->memory_i - 1);
+    op->handler = h;
+}
+
+uint32_t chip8_threaded_run(Chip8Threaded* t, Chip8* c8, uint32_t cycles) {
+    if (!c8->running || cycles == 0) return 0;
+    if (c8->quirks == CHIP8_QUIRKS_XOCHIP) return chip8_run(c8, cycles);
+    if (t->quirks != c8->quirks) {
+        chip8_threaded_init(t);
+        t->quirks = c8->quirks;
+    }
+
+    Chip8DecodedOp* ops = t->ops;
+    uint8_t* V = c8->V;
+    uint16_t pc = c8->pc & CHIP8_ADDR_MASK;
+    uint32_t left = cycles;
+    Chip8DecodedOp* op;
+
+#if THREADED_GOTO
+#define HANDLER_LABEL(name) &&L_##name,
+    static const void* const labels[OP_COUNT] = { THREADED_HANDLERS(HANDLER_LABEL) };
+#undef HANDLER_LABEL
+#define DISPATCH() goto *labels[op->handler]
+#define HANDLER(name) L_##name:
+#else
+#define DISPATCH() goto dispatch
+#define HANDLER(name) case OP_##name:
+#endif
+
+#define FETCH() do { \
+        op = &ops[pc]; \
+        CHIP8_PROFILE_INSTR(c8, pc, (uint16_t)(c8->memory[pc] << 8 | c8->memory[(pc + 1) & CHIP8_ADDR_MASK])); \
+        pc = (pc + 2) & CHIP8_ADDR_MASK; \
+    } while (0)
+#define NEXT() do { if (--left == 0) goto done; FETCH(); DISPATCH(); } while (0)
+#define SKIP_IF(cond) do { if (cond) pc = (pc + 2) & CHIP8_ADDR_MASK; } while (0)
+#define IDLE_SKIP() do { left -= chip8_idle_skip(c8, pc, left - 1); } while (0)
+#define KK ((uint8_t)op->arg)
+
+    FETCH();
+#if THREADED_GOTO
+    DISPATCH();
+#else
+dispatch:
+    switch (op->handler) {
+#endif
+
+    HANDLER(DECODE)
+        decode(op, c8, (uint16_t)((pc - 2) & CHIP8_ADDR_MASK));
+        DISPATCH();
+    HANDLER(NOP)
+        NEXT();
+    HANDLER(CLS)
+        chip8_clear_display(c8);
+        NEXT();
+    HANDLER(RET)
+        if (c8->sp > 0) {
+            c8->sp--;
+            pc = c8->stack[c8->sp] & CHIP8_ADDR_MASK;
+        }
+        NEXT();
+    HANDLER(LOW)
+        c8->high_res = false;
+        chip8_clear_display(c8);
+        NEXT();
+    HANDLER(HIGH)
+        c8->high_res = true;
+        chip8_clear_display(c8);
+        NEXT();
+    HANDLER(EXIT)
+        c8->running = false;
+        left--;
+        goto done;
+    HANDLER(SCR)
+        chip8_scroll_right(c8);
+        NEXT();
+    HANDLER(SCL)
+        chip8_scroll_left(c8);
+        NEXT();
+    HANDLER(SCD)
+        chip8_scroll_down(c8, op->n);
+        NEXT();
+    HANDLER(JP)
+        // Backward jumps may close an idle loop
+        if (op->arg <= ((pc - 2) & CHIP8_ADDR_MASK)) {
+            pc = op->arg;
+            IDLE_SKIP();
+            NEXT();
+        }
+        pc = op->arg;
+        NEXT();
+    HANDLER(CALL)
+        if (c8->sp < CHIP8_STACK_SIZE) {
+            c8->stack[c8->sp] = pc;
+            c8->sp++;
+            pc = op->arg;
+        }
+        NEXT();
+    HANDLER(SE_IMM)
+        SKIP_IF(V[op->x] == KK);
+        NEXT();
+    HANDLER(SNE_IMM)
+        SKIP_IF(V[op->x] != KK);
+        NEXT();
+    HANDLER(SE_REG)
+        SKIP_IF(V[op->x] == V[op->y]);
+        NEXT();
+    HANDLER(LD_IMM)
+        V[op->x] = KK;
+        NEXT();
+    HANDLER(ADD_IMM)
+        V[op->x] += KK;
+        NEXT();
+    HANDLER(LD_REG)
+        V[op->x] = V[op->y];
+        NEXT();
+    HANDLER(OR)
+        V[op->x] |= V[op->y];
+        NEXT();
+    HANDLER(AND)
+        V[op->x] &= V[op->y];
+        NEXT();
+    HANDLER(XOR)
+        V[op->x] ^= V[op->y];
+        NEXT();
+    HANDLER(ADD_REG) {
+        uint16_t sum = V[op->x] + V[op->y];
+        V[0xF] = sum > 0xFF;
+        V[op->x] = (uint8_t)(sum & 0xFF);
+    }
+        NEXT();
+    HANDLER(SUB)
+        V[0xF] = V[op->x] > V[op->y];
+        V[op->x] = (uint8_t)(V[op->x] - V[op->y]);
+        NEXT();
+    HANDLER(SHR)
+        V[0xF] = V[op->x] & 0x1;
+        V[op->x] >>= 1;
+        NEXT();
+    HANDLER(SUBN)
+        V[0xF] = V[op->y] > V[op->x];
+        V[op->x] = (uint8_t)(V[op->y] - V[op->x]);
+        NEXT();
+    HANDLER(SHL)
+        V[0xF] = (V[op->x] & 0x80) >> 7;
+        V[op->x] <<= 1;
+        NEXT();
+    HANDLER(SNE_REG)
+        SKIP_IF(V[op->x] != V[op->y]);
+        NEXT();
+    HANDLER(LD_I)
+        c8->I = op->arg;
+        NEXT();
+    HANDLER(JP_V0)
+        pc = (op->arg + V[0]) & CHIP8_ADDR_MASK;
+        NEXT();
+    HANDLER(RND)
+        V[op->x] = (uint8_t)(chip8_random_byte(c8) & KK);
+        NEXT();
+    HANDLER(DRW)
+        chip8_draw_sprite(c8, V[op->x], V[op->y], op->n);
+        NEXT();
+    HANDLER(SKP)
+        SKIP_IF(c8->keys[V[op->x] & 0xF]);
+        NEXT();
+    HANDLER(SKNP)
+        SKIP_IF(!c8->keys[V[op->x] & 0xF]);
+        NEXT();
+    HANDLER(LD_VX_DT)
+        V[op->x] = c8->delay_timer;
+        NEXT();
+    HANDLER(LD_VX_K)
+        if (!chip8_wait_key(c8, op->x)) {
+            pc = (pc - 2) & CHIP8_ADDR_MASK;
+            IDLE_SKIP();
+        }
+        NEXT();
+    HANDLER(LD_DT)
+        c8->delay_timer = V[op->x];
+        NEXT();
+    HANDLER(LD_ST)
+        c8->sound_timer = V[op->x];
+        NEXT();
+    HANDLER(ADD_I)
+        c8->I += V[op->x];
+        NEXT();
+    HANDLER(LD_F)
+        c8->I = (uint16_t)(V[op->x] * 5);
+        NEXT();
+    HANDLER(LD_HF)
+        c8->I = (uint16_t)(0x50 + (V[op->x] * 10));
+        NEXT();
+    HANDLER(BCD)
+        chip8_store_bcd(c8, op->x);
+        chip8_threaded_invalidate(t, c8->I, 3);
+        NEXT();
+    HANDLER(STORE)
+        chip8_store_registers(c8, op->x);
+        chip8_threaded_invalidate(t, c8->I, (uint16_t)(op->x + 1));
+        NEXT();
+    HANDLER(LOAD)
+        chip8_load_registers(c8, op->x);
+        NEXT();
+
+    // Quirk profile variants (see decode)
+    HANDLER(OR_VF)
+        V[op->x] |= V[op->y];
+        V[0xF] = 0;
+        NEXT();
+    HANDLER(AND_VF)
+        V[op->x] &= V[op->y];
+        V[0xF] = 0;
+        NEXT();
+    HANDLER(XOR_VF)
+        V[op->x] ^= V[op->y];
+        V[0xF] = 0;
+        NEXT();
+    HANDLER(SHR_VY) {
+        uint8_t v = V[op->y];
+        V[0xF] = v & 0x1;
+        V[op->x] = (uint8_t)(v >> 1);
+    }
+        NEXT();
+    HANDLER(SHL_VY) {
+        uint8_t v = V[op->y];
+        V[0xF] = (v & 0x80) >> 7;
+        V[op->x] = (uint8_t)(v << 1);
+    }
+        NEXT();
+    HANDLER(JP_VX)
+        pc = (op->arg + V[op->x]) & CHIP8_ADDR_MASK;
+        NEXT();
+    HANDLER(DRW_CLIP)
+        chip8_draw_sprite_clipped(c8, V[op->x], V[op->y], op->n);
+        NEXT();
+    HANDLER(STORE_ADV)
+        chip8_store_registers(c8, op->x);
+        chip8_threaded_invalidate(t, c8->I, (uint16_t)(op->x + 1));
+        c8->I = (uint16_t)(c8->I + op->arg);
+        NEXT();
+    HANDLER(LOAD_ADV)
+        chip8_load_registers(c8, op->x);
+        c8->I = (uint16_t)(c8->I + op->arg);
+        NEXT();
+
+#if !THREADED_GOTO
+    default:
+        NEXT();
+    }
+#endif
+
+#undef DISPATCH
+#undef HANDLER
+#undef FETCH
+#undef NEXT
+#undef SKIP_IF
+#undef IDLE_SKIP
+#undef KK
+
+done:
+    c8->pc = pc;
+    c8->cycle_count += cycles - left;
+    return cycles - left;
+}
@@ -0,0 +1,38 @@
+// Predecoded, threaded-dispatch CHIP-8 interpreter.
+// Every address in memory[] is decoded once into a compact record (handler plus operands);
+// records are rebuilt lazily and only invalidated when Fx33/Fx55 write into them. Decoding
+// picks the handler variant of the machine's quirk profile, so handlers never test quirks.
+
+#ifndef CHIP8_THREADED_H
+#define CHIP8_THREADED_H
+
+#include <stdint.h>
+#include "chip8.h"
+
+typedef struct Chip8DecodedOp {
+    uint8_t  handler;   // Chip8ThreadedHandler, 0 = not decoded yet
+    uint8_t  x;
+    uint8_t  y;
+    uint8_t  n;
+    uint16_t arg;       // kk or nnn depending on handler; I advance for STORE_ADV/LOAD_ADV
+} Chip8DecodedOp;
+
+// Decode cache for one machine. Bind one cache to one Chip8.
+typedef struct Chip8Threaded {
+    Chip8DecodedOp ops[CHIP8_MEMORY_SIZE];
+    uint8_t quirks;   // Chip8Quirks the records were decoded for
+} Chip8Threaded;
+
+// Mark every address as undecoded
+void chip8_threaded_init(Chip8Threaded* t);
+
+// Drop decoded records that cover memory[addr, addr + len). Call after writing memory
+// outside the engine (ROM load, state restore, another engine running on the machine).
+void chip8_threaded_invalidate(Chip8Threaded* t, uint16_t addr, uint16_t len);
+
+// Execute up to `cycles` instructions with the same semantics as chip8_cycle.
+// Returns the number of instructions executed. Records cover the 4 KB of classic machines;
+// XO-CHIP machines are handed to chip8_run.
+uint32_t chip8_threaded_run(Chip8Threaded* t, Chip8* c8, uint32_t cycles);
+
+#endif // CHIP8_THREADED_H
@@ -0,0 +1,777 @@
+// Execution trace recorder: traced interpreter loops, the writer thread and the reader.
+//
+// Chunk encoding: one tag byte per record, then the fields the tag names, little-endian.
+// A field is left out when it matches the prediction from the previous record: the cycle
+// after, the next pc, the opcode last seen at that pc in this chunk, unchanged I and V.
+// The encoded chunk is then LZ-compressed (LZ4-style sequences: a token of literal and
+// match lengths, the literals, a 16-bit offset) unless that does not make it smaller.
+
+#include "chip8_trace.h"
+#include "chip8_internal.h"
+#include "chip8_profile.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define TAG_CYCLE   0x01   // zigzag varint: cycle - (previous cycle + 1)
+#define TAG_PC      0x02   // u16 pc
+#define TAG_OPCODE  0x04   // u16 opcode
+#define TAG_I       0x08   // u16 I
+#define TAG_REG     0x10   // one register changed: u8 index, u8 value
+#define TAG_REGS    0x20   // several: u16 mask, then the values in register order
+#define TAG_STORE   0x40   // u16 address, u8 length, the bytes
+
+#define RECORD_MAX_BYTES  64     // longest encoding of one record
+#define LZ_HASH_BITS      12
+#define LZ_MIN_MATCH      4
+#define LZ_MAX_OFFSET     65535
+#define WRITER_IDLE_NS    20000ull       // writer poll interval while the ring is empty
+#define WRITER_CUT_NS     250000000ull   // an idle writer ends a chunk this old
+#define STALL_WAIT_NS     10000ull
+
+#define NO_CHUNK          UINT32_MAX
+
+// ---------------------------------------------------------------------------------------------
+// Recording
+
+// One specialized interpreter per quirk profile, driven by the traced loop below
+#define QUIRK_CYCLE_ONLY
+
+#define QUIRK_PROFILE CHIP8_QUIRKS_MODERN
+#define QUIRK_SUFFIX  modern
+#include "chip8_cycle_impl.h"
+
+#define QUIRK_PROFILE CHIP8_QUIRKS_VIP
+#define QUIRK_SUFFIX  vip
+#include "chip8_cycle_impl.h"
+
+#define QUIRK_PROFILE CHIP8_QUIRKS_CHIP48
+#define QUIRK_SUFFIX  chip48
+#include "chip8_cycle_impl.h"
+
+#define QUIRK_PROFILE CHIP8_QUIRKS_SCHIP
+#define QUIRK_SUFFIX  schip
+#include "chip8_cycle_impl.h"
+
+#define QUIRK_PROFILE CHIP8_QUIRKS_XOCHIP
+#define QUIRK_SUFFIX  xochip
+#include "chip8_cycle_impl.h"
+
+#undef QUIRK_CYCLE_ONLY
+
+static void publish_block(Chip8Trace* t) {
+    spsc_ring_commit(&t->ring);
+    t->block = NULL;
+}
+
+// Free slot for the next block, waiting for the writer if the ring is full
+static Chip8TraceBlock* claim_block(Chip8Trace* t) {
+    Chip8TraceBlock* b;
+    while (!(b = (Chip8TraceBlock*)spsc_ring_claim(&t->ring))) {
+        t->stalls++;
+        host_sleep_until_ns(host_time_ns() + STALL_WAIT_NS);
+    }
+    b->count = 0;
+    t->block = b;
+    return b;
+}
+
+// `cycle` and the masks are constants at each call site, so every profile gets its own loop
+// with the interpreter inlined. Registers are recorded after the instruction; the writer
+// works out which changed. Stores are found from the opcode and I before it.
+static inline uint32_t trace_loop(Chip8Trace* t, Chip8* c8, uint32_t cycles,
+    void (*cycle)(Chip8*), uint16_t mask, bool xo) {
+    uint32_t executed = 0;
+    while (executed < cycles && c8->running) {
+        Chip8TraceBlock* b = t->block ? t->block : claim_block(t);
+        uint32_t n = b->count;
+        uint32_t end = n + (cycles - executed < CHIP8_TRACE_BLOCK_RECORDS - n ?
+            cycles - executed : CHIP8_TRACE_BLOCK_RECORDS - n);
+        uint32_t start = n;
+
+        for (; n < end && c8->running; ++n) {
+            Chip8TraceRecord* rec = &b->records[n];
+            uint16_t pc = c8->pc & mask;
+            uint16_t I = c8->I;
+            uint16_t opcode = (uint16_t)(c8->memory[pc] << 8 | c8->memory[(pc + 1) & mask]);
+            cycle(c8);
+
+            rec->cycle = c8->cycle_count;
+            rec->pc = pc;
+            rec->opcode = opcode;
+            rec->I = c8->I;
+            rec->store_len = 0;
+            memcpy(rec->V, c8->V, CHIP8_REGISTER_COUNT);
+
+            uint8_t len = chip8_store_length(opcode, xo);
+            if (len) {
+                rec->store_addr = I & mask;
+                rec->store_len = len;
+                for (uint8_t i = 0; i < len; ++i) rec->stored[i] = c8->memory[(I + i) & mask];
+            }
+        }
+        b->count = n;
+        executed += n - start;
+        if (n == CHIP8_TRACE_BLOCK_RECORDS) publish_block(t);
+    }
+    return executed;
+}
+
+uint32_t chip8_trace_run(Chip8Trace* t, Chip8* c8, uint32_t cycles) {
+    switch (c8->quirks) {
+    case CHIP8_QUIRKS_VIP:    return trace_loop(t, c8, cycles, cycle_vip, CHIP8_ADDR_MASK, false);
+    case CHIP8_QUIRKS_CHIP48: return trace_loop(t, c8, cycles, cycle_chip48, CHIP8_ADDR_MASK, false);
+    case CHIP8_QUIRKS_SCHIP:  return trace_loop(t, c8, cycles, cycle_schip, CHIP8_ADDR_MASK, false);
+    case CHIP8_QUIRKS_XOCHIP: return trace_loop(t, c8, cycles, cycle_xochip, CHIP8_XO_ADDR_MASK, true);
+    default:                  return trace_loop(t, c8, cycles, cycle_modern, CHIP8_ADDR_MASK, false);
+    }
+}
+
+void chip8_trace_flush(Chip8Trace* t) {
+    if (t->block && t->block->count) publish_block(t);
+}
+
+// ---------------------------------------------------------------------------------------------
+// LZ compression
+
+static uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint8_t* put_length(uint8_t* out, uint32_t extra) {
+    while (extra >= 255) {
+        *out++ = 255;
+        extra -= 255;
+    }
+    *out++ = (uint8_t)extra;
+    return out;
+}
+
+static uint8_t* put_sequence(uint8_t* out, const uint8_t* literals, uint32_t lit_len,
+    uint32_t offset, uint32_t match_len) {
+    uint32_t m = match_len ? match_len - LZ_MIN_MATCH : 0;
+    *out++ = (uint8_t)((lit_len < 15 ? lit_len : 15) << 4 | (m < 15 ? m : 15));
+    if (lit_len >= 15) out = put_length(out, lit_len - 15);
+    memcpy(out, literals, lit_len);
+    out += lit_len;
+    if (!match_len) return out;
+    *out++ = (uint8_t)offset;
+    *out++ = (uint8_t)(offset >> 8);
+    if (m >= 15) out = put_length(out, m - 15);
+    return out;
+}
+
+// Compress src into dst, which must hold n + n / 255 + 16 bytes. Returns the packed size.
+// Like LZ4, the search steps further after each run of misses, so incompressible stretches
+// cost little.
+static uint32_t lz_compress(const uint8_t* src, uint32_t n, uint8_t* dst, uint32_t* table) {
+    memset(table, 0, sizeof(uint32_t) << LZ_HASH_BITS);
+    uint8_t* out = dst;
+    uint32_t anchor = 0;
+    uint32_t i = 0;
+    uint32_t misses = 0;
+    while (i + LZ_MIN_MATCH <= n) {
+        uint32_t seq = read32(src + i);
+        uint32_t h = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+        uint32_t candidate = table[h];
+        table[h] = i + 1;
+        if (!candidate || i - (candidate - 1) > LZ_MAX_OFFSET || read32(src + candidate - 1) != seq) {
+            i += 1 + (misses++ >> 5);
+            continue;
+        }
+        misses = 0;
+        uint32_t from = candidate - 1;
+        uint32_t len = LZ_MIN_MATCH;
+        while (i + len < n && src[from + len] == src[i + len]) ++len;
+        out = put_sequence(out, src + anchor, i - anchor, i - from, len);
+        i += len;
+        anchor = i;
+    }
+    out = put_sequence(out, src + anchor, n - anchor, 0, 0);
+    return (uint32_t)(out - dst);
+}
+
+static bool get_length(const uint8_t* src, uint32_t n, uint32_t* ip, uint32_t* len) {
+    uint8_t b;
+    do {
+        if (*ip >= n) return false;
+        b = src[(*ip)++];
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+// Inverse of lz_compress; false unless src decodes to exactly `size` bytes
+static bool lz_decompress(const uint8_t* src, uint32_t n, uint8_t* dst, uint32_t size) {
+    uint32_t ip = 0;
+    uint32_t op = 0;
+    while (ip < n) {
+        uint8_t token = src[ip++];
+        uint32_t lit_len = token >> 4;
+        if (lit_len == 15 && !get_length(src, n, &ip, &lit_len)) return false;
+        if (lit_len > n - ip || lit_len > size - op) return false;
+        memcpy(dst + op, src + ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+        if (ip == n) break;
+
+        if (n - ip < 2) return false;
+        uint32_t offset = src[ip] | (uint32_t)src[ip + 1] << 8;
+        ip += 2;
+        uint32_t len = token & 15;
+        if (len == 15 && !get_length(src, n, &ip, &len)) return false;
+        len += LZ_MIN_MATCH;
+        if (offset == 0 || offset > op || len > size - op) return false;
+        for (uint32_t k = 0; k < len; ++k, ++op) dst[op] = dst[op - offset];
+    }
+    return op == size;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Record encoding, shared by the writer and the reader
+
+static uint8_t* put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+// Bit k set when byte k (in memory order on little-endian hosts) of x is non-zero
+static uint32_t nonzero_bytes(uint64_t x) {
+    x = (((x & 0x7F7F7F7F7F7F7F7Full) + 0x7F7F7F7F7F7F7F7Full) | x) & 0x8080808080808080ull;
+    return (uint32_t)((x >> 7) * 0x0102040810204080ull >> 56);
+}
+
+// Bit r set when register r differs
+static uint16_t register_diff(const uint8_t* a, const uint8_t* b) {
+    uint64_t a0, a1, b0, b1;
+    memcpy(&a0, a, 8);
+    memcpy(&a1, a + 8, 8);
+    memcpy(&b0, b, 8);
+    memcpy(&b1, b + 8, 8);
+    return (uint16_t)(nonzero_bytes(a0 ^ b0) | nonzero_bytes(a1 ^ b1) << 8);
+}
+
+// Encode rec after prev into out; returns the bytes written. Updates the opcode table.
+static uint32_t encode_record(const Chip8TraceRecord* prev, const Chip8TraceRecord* rec, uint16_t mask,
+    uint16_t* ops, uint32_t* ops_gen, uint32_t generation, uint8_t* out) {
+    uint8_t* p = out + 1;
+    uint8_t tag = 0;
+
+    if (rec->cycle != prev->cycle + 1) {
+        int64_t d = (int64_t)(rec->cycle - prev->cycle - 1);
+        uint64_t z = (uint64_t)(d << 1) ^ (uint64_t)(d >> 63);
+        tag |= TAG_CYCLE;
+        while (z >= 0x80) {
+            *p++ = (uint8_t)(z | 0x80);
+            z >>= 7;
+        }
+        *p++ = (uint8_t)z;
+    }
+    if (rec->pc != ((prev->pc + 2) & mask)) {
+        tag |= TAG_PC;
+        p = put16(p, rec->pc);
+    }
+    if (ops_gen[rec->pc] != generation || ops[rec->pc] != rec->opcode) {
+        tag |= TAG_OPCODE;
+        p = put16(p, rec->opcode);
+        ops[rec->pc] = rec->opcode;
+        ops_gen[rec->pc] = generation;
+    }
+    if (rec->I != prev->I) {
+        tag |= TAG_I;
+        p = put16(p, rec->I);
+    }
+    uint16_t changed = register_diff(prev->V, rec->V);
+    if (changed && !(changed & (changed - 1))) {
+        int r = 0;
+        while (!(changed >> r & 1)) ++r;
+        tag |= TAG_REG;
+        *p++ = (uint8_t)r;
+        *p++ = rec->V[r];
+    }
+    else if (changed) {
+        tag |= TAG_REGS;
+        p = put16(p, changed);
+        for (int r = 0; r < CHIP8_REGISTER_COUNT; ++r) {
+            if (changed >> r & 1) *p++ = rec->V[r];
+        }
+    }
+    if (rec->store_len) {
+        tag |= TAG_STORE;
+        p = put16(p, rec->store_addr);
+        *p++ = rec->store_len;
+        memcpy(p, rec->stored, rec->store_len);
+        p += rec->store_len;
+    }
+    out[0] = tag;
+    return (uint32_t)(p - out);
+}
+
+// Decode the record after prev (in place) from raw[*pos...]; false if the chunk is corrupt
+static bool decode_record(Chip8TraceRecord* rec, const uint8_t* raw, uint32_t size, uint32_t* pos,
+    uint16_t mask, uint16_t* ops, uint32_t* ops_gen, uint32_t generation) {
+    if (size - *pos < 1) return false;
+    const uint8_t* p = raw + *pos;
+    const uint8_t* end = raw + size;
+    uint8_t tag = *p++;
+
+    uint64_t cycle = rec->cycle + 1;
+    if (tag & TAG_CYCLE) {
+        uint64_t z = 0;
+        for (int shift = 0;; shift += 7) {
+            if (p == end || shift > 63) return false;
+            uint8_t b = *p++;
+            z |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) break;
+        }
+        cycle += (uint64_t)((int64_t)(z >> 1) ^ -(int64_t)(z & 1));
+    }
+    rec->cycle = cycle;
+    rec->pc = (rec->pc + 2) & mask;
+    if (tag & TAG_PC) {
+        if (end - p < 2) return false;
+        rec->pc = get16(p) & mask;
+        p += 2;
+    }
+    if (tag & TAG_OPCODE) {
+        if (end - p < 2) return false;
+        ops[rec->pc] = get16(p);
+        ops_gen[rec->pc] = generation;
+        p += 2;
+    }
+    else if (ops_gen[rec->pc] != generation) {
+        return false;
+    }
+    rec->opcode = ops[rec->pc];
+    if (tag & TAG_I) {
+        if (end - p < 2) return false;
+        rec->I = get16(p);
+        p += 2;
+    }
+    rec->changed = 0;
+    if (tag & TAG_REG) {
+        if (end - p < 2 || p[0] >= CHIP8_REGISTER_COUNT) return false;
+        rec->V[p[0]] = p[1];
+        rec->changed = (uint16_t)(1u << p[0]);
+        p += 2;
+    }
+    else if (tag & TAG_REGS) {
+        if (end - p < 2) return false;
+        rec->changed = get16(p);
+        p += 2;
+        for (int r = 0; r < CHIP8_REGISTER_COUNT; ++r) {
+            if (!(rec->changed >> r & 1)) continue;
+            if (p == end) return false;
+            rec->V[r] = *p++;
+        }
+    }
+    rec->store_len = 0;
+    if (tag & TAG_STORE) {
+        if (end - p < 3) return false;
+        rec->store_addr = get16(p);
+        rec->store_len = p[2];
+        p += 3;
+        if (rec->store_len > sizeof(rec->stored) || end - p < rec->store_len) return false;
+        memcpy(rec->stored, p, rec->store_len);
+        p += rec->store_len;
+    }
+    *pos = (uint32_t)(p - raw);
+    return true;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Writer thread
+
+typedef struct Chip8TraceWriter {
+    FILE*    file;
+    uint64_t offset;             // bytes written so far
+    bool     failed;
+    uint16_t addr_mask;
+    uint32_t index_cycles;
+
+    uint8_t* raw;                // chunk being encoded
+    uint32_t raw_size;
+    uint8_t* packed;
+    uint32_t records;
+    uint64_t first_cycle;
+    uint64_t started_ns;         // when the chunk got its first record
+    uint8_t  key_V[CHIP8_REGISTER_COUNT];
+    Chip8TraceRecord prev;       // last record encoded, or the machine at open
+    uint16_t* ops;
+    uint32_t* ops_gen;
+    uint32_t generation;
+    uint32_t lz_table[1 << LZ_HASH_BITS];
+
+    Chip8TraceIndexEntry* index;
+    uint32_t index_count;
+    uint32_t index_capacity;
+} Chip8TraceWriter;
+
+static void write_bytes(Chip8TraceWriter* w, const void* data, size_t size) {
+    if (w->failed) return;
+    if (fwrite(data, 1, size, w->file) != size) {
+        fprintf(stderr, "Failed to write trace file\n");
+        w->failed = true;
+        return;
+    }
+    w->offset += size;
+}
+
+static void end_chunk(Chip8TraceWriter* w) {
+    if (!w->records) return;
+    if (w->index_count == w->index_capacity) {
+        uint32_t capacity = w->index_capacity ? w->index_capacity * 2 : 256;
+        Chip8TraceIndexEntry* index = realloc(w->index, capacity * sizeof(*index));
+        if (index) {
+            w->index = index;
+            w->index_capacity = capacity;
+        }
+    }
+    if (w->index_count < w->index_capacity) {
+        w->index[w->index_count].first_cycle = w->first_cycle;
+        w->index[w->index_count].offset = w->offset;
+        w->index_count++;
+    }
+
+    Chip8TraceChunkHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = CHIP8_TRACE_CHUNK_MAGIC;
+    header.records = w->records;
+    header.first_cycle = w->first_cycle;
+    header.raw_size = w->raw_size;
+    memcpy(header.V, w->key_V, sizeof(header.V));
+    uint32_t packed = lz_compress(w->raw, w->raw_size, w->packed, w->lz_table);
+    bool stored_raw = packed >= w->raw_size;
+    header.packed_size = stored_raw ? w->raw_size : packed;
+
+    write_bytes(w, &header, sizeof(header));
+    write_bytes(w, stored_raw ? w->raw : w->packed, header.packed_size);
+    // Complete chunks reach the file promptly, for live readers and in case the host dies
+    if (!w->failed) fflush(w->file);
+    w->records = 0;
+    w->raw_size = 0;
+}
+
+static void add_record(Chip8TraceWriter* w, const Chip8TraceRecord* rec) {
+    if (w->records && (rec->cycle / w->index_cycles != w->first_cycle / w->index_cycles ||
+        w->raw_size + RECORD_MAX_BYTES > CHIP8_TRACE_CHUNK_BYTES)) {
+        end_chunk(w);
+    }
+    if (!w->records) {
+        // New chunk: a keyframe of the registers and a fresh prediction state
+        w->first_cycle = rec->cycle;
+        w->started_ns = host_time_ns();
+        memcpy(w->key_V, w->prev.V, sizeof(w->key_V));
+        w->prev.cycle = rec->cycle - 1;
+        w->prev.pc = 0;
+        w->prev.I = 0;
+        w->generation++;
+    }
+    w->raw_size += encode_record(&w->prev, rec, w->addr_mask, w->ops, w->ops_gen, w->generation,
+        w->raw + w->raw_size);
+    w->records++;
+    w->prev = *rec;
+}
+
+static void writer_thread(void* arg) {
+    Chip8Trace* t = (Chip8Trace*)arg;
+    Chip8TraceWriter* w = t->writer;
+    for (;;) {
+        const Chip8TraceBlock* b = (const Chip8TraceBlock*)spsc_ring_front(&t->ring);
+        if (!b) {
+            if (atomic_load(&t->stop) && !spsc_ring_front(&t->ring)) break;
+            if (w->records && host_time_ns() - w->started_ns > WRITER_CUT_NS) end_chunk(w);
+            host_sleep_until_ns(host_time_ns() + WRITER_IDLE_NS);
+            continue;
+        }
+        for (uint32_t i = 0; i < b->count; ++i) add_record(w, &b->records[i]);
+        spsc_ring_pop(&t->ring, NULL);
+    }
+    end_chunk(w);
+}
+
+static void writer_free(Chip8TraceWriter* w) {
+    if (!w) return;
+    free(w->raw);
+    free(w->packed);
+    free(w->ops);
+    free(w->ops_gen);
+    free(w->index);
+    free(w);
+}
+
+bool chip8_trace_open(Chip8Trace* t, const char* path, const Chip8* c8, uint32_t index_cycles) {
+    memset(t, 0, sizeof(*t));
+    atomic_init(&t->stop, false);
+    size_t pcs = (size_t)c8->addr_mask + 1;
+
+    Chip8TraceWriter* w = calloc(1, sizeof(Chip8TraceWriter));
+    if (w) {
+        w->raw = malloc(CHIP8_TRACE_CHUNK_BYTES);
+        w->packed = malloc(CHIP8_TRACE_CHUNK_BYTES + CHIP8_TRACE_CHUNK_BYTES / 255 + 16);
+        w->ops = malloc(pcs * sizeof(uint16_t));
+        w->ops_gen = calloc(pcs, sizeof(uint32_t));
+    }
+    if (!w || !w->raw || !w->packed || !w->ops || !w->ops_gen ||
+        !spsc_ring_init(&t->ring, CHIP8_TRACE_RING_BLOCKS, sizeof(Chip8TraceBlock))) {
+        fprintf(stderr, "Out of memory for the trace buffers\n");
+        writer_free(w);
+        spsc_ring_free(&t->ring);
+        return false;
+    }
+    w->addr_mask = c8->addr_mask;
+    w->index_cycles = index_cycles ? index_cycles : CHIP8_TRACE_DEFAULT_INDEX;
+    w->prev.cycle = c8->cycle_count;
+    memcpy(w->prev.V, c8->V, sizeof(w->prev.V));
+
+#ifdef _MSC_VER
+    fopen_s(&w->file, path, "wb");
+#else
+    w->file = fopen(path, "wb");
+#endif
+    if (!w->file) {
+        fprintf(stderr, "Failed to create trace file: %s\n", path);
+        writer_free(w);
+        spsc_ring_free(&t->ring);
+        return false;
+    }
+
+    Chip8TraceFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = CHIP8_TRACE_MAGIC;
+    header.version = CHIP8_TRACE_VERSION;
+    header.addr_mask = c8->addr_mask;
+    header.index_cycles = w->index_cycles;
+    write_bytes(w, &header, sizeof(header));
+    fflush(w->file);
+
+    t->writer = w;
+    if (w->failed || !host_thread_start(&t->thread, writer_thread, t)) {
+        fprintf(stderr, "Failed to start the trace writer\n");
+        fclose(w->file);
+        writer_free(w);
+        spsc_ring_free(&t->ring);
+        t->writer = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool chip8_trace_close(Chip8Trace* t) {
+    Chip8TraceWriter* w = t->writer;
+    if (!w) return false;
+    chip8_trace_flush(t);
+    atomic_store(&t->stop, true);
+    host_thread_join(&t->thread);
+
+    Chip8TraceTrailer trailer;
+    memset(&trailer, 0, sizeof(trailer));
+    trailer.index_offset = w->offset;
+    trailer.count = w->index_count;
+    trailer.magic = CHIP8_TRACE_INDEX_MAGIC;
+    write_bytes(w, w->index, w->index_count * sizeof(Chip8TraceIndexEntry));
+    write_bytes(w, &trailer, sizeof(trailer));
+
+    bool ok = (fclose(w->file) == 0) && !w->failed;
+    if (!ok) fprintf(stderr, "Failed to finish trace file\n");
+    writer_free(w);
+    spsc_ring_free(&t->ring);
+    t->writer = NULL;
+    return ok;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Reader
+
+static bool seek_file(FILE* f, uint64_t offset) {
+#ifdef _MSC_VER
+    return _fseeki64(f, (__int64)offset, SEEK_SET) == 0;
+#else
+    return fseeko(f, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+static uint64_t file_size(FILE* f) {
+#ifdef _MSC_VER
+    if (_fseeki64(f, 0, SEEK_END) != 0) return 0;
+    return (uint64_t)_ftelli64(f);
+#else
+    if (fseeko(f, 0, SEEK_END) != 0) return 0;
+    return (uint64_t)ftello(f);
+#endif
+}
+
+static bool add_index(Chip8TraceReader* r, uint64_t first_cycle, uint64_t offset) {
+    if (r->index_count == r->index_capacity) {
+        uint32_t capacity = r->index_capacity ? r->index_capacity * 2 : 256;
+        Chip8TraceIndexEntry* index = realloc(r->index, capacity * sizeof(*index));
+        if (!index) return false;
+        r->index = index;
+        r->index_capacity = capacity;
+    }
+    r->index[r->index_count].first_cycle = first_cycle;
+    r->index[r->index_count].offset = offset;
+    r->index_count++;
+    return true;
+}
+
+// Without a trailer: add the next chunk if it has been written completely
+static bool scan_chunk(Chip8TraceReader* r) {
+    if (r->indexed) return false;
+    Chip8TraceChunkHeader header;
+    uint64_t size = file_size(r->file);
+    if (size < r->scan_offset + sizeof(header) || !seek_file(r->file, r->scan_offset) ||
+        fread(&header, sizeof(header), 1, r->file) != 1 || header.magic != CHIP8_TRACE_CHUNK_MAGIC ||
+        size < r->scan_offset + sizeof(header) + header.packed_size) {
+        return false;
+    }
+    if (!add_index(r, header.first_cycle, r->scan_offset)) return false;
+    r->scan_offset += sizeof(header) + header.packed_size;
+    return true;
+}
+
+static bool load_chunk(Chip8TraceReader* r, uint32_t i) {
+    Chip8TraceChunkHeader header;
+    if (!seek_file(r->file, r->index[i].offset) || fread(&header, sizeof(header), 1, r->file) != 1 ||
+        header.magic != CHIP8_TRACE_CHUNK_MAGIC || header.raw_size > CHIP8_TRACE_CHUNK_BYTES ||
+        header.packed_size > header.raw_size) {
+        fprintf(stderr, "Corrupt trace chunk at offset %llu\n", (unsigned long long)r->index[i].offset);
+        return false;
+    }
+    bool stored_raw = header.packed_size == header.raw_size;
+    uint8_t* packed = stored_raw ? r->raw : malloc(header.packed_size ? header.packed_size : 1);
+    bool ok = packed && fread(packed, 1, header.packed_size, r->file) == header.packed_size &&
+        (stored_raw || lz_decompress(packed, header.packed_size, r->raw, header.raw_size));
+    if (!stored_raw) free(packed);
+    if (!ok) {
+        fprintf(stderr, "Corrupt trace chunk at offset %llu\n", (unsigned long long)r->index[i].offset);
+        return false;
+    }
+
+    r->raw_size = header.raw_size;
+    r->raw_pos = 0;
+    r->left = header.records;
+    r->next_chunk = i + 1;
+    r->generation++;
+    memset(&r->prev, 0, sizeof(r->prev));
+    r->prev.cycle = header.first_cycle - 1;
+    memcpy(r->prev.V, header.V, sizeof(r->prev.V));
+    r->pending = false;
+    return true;
+}
+
+bool chip8_trace_reader_open(Chip8TraceReader* r, const char* path) {
+    memset(r, 0, sizeof(*r));
+#ifdef _MSC_VER
+    fopen_s(&r->file, path, "rb");
+#else
+    r->file = fopen(path, "rb");
+#endif
+    if (!r->file) {
+        fprintf(stderr, "Failed to open trace file: %s\n", path);
+        return false;
+    }
+    if (fread(&r->header, sizeof(r->header), 1, r->file) != 1 || r->header.magic != CHIP8_TRACE_MAGIC) {
+        fprintf(stderr, "Not a CHIP-8 trace file: %s\n", path);
+        chip8_trace_reader_close(r);
+        return false;
+    }
+    if (r->header.version != CHIP8_TRACE_VERSION || r->header.index_cycles == 0 ||
+        (r->header.addr_mask != CHIP8_ADDR_MASK && r->header.addr_mask != CHIP8_XO_ADDR_MASK)) {
+        fprintf(stderr, "Unsupported trace file version: %s\n", path);
+        chip8_trace_reader_close(r);
+        return false;
+    }
+
+    size_t pcs = (size_t)r->header.addr_mask + 1;
+    r->raw = malloc(CHIP8_TRACE_CHUNK_BYTES);
+    r->ops = malloc(pcs * sizeof(uint16_t));
+    r->ops_gen = calloc(pcs, sizeof(uint32_t));
+    if (!r->raw || !r->ops || !r->ops_gen) {
+        fprintf(stderr, "Out of memory reading trace file: %s\n", path);
+        chip8_trace_reader_close(r);
+        return false;
+    }
+    r->scan_offset = sizeof(Chip8TraceFileHeader);
+
+    // A finished file ends with the index; an unfinished one is scanned chunk by chunk
+    Chip8TraceTrailer trailer;
+    uint64_t size = file_size(r->file);
+    if (size >= sizeof(Chip8TraceFileHeader) + sizeof(trailer) &&
+        seek_file(r->file, size - sizeof(trailer)) && fread(&trailer, sizeof(trailer), 1, r->file) == 1 &&
+        trailer.magic == CHIP8_TRACE_INDEX_MAGIC &&
+        trailer.index_offset + (uint64_t)trailer.count * sizeof(Chip8TraceIndexEntry) + sizeof(trailer) == size) {
+        r->index = malloc((trailer.count ? trailer.count : 1) * sizeof(Chip8TraceIndexEntry));
+        if (r->index && seek_file(r->file, trailer.index_offset) &&
+            fread(r->index, sizeof(Chip8TraceIndexEntry), trailer.count, r->file) == trailer.count) {
+            r->index_count = trailer.count;
+            r->index_capacity = trailer.count;
+            r->indexed = true;
+        }
+        else {
+            free(r->index);
+            r->index = NULL;
+        }
+    }
+    return true;
+}
+
+void chip8_trace_reader_close(Chip8TraceReader* r) {
+    if (r->file) fclose(r->file);
+    free(r->index);
+    free(r->raw);
+    free(r->ops);
+    free(r->ops_gen);
+    memset(r, 0, sizeof(*r));
+}
+
+bool chip8_trace_reader_next(Chip8TraceReader* r, Chip8TraceRecord* rec) {
+    if (r->pending) {
+        r->pending = false;
+        *rec = r->prev;
+        return true;
+    }
+    while (r->left == 0) {
+        if (r->next_chunk >= r->index_count && !scan_chunk(r)) return false;
+        if (!load_chunk(r, r->next_chunk)) return false;
+    }
+    if (!decode_record(&r->prev, r->raw, r->raw_size, &r->raw_pos, r->header.addr_mask, r->ops,
+        r->ops_gen, r->generation)) {
+        fprintf(stderr, "Corrupt trace record\n");
+        r->left = 0;
+        return false;
+    }
+    r->left--;
+    *rec = r->prev;
+    return true;
+}
+
+bool chip8_trace_reader_seek(Chip8TraceReader* r, uint64_t cycle) {
+    while (scan_chunk(r)) {
+    }
+    if (r->index_count == 0) return false;
+
+    // Last chunk starting at or before `cycle`
+    uint32_t lo = 0, hi = r->index_count;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (r->index[mid].first_cycle <= cycle) lo = mid;
+        else hi = mid;
+    }
+    if (!load_chunk(r, lo)) return false;
+
+    Chip8TraceRecord rec;
+    while (chip8_trace_reader_next(r, &rec)) {
+        if (rec.cycle >= cycle) {
+            r->pending = true;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,134 @@
+// Execution trace recorder: every instruction's cycle, pc, opcode, register changes, I and
+// Fx33/Fx55/5xy2 memory writes. The emulation thread fills blocks of records in an SPSC ring;
+// a writer thread delta-encodes and LZ-compresses them into self-contained chunks, one every
+// index_cycles cycles, so a file can be read while it grows, after a crash, or from any chunk.
+
+#ifndef CHIP8_TRACE_H
+#define CHIP8_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include "chip8.h"
+#include "host_thread.h"
+#include "spsc_ring.h"
+
+#define CHIP8_TRACE_MAGIC          0x52543843u   // "C8TR" in file byte order on little-endian hosts
+#define CHIP8_TRACE_CHUNK_MAGIC    0x43543843u   // "C8TC"
+#define CHIP8_TRACE_INDEX_MAGIC    0x49543843u   // "C8TI"
+#define CHIP8_TRACE_VERSION        1
+#define CHIP8_TRACE_BLOCK_RECORDS  256           // records per ring slot
+#define CHIP8_TRACE_RING_BLOCKS    64            // ring slots between emulation and writer
+#define CHIP8_TRACE_DEFAULT_INDEX  65536         // cycles between index points
+#define CHIP8_TRACE_CHUNK_BYTES    (1u << 20)    // encoded bytes that also end a chunk early
+
+// One executed instruction, as recorded and as read back
+typedef struct Chip8TraceRecord {
+    uint64_t cycle;        // Chip8.cycle_count after the instruction
+    uint16_t pc;           // address it was fetched from
+    uint16_t opcode;       // first word (XO-CHIP F000 nnnn records F000)
+    uint16_t I;            // after the instruction
+    uint16_t changed;      // read back: bit r set when Vr differs from the previous record
+    uint16_t store_addr;   // first byte written by Fx33 / Fx55 / 5xy2
+    uint8_t  store_len;    // bytes written, 0 if none
+    uint8_t  reserved;
+    uint8_t  V[CHIP8_REGISTER_COUNT];   // registers after the instruction
+    uint8_t  stored[16];   // the bytes written
+} Chip8TraceRecord;
+
+typedef struct Chip8TraceBlock {
+    uint32_t         count;
+    Chip8TraceRecord records[CHIP8_TRACE_BLOCK_RECORDS];
+} Chip8TraceBlock;
+
+typedef struct Chip8TraceFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t addr_mask;      // Chip8.addr_mask of the traced machine
+    uint32_t index_cycles;
+    uint32_t reserved;
+} Chip8TraceFileHeader;
+
+// Every chunk starts with a keyframe, so it decodes without the chunks before it
+typedef struct Chip8TraceChunkHeader {
+    uint32_t magic;          // CHIP8_TRACE_CHUNK_MAGIC
+    uint32_t records;
+    uint64_t first_cycle;
+    uint32_t raw_size;       // encoded records
+    uint32_t packed_size;    // bytes following the header; equal to raw_size if stored raw
+    uint8_t  V[CHIP8_REGISTER_COUNT];   // registers before the first record
+} Chip8TraceChunkHeader;
+
+// Written by chip8_trace_close after the last chunk: the index, then this trailer
+typedef struct Chip8TraceIndexEntry {
+    uint64_t first_cycle;
+    uint64_t offset;         // file offset of the chunk header
+} Chip8TraceIndexEntry;
+
+typedef struct Chip8TraceTrailer {
+    uint64_t index_offset;
+    uint32_t count;
+    uint32_t magic;          // CHIP8_TRACE_INDEX_MAGIC
+} Chip8TraceTrailer;
+
+struct Chip8TraceWriter;
+
+typedef struct Chip8Trace {
+    SpscRing          ring;        // Chip8TraceBlock slots, emulation thread -> writer
+    Chip8TraceBlock*  block;       // slot being filled, NULL until claimed
+    HostThread        thread;
+    atomic_bool       stop;
+    struct Chip8TraceWriter* writer;   // writer thread state
+    uint64_t          stalls;      // times the emulation thread waited for a free slot
+} Chip8Trace;
+
+// Create `path` and start the writer thread for the machine `c8` (classic or XO-CHIP).
+// index_cycles 0 uses CHIP8_TRACE_DEFAULT_INDEX. Returns false if the file or thread fails.
+bool chip8_trace_open(Chip8Trace* t, const char* path, const Chip8* c8, uint32_t index_cycles);
+
+// Execute up to `cycles` instructions like chip8_run, recording each one; idle loops are
+// stepped rather than skipped so every instruction appears. When the writer falls a whole
+// ring behind the emulation thread waits for it. Returns the instructions executed.
+uint32_t chip8_trace_run(Chip8Trace* t, Chip8* c8, uint32_t cycles);
+
+// Hand the partly filled block to the writer, e.g. once per frame so a live reader keeps up
+void chip8_trace_flush(Chip8Trace* t);
+
+// Flush, stop the writer, append the index and close the file. Returns false on write errors.
+bool chip8_trace_close(Chip8Trace* t);
+
+// Incremental reader
+typedef struct Chip8TraceReader {
+    FILE*                 file;
+    Chip8TraceFileHeader  header;
+    Chip8TraceIndexEntry* index;        // chunks found so far, by file offset
+    uint32_t              index_count;
+    uint32_t              index_capacity;
+    bool                  indexed;      // index came from the trailer, the file is complete
+    uint64_t              scan_offset;  // next unscanned chunk header without a trailer
+
+    uint8_t*              raw;          // current chunk, decoded
+    uint32_t              raw_size;
+    uint32_t              raw_pos;
+    uint32_t              next_chunk;   // index entry to load when this chunk runs out
+    uint32_t              left;         // records left in the current chunk
+    Chip8TraceRecord      prev;         // last record decoded
+    bool                  pending;      // prev is the next record to return (after a seek)
+    uint16_t*             ops;          // opcode last seen per pc in the current chunk
+    uint32_t*             ops_gen;      // generation for which ops[pc] is valid
+    uint32_t              generation;   // chunks loaded so far
+} Chip8TraceReader;
+
+bool chip8_trace_reader_open(Chip8TraceReader* r, const char* path);
+void chip8_trace_reader_close(Chip8TraceReader* r);
+
+// Next record. Returns false at the end of what has been written so far; on a file that is
+// still being written, calling again later continues once the next chunk is complete.
+bool chip8_trace_reader_next(Chip8TraceReader* r, Chip8TraceRecord* rec);
+
+// Position so the next record is the first with cycle >= `cycle`, decoding only from the
+// index point before it. Returns false if no such record has been written.
+bool chip8_trace_reader_seek(Chip8TraceReader* r, uint64_t cycle);
+
+#endif // CHIP8_TRACE_H
@@ -0,0 +1,567 @@
+// Headless video capture: per-stream frame queues drained by a pool of encoder threads.
+
+#include "chip8_video.h"
+#include "chip8_blit.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define WORKER_IDLE_NS   1000000ull   // encoder poll interval while every queue is empty
+#define WORKER_BATCH     8            // frames an encoder takes from one stream before moving on
+#define STALL_WAIT_NS    100000ull
+
+#define HASH_BITS        14           // PNG deflate match finder
+#define WINDOW_SIZE      32768
+#define MAX_MATCH        258
+
+#define MAX_WIDTH        (CHIP8_VIDEO_WIDTH * CHIP8_VIDEO_MAX_SCALE)
+#define MAX_HEIGHT       (CHIP8_VIDEO_HEIGHT * CHIP8_VIDEO_MAX_SCALE)
+#define PNG_RAW_BYTES    ((size_t)MAX_HEIGHT * (1 + MAX_WIDTH / 4))   // filter byte + 2-bit pixels per row
+
+// Slot life cycle: FREE -> OPENING (producer sets up) -> OPEN -> CLOSING (drain) -> FREE
+enum {
+    SLOT_FREE,
+    SLOT_OPENING,
+    SLOT_OPEN,
+    SLOT_CLOSING,
+};
+
+static const uint32_t default_palette[1 << CHIP8_DISPLAY_PLANES] = {
+    0xFF000000, 0xFF00FF00, 0xFFFF8000, 0xFFFFFFFF
+};
+
+typedef struct Chip8VideoWorker {
+    Chip8VideoEncoder* encoder;
+    HostThread thread;
+    bool       started;
+    int        index;
+    uint32_t*  frame;    // colour index per display pixel
+    uint32_t*  smooth;   // frame after Scale2x
+    uint32_t*  image;    // colour index per output pixel
+    uint8_t*   pixels;   // Y4M planes or RGB24
+    uint8_t*   raw;      // PNG scanlines before compression
+    uint8_t*   packed;   // zlib stream
+    int32_t*   head;     // deflate hash chains: last position per hash
+} Chip8VideoWorker;
+
+static uint32_t crc_table[256];
+
+static void init_crc_table(void) {
+    for (uint32_t n = 0; n < 256; ++n) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[n] = c;
+    }
+}
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; ++i) crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static uint32_t adler32(const uint8_t* data, size_t len) {
+    uint32_t a = 1, b = 0;
+    while (len > 0) {
+        size_t n = len < 5552 ? len : 5552;   // largest run without 32-bit overflow
+        len -= n;
+        while (n--) {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return b << 16 | a;
+}
+
+// ---- Deflate, fixed Huffman codes with a greedy LZ77 match finder ----
+
+typedef struct BitWriter {
+    uint8_t* out;
+    size_t   pos;
+    uint64_t bits;
+    int      count;
+} BitWriter;
+
+static const uint16_t length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115,
+    131, 163, 195, 227, 258
+};
+static const uint8_t length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537,
+    2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static void put_bits(BitWriter* b, uint32_t value, int n) {
+    b->bits |= (uint64_t)value << b->count;
+    b->count += n;
+    while (b->count >= 8) {
+        b->out[b->pos++] = (uint8_t)b->bits;
+        b->bits >>= 8;
+        b->count -= 8;
+    }
+}
+
+// Huffman codes go out most significant bit first
+static void put_code(BitWriter* b, uint32_t code, int n) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < n; ++i) reversed |= ((code >> i) & 1) << (n - 1 - i);
+    put_bits(b, reversed, n);
+}
+
+static void put_symbol(BitWriter* b, uint32_t sym) {
+    if (sym < 144) put_code(b, 0x30 + sym, 8);
+    else if (sym < 256) put_code(b, 0x190 + sym - 144, 9);
+    else if (sym < 280) put_code(b, sym - 256, 7);
+    else put_code(b, 0xC0 + sym - 280, 8);
+}
+
+static void put_match(BitWriter* b, uint32_t len, uint32_t dist) {
+    int i = 28;
+    while (length_base[i] > len) i--;
+    put_symbol(b, 257 + (uint32_t)i);
+    put_bits(b, len - length_base[i], length_extra[i]);
+    int d = 29;
+    while (dist_base[d] > dist) d--;
+    put_code(b, (uint32_t)d, 5);
+    put_bits(b, dist - dist_base[d], dist_extra[d]);
+}
+
+static uint32_t hash3(const uint8_t* p) {
+    return ((uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2]) * 2654435761u >> (32 - HASH_BITS);
+}
+
+// One final fixed-Huffman block. `out` needs len * 9 / 8 + 8 bytes.
+static size_t deflate_fixed(const uint8_t* in, size_t len, uint8_t* out, int32_t* head) {
+    for (size_t i = 0; i < (1u << HASH_BITS); ++i) head[i] = -1;
+    BitWriter b = { out, 0, 0, 0 };
+    put_bits(&b, 1, 1);   // BFINAL
+    put_bits(&b, 1, 2);   // BTYPE 01: fixed codes
+
+    size_t i = 0;
+    while (i < len) {
+        size_t best = 0;
+        size_t dist = 0;
+        if (i + 3 <= len) {
+            uint32_t h = hash3(in + i);
+            int32_t cand = head[h];
+            head[h] = (int32_t)i;
+            if (cand >= 0 && i - (size_t)cand <= WINDOW_SIZE) {
+                size_t max = len - i < MAX_MATCH ? len - i : MAX_MATCH;
+                size_t n = 0;
+                while (n < max && in[(size_t)cand + n] == in[i + n]) n++;
+                if (n >= 3) {
+                    best = n;
+                    dist = i - (size_t)cand;
+                }
+            }
+        }
+        if (!best) {
+            put_symbol(&b, in[i++]);
+            continue;
+        }
+        put_match(&b, (uint32_t)best, (uint32_t)dist);
+        for (size_t j = i + 1; j < i + best && j + 3 <= len; ++j) head[hash3(in + j)] = (int32_t)j;
+        i += best;
+    }
+    put_symbol(&b, 256);
+    if (b.count > 0) b.out[b.pos++] = (uint8_t)b.bits;
+    return b.pos;
+}
+
+// ---- Frame encoding (encoder threads) ----
+
+static FILE* open_output(const char* path) {
+    FILE* f = NULL;
+#ifdef _MSC_VER
+    fopen_s(&f, path, "wb");
+#else
+    f = fopen(path, "wb");
+#endif
+    return f;
+}
+
+// Colour index per output pixel. Low-res frames are doubled so every frame has the same size;
+// with smoothing the first doubling is Scale2x.
+static void render(Chip8VideoWorker* w, const Chip8VideoFrame* f) {
+    static const uint32_t indices[1 << CHIP8_DISPLAY_PLANES] = { 0, 1, 2, 3 };
+    const Chip8VideoEncoder* e = w->encoder;
+    size_t out_w = (size_t)CHIP8_VIDEO_WIDTH * (size_t)e->scale;
+    int factor = e->scale * (f->high_res ? 1 : 2);
+    int width = f->high_res ? CHIP8_HIGH_RES_WIDTH : CHIP8_LOW_RES_WIDTH;
+    int height = f->high_res ? CHIP8_HIGH_RES_HEIGHT : CHIP8_LOW_RES_HEIGHT;
+    chip8_blit(&f->rows[0][0], width, height, indices, w->frame, CHIP8_HIGH_RES_WIDTH);
+    if (e->smooth && factor % 2 == 0) {
+        chip8_upscale_scale2x(w->frame, width, height, CHIP8_HIGH_RES_WIDTH, w->smooth, 2 * CHIP8_HIGH_RES_WIDTH);
+        chip8_upscale_nearest(w->smooth, 2 * width, 2 * height, 2 * CHIP8_HIGH_RES_WIDTH,
+            w->image, out_w, factor / 2);
+    }
+    else {
+        chip8_upscale_nearest(w->frame, width, height, CHIP8_HIGH_RES_WIDTH, w->image, out_w, factor);
+    }
+}
+
+static bool write_chunk(FILE* file, const char* type, const uint8_t* data, size_t len) {
+    uint8_t header[8] = {
+        (uint8_t)(len >> 24), (uint8_t)(len >> 16), (uint8_t)(len >> 8), (uint8_t)len,
+        (uint8_t)type[0], (uint8_t)type[1], (uint8_t)type[2], (uint8_t)type[3]
+    };
+    uint32_t crc = crc32_update(0xFFFFFFFFu, header + 4, 4);
+    crc = crc32_update(crc, data, len) ^ 0xFFFFFFFFu;
+    uint8_t trailer[4] = { (uint8_t)(crc >> 24), (uint8_t)(crc >> 16), (uint8_t)(crc >> 8), (uint8_t)crc };
+    return fwrite(header, 1, 8, file) == 8 && fwrite(data, 1, len, file) == len &&
+        fwrite(trailer, 1, 4, file) == 4;
+}
+
+// Indexed PNG, 2 bits per pixel with the palette as PLTE
+static bool write_png(Chip8VideoWorker* w, const char* path, int width, int height) {
+    const Chip8VideoEncoder* e = w->encoder;
+    size_t stride = 1 + (size_t)width / 4;
+    for (int y = 0; y < height; ++y) {
+        const uint32_t* src = w->image + (size_t)y * (size_t)width;
+        uint8_t* dst = w->raw + (size_t)y * stride;
+        *dst++ = 0;   // filter: none
+        for (int x = 0; x < width; x += 4) {
+            *dst++ = (uint8_t)(src[x] << 6 | src[x + 1] << 4 | src[x + 2] << 2 | src[x + 3]);
+        }
+    }
+    size_t raw_size = stride * (size_t)height;
+
+    uint8_t* z = w->packed;
+    z[0] = 0x78;   // deflate, 32K window
+    z[1] = 0x01;
+    size_t len = 2 + deflate_fixed(w->raw, raw_size, z + 2, w->head);
+    uint32_t adler = adler32(w->raw, raw_size);
+    z[len++] = (uint8_t)(adler >> 24);
+    z[len++] = (uint8_t)(adler >> 16);
+    z[len++] = (uint8_t)(adler >> 8);
+    z[len++] = (uint8_t)adler;
+
+    uint8_t ihdr[13] = {
+        (uint8_t)(width >> 24), (uint8_t)(width >> 16), (uint8_t)(width >> 8), (uint8_t)width,
+        (uint8_t)(height >> 24), (uint8_t)(height >> 16), (uint8_t)(height >> 8), (uint8_t)height,
+        2, 3, 0, 0, 0   // 2-bit palette indices, deflate, adaptive filters, no interlace
+    };
+    uint8_t plte[3 << CHIP8_DISPLAY_PLANES];
+    for (int i = 0; i < (1 << CHIP8_DISPLAY_PLANES); ++i) {
+        plte[3 * i] = (uint8_t)(e->palette[i] >> 16);
+        plte[3 * i + 1] = (uint8_t)(e->palette[i] >> 8);
+        plte[3 * i + 2] = (uint8_t)e->palette[i];
+    }
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    FILE* file = open_output(path);
+    if (!file) return false;
+    bool ok = fwrite(signature, 1, 8, file) == 8 &&
+        write_chunk(file, "IHDR", ihdr, sizeof(ihdr)) &&
+        write_chunk(file, "PLTE", plte, sizeof(plte)) &&
+        write_chunk(file, "IDAT", z, len) &&
+        write_chunk(file, "IEND", NULL, 0);
+    return fclose(file) == 0 && ok;
+}
+
+static bool write_frame(Chip8VideoWorker* w, Chip8VideoStream* s, const Chip8VideoFrame* f) {
+    const Chip8VideoEncoder* e = w->encoder;
+    int width = CHIP8_VIDEO_WIDTH * e->scale;
+    int height = CHIP8_VIDEO_HEIGHT * e->scale;
+    size_t count = (size_t)width * (size_t)height;
+    render(w, f);
+
+    if (s->format == CHIP8_VIDEO_PNG) {
+        size_t len = strlen(s->path) + 32;
+        char* name = (char*)malloc(len);
+        if (!name) return false;
+        snprintf(name, len, "%s_%06llu.png", s->path, (unsigned long long)f->sequence);
+        bool ok = write_png(w, name, width, height);
+        free(name);
+        return ok;
+    }
+
+    if (s->format == CHIP8_VIDEO_Y4M) {
+        // BT.601 studio range, per palette entry
+        uint8_t yuv[3][1 << CHIP8_DISPLAY_PLANES];
+        for (int i = 0; i < (1 << CHIP8_DISPLAY_PLANES); ++i) {
+            int r = (e->palette[i] >> 16) & 0xFF, g = (e->palette[i] >> 8) & 0xFF, b = e->palette[i] & 0xFF;
+            yuv[0][i] = (uint8_t)((66 * r + 129 * g + 25 * b + 4224) >> 8);
+            yuv[1][i] = (uint8_t)((-38 * r - 74 * g + 112 * b + 32896) >> 8);
+            yuv[2][i] = (uint8_t)((112 * r - 94 * g - 18 * b + 32896) >> 8);
+        }
+        for (int p = 0; p < 3; ++p) {
+            uint8_t* plane = w->pixels + (size_t)p * count;
+            for (size_t i = 0; i < count; ++i) plane[i] = yuv[p][w->image[i]];
+        }
+        return fputs("FRAME\n", s->file) >= 0 && fwrite(w->pixels, 1, 3 * count, s->file) == 3 * count;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t c = e->palette[w->image[i]];
+        w->pixels[3 * i] = (uint8_t)(c >> 16);
+        w->pixels[3 * i + 1] = (uint8_t)(c >> 8);
+        w->pixels[3 * i + 2] = (uint8_t)c;
+    }
+    return fwrite(w->pixels, 1, 3 * count, s->file) == 3 * count;
+}
+
+// Encode one queued frame, first repeating the previous one over frames dropped before it.
+// A sequence keeps frame numbers, so gaps there just leave numbers out.
+static void encode_frame(Chip8VideoWorker* w, Chip8VideoStream* s, const Chip8VideoFrame* f) {
+    if (s->stats.failed) return;
+    bool ok = true;
+    if (s->format != CHIP8_VIDEO_PNG && s->has_last) {
+        for (uint64_t n = s->last.sequence + 1; n < f->sequence && ok; ++n) {
+            ok = write_frame(w, s, &s->last);
+            s->stats.written++;
+        }
+    }
+    if (ok) {
+        ok = write_frame(w, s, f);
+        s->stats.written++;
+    }
+    if (!ok) {
+        fprintf(stderr, "Failed writing video frame %llu of %s\n", (unsigned long long)f->sequence, s->path);
+        s->stats.failed = true;
+        return;
+    }
+    if (s->format != CHIP8_VIDEO_PNG) {
+        memcpy(&s->last, f, sizeof(s->last));
+        s->has_last = true;
+    }
+}
+
+static void worker_thread(void* arg) {
+    Chip8VideoWorker* w = (Chip8VideoWorker*)arg;
+    Chip8VideoEncoder* e = w->encoder;
+    int start = w->index;   // workers begin their scans at different streams
+
+    while (!atomic_load(&e->quit)) {
+        bool worked = false;
+        for (int n = 0; n < e->max_streams; ++n) {
+            Chip8VideoStream* s = &e->streams[(start + n) % e->max_streams];
+            // Claim the consumer side first: the slot may be in the middle of opening
+            if (atomic_exchange(&s->busy, true)) continue;
+            int state = atomic_load(&s->state);
+            if (state == SLOT_OPEN || state == SLOT_CLOSING) {
+                const Chip8VideoFrame* f;
+                for (int k = 0; k < WORKER_BATCH && (f = (const Chip8VideoFrame*)spsc_ring_front(&s->queue)); ++k) {
+                    encode_frame(w, s, f);
+                    spsc_ring_pop(&s->queue, NULL);
+                    worked = true;
+                }
+            }
+            atomic_store(&s->busy, false);
+        }
+        start++;
+        if (!worked) host_sleep_until_ns(host_time_ns() + WORKER_IDLE_NS);
+    }
+}
+
+// ---- Public API ----
+
+static bool has_extension(const char* path, const char* ext) {
+    const char* dot = strrchr(path, '.');
+    if (!dot) return false;
+    for (++dot; *dot && *ext; ++dot, ++ext) {
+        if (tolower((unsigned char)*dot) != *ext) return false;
+    }
+    return *dot == '\0' && *ext == '\0';
+}
+
+Chip8VideoFormat chip8_video_format_for_path(const char* path) {
+    if (has_extension(path, "y4m")) return CHIP8_VIDEO_Y4M;
+    if (has_extension(path, "png")) return CHIP8_VIDEO_PNG;
+    return CHIP8_VIDEO_RAW;
+}
+
+const char* chip8_video_format_name(Chip8VideoFormat format) {
+    switch (format) {
+    case CHIP8_VIDEO_Y4M: return "y4m";
+    case CHIP8_VIDEO_PNG: return "png";
+    default:              return "raw rgb24";
+    }
+}
+
+static void free_worker(Chip8VideoWorker* w) {
+    free(w->frame);
+    free(w->smooth);
+    free(w->image);
+    free(w->pixels);
+    free(w->raw);
+    free(w->packed);
+    free(w->head);
+}
+
+bool chip8_video_encoder_start(Chip8VideoEncoder* e, const Chip8VideoConfig* config) {
+    memset(e, 0, sizeof(*e));
+    atomic_init(&e->quit, false);
+    e->scale = config->scale ? config->scale : CHIP8_VIDEO_DEFAULT_SCALE;
+    if (e->scale < 1 || e->scale > CHIP8_VIDEO_MAX_SCALE) {
+        fprintf(stderr, "Video scale must be 1 to %d\n", CHIP8_VIDEO_MAX_SCALE);
+        return false;
+    }
+    e->queue_frames = config->queue_frames ? config->queue_frames : CHIP8_VIDEO_DEFAULT_QUEUE;
+    e->max_streams = config->max_streams > 0 ? config->max_streams : 1;
+    e->smooth = config->smooth;
+    memcpy(e->palette, config->palette ? config->palette : default_palette, sizeof(e->palette));
+    if (!crc_table[1]) init_crc_table();
+
+    e->worker_count = config->threads > 0 ? config->threads : host_cpu_count();
+    e->streams = (Chip8VideoStream*)calloc((size_t)e->max_streams, sizeof(Chip8VideoStream));
+    e->workers = (Chip8VideoWorker*)calloc((size_t)e->worker_count, sizeof(Chip8VideoWorker));
+    if (!e->streams || !e->workers) {
+        fprintf(stderr, "Out of memory for the video encoder\n");
+        free(e->streams);
+        free(e->workers);
+        return false;
+    }
+    for (int i = 0; i < e->max_streams; ++i) {
+        atomic_init(&e->streams[i].state, SLOT_FREE);
+        atomic_init(&e->streams[i].busy, false);
+    }
+
+    size_t pixels = (size_t)MAX_WIDTH * MAX_HEIGHT;
+    int started = 0;
+    for (int i = 0; i < e->worker_count; ++i) {
+        Chip8VideoWorker* w = &e->workers[i];
+        w->encoder = e;
+        w->index = i;
+        w->frame = (uint32_t*)malloc(sizeof(uint32_t) * CHIP8_HIGH_RES_WIDTH * CHIP8_HIGH_RES_HEIGHT);
+        w->smooth = (uint32_t*)malloc(sizeof(uint32_t) * 4 * CHIP8_HIGH_RES_WIDTH * CHIP8_HIGH_RES_HEIGHT);
+        w->image = (uint32_t*)malloc(sizeof(uint32_t) * pixels);
+        w->pixels = (uint8_t*)malloc(3 * pixels);
+        w->raw = (uint8_t*)malloc(PNG_RAW_BYTES);
+        w->packed = (uint8_t*)malloc(PNG_RAW_BYTES * 9 / 8 + 64);
+        w->head = (int32_t*)malloc(sizeof(int32_t) << HASH_BITS);
+        if (w->frame && w->smooth && w->image && w->pixels && w->raw && w->packed && w->head) {
+            w->started = host_thread_start(&w->thread, worker_thread, w);
+        }
+        if (w->started) started++;
+    }
+    if (started == 0) {
+        fprintf(stderr, "Failed to start the video encoder threads\n");
+        chip8_video_encoder_stop(e);
+        return false;
+    }
+    return true;
+}
+
+void chip8_video_encoder_stop(Chip8VideoEncoder* e) {
+    atomic_store(&e->quit, true);
+    for (int i = 0; i < e->worker_count; ++i) {
+        if (e->workers[i].started) host_thread_join(&e->workers[i].thread);
+        free_worker(&e->workers[i]);
+    }
+    free(e->workers);
+    free(e->streams);
+    e->workers = NULL;
+    e->streams = NULL;
+    e->worker_count = 0;
+}
+
+Chip8VideoStream* chip8_video_open(Chip8VideoEncoder* e, const char* path) {
+    Chip8VideoStream* s = NULL;
+    for (int i = 0; i < e->max_streams && !s; ++i) {
+        int expected = SLOT_FREE;
+        if (atomic_compare_exchange_strong(&e->streams[i].state, &expected, SLOT_OPENING)) s = &e->streams[i];
+    }
+    if (!s) {
+        fprintf(stderr, "No free video stream for %s\n", path);
+        return NULL;
+    }
+
+    s->format = chip8_video_format_for_path(path);
+    s->file = NULL;
+    s->has_last = false;
+    s->sequence = 0;
+    memset(&s->stats, 0, sizeof(s->stats));
+
+    // A PNG sequence keeps the name without its extension and numbers each frame
+    size_t len = strlen(path);
+    if (s->format == CHIP8_VIDEO_PNG) len -= 4;
+    s->path = (char*)malloc(len + 1);
+    if (!s->path || !spsc_ring_init(&s->queue, e->queue_frames, sizeof(Chip8VideoFrame))) {
+        fprintf(stderr, "Out of memory for video stream %s\n", path);
+        free(s->path);
+        atomic_store(&s->state, SLOT_FREE);
+        return NULL;
+    }
+    memcpy(s->path, path, len);
+    s->path[len] = '\0';
+
+    if (s->format != CHIP8_VIDEO_PNG) {
+        s->file = open_output(path);
+        bool ok = s->file != NULL;
+        if (ok && s->format == CHIP8_VIDEO_Y4M) {
+            ok = fprintf(s->file, "YUV4MPEG2 W%d H%d F60:1 Ip A1:1 C444\n",
+                CHIP8_VIDEO_WIDTH * e->scale, CHIP8_VIDEO_HEIGHT * e->scale) > 0;
+        }
+        if (!ok) {
+            fprintf(stderr, "Failed to create video file: %s\n", path);
+            if (s->file) fclose(s->file);
+            free(s->path);
+            spsc_ring_free(&s->queue);
+            atomic_store(&s->state, SLOT_FREE);
+            return NULL;
+        }
+    }
+    atomic_store(&s->state, SLOT_OPEN);
+    return s;
+}
+
+// Fill the claimed slot from the display and publish it
+static void fill_frame(Chip8VideoStream* s, Chip8VideoFrame* f, const Chip8* c8) {
+    int w, h;
+    const uint64_t* display = chip8_get_display(c8, &w, &h);
+    memcpy(f->rows, display, (size_t)h * sizeof(f->rows[0]));   // rows below h are never read
+    f->high_res = w == CHIP8_HIGH_RES_WIDTH;
+    f->sequence = s->sequence++;
+    spsc_ring_commit(&s->queue);
+    s->stats.captured++;
+}
+
+void chip8_video_capture(Chip8VideoStream* s, const Chip8* c8) {
+    Chip8VideoFrame* f = (Chip8VideoFrame*)spsc_ring_claim(&s->queue);
+    if (!f) {
+        uint64_t start = host_time_ns();
+        s->stats.stalls++;
+        while (!(f = (Chip8VideoFrame*)spsc_ring_claim(&s->queue))) {
+            host_sleep_until_ns(host_time_ns() + STALL_WAIT_NS);
+        }
+        s->stats.stall_ns += host_time_ns() - start;
+    }
+    fill_frame(s, f, c8);
+}
+
+bool chip8_video_try_capture(Chip8VideoStream* s, const Chip8* c8) {
+    Chip8VideoFrame* f = (Chip8VideoFrame*)spsc_ring_claim(&s->queue);
+    if (!f) {
+        s->stats.dropped++;
+        s->sequence++;
+        return false;
+    }
+    fill_frame(s, f, c8);
+    return true;
+}
+
+bool chip8_video_close(Chip8VideoStream* s, Chip8VideoStats* stats) {
+    atomic_store(&s->state, SLOT_CLOSING);
+    while (spsc_ring_count(&s->queue) > 0) host_sleep_until_ns(host_time_ns() + STALL_WAIT_NS);
+    while (atomic_exchange(&s->busy, true)) host_sleep_until_ns(host_time_ns() + STALL_WAIT_NS);
+
+    if (s->file && fclose(s->file) != 0) s->stats.failed = true;
+    s->file = NULL;
+    bool ok = !s->stats.failed;
+    if (stats) *stats = s->stats;
+    free(s->path);
+    s->path = NULL;
+    spsc_ring_free(&s->queue);
+
+    atomic_store(&s->state, SLOT_FREE);
+    atomic_store(&s->busy, false);
+    return ok;
+}
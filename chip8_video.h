@@ -0,0 +1,110 @@
+// Headless video capture: finished 60Hz frames go from the emulation threads into a bounded
+// queue per stream, and a pool of encoder threads scales them and writes Y4M, raw RGB24 or a
+// numbered PNG sequence. One encoder serves many streams, so a batch of instances running
+// faster than real time can all be captured at once.
+
+#ifndef CHIP8_VIDEO_H
+#define CHIP8_VIDEO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include "chip8.h"
+#include "host_thread.h"
+#include "spsc_ring.h"
+
+#define CHIP8_VIDEO_MAX_SCALE      8
+#define CHIP8_VIDEO_DEFAULT_SCALE  4
+#define CHIP8_VIDEO_DEFAULT_QUEUE  64    // frames queued per stream before capture waits or drops
+#define CHIP8_VIDEO_WIDTH          CHIP8_HIGH_RES_WIDTH    // output size before scaling; low-res
+#define CHIP8_VIDEO_HEIGHT         CHIP8_HIGH_RES_HEIGHT   // frames are doubled to fill it
+
+typedef enum Chip8VideoFormat {
+    CHIP8_VIDEO_Y4M,   // YUV4MPEG2, 4:4:4, 60 fps: plays in ffmpeg/mpv as is
+    CHIP8_VIDEO_RAW,   // packed RGB24 frames back to back
+    CHIP8_VIDEO_PNG,   // one indexed PNG per frame, numbered by frame
+} Chip8VideoFormat;
+
+// Format for an output path: .y4m, .png (the frame number goes before the extension) or
+// anything else as raw RGB24
+Chip8VideoFormat chip8_video_format_for_path(const char* path);
+const char* chip8_video_format_name(Chip8VideoFormat format);
+
+typedef struct Chip8VideoConfig {
+    int             threads;        // encoder threads, 0 = one per CPU
+    int             max_streams;    // streams open at the same time
+    uint32_t        queue_frames;   // per stream, 0 = CHIP8_VIDEO_DEFAULT_QUEUE
+    int             scale;          // 1..CHIP8_VIDEO_MAX_SCALE, 0 = CHIP8_VIDEO_DEFAULT_SCALE
+    const uint32_t* palette;        // ARGB per colour index (chip8_pixel_color), NULL = default
+    bool            smooth;         // Scale2x for the first doubling when the total factor is even
+} Chip8VideoConfig;
+
+// A captured frame as queued: the display in Chip8.display layout
+typedef struct Chip8VideoFrame {
+    uint64_t rows[CHIP8_HIGH_RES_HEIGHT][CHIP8_ROW_WORDS];
+    uint64_t sequence;   // frame number in the stream, counting dropped frames
+    bool     high_res;
+} Chip8VideoFrame;
+
+typedef struct Chip8VideoStats {
+    uint64_t captured;   // frames queued
+    uint64_t dropped;    // chip8_video_try_capture found the queue full
+    uint64_t stalls;     // chip8_video_capture waited for the encoder
+    uint64_t stall_ns;   // time those waits took
+    uint64_t written;    // frames in the output, including repeats standing in for dropped ones
+    bool     failed;     // an output could not be written
+} Chip8VideoStats;
+
+typedef struct Chip8VideoStream {
+    atomic_int       state;      // slot state, see chip8_video.c
+    atomic_bool      busy;       // an encoder thread (or the closing producer) owns the consumer side
+    SpscRing         queue;      // Chip8VideoFrame, producer -> encoder threads
+    Chip8VideoFormat format;
+    char*            path;
+    FILE*            file;       // Y4M and raw output
+    Chip8VideoFrame  last;       // consumer: last frame written, repeated over dropped ones
+    bool             has_last;
+    uint64_t         sequence;   // producer: number of the next frame
+    Chip8VideoStats  stats;      // producer fields, and consumer fields under `busy`
+} Chip8VideoStream;
+
+struct Chip8VideoWorker;
+
+typedef struct Chip8VideoEncoder {
+    Chip8VideoStream*        streams;   // max_streams slots
+    int                      max_streams;
+    struct Chip8VideoWorker* workers;    // worker_count, some of which may have failed to start
+    int                      worker_count;
+    uint32_t                 queue_frames;
+    int                      scale;
+    bool                     smooth;
+    uint32_t                 palette[1 << CHIP8_DISPLAY_PLANES];
+    atomic_bool              quit;
+} Chip8VideoEncoder;
+
+// Start the encoder threads. Returns false if memory or every thread failed.
+bool chip8_video_encoder_start(Chip8VideoEncoder* e, const Chip8VideoConfig* config);
+
+// Stop the encoder threads; close every stream first
+void chip8_video_encoder_stop(Chip8VideoEncoder* e);
+
+// Open a stream writing to `path` in the format its name selects. Any thread may open and
+// close streams; each stream is then captured from one thread. Returns NULL if every slot is
+// in use or the output cannot be created.
+Chip8VideoStream* chip8_video_open(Chip8VideoEncoder* e, const char* path);
+
+// Queue the current display of c8 (chip8_get_display) as the next frame. When the encoder
+// has fallen a whole queue behind this waits for room, counted in stats.stalls.
+void chip8_video_capture(Chip8VideoStream* s, const Chip8* c8);
+
+// Like chip8_video_capture, but never waits: a full queue drops the frame, counted in
+// stats.dropped, and the encoder repeats the previous frame so the timing stays intact.
+// Returns false if the frame was dropped.
+bool chip8_video_try_capture(Chip8VideoStream* s, const Chip8* c8);
+
+// Wait for the queued frames to be encoded, close the output and free the slot.
+// Fills `stats` if not NULL. Returns false if writing failed.
+bool chip8_video_close(Chip8VideoStream* s, Chip8VideoStats* stats);
+
+#endif // CHIP8_VIDEO_H
@@ -0,0 +1,773 @@
+// Differential fuzzer: generated or mutated ROMs with random key input run on a production
+// engine and on the reference interpreter (chip8_ref.h) side by side, across all cores.
+// Every case where the two disagree is minimized and saved as a ROM plus an input movie.
+// The lockstep engine (chip8_lockstep.h) runs each case on several lanes seeded apart, every
+// lane checked against a reference of its own.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "chip8.h"
+#include "chip8_engine.h"
+#include "chip8_lockstep.h"
+#include "chip8_movie.h"
+#include "chip8_ref.h"
+#include "host_thread.h"
+#include "work_pool.h"
+
+#define DEFAULT_CASES        1000
+#define DEFAULT_FRAMES       120     // 2 seconds of emulated time per case
+#define DEFAULT_IPF          32      // instructions per 60Hz frame
+#define GENERATED_MIN_WORDS  16
+#define GENERATED_MAX_WORDS  512
+#define MUTATIONS_MAX        8
+#define MINIMIZE_RUNS        4000    // reruns one minimization may spend
+#define ENGINE_CYCLE         (-1)    // chip8_cycle one instruction at a time, no engine
+#define ENGINE_LOCKSTEP      (-2)    // chip8_lockstep_run over cfg->lanes machines
+#define LANE_SEED_STEP       0x9E3779B97F4A7C15ull   // lane l runs with the case seed + l * this
+#define FULL_COMPARE_TICKS   60      // compare all of memory and the display once a second
+
+typedef struct RomImage {
+    const char* path;
+    uint8_t*    data;
+    size_t      size;
+} RomImage;
+
+typedef struct FuzzConfig {
+    int      threads;
+    int      cases;
+    uint64_t seed;
+    uint32_t frames;
+    uint32_t instructions_per_frame;
+    int      engine;           // Chip8EngineKind, ENGINE_CYCLE or ENGINE_LOCKSTEP
+    int      lanes;            // machines per case for ENGINE_LOCKSTEP
+    int      quirks;           // Chip8Quirks, or -1 for a random profile per case
+    bool     per_frame;        // compare at frame and input boundaries, not after every instruction
+    bool     minimize;
+    const char* out_dir;
+    const RomImage* corpus;    // ROMs to mutate; cases are generated from scratch if none
+    int      corpus_count;
+} FuzzConfig;
+
+// One test: a ROM and what to run it with. The movie carries the seed, the quirk profile and
+// the key and timer events; the run stops when cycle_count reaches end_cycle.
+typedef struct FuzzCase {
+    uint8_t*   rom;
+    size_t     size;
+    Chip8Movie movie;
+    uint64_t   end_cycle;
+} FuzzCase;
+
+typedef struct FuzzOutcome {
+    bool     diverged;
+    uint64_t cycle;          // cycle_count when the difference was seen
+    uint16_t pc;             // the machine's pc then
+    uint64_t instructions;   // executed by the production side
+    char     what[160];
+} FuzzOutcome;
+
+// ENGINE_LOCKSTEP scratch: the engine and a machine and reference per lane
+typedef struct FuzzLanes {
+    Chip8Lockstep engine;
+    Chip8         machines[CHIP8_LOCKSTEP_LANES];
+    Chip8Ref      refs[CHIP8_LOCKSTEP_LANES];
+} FuzzLanes;
+
+// Per-worker scratch, big enough for an XO-CHIP machine
+typedef struct FuzzWorker {
+    Chip8Xo     machine;
+    Chip8Ref    ref;
+    Chip8Engine engine;
+    bool        engine_ok;
+    FuzzLanes*  lanes;       // ENGINE_LOCKSTEP only
+} FuzzWorker;
+
+typedef struct CaseReport {
+    FuzzOutcome outcome;
+    uint8_t     quirks;
+    size_t      rom_size;      // after minimization
+    size_t      event_count;
+    char        saved[256];    // reproducer path without extension, empty if not saved
+} CaseReport;
+
+typedef struct FuzzJob {
+    const FuzzConfig* config;
+    FuzzWorker**      workers;
+    CaseReport*       reports;
+} FuzzJob;
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+        "Usage: %s [options] [rom ...]\n"
+        "  ROMs given are mutated into cases; without any, cases are generated from scratch.\n"
+        "  -n N   cases to run (default %d)\n"
+        "  -s N   seed; case i is reproducible from the seed and i (default 1)\n"
+        "  -f N   frames per case (default %d)\n"
+        "  -i N   instructions per 60Hz frame (default %d)\n"
+        "  -e E   production side: cycle (chip8_cycle), switch, threaded, jit, lockstep (default cycle)\n"
+        "  -L N   lockstep lanes per case, 1-%d, seeded apart (default %d); no XO-CHIP cases\n"
+        "  -Q P   quirk profile: modern, vip, chip48, schip, xochip (default: random per case)\n"
+        "  -F     compare at frame and input boundaries only (default: every instruction)\n"
+        "  -o D   directory for reproducers (default .)\n"
+        "  -M     save reproducers unminimized\n"
+        "  -t N   worker threads (default: one per CPU)\n"
+        "  -r ROM MOVIE  replay a saved reproducer and report its first difference\n",
+        prog, DEFAULT_CASES, DEFAULT_FRAMES, DEFAULT_IPF, CHIP8_LOCKSTEP_LANES, CHIP8_LOCKSTEP_LANES);
+}
+
+static bool read_rom_file(RomImage* rom) {
+    FILE* f = NULL;
+#ifdef _MSC_VER
+    fopen_s(&f, rom->path, "rb");
+#else
+    f = fopen(rom->path, "rb");
+#endif
+    if (!f) {
+        fprintf(stderr, "Failed to open ROM: %s\n", rom->path);
+        return false;
+    }
+    size_t limit = CHIP8_XO_MEMORY_SIZE - 0x200;
+    rom->data = (uint8_t*)malloc(limit);
+    rom->size = rom->data ? fread(rom->data, 1, limit, f) : 0;
+    fclose(f);
+    if (rom->size == 0) {
+        fprintf(stderr, "ROM empty or unreadable: %s\n", rom->path);
+        return false;
+    }
+    return true;
+}
+
+static bool write_file(const char* path, const uint8_t* data, size_t size) {
+    FILE* f = NULL;
+#ifdef _MSC_VER
+    fopen_s(&f, path, "wb");
+#else
+    f = fopen(path, "wb");
+#endif
+    if (!f) {
+        fprintf(stderr, "Failed to create %s\n", path);
+        return false;
+    }
+    bool ok = fwrite(data, 1, size, f) == size;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) fprintf(stderr, "Failed to write %s\n", path);
+    return ok;
+}
+
+// xorshift64*: a case is reproducible from its seed alone
+static uint32_t next_random(uint64_t* s) {
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return (uint32_t)((*s * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+// A random instruction, weighted towards ones that do something: jumps and calls land in the
+// ROM, I points at the ROM or the fonts, and the low bytes of 0nnn, 8xyN, Exkk and Fxkk are
+// ones some profile defines.
+static uint16_t random_opcode(uint64_t* s, size_t rom_size, bool xo) {
+    static const uint16_t system_ops[] = { 0x00E0, 0x00EE, 0x00FB, 0x00FC, 0x00FE, 0x00FF, 0x00C0, 0x00D0 };
+    static const uint8_t alu_ops[] = { 0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0xE };
+    static const uint8_t misc_ops[] = { 0x07, 0x0A, 0x15, 0x18, 0x1E, 0x29, 0x30, 0x33, 0x55, 0x65,
+                                        0x00, 0x01, 0x02, 0x3A };   // XO-CHIP only from 0x00 on
+    uint32_t r = next_random(s);
+    uint32_t operand = next_random(s);
+    size_t reach = rom_size < 0xE00 ? rom_size : 0xE00;
+    uint16_t target = (uint16_t)(0x200 + (operand % (reach / 2 + 1)) * 2);
+    uint16_t xy = (uint16_t)(r & 0x0FF0);
+
+    switch (r >> 28) {
+    case 0x0: {
+        if ((operand & 63) == 0) return 0x00FD;   // rare, it ends the case
+        uint16_t op = system_ops[(operand >> 8) % (xo ? 8 : 7)];
+        return op == 0x00C0 || op == 0x00D0 ? (uint16_t)(op | (r & 0xF)) : op;   // 00Cn / 00Dn
+    }
+    case 0x1: return (uint16_t)(0x1000 | target);
+    case 0x2: return (uint16_t)(0x2000 | target);
+    case 0x5: return (uint16_t)(0x5000 | xy | (xo ? (operand >> 8) % 4 : 0));
+    case 0x8: return (uint16_t)(0x8000 | xy | alu_ops[(operand >> 8) % sizeof(alu_ops)]);
+    case 0x9: return (uint16_t)(0x9000 | xy);
+    case 0xA: return (uint16_t)(0xA000 | (operand >> 31 ? target : (operand >> 8) % 0xA0));
+    case 0xE: return (uint16_t)(0xE000 | (xy & 0x0F00) | (operand >> 31 ? 0x9E : 0xA1));
+    case 0xF: return (uint16_t)(0xF000 | (xy & 0x0F00) | misc_ops[(operand >> 8) % (xo ? 14 : 10)]);
+    default:  return (uint16_t)(r >> 16);
+    }
+}
+
+static Chip8* reset_machine(FuzzWorker* w, Chip8Quirks quirks, uint64_t seed) {
+    Chip8* c8 = &w->machine.base;
+    if (quirks == CHIP8_QUIRKS_XOCHIP) {
+        chip8_xo_init(&w->machine);
+    }
+    else {
+        chip8_init(c8);
+        chip8_set_quirks(c8, quirks);
+    }
+    chip8_seed(c8, seed);
+    return c8;
+}
+
+static void free_case(FuzzCase* fc) {
+    free(fc->rom);
+    chip8_movie_free(&fc->movie);
+    memset(fc, 0, sizeof(*fc));
+}
+
+// Case `index`: a generated or mutated ROM, a random profile unless one was given, and a key
+// toggle in about one frame in four
+static bool build_case(const FuzzConfig* cfg, FuzzWorker* w, int index, FuzzCase* fc) {
+    memset(fc, 0, sizeof(*fc));
+    uint64_t s = (cfg->seed ^ 0x6A09E667F3BCC909ull) + (uint64_t)(index + 1) * 0x9E3779B97F4A7C15ull;
+    if (!s) s = 1;
+    next_random(&s);
+
+    // Lockstep lanes are classic machines: XO-CHIP, the last profile, is left out
+    uint32_t profiles = cfg->engine == ENGINE_LOCKSTEP ? CHIP8_QUIRKS_XOCHIP : CHIP8_QUIRKS_COUNT;
+    Chip8Quirks quirks = cfg->quirks >= 0 ? (Chip8Quirks)cfg->quirks
+                                          : (Chip8Quirks)(next_random(&s) % profiles);
+    bool xo = quirks == CHIP8_QUIRKS_XOCHIP;
+    size_t limit = (xo ? CHIP8_XO_MEMORY_SIZE : CHIP8_MEMORY_SIZE) - 0x200;
+
+    if (cfg->corpus_count) {
+        const RomImage* src = &cfg->corpus[next_random(&s) % (uint32_t)cfg->corpus_count];
+        fc->size = src->size < limit ? src->size : limit;
+        fc->rom = (uint8_t*)malloc(fc->size);
+        if (!fc->rom) return false;
+        memcpy(fc->rom, src->data, fc->size);
+
+        int mutations = 1 + (int)(next_random(&s) % MUTATIONS_MAX);
+        for (int m = 0; m < mutations; ++m) {
+            uint32_t r = next_random(&s);
+            size_t at = next_random(&s) % fc->size;
+            switch (r % 4) {
+            case 0: fc->rom[at] ^= (uint8_t)(1u << (r >> 8 & 7)); break;
+            case 1: fc->rom[at] = (uint8_t)(r >> 8); break;
+            case 2:
+                if ((at & ~(size_t)1) + 1 < fc->size) {
+                    uint16_t op = random_opcode(&s, fc->size, xo);
+                    fc->rom[at & ~(size_t)1] = (uint8_t)(op >> 8);
+                    fc->rom[(at & ~(size_t)1) + 1] = (uint8_t)op;
+                }
+                break;
+            default: {   // copy a run of bytes elsewhere
+                size_t from = next_random(&s) % fc->size;
+                size_t len = 1 + (r >> 8) % 16;
+                if (len > fc->size - at) len = fc->size - at;
+                if (len > fc->size - from) len = fc->size - from;
+                memmove(&fc->rom[at], &fc->rom[from], len);
+            } break;
+            }
+        }
+    }
+    else {
+        size_t words = GENERATED_MIN_WORDS + next_random(&s) % (GENERATED_MAX_WORDS - GENERATED_MIN_WORDS + 1);
+        fc->size = words * 2;
+        fc->rom = (uint8_t*)malloc(fc->size);
+        if (!fc->rom) return false;
+        for (size_t i = 0; i < words; ++i) {
+            uint16_t op = random_opcode(&s, fc->size, xo);
+            fc->rom[2 * i] = (uint8_t)(op >> 8);
+            fc->rom[2 * i + 1] = (uint8_t)op;
+        }
+    }
+
+    uint64_t seed = (uint64_t)next_random(&s) << 32 | next_random(&s);
+    Chip8* c8 = reset_machine(w, quirks, seed);
+    if (!chip8_load_rom_data(c8, fc->rom, fc->size)) return false;
+    chip8_movie_init(&fc->movie, seed, c8);
+
+    uint16_t down = 0;
+    uint32_t ipf = cfg->instructions_per_frame;
+    for (uint32_t f = 0; f < cfg->frames; ++f) {
+        uint64_t start = (uint64_t)f * ipf;
+        uint32_t r = next_random(&s);
+        if (r % 4 == 0) {
+            uint8_t key = (uint8_t)(r >> 8 & 0xF);
+            Chip8MovieEventType type = down >> key & 1 ? CHIP8_MOVIE_KEY_UP : CHIP8_MOVIE_KEY_DOWN;
+            down ^= (uint16_t)(1u << key);
+            if (!chip8_movie_add(&fc->movie, start + (r >> 12) % ipf, type, key)) return false;
+        }
+        if (!chip8_movie_add(&fc->movie, start + ipf, CHIP8_MOVIE_TICK, 0)) return false;
+    }
+    fc->end_cycle = (uint64_t)cfg->frames * ipf;
+    return true;
+}
+
+// run_case for ENGINE_LOCKSTEP: cfg->lanes machines with the case's ROM and input, lane l
+// seeded with seed + l * LANE_SEED_STEP so Cxkk sends the lanes down different paths. After
+// every slice each lane is compared with its own reference, and a lane still running must have
+// executed the whole slice. out->instructions counts every lane.
+static bool run_lockstep_case(const FuzzConfig* cfg, FuzzWorker* w, const FuzzCase* fc, uint64_t end,
+    FuzzOutcome* out)
+{
+    FuzzLanes* lanes = w->lanes;
+    Chip8* machines[CHIP8_LOCKSTEP_LANES];
+    int count = cfg->lanes;
+    for (int l = 0; l < count; ++l) {
+        Chip8* c8 = &lanes->machines[l];
+        chip8_init(c8);
+        if (!chip8_set_quirks(c8, (Chip8Quirks)fc->movie.quirks)) return false;
+        chip8_seed(c8, fc->movie.seed + (uint64_t)l * LANE_SEED_STEP);
+        if (!chip8_load_rom_data(c8, fc->rom, fc->size)) return false;
+        chip8_ref_load(&lanes->refs[l], c8);
+        machines[l] = c8;
+    }
+    if (!chip8_lockstep_init(&lanes->engine, machines, count)) return false;
+
+    const Chip8Movie* movie = &fc->movie;
+    size_t next = 0;
+    uint32_t ticks = 0;
+    uint64_t cycle = 0;   // cycle_count of every lane still running
+    bool running = true;
+    int bad = -1;
+    char what[sizeof(out->what) - 24];
+    while (bad < 0 && running && cycle < end) {
+        bool full = false;
+        while (next < movie->count && movie->events[next].cycle <= cycle) {
+            const Chip8MovieEvent* ev = &movie->events[next++];
+            if (ev->type == CHIP8_MOVIE_TICK && ++ticks % FULL_COMPARE_TICKS == 0) full = true;
+            for (int l = 0; l < count; ++l) {
+                if (ev->type == CHIP8_MOVIE_TICK) {
+                    chip8_tick_timers(machines[l]);
+                    chip8_ref_tick_timers(&lanes->refs[l]);
+                }
+                else {
+                    bool pressed = ev->type == CHIP8_MOVIE_KEY_DOWN;
+                    machines[l]->keys[ev->key & 0xF] = pressed;
+                    lanes->refs[l].keys[ev->key & 0xF] = pressed;
+                }
+            }
+        }
+
+        uint64_t left = end - cycle;
+        if (next < movie->count && movie->events[next].cycle - cycle < left) {
+            left = movie->events[next].cycle - cycle;
+        }
+        if (!cfg->per_frame) left = 1;
+        uint32_t slice = left > UINT32_MAX ? UINT32_MAX : (uint32_t)left;
+
+        out->instructions += chip8_lockstep_run(&lanes->engine, slice);
+        chip8_lockstep_sync(&lanes->engine);
+        cycle += slice;
+
+        running = false;
+        for (int l = 0; l < count && bad < 0; ++l) {
+            uint32_t ran = lanes->engine.executed[l];
+            for (uint32_t i = 0; i < ran; ++i) chip8_ref_step(&lanes->refs[l]);
+            if (machines[l]->running && ran != slice) {
+                snprintf(what, sizeof(what), "ran %u of %u instructions while running", ran, slice);
+                bad = l;
+            }
+            else if (!chip8_ref_compare(&lanes->refs[l], machines[l], full, what, sizeof(what))) {
+                bad = l;
+            }
+            running = running || machines[l]->running;
+        }
+    }
+    for (int l = 0; l < count && bad < 0; ++l) {
+        if (!chip8_ref_compare(&lanes->refs[l], machines[l], true, what, sizeof(what))) bad = l;
+    }
+
+    const Chip8* shown = machines[bad < 0 ? 0 : bad];
+    out->diverged = bad >= 0;
+    out->cycle = shown->cycle_count;
+    out->pc = shown->pc;
+    if (bad >= 0) snprintf(out->what, sizeof(out->what), "lane %d: %s", bad, what);
+    return true;
+}
+
+// Run a case on both sides until cycle_count reaches `end`, the machine halts or they differ.
+// Returns false if the ROM does not load.
+static bool run_case(const FuzzConfig* cfg, FuzzWorker* w, const FuzzCase* fc, uint64_t end, FuzzOutcome* out) {
+    memset(out, 0, sizeof(*out));
+    if (cfg->engine == ENGINE_LOCKSTEP) return run_lockstep_case(cfg, w, fc, end, out);
+    Chip8* c8 = reset_machine(w, (Chip8Quirks)fc->movie.quirks, fc->movie.seed);
+    if (!chip8_load_rom_data(c8, fc->rom, fc->size)) return false;
+    if (w->engine_ok) chip8_engine_reset(&w->engine);
+    Chip8Ref* ref = &w->ref;
+    chip8_ref_load(ref, c8);
+
+    // Between full comparisons only what either side touched is compared: the reference's
+    // own record, and the machine's dirty rows and pages (a missed mark still shows up at
+    // the next full comparison)
+    const Chip8Movie* movie = &fc->movie;
+    size_t next = 0;
+    uint32_t ticks = 0;
+    bool same = true;
+    while (same && c8->running && c8->cycle_count < end) {
+        bool full = false;
+        while (next < movie->count && movie->events[next].cycle <= c8->cycle_count) {
+            const Chip8MovieEvent* ev = &movie->events[next++];
+            if (ev->type == CHIP8_MOVIE_TICK) {
+                chip8_tick_timers(c8);
+                chip8_ref_tick_timers(ref);
+                if (++ticks % FULL_COMPARE_TICKS == 0) full = true;
+            }
+            else {
+                bool pressed = ev->type == CHIP8_MOVIE_KEY_DOWN;
+                c8->keys[ev->key & 0xF] = pressed;
+                ref->keys[ev->key & 0xF] = pressed;
+            }
+        }
+
+        uint64_t left = end - c8->cycle_count;
+        if (next < movie->count && movie->events[next].cycle - c8->cycle_count < left) {
+            left = movie->events[next].cycle - c8->cycle_count;
+        }
+        if (!cfg->per_frame) left = 1;
+        uint32_t slice = left > UINT32_MAX ? UINT32_MAX : (uint32_t)left;
+
+        uint32_t ran = 0;
+        if (cfg->engine == ENGINE_CYCLE) {
+            for (; ran < slice && c8->running; ++ran) chip8_cycle(c8);
+        }
+        else {
+            ran = chip8_engine_run(&w->engine, c8, slice);
+        }
+        for (uint32_t i = 0; i < ran; ++i) chip8_ref_step(ref);
+        out->instructions += ran;
+
+        same = chip8_ref_compare(ref, c8, full, out->what, sizeof(out->what));
+    }
+    if (same) same = chip8_ref_compare(ref, c8, true, out->what, sizeof(out->what));
+
+    out->diverged = !same;
+    out->cycle = c8->cycle_count;
+    out->pc = c8->pc;
+    return true;
+}
+
+// Drop the events from `end` on: they would apply after the last instruction compared
+static void cut_events(FuzzCase* fc) {
+    while (fc->movie.count && fc->movie.events[fc->movie.count - 1].cycle >= fc->end_cycle) fc->movie.count--;
+}
+
+// Greedy delta debugging: remove chunks of input events, then blank chunks of ROM words to
+// 0000 (ignored by every profile), halving the chunk size each pass and keeping every change
+// after which the case still diverges. Each kept change also moves the end of the run to the
+// new point of divergence. Trailing zero bytes of the ROM are then trimmed, which changes
+// nothing as memory past the ROM is zero.
+static void minimize(const FuzzConfig* cfg, FuzzWorker* w, FuzzCase* fc, FuzzOutcome* best) {
+    int runs = 0;
+    FuzzOutcome trial;
+    fc->end_cycle = best->cycle;
+    cut_events(fc);
+
+    Chip8MovieEvent* saved = fc->movie.count ? (Chip8MovieEvent*)malloc(fc->movie.count * sizeof(Chip8MovieEvent)) : NULL;
+    if (saved) {
+        for (size_t chunk = fc->movie.count > 1 ? fc->movie.count / 2 : 1; runs < MINIMIZE_RUNS; chunk /= 2) {
+            for (size_t start = 0; start < fc->movie.count && runs < MINIMIZE_RUNS;) {
+                Chip8MovieEvent* events = fc->movie.events;
+                size_t len = chunk < fc->movie.count - start ? chunk : fc->movie.count - start;
+                memcpy(saved, &events[start], len * sizeof(Chip8MovieEvent));
+                memmove(&events[start], &events[start + len], (fc->movie.count - start - len) * sizeof(Chip8MovieEvent));
+                fc->movie.count -= len;
+
+                runs++;
+                if (run_case(cfg, w, fc, fc->end_cycle, &trial) && trial.diverged) {
+                    *best = trial;
+                    fc->end_cycle = trial.cycle;
+                    cut_events(fc);
+                    continue;
+                }
+                memmove(&events[start + len], &events[start], (fc->movie.count - start) * sizeof(Chip8MovieEvent));
+                memcpy(&events[start], saved, len * sizeof(Chip8MovieEvent));
+                fc->movie.count += len;
+                start += len;
+            }
+            if (chunk == 1) break;
+        }
+        free(saved);
+    }
+
+    size_t words = fc->size / 2;
+    uint8_t* original = words ? (uint8_t*)malloc(fc->size) : NULL;
+    if (original) {
+        for (size_t chunk = words > 1 ? words / 2 : 1; runs < MINIMIZE_RUNS; chunk /= 2) {
+            for (size_t start = 0; start < words && runs < MINIMIZE_RUNS; start += chunk) {
+                size_t len = chunk < words - start ? chunk : words - start;
+                uint8_t* bytes = &fc->rom[2 * start];
+                bool blank = true;
+                for (size_t i = 0; i < 2 * len; ++i) blank = blank && bytes[i] == 0;
+                if (blank) continue;
+
+                memcpy(original, bytes, 2 * len);
+                memset(bytes, 0, 2 * len);
+                runs++;
+                if (run_case(cfg, w, fc, fc->end_cycle, &trial) && trial.diverged) {
+                    *best = trial;
+                    fc->end_cycle = trial.cycle;
+                    cut_events(fc);
+                }
+                else {
+                    memcpy(bytes, original, 2 * len);
+                }
+            }
+            if (chunk == 1) break;
+        }
+        free(original);
+    }
+
+    while (fc->size > 1 && fc->rom[fc->size - 1] == 0) fc->size--;
+}
+
+// Write <out_dir>/fuzz_<index>.ch8 and .c8m. The movie's last event is a tick at the cycle of
+// the divergence, so a replay runs exactly that far.
+static bool save_case(const FuzzConfig* cfg, FuzzWorker* w, FuzzCase* fc, int index, char* stem, size_t size) {
+    snprintf(stem, size, "%s/fuzz_%d", cfg->out_dir, index);
+    char path[300];
+
+    Chip8* c8 = reset_machine(w, (Chip8Quirks)fc->movie.quirks, fc->movie.seed);
+    if (!chip8_load_rom_data(c8, fc->rom, fc->size)) return false;
+    fc->movie.rom_hash = chip8_movie_rom_hash(c8);
+    size_t count = fc->movie.count;
+    if (!count || fc->movie.events[count - 1].cycle < fc->end_cycle) {
+        if (!chip8_movie_add(&fc->movie, fc->end_cycle, CHIP8_MOVIE_TICK, 0)) return false;
+    }
+
+    snprintf(path, sizeof(path), "%s.ch8", stem);
+    if (!write_file(path, fc->rom, fc->size)) return false;
+    snprintf(path, sizeof(path), "%s.c8m", stem);
+    return chip8_movie_save(&fc->movie, path);
+}
+
+static void run_fuzz_case(void* ctx, int task, int worker) {
+    FuzzJob* job = (FuzzJob*)ctx;
+    const FuzzConfig* cfg = job->config;
+    FuzzWorker* w = job->workers[worker];
+    CaseReport* report = &job->reports[task];
+
+    FuzzCase fc;
+    if (build_case(cfg, w, task, &fc) && run_case(cfg, w, &fc, fc.end_cycle, &report->outcome)) {
+        report->quirks = fc.movie.quirks;
+        if (report->outcome.diverged) {
+            uint64_t executed = report->outcome.instructions;
+            if (cfg->minimize) minimize(cfg, w, &fc, &report->outcome);
+            report->outcome.instructions = executed;
+            if (!save_case(cfg, w, &fc, task, report->saved, sizeof(report->saved))) report->saved[0] = '\0';
+            report->rom_size = fc.size;
+            report->event_count = fc.movie.count;
+        }
+    }
+    free_case(&fc);
+}
+
+static FuzzWorker* create_worker(const FuzzConfig* cfg) {
+    FuzzWorker* w = (FuzzWorker*)calloc(1, sizeof(FuzzWorker));
+    if (!w) return NULL;
+    if (cfg->engine == ENGINE_LOCKSTEP) {
+        w->lanes = (FuzzLanes*)calloc(1, sizeof(FuzzLanes));
+        if (!w->lanes) {
+            free(w);
+            return NULL;
+        }
+    }
+    else if (cfg->engine != ENGINE_CYCLE) {
+        w->engine_ok = chip8_engine_create(&w->engine, (Chip8EngineKind)cfg->engine);
+        if (!w->engine_ok) {
+            chip8_engine_destroy(&w->engine);
+            free(w);
+            return NULL;
+        }
+    }
+    return w;
+}
+
+static void destroy_worker(FuzzWorker* w) {
+    if (!w) return;
+    if (w->engine_ok) chip8_engine_destroy(&w->engine);
+    free(w->lanes);
+    free(w);
+}
+
+static const char* engine_label(int engine) {
+    if (engine == ENGINE_CYCLE) return "cycle";
+    if (engine == ENGINE_LOCKSTEP) return "lockstep";
+    return chip8_engine_name((Chip8EngineKind)engine);
+}
+
+static void print_outcome(const FuzzOutcome* o) {
+    printf("diverged at cycle %llu, pc %04X: %s\n", (unsigned long long)o->cycle, o->pc, o->what);
+}
+
+// -r: run a saved reproducer up to its last event
+static int replay(const FuzzConfig* cfg, const char* rom_path, const char* movie_path) {
+    RomImage rom = { rom_path, NULL, 0 };
+    FuzzCase fc;
+    memset(&fc, 0, sizeof(fc));
+    FuzzWorker* w = create_worker(cfg);
+    if (!w || !read_rom_file(&rom) || !chip8_movie_load(&fc.movie, movie_path)) {
+        destroy_worker(w);
+        free(rom.data);
+        return 1;
+    }
+    fc.rom = rom.data;
+    fc.size = rom.size;
+    fc.end_cycle = fc.movie.count ? fc.movie.events[fc.movie.count - 1].cycle
+                                  : (uint64_t)cfg->frames * cfg->instructions_per_frame;
+
+    FuzzOutcome outcome;
+    int status = 1;
+    if (run_case(cfg, w, &fc, fc.end_cycle, &outcome)) {
+        printf("%s, %s quirks, engine %s, %llu instructions: ", rom_path,
+            chip8_quirks_name((Chip8Quirks)fc.movie.quirks), engine_label(cfg->engine),
+            (unsigned long long)outcome.instructions);
+        if (outcome.diverged) print_outcome(&outcome);
+        else printf("no difference\n");
+        status = outcome.diverged ? 1 : 0;
+    }
+    free_case(&fc);
+    destroy_worker(w);
+    return status;
+}
+
+int main(int argc, char* argv[]) {
+    FuzzConfig cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.cases = DEFAULT_CASES;
+    cfg.seed = 1;
+    cfg.frames = DEFAULT_FRAMES;
+    cfg.instructions_per_frame = DEFAULT_IPF;
+    cfg.engine = ENGINE_CYCLE;
+    cfg.lanes = CHIP8_LOCKSTEP_LANES;
+    cfg.quirks = -1;
+    cfg.minimize = true;
+    cfg.out_dir = ".";
+
+    const char* replay_rom = NULL;
+    const char* replay_movie = NULL;
+    RomImage* corpus = (RomImage*)calloc((size_t)argc, sizeof(RomImage));
+    if (!corpus) return 1;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(arg, "-n") == 0 && has_value) {
+            cfg.cases = atoi(argv[++i]);
+        }
+        else if (strcmp(arg, "-s") == 0 && has_value) {
+            cfg.seed = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(arg, "-f") == 0 && has_value) {
+            cfg.frames = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(arg, "-i") == 0 && has_value) {
+            cfg.instructions_per_frame = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(arg, "-e") == 0 && has_value) {
+            Chip8EngineKind kind;
+            const char* name = argv[++i];
+            if (strcmp(name, "cycle") == 0) {
+                cfg.engine = ENGINE_CYCLE;
+            }
+            else if (strcmp(name, "lockstep") == 0) {
+                cfg.engine = ENGINE_LOCKSTEP;
+            }
+            else if (chip8_engine_parse(name, &kind)) {
+                cfg.engine = (int)kind;
+            }
+            else {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(arg, "-L") == 0 && has_value) {
+            cfg.lanes = atoi(argv[++i]);
+        }
+        else if (strcmp(arg, "-Q") == 0 && has_value) {
+            Chip8Quirks quirks;
+            if (!chip8_quirks_parse(argv[++i], &quirks)) {
+                usage(argv[0]);
+                return 1;
+            }
+            cfg.quirks = (int)quirks;
+        }
+        else if (strcmp(arg, "-F") == 0) {
+            cfg.per_frame = true;
+        }
+        else if (strcmp(arg, "-o") == 0 && has_value) {
+            cfg.out_dir = argv[++i];
+        }
+        else if (strcmp(arg, "-M") == 0) {
+            cfg.minimize = false;
+        }
+        else if (strcmp(arg, "-t") == 0 && has_value) {
+            cfg.threads = atoi(argv[++i]);
+        }
+        else if (strcmp(arg, "-r") == 0 && i + 2 < argc) {
+            replay_rom = argv[++i];
+            replay_movie = argv[++i];
+        }
+        else if (arg[0] == '-') {
+            usage(argv[0]);
+            return 1;
+        }
+        else {
+            corpus[cfg.corpus_count].path = arg;
+            if (!read_rom_file(&corpus[cfg.corpus_count])) return 1;
+            cfg.corpus_count++;
+        }
+    }
+
+    if (cfg.cases <= 0 || cfg.instructions_per_frame == 0 ||
+        cfg.lanes < 1 || cfg.lanes > CHIP8_LOCKSTEP_LANES ||
+        (cfg.engine == ENGINE_LOCKSTEP && cfg.quirks == CHIP8_QUIRKS_XOCHIP)) {
+        usage(argv[0]);
+        return 1;
+    }
+    cfg.corpus = corpus;
+
+    if (replay_rom) {
+        free(corpus);
+        return replay(&cfg, replay_rom, replay_movie);
+    }
+
+    CaseReport* reports = (CaseReport*)calloc((size_t)cfg.cases, sizeof(CaseReport));
+    int workers = work_pool_thread_count(cfg.threads, cfg.cases);
+    FuzzWorker** scratch = (FuzzWorker**)calloc((size_t)workers, sizeof(FuzzWorker*));
+    if (!reports || !scratch) return 1;
+    for (int w = 0; w < workers; ++w) {
+        scratch[w] = create_worker(&cfg);
+        if (!scratch[w]) {
+            fprintf(stderr, "Failed to create worker state\n");
+            return 1;
+        }
+    }
+
+    FuzzJob job = { &cfg, scratch, reports };
+    uint64_t start = host_time_ns();
+    work_pool_run(workers, cfg.cases, run_fuzz_case, &job);
+    uint64_t wall_ns = host_time_ns() - start;
+
+    uint64_t total_instructions = 0;
+    int diverged = 0;
+    for (int i = 0; i < cfg.cases; ++i) {
+        const CaseReport* r = &reports[i];
+        total_instructions += r->outcome.instructions;
+        if (!r->outcome.diverged) continue;
+        diverged++;
+        printf("case %d (%s): ", i, chip8_quirks_name((Chip8Quirks)r->quirks));
+        print_outcome(&r->outcome);
+        if (r->saved[0]) {
+            printf("  saved %s.ch8 (%zu bytes) and %s.c8m (%zu events)\n",
+                r->saved, r->rom_size, r->saved, r->event_count);
+        }
+    }
+
+    double seconds = (double)wall_ns / 1e9;
+    printf("# engine=%s compare=%s cases=%d diverged=%d threads=%d instructions=%llu seconds=%.3f ips=%.0f\n",
+        engine_label(cfg.engine), cfg.per_frame ? "frame" : "instruction",
+        cfg.cases, diverged, workers,
+        (unsigned long long)total_instructions, seconds,
+        seconds > 0.0 ? (double)total_instructions / seconds : 0.0);
+
+    for (int w = 0; w < workers; ++w) destroy_worker(scratch[w]);
+    free(scratch);
+    free(reports);
+    for (int i = 0; i < cfg.corpus_count; ++i) free(corpus[i].data);
+    free(corpus);
+    return diverged ? 1 : 0;
+}
@@ -0,0 +1,116 @@
+// Win32 / POSIX implementation of the host threading and timing helpers.
+
+#include "host_thread.h"
+#include <stdlib.h>
+
+#ifdef _WIN32
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#else
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+typedef struct ThreadStart {
+    HostThreadFn fn;
+    void* arg;
+} ThreadStart;
+
+#ifdef _WIN32
+static DWORD WINAPI thread_entry(LPVOID p) {
+#else
+static void* thread_entry(void* p) {
+#endif
+    ThreadStart start = *(ThreadStart*)p;
+    free(p);
+    start.fn(start.arg);
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+bool host_thread_start(HostThread* t, HostThreadFn fn, void* arg) {
+    ThreadStart* start = (ThreadStart*)malloc(sizeof(ThreadStart));
+    if (!start) return false;
+    start->fn = fn;
+    start->arg = arg;
+
+#ifdef _WIN32
+    t->handle = CreateThread(NULL, 0, thread_entry, start, 0, NULL);
+    if (!t->handle) {
+        free(start);
+        return false;
+    }
+#else
+    if (pthread_create(&t->handle, NULL, thread_entry, start) != 0) {
+        free(start);
+        return false;
+    }
+#endif
+    return true;
+}
+
+void host_thread_join(HostThread* t) {
+#ifdef _WIN32
+    WaitForSingleObject(t->handle, INFINITE);
+    CloseHandle(t->handle);
+#else
+    pthread_join(t->handle, NULL);
+#endif
+}
+
+int host_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+uint64_t host_time_ns(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)((double)now.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+void host_sleep_until_ns(uint64_t deadline_ns) {
+#ifdef _WIN32
+    uint64_t now = host_time_ns();
+    if (deadline_ns <= now) return;
+
+    // High-resolution timers need Windows 10 1803+; older systems get the default timer.
+    HANDLE timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!timer) timer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+    if (!timer) {
+        Sleep((DWORD)((deadline_ns - now) / 1000000));
+        return;
+    }
+    LARGE_INTEGER due;
+    due.QuadPart = -(LONGLONG)((deadline_ns - now) / 100);   // relative, 100ns units
+    if (SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE)) {
+        WaitForSingleObject(timer, INFINITE);
+    }
+    CloseHandle(timer);
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadline_ns / 1000000000ull);
+    ts.tv_nsec = (long)(deadline_ns % 1000000000ull);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+#endif
+}
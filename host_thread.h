@@ -0,0 +1,39 @@
+// Minimal host threading and timing helpers shared by the frontend and the headless tools.
+
+#ifndef HOST_THREAD_H
+#define HOST_THREAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <windows.h>
+typedef struct HostThread {
+    HANDLE handle;
+} HostThread;
+#else
+#include <pthread.h>
+typedef struct HostThread {
+    pthread_t handle;
+} HostThread;
+#endif
+
+typedef void (*HostThreadFn)(void* arg);
+
+// Start a thread running fn(arg). Returns false if the thread could not be created.
+bool host_thread_start(HostThread* t, HostThreadFn fn, void* arg);
+
+// Wait for a thread started with host_thread_start to finish.
+void host_thread_join(HostThread* t);
+
+// Number of online logical CPUs (at least 1).
+int host_cpu_count(void);
+
+// Monotonic clock in nanoseconds.
+uint64_t host_time_ns(void);
+
+// Sleep until host_time_ns() reaches deadline_ns, on a high-resolution timer
+// (absolute clock_nanosleep / high-resolution waitable timer). Returns at once if it already passed.
+void host_sleep_until_ns(uint64_t deadline_ns);
+
+#endif // HOST_THREAD_H
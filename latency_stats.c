@@ -0,0 +1,47 @@
+// Latency histogram accumulation and percentile reporting.
+
+#include "latency_stats.h"
+#include <string.h>
+
+void latency_stats_init(LatencyStats* s) {
+    memset(s, 0, sizeof(*s));
+}
+
+void latency_stats_add(LatencyStats* s, uint64_t ns) {
+    uint64_t bucket = ns / LATENCY_BUCKET_NS;
+    if (bucket >= LATENCY_BUCKETS) bucket = LATENCY_BUCKETS - 1;
+    s->buckets[bucket]++;
+    s->count++;
+    s->total_ns += ns;
+    if (ns > s->max_ns) s->max_ns = ns;
+}
+
+uint64_t latency_stats_percentile(const LatencyStats* s, double percentile) {
+    if (s->count == 0) return 0;
+    uint64_t rank = (uint64_t)((double)s->count * percentile / 100.0);
+    if (rank >= s->count) rank = s->count - 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS - 1; ++i) {
+        seen += s->buckets[i];
+        if (seen > rank) {
+            uint64_t edge = (uint64_t)(i + 1) * LATENCY_BUCKET_NS;
+            return edge < s->max_ns ? edge : s->max_ns;
+        }
+    }
+    return s->max_ns;
+}
+
+static double ms(uint64_t ns) {
+    return (double)ns / 1e6;
+}
+
+void latency_stats_print(const LatencyStats* s, const char* label, FILE* out) {
+    if (s->count == 0) {
+        fprintf(out, "%s: no samples\n", label);
+        return;
+    }
+    fprintf(out, "%s: n=%llu mean=%.2fms p50=%.2fms p99=%.2fms max=%.2fms\n", label,
+        (unsigned long long)s->count, ms(s->total_ns / s->count),
+        ms(latency_stats_percentile(s, 50.0)), ms(latency_stats_percentile(s, 99.0)), ms(s->max_ns));
+}
@@ -0,0 +1,29 @@
+// Fixed-bucket latency histogram for the input latency instrumentation.
+
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define LATENCY_BUCKET_NS 250000ull   // 0.25 ms per bucket
+#define LATENCY_BUCKETS   400         // up to 100 ms; the last bucket takes anything slower
+
+typedef struct LatencyStats {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint32_t buckets[LATENCY_BUCKETS];
+} LatencyStats;
+
+void latency_stats_init(LatencyStats* s);
+
+void latency_stats_add(LatencyStats* s, uint64_t ns);
+
+// Upper edge of the bucket holding the given percentile (0-100), capped at max_ns; 0 when empty
+uint64_t latency_stats_percentile(const LatencyStats* s, double percentile);
+
+// One line: "label: n=.. mean=..ms p50=..ms p99=..ms max=..ms"
+void latency_stats_print(const LatencyStats* s, const char* label, FILE* out);
+
+#endif // LATENCY_STATS_H
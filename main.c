@@ -1,133 +1,421 @@
-// Initialize and run a CHIP-8 / Super CHIP-8 emulator with SDL for graphics and input handling.
-
-#include <stdio.h>
-#include <stdbool.h>
-#include <windows.h> // For Beep()
-#define SDL_MAIN_HANDLED
-#include <SDL.h>
-
-#include "chip8.h"
-#include "platform.h"
-#include "rom_browser.h"
-
-// Desired speeds
-#define CPU_HZ   700
-#define TIMER_HZ 60
-
-int main(int argc, char* argv[]) {
-    (void)argc;
-    (void)argv;
-
-    // Console: ROM browser
-    roms_ensure_directory();
-
-    RomList roms;
-    if (!roms_scan(&roms)) {
-        printf("Error scanning ROMs directory.\n");
-        printf("Press Enter to exit...\n");
-        getchar();
-        return 1;
-    }
-
-    if (roms.count == 0) {
-        printf("No ROMs found. Place .ch8 / Super CHIP-8 ROM files into the ROMs folder.\n");
-        printf("Press Enter to exit...\n");
-        getchar();
-        roms_free(&roms);
-        return 0;
-    }
-
-    int idx = roms_prompt_selection(&roms);
-    if (idx < 0) {
-        roms_free(&roms);
-        return 0;
-    }
-
-    const char* rom_path = roms.paths[idx];
-    printf("Loading ROM: %s\n", rom_path);
-
-    // Initialize CHIP-8 machine
-    Chip8 chip8;
-    chip8_init(&chip8);
-
-    if (!chip8_load_rom(&chip8, rom_path)) {
-        printf("Failed to load ROM.\n");
-        printf("Press Enter to exit...\n");
-        getchar();
-        roms_free(&roms);
-        return 1;
-    }
-
-    roms_free(&roms);
-
-    // Initialize SDL platform
-    // Use high-res logical size; SDL will scale low-res as needed.
-    int logical_w = CHIP8_HIGH_RES_WIDTH;
-    int logical_h = CHIP8_HIGH_RES_HEIGHT;
-
-    // Window scaling factor
-    int scale = 8; // 128*8 = 1024, 64*8 = 512
-    int window_w = logical_w * scale;
-    int window_h = logical_h * scale;
-
-    if (!platform_init("CHIP-8 / Super CHIP-8 Emulator",
-        window_w, window_h,
-        logical_w, logical_h)) {
-        printf("Failed to initialize SDL.\n");
-        printf("Press Enter to exit...\n");
-        getchar();
-        return 1;
-    }
-
-    bool quit = false;
-    Uint32 last_timer_tick = SDL_GetTicks();
-    Uint32 last_cycle_tick = SDL_GetTicks();
-
-    // Main emulation loop
-    while (!quit && chip8.running) {
-        Uint32 now = SDL_GetTicks();
-        Uint32 elapsed_ms = now - last_cycle_tick;
-
-        // Run enough cycles to approximate CPU_HZ
-        double cycles_to_run_f = (double)elapsed_ms * CPU_HZ / 1000.0;
-        int cycles_to_run = (int)cycles_to_run_f;
-        if (cycles_to_run <= 0) {
-            cycles_to_run = 1;
-        }
-
-        for (int i = 0; i < cycles_to_run && chip8.running; ++i) {
-            chip8_cycle(&chip8);
-        }
-        last_cycle_tick = now;
-
-        // Timers at 60Hz
-        Uint32 timer_now = SDL_GetTicks();
-        if (timer_now - last_timer_tick >= (1000 / TIMER_HZ)) {
-            if (chip8.delay_timer > 0) {
-                chip8.delay_timer--;
-            }
-            if (chip8.sound_timer > 0) {
-                // Simple square beep; you can enhance with SDL audio if desired
-                Beep(800, 10); // frequency 800Hz, duration 10ms
-                chip8.sound_timer--;
-            }
-            last_timer_tick = timer_now;
-        }
-
-        // Handle input (ESC or window close should quit)
-        platform_handle_input(&chip8, &quit);
-
-        // Redraw if needed
-        if (chip8.draw_flag) {
-            platform_draw(&chip8);
-            chip8.draw_flag = false;
-        }
-
-        SDL_Delay(1); // Small delay to avoid 100% CPU usage
-    }
-
-    platform_cleanup();
-
-    // When emulator exits (ESC or window close), console will also terminate because the process ends.
-    return 0;
-}
+// Initialize and run a CHIP-8 / Super CHIP-8 emulator with SDL for graphics and input handling.
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#define SDL_MAIN_HANDLED
+#include <SDL.h>
+
+#include "audio.h"
+#include "chip8.h"
+#include "chip8_gdb.h"
+#include "chip8_movie.h"
+#include "chip8_profile.h"
+#include "chip8_trace.h"
+#include "host_thread.h"
+#include "latency_stats.h"
+#include "platform.h"
+#include "rom_browser.h"
+#include "scheduler.h"
+#include "spsc_ring.h"
+#include "triple_buffer.h"
+
+// Default speed
+#define CPU_HZ   700
+
+#define KEY_QUEUE_CAPACITY 256
+#define INPUT_WAIT_MS      100   // render thread idle wait; new frames and input end it early
+#define INPUT_SLICES       8     // a frame's instructions run in this many paced slices; keys apply between them
+
+// Everything the emulation thread owns or shares with the render/input (main) thread
+typedef struct Emulation {
+    Chip8*        chip8;
+    Scheduler*    sched;
+    Audio*        audio;        // NULL when audio is unavailable
+    Chip8Movie*   movie;        // NULL unless recording
+    Chip8Trace*   trace;        // NULL unless tracing
+    Chip8Gdb*     gdb;          // NULL unless --gdb
+    SpscRing*     key_events;   // PlatformKeyEvent, main thread -> emulation thread
+    TripleBuffer* frames;       // emulation thread -> main thread
+    atomic_bool   quit;         // set by the main thread
+    atomic_bool   done;         // set by the emulation thread when it stops
+
+    // --latency: emulation-thread side of the key-to-photon measurement
+    bool          measure_latency;
+    uint64_t      key_event_ns[CHIP8_KEY_COUNT];   // arrival of the last armed transition per key
+    LatencyStats  to_apply;     // key event -> applied to the machine
+    LatencyStats  to_read;      // key event -> first Ex9E/ExA1/Fx0A that read it
+} Emulation;
+
+// Apply every queued key transition at the current cycle
+static void apply_key_events(Emulation* emu) {
+    Chip8* c8 = emu->chip8;
+    PlatformKeyEvent key;
+    while (spsc_ring_pop(emu->key_events, &key)) {
+        if (key.down) chip8_key_down(c8, key.key);
+        else chip8_key_up(c8, key.key);
+        if (emu->movie) {
+            chip8_movie_record(emu->movie, c8, key.down ? CHIP8_MOVIE_KEY_DOWN : CHIP8_MOVIE_KEY_UP, key.key);
+        }
+        if (emu->measure_latency) {
+            latency_stats_add(&emu->to_apply, host_time_ns() - key.time_ns);
+#ifdef CHIP8_PROFILE
+            emu->key_event_ns[key.key & 0xF] = key.time_ns;
+            chip8_profile_arm_key(c8->profile, key.key);
+#endif
+        }
+    }
+}
+
+// Pick up keys the program read during the last slice and tag the next frame with them
+static void collect_key_reads(Emulation* emu) {
+#ifdef CHIP8_PROFILE
+    Chip8Profile* p = emu->chip8->profile;
+    if (!p || !p->key_seen) return;
+    for (int k = 0; k < CHIP8_KEY_COUNT; ++k) {
+        if (!(p->key_seen & (1u << k))) continue;
+        latency_stats_add(&emu->to_read, p->key_seen_ns[k] - emu->key_event_ns[k]);
+        triple_buffer_note_key(emu->frames, emu->key_event_ns[k], p->key_seen_ns[k]);
+    }
+    p->key_seen = 0;
+#else
+    (void)emu;
+#endif
+}
+
+// Emulation thread: runs one 60Hz frame per iteration and never waits on the display.
+static void emulation_thread(void* arg) {
+    Emulation* emu = (Emulation*)arg;
+    Chip8* c8 = emu->chip8;
+
+    while (!atomic_load(&emu->quit) && c8->running) {
+        // Spread the frame over its real-time span so a key lands within 1/INPUT_SLICES of a
+        // frame of when it was pressed, instead of waiting for the next frame boundary.
+        uint32_t cycles = scheduler_frame_cycles(emu->sched);
+        for (uint32_t slice = 0; slice < INPUT_SLICES && c8->running; ++slice) {
+            if (slice > 0) {
+                uint64_t due = scheduler_slice_due_ns(emu->sched, slice, INPUT_SLICES);
+                if (due) host_sleep_until_ns(due);
+            }
+            apply_key_events(emu);
+            uint32_t begin = (uint32_t)((uint64_t)cycles * slice / INPUT_SLICES);
+            uint32_t end = (uint32_t)((uint64_t)cycles * (slice + 1) / INPUT_SLICES);
+            if (emu->gdb) chip8_gdb_run(emu->gdb, c8, end - begin);
+            else if (emu->trace) chip8_trace_run(emu->trace, c8, end - begin);
+            else chip8_run(c8, end - begin);
+            collect_key_reads(emu);
+        }
+
+        // Timers tick once per frame of emulated time
+        if (emu->audio) {
+            if (c8->audio_pattern_set) audio_pattern(emu->audio, emu->sched->frames, c8->audio_pattern, c8->pitch);
+            audio_frame(emu->audio, emu->sched->frames, c8->sound_timer > 0);
+        }
+        chip8_tick_timers(c8);
+        if (emu->movie) chip8_movie_record(emu->movie, c8, CHIP8_MOVIE_TICK, 0);
+        if (emu->trace) chip8_trace_flush(emu->trace);   // a live reader sees every frame
+
+        // Hand the frame to the render thread; wake it only if it may be idle
+        if (c8->draw_flag) {
+            if (triple_buffer_publish(emu->frames, c8)) platform_notify_frame();
+            c8->draw_flag = false;
+            chip8_clear_dirty_rows(c8);
+        }
+
+        scheduler_end_frame(emu->sched); // Sleep until the next frame is due
+    }
+
+    atomic_store(&emu->done, true);
+    platform_notify_frame();
+}
+
+int main(int argc, char* argv[]) {
+    // Optional arguments:
+    //   --record <file>  write an input movie of the session on exit
+    //   --trace <file>   record every executed instruction to an execution trace
+    //   --gdb <port>     accept a GDB remote debugger on 127.0.0.1:port (0: the default port)
+    //   --ipf <n>        frame-locked: exactly n instructions per 60Hz frame
+    //   --speed <k>      run k times faster (or slower) than real time
+    //   --turbo          run uncapped
+    //   --latency        report key-to-photon latency on exit (read/present stages need a
+    //                    -DCHIP8_PROFILE build)
+    //   --quirks <p>     quirk profile: modern, vip, chip48, schip or xochip (default: modern,
+    //                    or the profile of the platform the browser detects)
+    const char* movie_path = NULL;
+    const char* trace_path = NULL;
+    const char* gdb_port = NULL;
+    const char* quirks_name = NULL;
+    bool measure_latency = false;
+    SchedulerConfig sched_config = { SCHEDULER_REALTIME, CPU_HZ, 0, 1.0 };
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--record") == 0 && has_value) {
+            movie_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && has_value) {
+            trace_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--gdb") == 0 && has_value) {
+            gdb_port = argv[++i];
+        }
+        else if (strcmp(argv[i], "--ipf") == 0 && has_value) {
+            sched_config.mode = SCHEDULER_FRAME_LOCKED;
+            sched_config.instructions_per_frame = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--speed") == 0 && has_value) {
+            sched_config.mode = SCHEDULER_MULTIPLIER;
+            sched_config.multiplier = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--turbo") == 0) {
+            sched_config.mode = SCHEDULER_TURBO;
+        }
+        else if (strcmp(argv[i], "--latency") == 0) {
+            measure_latency = true;
+        }
+        else if (strcmp(argv[i], "--quirks") == 0 && has_value) {
+            quirks_name = argv[++i];
+        }
+    }
+
+    Chip8Quirks quirks = CHIP8_QUIRKS_MODERN;
+    if (quirks_name && !chip8_quirks_parse(quirks_name, &quirks)) {
+        printf("Unknown quirk profile: %s\n", quirks_name);
+        return 1;
+    }
+
+    // Console: ROM browser
+    roms_ensure_directory();
+
+    RomList roms;
+    if (!roms_scan(&roms)) {
+        printf("Error scanning ROMs directory.\n");
+        printf("Press Enter to exit...\n");
+        getchar();
+        return 1;
+    }
+
+    if (roms.count == 0) {
+        printf("No ROMs found. Place .ch8 / Super CHIP-8 ROM files into the ROMs folder.\n");
+        printf("Press Enter to exit...\n");
+        getchar();
+        roms_free(&roms);
+        return 0;
+    }
+
+    int idx = roms_prompt_selection(&roms);
+    if (idx < 0) {
+        roms_free(&roms);
+        return 0;
+    }
+
+    const RomEntry* rom = &roms.entries[idx];
+    const char* rom_path = rom->path;
+    sched_config.cpu_hz = rom->cpu_hz;   // the frame-locked mode keeps its explicit --ipf
+    if (!quirks_name && rom->platform == ROM_PLATFORM_SCHIP) quirks = CHIP8_QUIRKS_SCHIP;
+    if (!quirks_name && rom->platform == ROM_PLATFORM_XOCHIP) quirks = CHIP8_QUIRKS_XOCHIP;
+    printf("Loading ROM: %s (%s, %u Hz, %s quirks)\n", rom_path, roms_platform_name(rom->platform),
+        rom->cpu_hz, chip8_quirks_name(quirks));
+
+    // Initialize CHIP-8 machine. The storage fits an XO-CHIP machine; classic ROMs only
+    // initialize its Chip8 part.
+    static Chip8Xo machine;
+    Chip8* chip8 = &machine.base;
+    if (quirks == CHIP8_QUIRKS_XOCHIP) {
+        chip8_xo_init(&machine);
+    }
+    else {
+        chip8_init(chip8);
+        chip8_set_quirks(chip8, quirks);
+    }
+    uint64_t seed = (uint64_t)time(NULL);
+    chip8_seed(chip8, seed);
+
+    if (!chip8_load_rom(chip8, rom_path)) {
+        printf("Failed to load ROM.\n");
+        printf("Press Enter to exit...\n");
+        getchar();
+        roms_free(&roms);
+        return 1;
+    }
+
+    roms_free(&roms);
+
+    Chip8Movie movie;
+    chip8_movie_init(&movie, seed, chip8);
+
+    Chip8Trace trace;
+    if (trace_path && !chip8_trace_open(&trace, trace_path, chip8, 0)) {
+        printf("Failed to open trace file %s, running without it.\n", trace_path);
+        trace_path = NULL;
+    }
+
+    Chip8Gdb gdb;
+    if (gdb_port) {
+        if (chip8_gdb_open(&gdb, chip8, (uint16_t)strtoul(gdb_port, NULL, 10))) {
+            printf("GDB stub listening on 127.0.0.1:%u (target remote :%u)\n", gdb.port, gdb.port);
+        }
+        else {
+            printf("Failed to start the GDB stub, running without it.\n");
+            gdb_port = NULL;
+        }
+    }
+
+    // Initialize SDL platform
+    // Use high-res logical size; SDL will scale low-res as needed.
+    int logical_w = CHIP8_HIGH_RES_WIDTH;
+    int logical_h = CHIP8_HIGH_RES_HEIGHT;
+
+    // Window scaling factor
+    int scale = 8; // 128*8 = 1024, 64*8 = 512
+    int window_w = logical_w * scale;
+    int window_h = logical_h * scale;
+
+    if (!platform_init("CHIP-8 / Super CHIP-8 Emulator",
+        window_w, window_h,
+        logical_w, logical_h)) {
+        printf("Failed to initialize SDL.\n");
+        printf("Press Enter to exit...\n");
+        getchar();
+        return 1;
+    }
+
+    // Buzzer: the emulation loop only queues transitions; SDL's audio thread synthesizes.
+    Audio audio;
+    bool audio_ok = audio_init(&audio, AUDIO_DEFAULT_RATE) && platform_audio_start(&audio);
+    if (!audio_ok) {
+        printf("Audio unavailable, running without sound.\n");
+    }
+
+    Scheduler sched;
+    scheduler_init(&sched, &sched_config);
+
+    SpscRing key_events;
+    TripleBuffer frames;
+    triple_buffer_init(&frames);
+    if (!spsc_ring_init(&key_events, KEY_QUEUE_CAPACITY, sizeof(PlatformKeyEvent))) {
+        printf("Out of memory.\n");
+        return 1;
+    }
+
+    Emulation emu;
+    emu.chip8 = chip8;
+    emu.sched = &sched;
+    emu.audio = audio_ok ? &audio : NULL;
+    emu.movie = movie_path ? &movie : NULL;
+    emu.trace = trace_path ? &trace : NULL;
+    emu.gdb = gdb_port ? &gdb : NULL;
+    emu.key_events = &key_events;
+    emu.frames = &frames;
+    atomic_init(&emu.quit, false);
+    atomic_init(&emu.done, false);
+    emu.measure_latency = measure_latency;
+    memset(emu.key_event_ns, 0, sizeof(emu.key_event_ns));
+    latency_stats_init(&emu.to_apply);
+    latency_stats_init(&emu.to_read);
+
+#ifdef CHIP8_PROFILE
+    // The profiler hooks every instruction, which is where the key probe watches for reads.
+    Chip8Profile* probe = measure_latency ? chip8_profile_create() : NULL;
+    if (probe) chip8_profile_attach(chip8, probe);
+#endif
+
+    HostThread emu_thread;
+    if (!host_thread_start(&emu_thread, emulation_thread, &emu)) {
+        printf("Failed to start the emulation thread.\n");
+        return 1;
+    }
+
+    // Render/input loop on the main thread (SDL requires it here). Presenting may block on
+    // vsync, but only this thread waits; the emulation thread keeps its own schedule.
+    bool quit = false;
+    uint64_t presented = 0;
+    uint64_t duplicated = 0;
+    uint64_t refresh_ns = 1000000000ull / (uint64_t)platform_refresh_hz();
+    uint64_t last_present = 0;
+
+    // Render-thread side of --latency: a read key waits here until an image is presented.
+    LatencyStats to_present;
+    LatencyStats to_photon;
+    latency_stats_init(&to_present);
+    latency_stats_init(&to_photon);
+    uint64_t last_key_event = 0;
+    uint64_t pending_event = 0;
+    uint64_t pending_seen = 0;
+
+    while (!quit && !atomic_load(&emu.done)) {
+        platform_handle_input(&key_events, &quit, INPUT_WAIT_MS);
+
+        bool fresh;
+        const DisplayFrame* frame = triple_buffer_acquire(&frames, &fresh);
+        if (frame && fresh) {
+            if (frame->key_event_ns && frame->key_event_ns != last_key_event) {
+                last_key_event = frame->key_event_ns;
+                if (!pending_event) {
+                    pending_event = frame->key_event_ns;
+                    pending_seen = frame->key_seen_ns;
+                }
+            }
+            if (!platform_draw(frame)) continue;
+
+            uint64_t now = host_time_ns();
+            if (pending_event) {
+                latency_stats_add(&to_present, now - pending_seen);
+                latency_stats_add(&to_photon, now - pending_event);
+                pending_event = 0;
+            }
+            // Refreshes that passed since the last present kept showing the previous frame.
+            if (last_present && now - last_present > refresh_ns + refresh_ns / 2) {
+                duplicated += (now - last_present + refresh_ns / 2) / refresh_ns - 1;
+            }
+            last_present = now;
+            presented++;
+        }
+    }
+
+    atomic_store(&emu.quit, true);
+    if (gdb_port) chip8_gdb_close(&gdb);   // releases the emulation thread if it is stopped
+    host_thread_join(&emu_thread);
+
+    printf("Frames: %llu published, %llu dropped, %llu presented, %llu refreshes repeated a frame\n",
+        (unsigned long long)atomic_load(&frames.published),
+        (unsigned long long)atomic_load(&frames.dropped),
+        (unsigned long long)presented,
+        (unsigned long long)duplicated);
+
+    if (measure_latency) {
+        latency_stats_print(&emu.to_apply, "key event -> applied", stdout);
+#ifdef CHIP8_PROFILE
+        latency_stats_print(&emu.to_read, "key event -> read by program", stdout);
+        latency_stats_print(&to_present, "read -> presented", stdout);
+        latency_stats_print(&to_photon, "key event -> presented", stdout);
+        chip8_profile_attach(chip8, NULL);
+        chip8_profile_destroy(probe);
+#else
+        printf("Build with -DCHIP8_PROFILE to measure the read and present stages.\n");
+#endif
+    }
+
+    platform_cleanup();
+    audio_destroy(&audio);
+    spsc_ring_free(&key_events);
+
+    if (movie_path) {
+        if (chip8_movie_save(&movie, movie_path)) {
+            printf("Recorded %zu input events to %s\n", movie.count, movie_path);
+        }
+    }
+    chip8_movie_free(&movie);
+
+    if (trace_path) {
+        uint64_t stalls = trace.stalls;
+        if (chip8_trace_close(&trace)) {
+            printf("Trace written to %s (%llu writer stalls)\n", trace_path, (unsigned long long)stalls);
+        }
+    }
+
+    // When emulator exits (ESC or window close), console will also terminate because the process ends.
+    return 0;
+}
@@ -1,191 +1,268 @@
-// Generate the implementation of the platform layer for the CHIP-8 emulator using SDL2.
-
-#include "platform.h"
-#include <SDL.h>
-#include <string.h>
-
-static SDL_Window* g_window = NULL;
-static SDL_Renderer* g_renderer = NULL;
-static SDL_Texture* g_texture = NULL;
-
-static int g_window_width = 0;
-static int g_window_height = 0;
-
-bool platform_init(const char* title,
-    int window_width, int window_height,
-    int logical_width, int logical_height)
-{
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_EVENTS) != 0) {
-        SDL_Log("SDL_Init failed: %s", SDL_GetError());
-        return false;
-    }
-
-    g_window_width = window_width;
-    g_window_height = window_height;
-
-    g_window = SDL_CreateWindow(
-        title,
-        SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-        g_window_width, g_window_height,
-        SDL_WINDOW_SHOWN
-    );
-
-    if (!g_window) {
-        SDL_Log("SDL_CreateWindow failed: %s", SDL_GetError());
-        SDL_Quit();
-        return false;
-    }
-
-    g_renderer = SDL_CreateRenderer(
-        g_window, -1,
-        SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC
-    );
-    if (!g_renderer) {
-        SDL_Log("SDL_CreateRenderer failed: %s", SDL_GetError());
-        SDL_DestroyWindow(g_window);
-        SDL_Quit();
-        return false;
-    }
-
-    // Texture for full high-res buffer (128x64), we will scale it
-    g_texture = SDL_CreateTexture(
-        g_renderer,
-        SDL_PIXELFORMAT_ARGB8888,
-        SDL_TEXTUREACCESS_STREAMING,
-        CHIP8_HIGH_RES_WIDTH,
-        CHIP8_HIGH_RES_HEIGHT
-    );
-
-    if (!g_texture) {
-        SDL_Log("SDL_CreateTexture failed: %s", SDL_GetError());
-        SDL_DestroyRenderer(g_renderer);
-        SDL_DestroyWindow(g_window);
-        SDL_Quit();
-        return false;
-    }
-
-    // Set logical size for auto scaling (keeps aspect ratio with letterboxing)
-    SDL_RenderSetLogicalSize(g_renderer,
-        logical_width == 0 ? CHIP8_HIGH_RES_WIDTH : logical_width,
-        logical_height == 0 ? CHIP8_HIGH_RES_HEIGHT : logical_height);
-
-    return true;
-}
-
-static int map_key(SDL_Keycode key) {
-    // PC keymap to CHIP-8 hex keypad:
-    // 1 2 3 4    -> 1 2 3 C
-    // Q W E R    -> 4 5 6 D
-    // A S D F    -> 7 8 9 E
-    // Z X C V    -> A 0 B F
-
-    switch (key) {
-    case SDLK_1: return 0x1;
-    case SDLK_2: return 0x2;
-    case SDLK_3: return 0x3;
-    case SDLK_4: return 0xC;
-    case SDLK_q: return 0x4;
-    case SDLK_w: return 0x5;
-    case SDLK_e: return 0x6;
-    case SDLK_r: return 0xD;
-    case SDLK_a: return 0x7;
-    case SDLK_s: return 0x8;
-    case SDLK_d: return 0x9;
-    case SDLK_f: return 0xE;
-    case SDLK_z: return 0xA;
-    case SDLK_x: return 0x0;
-    case SDLK_c: return 0xB;
-    case SDLK_v: return 0xF;
-    default:     return -1;
-    }
-}
-
-void platform_handle_input(Chip8* c8, bool* quit) {
-    SDL_Event e;
-    while (SDL_PollEvent(&e)) {
-        switch (e.type) {
-        case SDL_QUIT:
-            *quit = true;
-            c8->running = false;
-            break;
-        case SDL_KEYDOWN:
-            if (e.key.keysym.sym == SDLK_ESCAPE) {
-                *quit = true;
-                c8->running = false;
-                break;
-            }
-            else {
-                int mapped = map_key(e.key.keysym.sym);
-                if (mapped >= 0) {
-                    chip8_key_down(c8, (uint8_t)mapped);
-                }
-            }
-            break;
-        case SDL_KEYUP: {
-            int mapped = map_key(e.key.keysym.sym);
-            if (mapped >= 0) {
-                chip8_key_up(c8, (uint8_t)mapped);
-            }
-            break;
-        }
-        default:
-            break;
-        }
-    }
-}
-
-void platform_draw(const Chip8* c8) {
-    int w, h;
-    const bool* disp = chip8_get_display(c8, &w, &h);
-
-    // We always update a 128x64 texture, using only w x h area
-    uint32_t* pixels = NULL;
-    int pitch = 0;
-    if (SDL_LockTexture(g_texture, NULL, (void**)&pixels, &pitch) != 0) {
-        SDL_Log("SDL_LockTexture failed: %s", SDL_GetError());
-        return;
-    }
-
-    int tex_width = CHIP8_HIGH_RES_WIDTH;
-    int tex_height = CHIP8_HIGH_RES_HEIGHT;
-
-    // Clear entire texture to black
-    int total = tex_width * tex_height;
-    for (int i = 0; i < total; ++i) {
-        pixels[i] = 0xFF000000; // ARGB: opaque black
-    }
-
-    // Draw pixels
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            int idx_disp = y * CHIP8_HIGH_RES_WIDTH + x;
-            if (disp[idx_disp]) {
-                int idx_tex = y * tex_width + x;
-                // ARGB: opaque greenish color (for "color" look; change as desired)
-                pixels[idx_tex] = 0xFF00FF00;
-            }
-        }
-    }
-
-    SDL_UnlockTexture(g_texture);
-
-    SDL_RenderClear(g_renderer);
-    SDL_RenderCopy(g_renderer, g_texture, NULL, NULL);
-    SDL_RenderPresent(g_renderer);
-}
-
-void platform_cleanup(void) {
-    if (g_texture) {
-        SDL_DestroyTexture(g_texture);
-        g_texture = NULL;
-    }
-    if (g_renderer) {
-        SDL_DestroyRenderer(g_renderer);
-        g_renderer = NULL;
-    }
-    if (g_window) {
-        SDL_DestroyWindow(g_window);
-        g_window = NULL;
-    }
-    SDL_Quit();
-}
+// Generate the implementation of the platform layer for the CHIP-8 emulator using SDL2.
+
+#include "platform.h"
+#include "chip8_blit.h"
+#include "host_thread.h"
+#include <SDL.h>
+#include <string.h>
+
+static SDL_Window* g_window = NULL;
+static SDL_Renderer* g_renderer = NULL;
+static SDL_Texture* g_texture = NULL;
+
+static int g_window_width = 0;
+static int g_window_height = 0;
+
+// Copy of the rows currently in the texture, used to skip rows (and frames) that did not change
+static uint64_t g_shown[CHIP8_HIGH_RES_HEIGHT][CHIP8_ROW_WORDS];
+static bool g_shown_valid = false;
+
+// ARGB per colour index (chip8_pixel_color): plane 0 alone keeps the classic green on black
+static const Uint32 g_palette[1 << CHIP8_DISPLAY_PLANES] = {
+    0xFF000000, 0xFF00FF00, 0xFFFF8000, 0xFFFFFFFF
+};
+
+static Uint32 g_frame_event = (Uint32)-1;   // user event type sent by platform_notify_frame
+
+static SDL_AudioDeviceID g_audio_device = 0;
+
+bool platform_init(const char* title,
+    int window_width, int window_height,
+    int logical_width, int logical_height)
+{
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_EVENTS) != 0) {
+        SDL_Log("SDL_Init failed: %s", SDL_GetError());
+        return false;
+    }
+    g_frame_event = SDL_RegisterEvents(1);
+
+    g_window_width = window_width;
+    g_window_height = window_height;
+
+    g_window = SDL_CreateWindow(
+        title,
+        SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+        g_window_width, g_window_height,
+        SDL_WINDOW_SHOWN
+    );
+
+    if (!g_window) {
+        SDL_Log("SDL_CreateWindow failed: %s", SDL_GetError());
+        SDL_Quit();
+        return false;
+    }
+
+    g_renderer = SDL_CreateRenderer(
+        g_window, -1,
+        SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC
+    );
+    if (!g_renderer) {
+        SDL_Log("SDL_CreateRenderer failed: %s", SDL_GetError());
+        SDL_DestroyWindow(g_window);
+        SDL_Quit();
+        return false;
+    }
+
+    // Texture for full high-res buffer (128x64), we will scale it
+    g_texture = SDL_CreateTexture(
+        g_renderer,
+        SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STREAMING,
+        CHIP8_HIGH_RES_WIDTH,
+        CHIP8_HIGH_RES_HEIGHT
+    );
+
+    if (!g_texture) {
+        SDL_Log("SDL_CreateTexture failed: %s", SDL_GetError());
+        SDL_DestroyRenderer(g_renderer);
+        SDL_DestroyWindow(g_window);
+        SDL_Quit();
+        return false;
+    }
+
+    // Set logical size for auto scaling (keeps aspect ratio with letterboxing)
+    SDL_RenderSetLogicalSize(g_renderer,
+        logical_width == 0 ? CHIP8_HIGH_RES_WIDTH : logical_width,
+        logical_height == 0 ? CHIP8_HIGH_RES_HEIGHT : logical_height);
+
+    return true;
+}
+
+static int map_key(SDL_Keycode key) {
+    // PC keymap to CHIP-8 hex keypad:
+    // 1 2 3 4    -> 1 2 3 C
+    // Q W E R    -> 4 5 6 D
+    // A S D F    -> 7 8 9 E
+    // Z X C V    -> A 0 B F
+
+    switch (key) {
+    case SDLK_1: return 0x1;
+    case SDLK_2: return 0x2;
+    case SDLK_3: return 0x3;
+    case SDLK_4: return 0xC;
+    case SDLK_q: return 0x4;
+    case SDLK_w: return 0x5;
+    case SDLK_e: return 0x6;
+    case SDLK_r: return 0xD;
+    case SDLK_a: return 0x7;
+    case SDLK_s: return 0x8;
+    case SDLK_d: return 0x9;
+    case SDLK_f: return 0xE;
+    case SDLK_z: return 0xA;
+    case SDLK_x: return 0x0;
+    case SDLK_c: return 0xB;
+    case SDLK_v: return 0xF;
+    default:     return -1;
+    }
+}
+
+static void queue_key(SpscRing* key_events, int key, bool down) {
+    PlatformKeyEvent ev;
+    ev.time_ns = host_time_ns();
+    ev.key = (uint8_t)key;
+    ev.down = down ? 1 : 0;
+    if (!spsc_ring_push(key_events, &ev)) {
+        SDL_Log("Key queue full, dropping key event");
+    }
+}
+
+void platform_handle_input(SpscRing* key_events, bool* quit, int wait_ms) {
+    SDL_Event e;
+    bool have = wait_ms > 0 ? SDL_WaitEventTimeout(&e, wait_ms) != 0 : SDL_PollEvent(&e) != 0;
+    for (; have; have = SDL_PollEvent(&e) != 0) {
+        switch (e.type) {
+        case SDL_QUIT:
+            *quit = true;
+            break;
+        case SDL_KEYDOWN:
+            if (e.key.keysym.sym == SDLK_ESCAPE) {
+                *quit = true;
+                break;
+            }
+            else {
+                int mapped = map_key(e.key.keysym.sym);
+                if (mapped >= 0 && !e.key.repeat) {
+                    queue_key(key_events, mapped, true);
+                }
+            }
+            break;
+        case SDL_KEYUP: {
+            int mapped = map_key(e.key.keysym.sym);
+            if (mapped >= 0) {
+                queue_key(key_events, mapped, false);
+            }
+            break;
+        }
+        default:
+            // g_frame_event only needs to end the wait
+            break;
+        }
+    }
+}
+
+void platform_notify_frame(void) {
+    if (g_frame_event == (Uint32)-1) return;
+    SDL_Event e;
+    memset(&e, 0, sizeof(e));
+    e.type = g_frame_event;
+    SDL_PushEvent(&e);
+}
+
+int platform_refresh_hz(void) {
+    SDL_DisplayMode mode;
+    if (g_window && SDL_GetWindowDisplayMode(g_window, &mode) == 0 && mode.refresh_rate > 0) {
+        return mode.refresh_rate;
+    }
+    return 60;
+}
+
+bool platform_draw(const DisplayFrame* frame) {
+    const uint64_t* disp = &frame->rows[0][0];
+
+    // Keep only rows whose pixels differ from what is on screen. Everything outside the
+    // active area is always clear in the packed buffer, so full rows can be compared.
+    uint64_t dirty = g_shown_valid ? frame->dirty_rows : ~0ull;
+    uint64_t changed = 0;
+    int first = -1;
+    int last = -1;
+    for (int y = 0; y < CHIP8_HIGH_RES_HEIGHT; ++y) {
+        if (!(dirty & (1ull << y))) continue;
+        const uint64_t* row = &disp[y * CHIP8_ROW_WORDS];
+        if (g_shown_valid && memcmp(g_shown[y], row, sizeof(g_shown[y])) == 0) continue;
+
+        memcpy(g_shown[y], row, sizeof(g_shown[y]));
+        changed |= 1ull << y;
+        if (first < 0) first = y;
+        last = y;
+    }
+    g_shown_valid = true;
+
+    // The frame's XORs cancelled out: nothing to upload or present.
+    if (!changed) return false;
+
+    // Lock only the band of rows that changed; locked texels are write-only, so every row
+    // in the band is converted from the shadow copy.
+    SDL_Rect band = { 0, first, CHIP8_HIGH_RES_WIDTH, last - first + 1 };
+    uint8_t* pixels = NULL;
+    int pitch = 0;
+    if (SDL_LockTexture(g_texture, &band, (void**)&pixels, &pitch) != 0) {
+        SDL_Log("SDL_LockTexture failed: %s", SDL_GetError());
+        return false;
+    }
+
+    chip8_blit(g_shown[first], CHIP8_HIGH_RES_WIDTH, last - first + 1, g_palette,
+        (uint32_t*)pixels, (size_t)pitch / sizeof(uint32_t));
+
+    SDL_UnlockTexture(g_texture);
+
+    SDL_RenderClear(g_renderer);
+    SDL_RenderCopy(g_renderer, g_texture, NULL, NULL);
+    SDL_RenderPresent(g_renderer);
+    return true;
+}
+
+// Runs on SDL's audio thread; only touches the consumer side of the Audio ring.
+static void audio_callback(void* userdata, Uint8* stream, int len) {
+    audio_render((Audio*)userdata, (int16_t*)stream, (size_t)len / sizeof(int16_t), true);
+}
+
+bool platform_audio_start(Audio* audio) {
+    SDL_AudioSpec want;
+    memset(&want, 0, sizeof(want));
+    want.freq = (int)audio->sample_rate;
+    want.format = AUDIO_S16SYS;
+    want.channels = 1;
+    want.samples = 512;
+    want.callback = audio_callback;
+    want.userdata = audio;
+
+    // No allowed changes: SDL converts if the device wants another format.
+    g_audio_device = SDL_OpenAudioDevice(NULL, 0, &want, NULL, 0);
+    if (!g_audio_device) {
+        SDL_Log("SDL_OpenAudioDevice failed: %s", SDL_GetError());
+        return false;
+    }
+    SDL_PauseAudioDevice(g_audio_device, 0);
+    return true;
+}
+
+void platform_cleanup(void) {
+    if (g_audio_device) {
+        SDL_CloseAudioDevice(g_audio_device);
+        g_audio_device = 0;
+    }
+    if (g_texture) {
+        SDL_DestroyTexture(g_texture);
+        g_texture = NULL;
+    }
+    if (g_renderer) {
+        SDL_DestroyRenderer(g_renderer);
+        g_renderer = NULL;
+    }
+    if (g_window) {
+        SDL_DestroyWindow(g_window);
+        g_window = NULL;
+    }
+    g_shown_valid = false;
+    SDL_Quit();
+}
@@ -1,26 +1,50 @@
----// defines the Chip8 structure used in platform.h
-
-#ifndef PLATFORM_H
-#define PLATFORM_H
-
-#include <stdbool.h>
-#include "chip8.h"
-
-// Initialize SDL, create window/renderer/texture.
-// window_width/height: actual window size on screen.
-// logical_width/height: current CHIP-8 resolution (will be scaled).
-bool platform_init(const char* title,
-    int window_width, int window_height,
-    int logical_width, int logical_height);
-
-// Handle SDL input and map to CHIP-8 keys; set quit to true on ESC or window close.
-void platform_handle_input(Chip8* c8, bool* quit);
-
-// Draw current CHIP-8 display buffer to the window.
-void platform_draw(const Chip8* c8);
-
-// Clean up SDL resources.
-void platform_cleanup(void);
-
-#endif // PLATFORM_H
-#pragma once
+// defines the Chip8 structure used in platform.h
+
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stdbool.h>
+#include "chip8.h"
+#include "audio.h"
+#include "spsc_ring.h"
+#include "triple_buffer.h"
+
+// Keypad transition queued by the input thread for the emulation thread
+typedef struct PlatformKeyEvent {
+    uint64_t time_ns;   // host_time_ns() when the event was taken from SDL
+    uint8_t  key;       // CHIP-8 key 0x0-0xF
+    uint8_t  down;      // 1 = pressed, 0 = released
+} PlatformKeyEvent;
+
+// Initialize SDL, create window/renderer/texture.
+// window_width/height: actual window size on screen.
+// logical_width/height: current CHIP-8 resolution (will be scaled).
+bool platform_init(const char* title,
+    int window_width, int window_height,
+    int logical_width, int logical_height);
+
+// Handle SDL input and queue mapped CHIP-8 key transitions (PlatformKeyEvent) into key_events;
+// set quit to true on ESC or window close. Waits up to wait_ms for the first event
+// (0 = just poll); platform_notify_frame ends the wait early.
+void platform_handle_input(SpscRing* key_events, bool* quit, int wait_ms);
+
+// Wake a platform_handle_input wait because a new frame is ready. Safe from any thread.
+void platform_notify_frame(void);
+
+// Draw a published display frame. Only rows flagged in frame->dirty_rows that actually
+// changed are uploaded; if none changed, nothing is presented. Render thread only.
+// Returns true if a new image was presented.
+bool platform_draw(const DisplayFrame* frame);
+
+// Refresh rate of the window's display in Hz (60 if unknown)
+int platform_refresh_hz(void);
+
+// Open the audio device and start pulling samples from `audio` on SDL's audio thread.
+// Returns false if no device could be opened; emulation then runs silently.
+bool platform_audio_start(Audio* audio);
+
+// Clean up SDL resources.
+void platform_cleanup(void);
+
+#endif // PLATFORM_H
+#pragma once
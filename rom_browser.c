@@ -1,107 +1,446 @@
-// Display terminal and create directory for ROMs, scan for ROM files, and prompt user to select one.
-
-#include "rom_browser.h"
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-
-#include <direct.h> // _mkdir
-#include <io.h>     // _findfirst, _findnext
-#include <stdint.h>
-#define BUFFERSIZE 512
-
-void roms_ensure_directory(void) {
-    // Create ROMs directory if it doesn't exist; ignore error if it already exists.
-    _mkdir("ROMs");
-}
-
-bool roms_scan(RomList* list) {
-    list->paths = NULL;
-    list->count = 0;
-
-    // Search pattern: ROMs\*.* (all files)
-    const char* pattern = "ROMs\\*.*";
-
-    struct _finddata_t fileinfo;
-    intptr_t handle = _findfirst(pattern, &fileinfo);
-
-    if (handle == -1L) {
-        // Directory empty or not found
-        return true; // not an error; just empty
-    }
-
-    int capacity = 8;
-    list->paths = (char**)malloc(capacity * sizeof(char*));
-    if (!list->paths) {
-        _findclose(handle);
-        return false;
-    }
-
-    do {
-        // Skip directories
-        if (fileinfo.attrib & _A_SUBDIR) continue;
-
-        // Build full path "ROMs\<filename>"
-        char .[512];
-        snprintf(fullpath, sizeof(fullpath), "ROMs\\%s", fileinfo.name);
-
-        if (list->count >= capacity) {
-            capacity *= 2;
-            char** new_paths = (char**)realloc(list->paths, capacity * sizeof(char*));
-            if (!new_paths) {
-                _findclose(handle);3.
-                return false;
-            }
-            list->paths = new_paths;
-        }
-
-        size_t len = strlen(fullpath);
-        list->paths[list->count] = (char*)malloc(len + 1);
-        if (!list->paths[list->count]) {
-            _findclose(handle);
-            return false;
-        }
-        strcpy_s(list->paths[list->count],len + 1,fullpath);
-        list->count++;
-
-    } while (_findnext(handle, &fileinfo) == 0);
-
-    _findclose(handle);
-    return true;
-}
-
-void roms_free(RomList* list) {
-    if (!list || !list->paths) return;
-    for (int i = 0; i < list->count; ++i) {
-        free(list->paths[i]);
-    }
-    free(list->paths);
-    list->paths = NULL;
-    list->count = 0;
-}
-
-int roms_prompt_selection(const RomList* list) {
-    if (!list || list->count == 0) {
-        printf("No ROM files found in ROMs directory.\n");
-        return -1;
-    }
-
-    printf("=== CHIP-8 / Super CHIP-8 ROMs ===\n");
-    for (int i = 0; i < list->count; ++i) {
-        printf("[%d] %s\n", i, list->paths[i]);
-    }
-    printf("==================================\n");
-    printf("Enter ROM index to launch (or -1 to exit): ");
-
-    int idx = -1;
-    if (scanf_s("%d", &idx) != 1) {
-        // Invalid input
-        return -1;
-    }
-
-    if (idx < 0 || idx >= list->count) {
-        return -1;
-    }
-
-    return idx;
-}
+// Display terminal and create directory for ROMs, scan for ROM files, and prompt user to select one.
+
+#include "rom_browser.h"
+#include "work_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <direct.h> // _mkdir
+#include <io.h>     // _findfirst, _findnext
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#define BUFFERSIZE 512
+
+#define ROMS_INDEX_MAGIC   0x58523843u   // "C8RX"
+#define ROMS_INDEX_VERSION 2             // 2: XO-CHIP detection
+
+#define ROMS_CHIP8_HZ      700
+#define ROMS_SCHIP_HZ      1800
+#define ROMS_XOCHIP_HZ     6000             // 100 instructions per frame
+
+#define ROMS_LOAD_ADDR     0x200
+#define ROMS_MEMORY_SIZE   4096
+
+#ifdef _WIN32
+#define ROMS_PATH_SEP "\\"
+#else
+#define ROMS_PATH_SEP "/"
+#endif
+
+// On-disk index: header, then `count` records each followed by path_len path bytes.
+typedef struct RomIndexHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+} RomIndexHeader;
+
+typedef struct RomIndexRecord {
+    uint64_t size;
+    int64_t  mtime;
+    uint64_t hash;
+    uint32_t cpu_hz;
+    uint16_t path_len;
+    uint8_t  platform;
+    uint8_t  reserved;
+} RomIndexRecord;
+
+static uint64_t fnv1a(const uint8_t* data, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+static FILE* open_file(const char* path, const char* mode) {
+    FILE* f = NULL;
+#ifdef _MSC_VER
+    fopen_s(&f, path, mode);
+#else
+    f = fopen(path, mode);
+#endif
+    return f;
+}
+
+static char* copy_string(const char* s, size_t len) {
+    char* copy = (char*)malloc(len + 1);
+    if (!copy) return NULL;
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+static bool is_schip_opcode(uint16_t op) {
+    return op == 0x00FF || op == 0x00FE || op == 0x00FD || op == 0x00FB || op == 0x00FC ||
+        (op & 0xFFF0) == 0x00C0 || (op & 0xF00F) == 0xD000;
+}
+
+static bool is_xochip_opcode(uint16_t op) {
+    return op == 0xF000 || op == 0xF002 || (op & 0xF0FF) == 0xF001 || (op & 0xF0FF) == 0xF03A ||
+        (op & 0xF00F) == 0x5002 || (op & 0xF00F) == 0x5003 || (op & 0xFFF0) == 0x00D0;
+}
+
+// Follow the program's control flow from 0x200 and look for Super CHIP-8 and XO-CHIP
+// instructions. Only reachable code is decoded, so sprite data that happens to read as 00FF
+// is ignored. XO-CHIP extends Super CHIP-8, so the scan goes on after a Super CHIP-8 opcode.
+static RomPlatform detect_platform(const uint8_t* data, size_t size) {
+    if (size > ROMS_MEMORY_SIZE - ROMS_LOAD_ADDR) return ROM_PLATFORM_XOCHIP;
+    RomPlatform platform = ROM_PLATFORM_CHIP8;
+
+    uint8_t visited[ROMS_MEMORY_SIZE];
+    uint16_t work[ROMS_MEMORY_SIZE];
+    int pending = 0;
+    memset(visited, 0, sizeof(visited));
+    work[pending++] = ROMS_LOAD_ADDR;
+
+    while (pending > 0) {
+        uint16_t addr = work[--pending];
+        for (;;) {
+            size_t offset = (size_t)addr - ROMS_LOAD_ADDR;
+            if (addr < ROMS_LOAD_ADDR || offset + 1 >= size || visited[addr]) break;
+            visited[addr] = 1;
+
+            uint16_t op = (uint16_t)(data[offset] << 8 | data[offset + 1]);
+            if (is_xochip_opcode(op)) return ROM_PLATFORM_XOCHIP;
+            if (is_schip_opcode(op)) platform = ROM_PLATFORM_SCHIP;
+
+            uint16_t next = (uint16_t)(addr + 2);
+            switch (op & 0xF000) {
+            case 0x0000:
+                if (op == 0x00EE) next = 0;
+                break;
+            case 0x1000:
+                next = op & 0x0FFF;
+                break;
+            case 0x2000:
+                if (pending < ROMS_MEMORY_SIZE) work[pending++] = op & 0x0FFF;
+                break;
+            case 0x3000: case 0x4000: case 0x5000: case 0x9000: case 0xE000:
+                // Skips: both the next and the one after may run
+                if (pending < ROMS_MEMORY_SIZE) work[pending++] = (uint16_t)(addr + 4);
+                break;
+            case 0xB000:
+                next = 0;   // computed jump, target unknown
+                break;
+            default:
+                break;
+            }
+            if (next == 0) break;
+            addr = next;
+        }
+    }
+    return platform;
+}
+
+// Hash and classify one ROM from disk. Unreadable files get hash 0 and CHIP-8 defaults.
+static void analyze_rom(RomEntry* e) {
+    e->hash = 0;
+    e->platform = ROM_PLATFORM_CHIP8;
+
+    FILE* f = open_file(e->path, "rb");
+    if (f) {
+        uint8_t* data = (uint8_t*)malloc(e->size ? (size_t)e->size : 1);
+        if (data) {
+            size_t n = fread(data, 1, (size_t)e->size, f);
+            e->hash = fnv1a(data, n);
+            e->platform = detect_platform(data, n);
+            free(data);
+        }
+        fclose(f);
+    }
+    e->cpu_hz = e->platform == ROM_PLATFORM_XOCHIP ? ROMS_XOCHIP_HZ
+              : e->platform == ROM_PLATFORM_SCHIP ? ROMS_SCHIP_HZ : ROMS_CHIP8_HZ;
+}
+
+typedef struct HashJob {
+    RomEntry* entries;
+    const int* pending;   // indices of entries to analyze
+} HashJob;
+
+static void hash_task(void* ctx, int task, int worker) {
+    (void)worker;
+    HashJob* job = (HashJob*)ctx;
+    analyze_rom(&job->entries[job->pending[task]]);
+}
+
+static int compare_entries(const void* a, const void* b) {
+    return strcmp(((const RomEntry*)a)->path, ((const RomEntry*)b)->path);
+}
+
+static void free_entries(RomEntry* entries, int count) {
+    for (int i = 0; i < count; ++i) {
+        free(entries[i].path);
+    }
+    free(entries);
+}
+
+static bool add_entry(RomList* list, int* capacity, const char* name, uint64_t size, int64_t mtime) {
+    if (list->count >= *capacity) {
+        int new_capacity = *capacity ? *capacity * 2 : 64;
+        RomEntry* grown = (RomEntry*)realloc(list->entries, (size_t)new_capacity * sizeof(RomEntry));
+        if (!grown) return false;
+        list->entries = grown;
+        *capacity = new_capacity;
+    }
+
+    // Build full path "ROMs/<filename>"
+    char fullpath[BUFFERSIZE];
+    snprintf(fullpath, sizeof(fullpath), "%s%s%s", ROMS_DIR, ROMS_PATH_SEP, name);
+
+    RomEntry* e = &list->entries[list->count];
+    memset(e, 0, sizeof(*e));
+    e->path = copy_string(fullpath, strlen(fullpath));
+    if (!e->path) return false;
+    e->size = size;
+    e->mtime = mtime;
+    list->count++;
+    return true;
+}
+
+// List regular files in ROMS_DIR with their size and mtime
+static bool list_directory(RomList* list) {
+    int capacity = 0;
+
+#ifdef _WIN32
+    // Search pattern: ROMs\*.* (all files)
+    struct _finddata_t fileinfo;
+    intptr_t handle = _findfirst(ROMS_DIR "\\*.*", &fileinfo);
+    if (handle == -1L) {
+        // Directory empty or not found
+        return true; // not an error; just empty
+    }
+    do {
+        // Skip directories and dot files (the index lives there)
+        if ((fileinfo.attrib & _A_SUBDIR) || fileinfo.name[0] == '.') continue;
+        if (!add_entry(list, &capacity, fileinfo.name, (uint64_t)fileinfo.size, (int64_t)fileinfo.time_write)) {
+            _findclose(handle);
+            return false;
+        }
+    } while (_findnext(handle, &fileinfo) == 0);
+    _findclose(handle);
+#else
+    DIR* dir = opendir(ROMS_DIR);
+    if (!dir) {
+        // Directory not found
+        return true; // not an error; just empty
+    }
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        // Skip dot files (the index lives there) and anything that is not a regular file
+        if (ent->d_name[0] == '.') continue;
+        char fullpath[BUFFERSIZE];
+        snprintf(fullpath, sizeof(fullpath), "%s/%s", ROMS_DIR, ent->d_name);
+        struct stat st;
+        if (stat(fullpath, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        if (!add_entry(list, &capacity, ent->d_name, (uint64_t)st.st_size, (int64_t)st.st_mtime)) {
+            closedir(dir);
+            return false;
+        }
+    }
+    closedir(dir);
+#endif
+    return true;
+}
+
+// Load the index into `out` sorted by path. A missing or invalid index yields an empty one.
+static void load_index(RomEntry** out, int* count) {
+    *out = NULL;
+    *count = 0;
+
+    FILE* f = open_file(ROMS_DIR ROMS_PATH_SEP ROMS_INDEX_FILE, "rb");
+    if (!f) return;
+
+    RomIndexHeader header;
+    if (fread(&header, sizeof(header), 1, f) != 1 || header.magic != ROMS_INDEX_MAGIC ||
+        header.version != ROMS_INDEX_VERSION) {
+        fclose(f);
+        return;
+    }
+
+    RomEntry* entries = (RomEntry*)calloc(header.count ? header.count : 1, sizeof(RomEntry));
+    if (!entries) {
+        fclose(f);
+        return;
+    }
+
+    int n = 0;
+    for (uint32_t i = 0; i < header.count; ++i) {
+        RomIndexRecord rec;
+        char path[BUFFERSIZE];
+        if (fread(&rec, sizeof(rec), 1, f) != 1 || rec.path_len >= sizeof(path) ||
+            fread(path, 1, rec.path_len, f) != rec.path_len) {
+            break;   // truncated: keep what was read
+        }
+        RomEntry* e = &entries[n];
+        e->path = copy_string(path, rec.path_len);
+        if (!e->path) break;
+        e->size = rec.size;
+        e->mtime = rec.mtime;
+        e->hash = rec.hash;
+        e->platform = rec.platform <= ROM_PLATFORM_XOCHIP ? (RomPlatform)rec.platform : ROM_PLATFORM_CHIP8;
+        e->cpu_hz = rec.cpu_hz;
+        n++;
+    }
+    fclose(f);
+
+    qsort(entries, (size_t)n, sizeof(RomEntry), compare_entries);
+    *out = entries;
+    *count = n;
+}
+
+// Write the index to a temporary file and move it into place, so a crash never leaves a
+// half-written index behind.
+static bool save_index(const RomList* list) {
+    const char* path = ROMS_DIR ROMS_PATH_SEP ROMS_INDEX_FILE;
+    const char* tmp_path = ROMS_DIR ROMS_PATH_SEP ROMS_INDEX_FILE ".tmp";
+
+    FILE* f = open_file(tmp_path, "wb");
+    if (!f) {
+        fprintf(stderr, "Failed to create ROM index: %s\n", tmp_path);
+        return false;
+    }
+
+    RomIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = ROMS_INDEX_MAGIC;
+    header.version = ROMS_INDEX_VERSION;
+    header.count = (uint32_t)list->count;
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+
+    for (int i = 0; i < list->count && ok; ++i) {
+        const RomEntry* e = &list->entries[i];
+        RomIndexRecord rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.size = e->size;
+        rec.mtime = e->mtime;
+        rec.hash = e->hash;
+        rec.cpu_hz = e->cpu_hz;
+        rec.path_len = (uint16_t)strlen(e->path);
+        rec.platform = (uint8_t)e->platform;
+        ok = fwrite(&rec, sizeof(rec), 1, f) == 1 && fwrite(e->path, 1, rec.path_len, f) == rec.path_len;
+    }
+    ok = (fclose(f) == 0) && ok;
+
+#ifdef _WIN32
+    if (ok) remove(path);   // rename does not replace on Windows
+#endif
+    if (!ok || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Failed to write ROM index: %s\n", path);
+        remove(tmp_path);
+        return false;
+    }
+    return true;
+}
+
+void roms_ensure_directory(void) {
+    // Create ROMs directory if it doesn't exist; ignore error if it already exists.
+#ifdef _WIN32
+    _mkdir(ROMS_DIR);
+#else
+    mkdir(ROMS_DIR, 0755);
+#endif
+}
+
+bool roms_scan(RomList* list) {
+    list->entries = NULL;
+    list->count = 0;
+    list->hashed = 0;
+
+    if (!list_directory(list)) {
+        roms_free(list);
+        return false;
+    }
+    if (list->count == 0) return true;
+    qsort(list->entries, (size_t)list->count, sizeof(RomEntry), compare_entries);
+
+    RomEntry* index;
+    int index_count;
+    load_index(&index, &index_count);
+
+    // Reuse index records whose file is unchanged; queue the rest for hashing.
+    int* pending = (int*)malloc((size_t)list->count * sizeof(int));
+    if (!pending) {
+        free_entries(index, index_count);
+        roms_free(list);
+        return false;
+    }
+    int pending_count = 0;
+    for (int i = 0; i < list->count; ++i) {
+        RomEntry* e = &list->entries[i];
+        const RomEntry* cached = index_count > 0
+            ? (const RomEntry*)bsearch(e, index, (size_t)index_count, sizeof(RomEntry), compare_entries)
+            : NULL;
+        if (cached && cached->size == e->size && cached->mtime == e->mtime) {
+            e->hash = cached->hash;
+            e->platform = cached->platform;
+            e->cpu_hz = cached->cpu_hz;
+        }
+        else {
+            pending[pending_count++] = i;
+        }
+    }
+
+    HashJob job;
+    job.entries = list->entries;
+    job.pending = pending;
+    work_pool_run(0, pending_count, hash_task, &job);
+    list->hashed = pending_count;
+
+    // Rewrite the index when anything was added, changed or removed.
+    if (pending_count > 0 || index_count != list->count) {
+        save_index(list);
+    }
+
+    free(pending);
+    free_entries(index, index_count);
+    return true;
+}
+
+void roms_free(RomList* list) {
+    if (!list || !list->entries) return;
+    free_entries(list->entries, list->count);
+    list->entries = NULL;
+    list->count = 0;
+}
+
+const char* roms_platform_name(RomPlatform platform) {
+    return platform == ROM_PLATFORM_XOCHIP ? "XO-CHIP" : platform == ROM_PLATFORM_SCHIP ? "SCHIP" : "CHIP-8";
+}
+
+int roms_prompt_selection(const RomList* list) {
+    if (!list || list->count == 0) {
+        printf("No ROM files found in ROMs directory.\n");
+        return -1;
+    }
+
+    printf("=== CHIP-8 / Super CHIP-8 ROMs ===\n");
+    for (int i = 0; i < list->count; ++i) {
+        printf("[%d] %s (%s)\n", i, list->entries[i].path, roms_platform_name(list->entries[i].platform));
+    }
+    printf("==================================\n");
+    printf("Enter ROM index to launch (or -1 to exit): ");
+
+    char line[32];
+    if (!fgets(line, sizeof(line), stdin)) {
+        return -1;
+    }
+    char* end;
+    long idx = strtol(line, &end, 10);
+    if (end == line) {
+        // Invalid input
+        return -1;
+    }
+
+    if (idx < 0 || idx >= list->count) {
+        return -1;
+    }
+
+    return (int)idx;
+}
@@ -1,27 +1,52 @@
-// Creates a simple ROM browser for a Chip-8 emulator via console.
-
-#ifndef ROM_BROWSER_H
-#define ROM_BROWSER_H
-
-#include <stdbool.h>
-
-typedef struct RomList {
-    char** paths;
-    int    count;
-} RomList;
-
-// Ensure ROMs directory exists
-void roms_ensure_directory(void);
-
-// Scan ROMs directory for files; fills RomList.
-// Returns false on error or no directory.
-bool roms_scan(RomList* list);
-
-// Free paths allocated in RomList
-void roms_free(RomList* list);
-
-// Print ROM list to console and ask user to select one.
-// Returns index in [0, count) or -1 on cancel.
-int roms_prompt_selection(const RomList* list);
-
-#endif 
+// Creates a simple ROM browser for a Chip-8 emulator via console.
+// Scans are backed by an index cache (ROMs/.rom_index) so only new or changed files are read.
+
+#ifndef ROM_BROWSER_H
+#define ROM_BROWSER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ROMS_DIR        "ROMs"
+#define ROMS_INDEX_FILE ".rom_index"   // inside ROMS_DIR; dot files are never listed as ROMs
+
+typedef enum RomPlatform {
+    ROM_PLATFORM_CHIP8,
+    ROM_PLATFORM_SCHIP,   // uses 00FF/00FE, 00FD, scrolling or Dxy0
+    ROM_PLATFORM_XOCHIP,  // uses F000 nnnn, 5xy2/5xy3, planes, audio patterns or 00Dn, or needs > 3.5 KB
+} RomPlatform;
+
+typedef struct RomEntry {
+    char*       path;
+    uint64_t    size;
+    int64_t     mtime;      // last write, seconds since the epoch
+    uint64_t    hash;       // FNV-1a 64 of the file contents
+    RomPlatform platform;
+    uint32_t    cpu_hz;     // recommended instructions per second for this platform
+} RomEntry;
+
+typedef struct RomList {
+    RomEntry* entries;   // sorted by path
+    int       count;
+    int       hashed;    // entries read this scan because the index had no current record
+} RomList;
+
+// Ensure ROMs directory exists
+void roms_ensure_directory(void);
+
+// Scan ROMs directory for files; fills RomList.
+// Files whose path, size and mtime match the index reuse its record; the others are hashed in
+// parallel and the index is rewritten. Returns false on error or no directory.
+bool roms_scan(RomList* list);
+
+// Free entries allocated in RomList
+void roms_free(RomList* list);
+
+// Print ROM list to console and ask user to select one.
+// Returns index in [0, count) or -1 on cancel.
+int roms_prompt_selection(const RomList* list);
+
+// Platform name for listings ("CHIP-8", "SCHIP", "XO-CHIP")
+const char* roms_platform_name(RomPlatform platform);
+
+#endif
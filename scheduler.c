@@ -0,0 +1,78 @@
+// Fixed-timestep scheduler: exact fractional instruction budgets and drift-free frame pacing.
+
+#include "scheduler.h"
+#include "host_thread.h"
+#include <string.h>
+
+static const char* const mode_names[] = {
+    "realtime",
+    "locked",
+    "turbo",
+    "multiplier",
+};
+
+// Host nanoseconds per frame, or 0 when frames are not paced
+static double frame_period_ns(const SchedulerConfig* c) {
+    switch (c->mode) {
+    case SCHEDULER_TURBO:
+        return 0.0;
+    case SCHEDULER_MULTIPLIER:
+        return 1e9 / (SCHEDULER_FRAME_HZ * c->multiplier);
+    case SCHEDULER_REALTIME:
+    case SCHEDULER_FRAME_LOCKED:
+    default:
+        return 1e9 / SCHEDULER_FRAME_HZ;
+    }
+}
+
+void scheduler_init(Scheduler* s, const SchedulerConfig* config) {
+    memset(s, 0, sizeof(*s));
+    s->config = *config;
+    if (s->config.mode == SCHEDULER_MULTIPLIER && !(s->config.multiplier > 0.0)) {
+        s->config.multiplier = 1.0;
+    }
+    s->epoch_ns = host_time_ns();
+}
+
+uint32_t scheduler_frame_cycles(Scheduler* s) {
+    if (s->config.mode == SCHEDULER_FRAME_LOCKED) {
+        return s->config.instructions_per_frame;
+    }
+
+    // cpu_hz / 60 instructions per frame; the remainder carries, so every 60 frames run
+    // exactly cpu_hz instructions.
+    uint64_t total = (uint64_t)s->config.cpu_hz + s->cycle_remainder;
+    s->cycle_remainder = (uint32_t)(total % SCHEDULER_FRAME_HZ);
+    return (uint32_t)(total / SCHEDULER_FRAME_HZ);
+}
+
+uint64_t scheduler_slice_due_ns(const Scheduler* s, uint32_t slice, uint32_t slices) {
+    double period = frame_period_ns(&s->config);
+    if (period == 0.0 || slices == 0) return 0;
+    double frame = (double)s->epoch_frames + (double)slice / (double)slices;
+    return s->epoch_ns + (uint64_t)(frame * period);
+}
+
+void scheduler_end_frame(Scheduler* s) {
+    s->frames++;
+    s->epoch_frames++;
+
+    double period = frame_period_ns(&s->config);
+    if (period == 0.0) return;
+
+    // Deadlines are computed from the epoch, not accumulated, so rounding never drifts.
+    uint64_t deadline = s->epoch_ns + (uint64_t)((double)s->epoch_frames * period);
+    uint64_t now = host_time_ns();
+
+    if (now > deadline + (uint64_t)(SCHEDULER_MAX_LAG * period)) {
+        s->epoch_ns = now;
+        s->epoch_frames = 0;
+        s->resyncs++;
+        return;
+    }
+    host_sleep_until_ns(deadline);
+}
+
+const char* scheduler_mode_name(SchedulerMode mode) {
+    return (unsigned)mode < sizeof(mode_names) / sizeof(mode_names[0]) ? mode_names[mode] : "unknown";
+}
@@ -0,0 +1,55 @@
+// Fixed-timestep emulation scheduler. Emulated time advances in 60Hz frames: each frame runs
+// a whole number of instructions (fractions carry over exactly), then ticks the timers once.
+// The mode decides how many instructions make a frame and how frames are paced on the host.
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SCHEDULER_FRAME_HZ   60
+#define SCHEDULER_MAX_LAG    4    // frames the host may fall behind before the schedule resyncs
+
+typedef enum SchedulerMode {
+    SCHEDULER_REALTIME,       // cpu_hz instructions per emulated second, paced at 60Hz
+    SCHEDULER_FRAME_LOCKED,   // exactly instructions_per_frame per frame, paced at 60Hz
+    SCHEDULER_TURBO,          // cpu_hz rate per frame, frames back to back without sleeping
+    SCHEDULER_MULTIPLIER,     // cpu_hz rate per frame, paced at 60Hz * multiplier
+} SchedulerMode;
+
+typedef struct SchedulerConfig {
+    SchedulerMode mode;
+    uint32_t cpu_hz;                   // REALTIME, TURBO, MULTIPLIER
+    uint32_t instructions_per_frame;   // FRAME_LOCKED
+    double   multiplier;               // MULTIPLIER, > 0
+} SchedulerConfig;
+
+typedef struct Scheduler {
+    SchedulerConfig config;
+    uint32_t cycle_remainder;   // carried instruction fraction, in 1/60ths
+    uint64_t epoch_ns;          // host time of frame 0 of the current schedule
+    uint64_t epoch_frames;      // frames run since epoch_ns
+
+    uint64_t frames;            // emulated frames (timer ticks) so far
+    uint64_t resyncs;           // times the host fell more than SCHEDULER_MAX_LAG frames behind
+} Scheduler;
+
+// Start a schedule at the current host time
+void scheduler_init(Scheduler* s, const SchedulerConfig* config);
+
+// Instructions to run in the next frame. Call once per frame, then tick the timers.
+uint32_t scheduler_frame_cycles(Scheduler* s);
+
+// Host time at which slice `slice` of `slices` equal parts of the current frame is due, so a
+// frame's instructions can be spread over its real-time span (0 = due now, e.g. in turbo).
+uint64_t scheduler_slice_due_ns(const Scheduler* s, uint32_t slice, uint32_t slices);
+
+// Finish the frame: sleep until the next frame is due (no-op in turbo). If the host has
+// fallen too far behind, the schedule restarts from now instead of running a catch-up burst.
+void scheduler_end_frame(Scheduler* s);
+
+// Mode name for messages ("realtime", "locked", "turbo", "multiplier")
+const char* scheduler_mode_name(SchedulerMode mode);
+
+#endif // SCHEDULER_H
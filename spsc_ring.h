@@ -0,0 +1,102 @@
+// Lock-free single-producer / single-consumer ring of fixed-size records.
+// One thread pushes, one other thread pops; neither side ever blocks or takes a lock.
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct SpscRing {
+    _Atomic uint32_t head;   // next slot the producer writes; only the producer stores it
+    char pad0[64 - sizeof(uint32_t)];
+    _Atomic uint32_t tail;   // next slot the consumer reads; only the consumer stores it
+    char pad1[64 - sizeof(uint32_t)];
+    uint8_t* data;
+    uint32_t mask;           // capacity - 1, capacity is a power of two
+    uint32_t record_size;
+} SpscRing;
+
+// Allocate room for `capacity` records (rounded up to a power of two). Returns false on failure.
+static inline bool spsc_ring_init(SpscRing* r, uint32_t capacity, uint32_t record_size) {
+    uint32_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+    memset(r, 0, sizeof(*r));
+    r->data = (uint8_t*)malloc((size_t)cap * record_size);
+    if (!r->data) return false;
+    r->mask = cap - 1;
+    r->record_size = record_size;
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    return true;
+}
+
+static inline void spsc_ring_free(SpscRing* r) {
+    free(r->data);
+    r->data = NULL;
+}
+
+// Producer: append a record. Returns false (dropping it) when the ring is full.
+static inline bool spsc_ring_push(SpscRing* r, const void* record) {
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    if (head - tail > r->mask) return false;
+    memcpy(r->data + (size_t)(head & r->mask) * r->record_size, record, r->record_size);
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    return true;
+}
+
+// Producer: slot for the next record, to fill in place and publish with spsc_ring_commit.
+// Returns NULL when the ring is full. Large records skip the copy spsc_ring_push makes.
+static inline void* spsc_ring_claim(SpscRing* r) {
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    if (head - tail > r->mask) return NULL;
+    return r->data + (size_t)(head & r->mask) * r->record_size;
+}
+
+// Producer: publish the slot returned by the last spsc_ring_claim
+static inline void spsc_ring_commit(SpscRing* r) {
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+}
+
+// Consumer: the oldest record in place, valid until it is popped. Returns NULL when empty.
+static inline const void* spsc_ring_front(SpscRing* r) {
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    if (head == tail) return NULL;
+    return r->data + (size_t)(tail & r->mask) * r->record_size;
+}
+
+// Consumer: copy the oldest record without removing it. Returns false when empty.
+static inline bool spsc_ring_peek(SpscRing* r, void* record) {
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    if (head == tail) return false;
+    memcpy(record, r->data + (size_t)(tail & r->mask) * r->record_size, r->record_size);
+    return true;
+}
+
+// Consumer: remove the oldest record, copying it out if record is not NULL. Returns false when empty.
+static inline bool spsc_ring_pop(SpscRing* r, void* record) {
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    if (head == tail) return false;
+    if (record) {
+        memcpy(record, r->data + (size_t)(tail & r->mask) * r->record_size, r->record_size);
+    }
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+// Records currently queued (approximate when called from the other side)
+static inline uint32_t spsc_ring_count(SpscRing* r) {
+    return atomic_load_explicit(&r->head, memory_order_acquire) -
+        atomic_load_explicit(&r->tail, memory_order_acquire);
+}
+
+#endif // SPSC_RING_H
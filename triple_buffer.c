@@ -0,0 +1,79 @@
+// Triple-buffered display frame handoff between the emulation and render threads.
+
+#include "triple_buffer.h"
+#include <string.h>
+
+#define TRIPLE_BUFFER_FRESH 4u   // set in `middle` while the consumer has not taken it
+#define TRIPLE_BUFFER_INDEX 3u
+
+void triple_buffer_init(TripleBuffer* tb) {
+    memset(tb, 0, sizeof(*tb));
+    tb->back = 0;
+    atomic_init(&tb->middle, 1u);
+    tb->front = 2;
+    atomic_init(&tb->published, 0);
+    atomic_init(&tb->dropped, 0);
+}
+
+bool triple_buffer_publish(TripleBuffer* tb, const Chip8* c8) {
+    // A frame carries its own dirty rows plus those of every earlier frame the consumer may
+    // not have taken yet, so dropping frames never loses a changed row.
+    uint64_t own = c8->dirty_rows;
+    uint64_t dirty = own | tb->carry_dirty;
+
+    DisplayFrame* f = &tb->buffers[tb->back];
+    memcpy(f->rows, c8->display, sizeof(f->rows));
+    f->dirty_rows = dirty;
+    f->sequence = ++tb->sequence;
+    f->cycle = c8->cycle_count;
+    f->high_res = c8->high_res;
+
+    // Key events of dropped frames likewise wait for the next frame that gets shown.
+    uint64_t event_ns = tb->key_event_ns;
+    uint64_t seen_ns = tb->key_seen_ns;
+    if (tb->carry_event_ns && (!event_ns || tb->carry_event_ns < event_ns)) {
+        event_ns = tb->carry_event_ns;
+        seen_ns = tb->carry_seen_ns;
+    }
+    f->key_event_ns = event_ns;
+    f->key_seen_ns = seen_ns;
+
+    uint32_t old = atomic_exchange_explicit(&tb->middle, tb->back | TRIPLE_BUFFER_FRESH,
+        memory_order_acq_rel);
+    tb->back = old & TRIPLE_BUFFER_INDEX;
+    atomic_fetch_add_explicit(&tb->published, 1, memory_order_relaxed);
+
+    bool idle = !(old & TRIPLE_BUFFER_FRESH);
+    if (idle) {
+        tb->carry_dirty = own;
+        tb->carry_event_ns = tb->key_event_ns;
+        tb->carry_seen_ns = tb->key_seen_ns;
+    }
+    else {
+        tb->carry_dirty = dirty;
+        tb->carry_event_ns = event_ns;
+        tb->carry_seen_ns = seen_ns;
+        atomic_fetch_add_explicit(&tb->dropped, 1, memory_order_relaxed);
+    }
+    tb->key_event_ns = 0;
+    tb->key_seen_ns = 0;
+    return idle;
+}
+
+void triple_buffer_note_key(TripleBuffer* tb, uint64_t event_ns, uint64_t seen_ns) {
+    if (!tb->key_event_ns || event_ns < tb->key_event_ns) {
+        tb->key_event_ns = event_ns;
+        tb->key_seen_ns = seen_ns;
+    }
+}
+
+const DisplayFrame* triple_buffer_acquire(TripleBuffer* tb, bool* fresh) {
+    *fresh = false;
+    if (atomic_load_explicit(&tb->middle, memory_order_acquire) & TRIPLE_BUFFER_FRESH) {
+        uint32_t old = atomic_exchange_explicit(&tb->middle, tb->front, memory_order_acq_rel);
+        tb->front = old & TRIPLE_BUFFER_INDEX;
+        tb->acquired++;
+        *fresh = true;
+    }
+    return tb->acquired ? &tb->buffers[tb->front] : NULL;
+}
@@ -0,0 +1,57 @@
+// Lock-free triple buffer handing finished display frames from the emulation thread to the
+// render thread. The producer never waits: it always has a private back buffer, and publishing
+// swaps it with the shared middle slot. The consumer takes the newest published frame, so
+// frames it could not show in time are dropped rather than queued.
+
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "chip8.h"
+
+typedef struct DisplayFrame {
+    uint64_t rows[CHIP8_HIGH_RES_HEIGHT][CHIP8_ROW_WORDS];   // Chip8.display layout, both planes
+    uint64_t dirty_rows;   // rows touched since the previous frame the consumer took
+    uint64_t sequence;     // 1 for the first published frame, then +1 per publish
+    uint64_t cycle;        // Chip8.cycle_count when the frame was captured
+    bool     high_res;
+
+    // Earliest key event first read by the program in this frame or in a dropped predecessor
+    // (triple_buffer_note_key), for key-to-photon measurements. 0 = none. Like dirty_rows it
+    // may repeat the previous frame's value, so consumers skip an unchanged key_event_ns.
+    uint64_t key_event_ns;   // host time the event arrived
+    uint64_t key_seen_ns;    // host time an instruction first read it
+} DisplayFrame;
+
+typedef struct TripleBuffer {
+    DisplayFrame buffers[3];
+    _Atomic uint32_t middle;   // index of the shared buffer, TRIPLE_BUFFER_FRESH if unread
+    uint32_t back;             // producer's buffer
+    uint32_t front;            // consumer's buffer
+    uint64_t carry_dirty;      // producer: rows the consumer may not have received yet
+    uint64_t sequence;
+    uint64_t key_event_ns, key_seen_ns;   // producer: noted since the last publish
+    uint64_t carry_event_ns, carry_seen_ns;
+
+    _Atomic uint64_t published;
+    _Atomic uint64_t dropped;  // published frames replaced before the consumer took them
+    uint64_t acquired;         // consumer side
+} TripleBuffer;
+
+void triple_buffer_init(TripleBuffer* tb);
+
+// Producer: copy the display of c8 into the back buffer and publish it.
+// Returns true if the consumer had already taken the previous frame (it may be idle and
+// waiting for a wakeup); false if an unread frame was replaced.
+bool triple_buffer_publish(TripleBuffer* tb, const Chip8* c8);
+
+// Producer: attach a key event that the program read to the next published frame
+void triple_buffer_note_key(TripleBuffer* tb, uint64_t event_ns, uint64_t seen_ns);
+
+// Consumer: the newest published frame. *fresh is false if nothing new arrived since the
+// last call (the same frame is returned again). Returns NULL before the first publish.
+const DisplayFrame* triple_buffer_acquire(TripleBuffer* tb, bool* fresh);
+
+#endif // TRIPLE_BUFFER_H
@@ -0,0 +1,138 @@
+// Work-stealing pool: every worker owns a range deque packed into one atomic word.
+// The owner pops from the bottom, thieves take from the top; both sides CAS the same word.
+
+#include "work_pool.h"
+#include "host_thread.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef struct WorkDeque {
+    _Atomic uint64_t range;   // top in the high 32 bits, bottom (exclusive) in the low 32 bits
+    char pad[64 - sizeof(uint64_t)];
+} WorkDeque;
+
+typedef struct WorkPool {
+    WorkDeque* deques;
+    int workers;
+    WorkPoolTaskFn fn;
+    void* ctx;
+} WorkPool;
+
+typedef struct WorkerArg {
+    WorkPool* pool;
+    int index;
+} WorkerArg;
+
+static uint64_t pack_range(uint32_t top, uint32_t bottom) {
+    return (uint64_t)top << 32 | bottom;
+}
+
+// Owner side: take the last task of our own range.
+static bool pop_bottom(WorkDeque* d, int* task) {
+    uint64_t r = atomic_load_explicit(&d->range, memory_order_acquire);
+    for (;;) {
+        uint32_t top = (uint32_t)(r >> 32);
+        uint32_t bottom = (uint32_t)r;
+        if (top >= bottom) return false;
+        if (atomic_compare_exchange_weak_explicit(&d->range, &r, pack_range(top, bottom - 1),
+            memory_order_acq_rel, memory_order_acquire)) {
+            *task = (int)(bottom - 1);
+            return true;
+        }
+    }
+}
+
+// Thief side: take the first task of a victim's range.
+static bool steal_top(WorkDeque* d, int* task) {
+    uint64_t r = atomic_load_explicit(&d->range, memory_order_acquire);
+    for (;;) {
+        uint32_t top = (uint32_t)(r >> 32);
+        uint32_t bottom = (uint32_t)r;
+        if (top >= bottom) return false;
+        if (atomic_compare_exchange_weak_explicit(&d->range, &r, pack_range(top + 1, bottom),
+            memory_order_acq_rel, memory_order_acquire)) {
+            *task = (int)top;
+            return true;
+        }
+    }
+}
+
+static void worker_main(void* p) {
+    WorkerArg* arg = (WorkerArg*)p;
+    WorkPool* pool = arg->pool;
+    int self = arg->index;
+    int task;
+
+    for (;;) {
+        if (pop_bottom(&pool->deques[self], &task)) {
+            pool->fn(pool->ctx, task, self);
+            continue;
+        }
+
+        // Own deque is empty: scan the others once, starting after ourselves.
+        bool stole = false;
+        for (int i = 1; i < pool->workers; ++i) {
+            int victim = (self + i) % pool->workers;
+            if (steal_top(&pool->deques[victim], &task)) {
+                pool->fn(pool->ctx, task, self);
+                stole = true;
+                break;
+            }
+        }
+        // No new work is ever added, so a full scan that finds nothing means we are done.
+        if (!stole) return;
+    }
+}
+
+int work_pool_thread_count(int threads, int task_count) {
+    if (threads <= 0) threads = host_cpu_count();
+    if (threads > task_count) threads = task_count;
+    return threads < 1 ? 1 : threads;
+}
+
+bool work_pool_run(int threads, int task_count, WorkPoolTaskFn fn, void* ctx) {
+    if (task_count <= 0) return true;
+    threads = work_pool_thread_count(threads, task_count);
+
+    WorkPool pool;
+    pool.fn = fn;
+    pool.ctx = ctx;
+    pool.workers = threads;
+    pool.deques = (WorkDeque*)calloc((size_t)threads, sizeof(WorkDeque));
+    WorkerArg* args = (WorkerArg*)calloc((size_t)threads, sizeof(WorkerArg));
+    HostThread* handles = (HostThread*)calloc((size_t)threads, sizeof(HostThread));
+    if (!pool.deques || !args || !handles) {
+        free(pool.deques);
+        free(args);
+        free(handles);
+        for (int i = 0; i < task_count; ++i) fn(ctx, i, 0);
+        return false;
+    }
+
+    for (int w = 0; w < threads; ++w) {
+        uint32_t begin = (uint32_t)((int64_t)task_count * w / threads);
+        uint32_t end = (uint32_t)((int64_t)task_count * (w + 1) / threads);
+        atomic_init(&pool.deques[w].range, pack_range(begin, end));
+        args[w].pool = &pool;
+        args[w].index = w;
+    }
+
+    int started = 0;
+    for (int w = 1; w < threads; ++w) {
+        if (!host_thread_start(&handles[w], worker_main, &args[w])) break;
+        started = w;
+    }
+
+    // Worker 0 runs here; it steals any slices whose threads failed to start.
+    worker_main(&args[0]);
+
+    for (int w = 1; w <= started; ++w) {
+        host_thread_join(&handles[w]);
+    }
+
+    free(pool.deques);
+    free(args);
+    free(handles);
+    return threads == 1 || started > 0;
+}
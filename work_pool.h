@@ -0,0 +1,20 @@
+// Work-stealing thread pool for running many independent tasks across all cores.
+
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <stdbool.h>
+
+// Task callback: runs task index `task` on worker `worker` (0 <= worker < threads).
+typedef void (*WorkPoolTaskFn)(void* ctx, int task, int worker);
+
+// Run tasks [0, task_count) on `threads` workers (0 = one per CPU).
+// Each worker starts with a contiguous slice and steals from the others when it runs dry.
+// The calling thread acts as worker 0. Blocks until every task has finished.
+// Returns false if no worker thread could be started (tasks then run on the caller).
+bool work_pool_run(int threads, int task_count, WorkPoolTaskFn fn, void* ctx);
+
+// Number of workers work_pool_run will use for a requested thread count.
+int work_pool_thread_count(int threads, int task_count);
+
+#endif // WORK_POOL_H